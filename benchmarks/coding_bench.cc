@@ -0,0 +1,253 @@
+/*
+ * 编码解码性能测试
+ * 用法: coding_bench [--benchmarks=varint32,varint32batch,...] [--num=N] [--value_bits=B]
+ *
+ * varint32bytewise -- 逐字节解码varint32, 作为对比的基准
+ * varint32         -- 使用GetVarint32Ptr逐个解码
+ * varint32batch    -- 使用DecodeVarint32Batch每次解码batch_size个
+ * varint64bytewise -- 逐字节解码varint64
+ * varint64         -- 使用GetVarint64Ptr逐个解码
+ * groupvarint32    -- 使用GetGroupVarint32Ptr每次解码batch_size个, 与varint32batch使用相同的值
+ *
+ * --value_bits=B  值在[0, 2^B)中随机选取位数后均匀分布, B越大varint越长; 为0时每个值的位数都随机
+ * --batch_size=S  varint32batch每次解码的数量
+*/
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "coding.h"
+#include "util/random.h"
+
+namespace kvstorage {
+
+namespace {
+
+// 逗号分隔的测试列表
+const char* FLAGS_benchmarks =
+    "varint32bytewise,varint32,varint32batch,varint64bytewise,varint64,groupvarint32";
+
+// 每轮解码的值的数量
+int FLAGS_num = 1000000;
+
+// 值的位数, 为0时随机
+int FLAGS_value_bits = 0;
+
+// varint32batch每次解码的数量
+int FLAGS_batch_size = 16;
+
+// 重复解码的轮数
+const int s_rounds = 20;
+
+uint64_t NowMicros() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void Report(const std::string& name, uint64_t start, uint64_t finish, int64_t ops, uint64_t checksum,
+            size_t bytes) {
+    double nanos = static_cast<double>(finish - start) * 1000.0;
+    std::fprintf(stdout, "%-16s : %8.3f ns/op; %5.2f bytes/value (checksum %llu)\n", name.c_str(), nanos / ops,
+                 static_cast<double>(bytes) / FLAGS_num, static_cast<unsigned long long>(checksum));
+    std::fflush(stdout);
+}
+
+uint64_t RandomValue(Random* rnd, int max_bits) {
+    const int bits = FLAGS_value_bits > 0 ? std::min(FLAGS_value_bits, max_bits) : 1 + rnd->uniform(max_bits);
+    const uint64_t v = (static_cast<uint64_t>(rnd->next()) << 32) | rnd->next();
+    return bits == 64 ? v : v & ((1ull << bits) - 1);
+}
+
+// 改进之前的实现, 每个字节判断一次最高位; 和coding.cc中的函数一样不内联, 保证对比公平
+__attribute__((noinline)) const char* BytewiseVarint32(const char* p, const char* limit, uint32_t* value) {
+    uint32_t result = 0;
+    for (uint32_t shift = 0; shift <= 28 && p < limit; shift += 7) {
+        uint32_t byte = *(reinterpret_cast<const uint8_t*>(p));
+        p++;
+        if (byte & 128) {
+            result |= ((byte & 127) << shift);
+        } else {
+            result |= (byte << shift);
+            *value = result;
+            return p;
+        }
+    }
+    return nullptr;
+}
+
+__attribute__((noinline)) const char* BytewiseVarint64(const char* p, const char* limit, uint64_t* value) {
+    uint64_t result = 0;
+    for (uint32_t shift = 0; shift <= 63 && p < limit; shift += 7) {
+        uint64_t byte = *(reinterpret_cast<const uint8_t*>(p));
+        p++;
+        if (byte & 128) {
+            result |= ((byte & 127) << shift);
+        } else {
+            result |= (byte << shift);
+            *value = result;
+            return p;
+        }
+    }
+    return nullptr;
+}
+
+void Varint32(const std::string& name, int mode) {
+    Random rnd(301);
+    std::string data;
+    for (int i = 0; i < FLAGS_num; i++) {
+        PutVarint32(&data, static_cast<uint32_t>(RandomValue(&rnd, 32)));
+    }
+    const char* const limit = data.data() + data.size();
+    std::vector<uint32_t> values(FLAGS_batch_size);
+    uint64_t checksum = 0;
+
+    uint64_t start = NowMicros();
+    for (int round = 0; round < s_rounds; round++) {
+        const char* p = data.data();
+        if (mode == 2) {
+            for (int i = 0; i < FLAGS_num; i += FLAGS_batch_size) {
+                const int n = std::min(FLAGS_batch_size, FLAGS_num - i);
+                p = DecodeVarint32Batch(p, limit, values.data(), n);
+                for (int j = 0; j < n; j++) {
+                    checksum += values[j];
+                }
+            }
+        } else {
+            for (int i = 0; i < FLAGS_num; i++) {
+                uint32_t v;
+                p = (mode == 0) ? BytewiseVarint32(p, limit, &v) : GetVarint32Ptr(p, limit, &v);
+                checksum += v;
+            }
+        }
+        if (p != limit) {
+            std::fprintf(stderr, "%s: decode error\n", name.c_str());
+            std::exit(1);
+        }
+    }
+    uint64_t finish = NowMicros();
+    Report(name, start, finish, static_cast<int64_t>(FLAGS_num) * s_rounds, checksum, data.size());
+}
+
+void GroupVarint32(const std::string& name) {
+    Random rnd(301);
+    std::vector<uint32_t> input(FLAGS_num);
+    for (int i = 0; i < FLAGS_num; i++) {
+        input[i] = static_cast<uint32_t>(RandomValue(&rnd, 32));
+    }
+    // 每batch_size个值单独编码, 和解码时的分组一致
+    std::string data;
+    for (int i = 0; i < FLAGS_num; i += FLAGS_batch_size) {
+        PutGroupVarint32(&data, input.data() + i, std::min(FLAGS_batch_size, FLAGS_num - i));
+    }
+    const char* const limit = data.data() + data.size();
+    std::vector<uint32_t> values(FLAGS_batch_size);
+    uint64_t checksum = 0;
+
+    uint64_t start = NowMicros();
+    for (int round = 0; round < s_rounds; round++) {
+        const char* p = data.data();
+        for (int i = 0; i < FLAGS_num; i += FLAGS_batch_size) {
+            const int n = std::min(FLAGS_batch_size, FLAGS_num - i);
+            p = GetGroupVarint32Ptr(p, limit, values.data(), n);
+            for (int j = 0; j < n; j++) {
+                checksum += values[j];
+            }
+        }
+        if (p != limit) {
+            std::fprintf(stderr, "%s: decode error\n", name.c_str());
+            std::exit(1);
+        }
+    }
+    uint64_t finish = NowMicros();
+    Report(name, start, finish, static_cast<int64_t>(FLAGS_num) * s_rounds, checksum, data.size());
+}
+
+void Varint64(const std::string& name, bool bytewise) {
+    Random rnd(301);
+    std::string data;
+    for (int i = 0; i < FLAGS_num; i++) {
+        PutVarint64(&data, RandomValue(&rnd, 64));
+    }
+    const char* const limit = data.data() + data.size();
+    uint64_t checksum = 0;
+
+    uint64_t start = NowMicros();
+    for (int round = 0; round < s_rounds; round++) {
+        const char* p = data.data();
+        for (int i = 0; i < FLAGS_num; i++) {
+            uint64_t v;
+            p = bytewise ? BytewiseVarint64(p, limit, &v) : GetVarint64Ptr(p, limit, &v);
+            checksum += v;
+        }
+        if (p != limit) {
+            std::fprintf(stderr, "%s: decode error\n", name.c_str());
+            std::exit(1);
+        }
+    }
+    uint64_t finish = NowMicros();
+    Report(name, start, finish, static_cast<int64_t>(FLAGS_num) * s_rounds, checksum, data.size());
+}
+
+void Run() {
+    std::fprintf(stdout, "Values:     %d\n", FLAGS_num);
+    std::fprintf(stdout, "ValueBits:  %d\n", FLAGS_value_bits);
+    std::fprintf(stdout, "------------------------------------------------\n");
+
+    const char* benchmarks = FLAGS_benchmarks;
+    while (benchmarks != nullptr) {
+        const char* sep = std::strchr(benchmarks, ',');
+        std::string name;
+        if (sep == nullptr) {
+            name = benchmarks;
+            benchmarks = nullptr;
+        } else {
+            name = std::string(benchmarks, sep - benchmarks);
+            benchmarks = sep + 1;
+        }
+
+        if (name == "varint32bytewise") {
+            Varint32(name, 0);
+        } else if (name == "varint32") {
+            Varint32(name, 1);
+        } else if (name == "varint32batch") {
+            Varint32(name, 2);
+        } else if (name == "varint64bytewise") {
+            Varint64(name, true);
+        } else if (name == "varint64") {
+            Varint64(name, false);
+        } else if (name == "groupvarint32") {
+            GroupVarint32(name);
+        } else if (!name.empty()) {
+            std::fprintf(stderr, "unknown benchmark '%s'\n", name.c_str());
+        }
+    }
+}
+
+}  // namespace
+
+}  // namespace kvstorage
+
+int main(int argc, char** argv) {
+    for (int i = 1; i < argc; i++) {
+        int n;
+        char junk;
+        if (std::strncmp(argv[i], "--benchmarks=", 13) == 0) {
+            kvstorage::FLAGS_benchmarks = argv[i] + 13;
+        } else if (std::sscanf(argv[i], "--num=%d%c", &n, &junk) == 1) {
+            kvstorage::FLAGS_num = n;
+        } else if (std::sscanf(argv[i], "--value_bits=%d%c", &n, &junk) == 1) {
+            kvstorage::FLAGS_value_bits = n;
+        } else if (std::sscanf(argv[i], "--batch_size=%d%c", &n, &junk) == 1 && n > 0) {
+            kvstorage::FLAGS_batch_size = n;
+        } else {
+            std::fprintf(stderr, "Invalid flag '%s'\n", argv[i]);
+            std::exit(1);
+        }
+    }
+    kvstorage::Run();
+    return 0;
+}
@@ -0,0 +1,131 @@
+/*
+ * crc32c性能测试
+ * 用法: crc32c_bench [--benchmarks=crc32c,crc32cportable] [--block_sizes=4096,32768] [--total_mb=N]
+ *
+ * crc32c         -- crc32c::Value(), 支持SSE4.2时使用硬件指令
+ * crc32cportable -- slicing-by-8的实现
+ *
+ * --block_sizes=S  逗号分隔的块大小, 每个块单独计算一次校验和, 相当于读取数据块时的校验
+ * --total_mb=N     每个测试处理的数据总量
+*/
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "crc32c.h"
+#include "util/random.h"
+
+namespace kvstorage {
+
+namespace {
+
+// 逗号分隔的测试列表
+const char* FLAGS_benchmarks = "crc32c,crc32cportable";
+
+// 逗号分隔的块大小
+const char* FLAGS_block_sizes = "4096,32768";
+
+// 每个测试处理的数据总量
+int FLAGS_total_mb = 1024;
+
+uint64_t NowMicros() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+std::vector<std::string> Split(const char* list) {
+    std::vector<std::string> result;
+    while (list != nullptr) {
+        const char* sep = std::strchr(list, ',');
+        if (sep == nullptr) {
+            result.emplace_back(list);
+            list = nullptr;
+        } else {
+            result.emplace_back(list, sep - list);
+            list = sep + 1;
+        }
+    }
+    return result;
+}
+
+void Crc32c(const std::string& name, size_t block_size, bool portable) {
+    // 数据大于L2缓存, 避免所有块都在L1中
+    const size_t buffer_size = 8 << 20;
+    Random rnd(301);
+    std::string data(buffer_size + block_size, '\0');
+    for (size_t i = 0; i < data.size(); i++) {
+        data[i] = static_cast<char>(rnd.next());
+    }
+    const uint64_t total = static_cast<uint64_t>(FLAGS_total_mb) << 20;
+
+    uint32_t checksum = 0;
+    uint64_t bytes = 0;
+    size_t pos = 0;
+    uint64_t start = NowMicros();
+    while (bytes < total) {
+        const char* block = data.data() + pos;
+        checksum += portable ? crc32c::ExtendPortable(0, block, block_size) : crc32c::Value(block, block_size);
+        bytes += block_size;
+        pos += block_size;
+        if (pos >= buffer_size) {
+            pos = 0;
+        }
+    }
+    uint64_t finish = NowMicros();
+
+    const double seconds = static_cast<double>(finish - start) / 1e6;
+    std::fprintf(stdout, "%-16s : %6zu bytes/block %8.3f micros/block %7.2f GB/s (checksum %08x)\n", name.c_str(),
+                 block_size, (finish - start) * static_cast<double>(block_size) / bytes, bytes / seconds / 1e9,
+                 checksum);
+    std::fflush(stdout);
+}
+
+void Run() {
+    std::fprintf(stdout, "CRC32C:     %s\n", crc32c::IsHardwareAccelerated() ? "sse4.2" : "slicing-by-8");
+    std::fprintf(stdout, "Data:       %d MB per benchmark\n", FLAGS_total_mb);
+    std::fprintf(stdout, "------------------------------------------------\n");
+
+    const std::vector<std::string> block_sizes = Split(FLAGS_block_sizes);
+    for (const std::string& name : Split(FLAGS_benchmarks)) {
+        for (const std::string& size : block_sizes) {
+            const size_t block_size = std::strtoul(size.c_str(), nullptr, 10);
+            if (block_size == 0) {
+                continue;
+            }
+            if (name == "crc32c") {
+                Crc32c(name, block_size, false);
+            } else if (name == "crc32cportable") {
+                Crc32c(name, block_size, true);
+            } else if (!name.empty()) {
+                std::fprintf(stderr, "unknown benchmark '%s'\n", name.c_str());
+                break;
+            }
+        }
+    }
+}
+
+}  // namespace
+
+}  // namespace kvstorage
+
+int main(int argc, char** argv) {
+    for (int i = 1; i < argc; i++) {
+        int n;
+        char junk;
+        if (std::strncmp(argv[i], "--benchmarks=", 13) == 0) {
+            kvstorage::FLAGS_benchmarks = argv[i] + 13;
+        } else if (std::strncmp(argv[i], "--block_sizes=", 14) == 0) {
+            kvstorage::FLAGS_block_sizes = argv[i] + 14;
+        } else if (std::sscanf(argv[i], "--total_mb=%d%c", &n, &junk) == 1 && n > 0) {
+            kvstorage::FLAGS_total_mb = n;
+        } else {
+            std::fprintf(stderr, "Invalid flag '%s'\n", argv[i]);
+            std::exit(1);
+        }
+    }
+    kvstorage::Run();
+    return 0;
+}
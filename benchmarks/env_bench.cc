@@ -0,0 +1,551 @@
+/*
+ * Env的文件读写性能测试
+ * 用法: env_bench [--benchmarks=write,seqread,randread] [--file_size_mb=N] [--block_size=B] [--env=posix|io_uring|mem]
+ *
+ * write     -- 通过WritableFile以block_size为单位顺序写入file_size_mb的文件, 最后sync
+ * seqread   -- 通过SequentialFile以block_size为单位顺序读取整个文件
+ * randread  -- 通过RandomAccessFile在随机位置读取reads次, 每次block_size字节
+ * multiread -- 和randread相同, 但每batch_size个请求通过一次multiRead()读取
+ * asyncread -- 和randread相同, 通过readAsync()提交, 最多同时有batch_size个未完成的请求
+ * readwhilecompacting -- 和randread相同, 同时在Low线程池中模拟compaction: 反复顺序读取compaction_file_mb的
+ *                        输入文件并写入输出文件; 报告前台读取的平均和p99延迟, compaction的吞吐,
+ *                        以及结束时compaction文件在page cache中占用的内存
+ *
+ * --env=E         posix为Env::defaultEnv(), io_uring为NewIoUringEnv(Env::defaultEnv()),
+ *                 mem为NewMemEnv(Env::defaultEnv()), 文件只在内存中, 用于排除磁盘和page cache的影响
+ * --batch_size=N  multiread每批的请求数量, asyncread的队列深度
+ * --mmap_limit=N  可以mmap的只读文件数量, 为0时randread使用pread
+ * --direct_io=0|1 compaction的读写是否使用O_DIRECT, 即Options::use_direct_io_for_flush_and_compaction
+ * --compaction_file_mb=N compaction输入文件的大小
+ * --compaction_rate_mb=N compaction读写的限速(MB/s), 为0时不限速
+ * --auto_tune_latency_us=N 不为0时限速器根据前台读取的延迟自动调整, compaction_rate_mb是上限
+ * --reads=R       randread的读取次数
+ * --db=DIR        测试文件所在的目录, 默认为Env::getTestDirectory()
+*/
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "env.h"
+#include "options.h"
+#include "rate_limiter.h"
+#include "util/aligned_buffer.h"
+#include "util/env_io_uring.h"
+#include "util/env_mem.h"
+#include "util/env_posix_test_helper.h"
+#include "util/random.h"
+
+namespace kvstorage {
+
+namespace {
+
+// 逗号分隔的测试列表
+const char* FLAGS_benchmarks = "write,seqread,randread";
+
+// 文件大小
+int FLAGS_file_size_mb = 256;
+
+// 每次读写的字节数
+int FLAGS_block_size = 4096;
+
+// randread的读取次数
+int FLAGS_reads = 200000;
+
+// 可以mmap的只读文件数量, 小于0时使用默认值
+int FLAGS_mmap_limit = -1;
+
+// 测试文件所在的目录
+const char* FLAGS_db = nullptr;
+
+// 使用的Env
+const char* FLAGS_env = "posix";
+
+// multiread每批的请求数量, asyncread的队列深度
+int FLAGS_batch_size = 32;
+
+// compaction的读写是否使用O_DIRECT
+bool FLAGS_direct_io = false;
+
+// compaction输入文件的大小
+int FLAGS_compaction_file_mb = 256;
+
+// compaction读写的限速(MB/s), 为0时不限速
+int FLAGS_compaction_rate_mb = 0;
+
+// 限速器自动调整的目标前台延迟, 为0时不自动调整
+int FLAGS_auto_tune_latency_us = 0;
+
+// compaction每次读写的字节数
+constexpr const size_t s_compaction_io_size = 1024 * 1024;
+
+// 文件在page cache中的页面占用的内存, 通过mincore统计
+double ResidentMB(const std::string& fname) {
+    int fd = ::open(fname.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return 0;
+    }
+    struct ::stat st;
+    double mb = 0;
+    if (::fstat(fd, &st) == 0 && st.st_size > 0) {
+        void* base = ::mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+        if (base != MAP_FAILED) {
+            const size_t page_size = ::sysconf(_SC_PAGESIZE);
+            std::vector<unsigned char> vec((st.st_size + page_size - 1) / page_size);
+            if (::mincore(base, st.st_size, vec.data()) == 0) {
+                size_t resident = 0;
+                for (unsigned char v : vec) {
+                    resident += v & 1;
+                }
+                mb = resident * page_size / 1048576.0;
+            }
+            ::munmap(base, st.st_size);
+        }
+    }
+    ::close(fd);
+    return mb;
+}
+
+Env* NewBenchmarkEnv() {
+    if (std::strcmp(FLAGS_env, "io_uring") == 0) {
+        if (!IoUringSupported()) {
+            std::fprintf(stderr, "io_uring is not supported, falling back to posix\n");
+        }
+        return NewIoUringEnv(Env::defaultEnv());
+    }
+    if (std::strcmp(FLAGS_env, "mem") == 0) {
+        return NewMemEnv(Env::defaultEnv());
+    }
+    if (std::strcmp(FLAGS_env, "posix") != 0) {
+        std::fprintf(stderr, "unknown env '%s'\n", FLAGS_env);
+        std::exit(1);
+    }
+    return Env::defaultEnv();
+}
+
+class Benchmark {
+public:
+    Benchmark() : env_(NewBenchmarkEnv()) {
+        std::string dir;
+        if (FLAGS_db != nullptr) {
+            dir = FLAGS_db;
+        } else {
+            env_->getTestDirectory(&dir);
+        }
+        fname_ = dir + "/env_bench.dat";
+    }
+
+    void run() {
+        std::fprintf(stdout, "File:       %s\n", fname_.c_str());
+        std::fprintf(stdout, "FileSize:   %d MB\n", FLAGS_file_size_mb);
+        std::fprintf(stdout, "BlockSize:  %d bytes\n", FLAGS_block_size);
+        std::fprintf(stdout, "MmapLimit:  %d\n", FLAGS_mmap_limit);
+        std::fprintf(stdout, "Env:        %s\n", FLAGS_env);
+        std::fprintf(stdout, "BatchSize:  %d\n", FLAGS_batch_size);
+        std::fprintf(stdout, "DirectIO:   %d\n", FLAGS_direct_io ? 1 : 0);
+        std::fprintf(stdout, "RateLimit:  %d MB/s%s\n", FLAGS_compaction_rate_mb,
+                     FLAGS_auto_tune_latency_us > 0 ? " (auto-tuned)" : "");
+        std::fprintf(stdout, "------------------------------------------------\n");
+
+        const char* benchmarks = FLAGS_benchmarks;
+        while (benchmarks != nullptr) {
+            const char* sep = std::strchr(benchmarks, ',');
+            std::string name;
+            if (sep == nullptr) {
+                name = benchmarks;
+                benchmarks = nullptr;
+            } else {
+                name = std::string(benchmarks, sep - benchmarks);
+                benchmarks = sep + 1;
+            }
+
+            if (name == "write") {
+                write(name);
+            } else if (name == "seqread") {
+                if (!env_->fileExists(fname_)) write("");
+                seqRead(name);
+            } else if (name == "randread") {
+                if (!env_->fileExists(fname_)) write("");
+                randRead(name);
+            } else if (name == "multiread") {
+                if (!env_->fileExists(fname_)) write("");
+                multiRead(name);
+            } else if (name == "asyncread") {
+                if (!env_->fileExists(fname_)) write("");
+                asyncRead(name);
+            } else if (name == "readwhilecompacting") {
+                if (!env_->fileExists(fname_)) write("");
+                readWhileCompacting(name);
+            } else if (!name.empty()) {
+                std::fprintf(stderr, "unknown benchmark '%s'\n", name.c_str());
+            }
+        }
+        env_->removeFile(fname_);
+    }
+
+private:
+    void report(const std::string& name, uint64_t start, uint64_t finish, int64_t ops, int64_t bytes) {
+        if (name.empty()) {
+            return;
+        }
+        const double micros = static_cast<double>(finish - start);
+        std::fprintf(stdout, "%-12s : %11.4f micros/op; %8.1f MB/s\n", name.c_str(), micros / ops,
+                     (bytes / 1048576.0) / (micros / 1e6));
+        std::fflush(stdout);
+    }
+
+    static void check(const Status& s) {
+        if (!s.ok()) {
+            std::fprintf(stderr, "%s\n", s.toString().c_str());
+            std::exit(1);
+        }
+    }
+
+    void write(const std::string& name) {
+        const int64_t total = static_cast<int64_t>(FLAGS_file_size_mb) * 1048576;
+        std::string block(FLAGS_block_size, 'x');
+        Random rnd(301);
+        for (char& c : block) {
+            c = static_cast<char>(' ' + rnd.uniform(95));
+        }
+        WritableFile* file;
+        check(env_->newWritableFile(fname_, &file));
+        int64_t ops = 0;
+        uint64_t start = env_->nowTimeMicros();
+        for (int64_t written = 0; written < total; written += block.size()) {
+            check(file->append(block));
+            ops++;
+        }
+        check(file->sync());
+        check(file->close());
+        uint64_t finish = env_->nowTimeMicros();
+        delete file;
+        report(name, start, finish, ops, ops * block.size());
+    }
+
+    void seqRead(const std::string& name) {
+        SequentialFile* file;
+        check(env_->newSequentialFile(fname_, &file));
+        std::string scratch(FLAGS_block_size, '\0');
+        int64_t ops = 0;
+        int64_t bytes = 0;
+        uint64_t start = env_->nowTimeMicros();
+        while (true) {
+            Slice result;
+            check(file->read(scratch.size(), &result, &scratch[0]));
+            if (result.empty()) {
+                break;
+            }
+            ops++;
+            bytes += result.size();
+        }
+        uint64_t finish = env_->nowTimeMicros();
+        delete file;
+        report(name, start, finish, ops, bytes);
+    }
+
+    void randRead(const std::string& name) {
+        uint64_t file_size;
+        check(env_->getFileSize(fname_, &file_size));
+        RandomAccessFile* file;
+        check(env_->newRandomAccessFile(fname_, &file));
+        std::string scratch(FLAGS_block_size, '\0');
+        const uint64_t blocks = file_size / FLAGS_block_size;
+        Random rnd(1000);
+        uint64_t checksum = 0;
+        uint64_t start = env_->nowTimeMicros();
+        for (int i = 0; i < FLAGS_reads; i++) {
+            Slice result;
+            check(file->read(rnd.uniform(blocks) * FLAGS_block_size, FLAGS_block_size, &result, &scratch[0]));
+            checksum += static_cast<uint8_t>(result[result.size() - 1]);  // 访问数据, mmap时才会触发缺页
+        }
+        uint64_t finish = env_->nowTimeMicros();
+        delete file;
+        report(name, start, finish, FLAGS_reads, static_cast<int64_t>(FLAGS_reads) * FLAGS_block_size);
+        if (checksum == 0) {
+            std::fprintf(stderr, "unexpected checksum\n");
+        }
+    }
+
+    void multiRead(const std::string& name) {
+        uint64_t file_size;
+        check(env_->getFileSize(fname_, &file_size));
+        RandomAccessFile* file;
+        check(env_->newRandomAccessFile(fname_, &file));
+        std::vector<std::string> scratch(FLAGS_batch_size, std::string(FLAGS_block_size, '\0'));
+        std::vector<RandomAccessFile::ReadRequest> reqs(FLAGS_batch_size);
+        const uint64_t blocks = file_size / FLAGS_block_size;
+        Random rnd(1000);
+        uint64_t checksum = 0;
+        uint64_t start = env_->nowTimeMicros();
+        for (int i = 0; i < FLAGS_reads; i += FLAGS_batch_size) {
+            const int n = std::min(FLAGS_batch_size, FLAGS_reads - i);
+            for (int j = 0; j < n; j++) {
+                reqs[j].offset = rnd.uniform(blocks) * FLAGS_block_size;
+                reqs[j].len = FLAGS_block_size;
+                reqs[j].scratch = &scratch[j][0];
+            }
+            check(file->multiRead(reqs.data(), n));
+            for (int j = 0; j < n; j++) {
+                checksum += static_cast<uint8_t>(reqs[j].result[reqs[j].result.size() - 1]);
+            }
+        }
+        uint64_t finish = env_->nowTimeMicros();
+        delete file;
+        report(name, start, finish, FLAGS_reads, static_cast<int64_t>(FLAGS_reads) * FLAGS_block_size);
+        if (checksum == 0) {
+            std::fprintf(stderr, "unexpected checksum\n");
+        }
+    }
+
+    // asyncread中每个未完成请求的状态, 完成后由回调放回空闲列表
+    struct AsyncState {
+        std::mutex mu;
+        std::condition_variable cv;
+        std::vector<RandomAccessFile::ReadRequest*> free_reqs;
+        uint64_t checksum = 0;
+        Status status;
+
+        static void Done(void* arg, RandomAccessFile::ReadRequest* req) {
+            AsyncState* state = static_cast<AsyncState*>(arg);
+            std::lock_guard<std::mutex> l(state->mu);
+            if (!req->status.ok()) {
+                state->status = req->status;
+            } else {
+                state->checksum += static_cast<uint8_t>(req->result[req->result.size() - 1]);
+            }
+            state->free_reqs.push_back(req);
+            state->cv.notify_one();
+        }
+    };
+
+    void asyncRead(const std::string& name) {
+        uint64_t file_size;
+        check(env_->getFileSize(fname_, &file_size));
+        RandomAccessFile* file;
+        check(env_->newRandomAccessFile(fname_, &file));
+        std::vector<std::string> scratch(FLAGS_batch_size, std::string(FLAGS_block_size, '\0'));
+        std::vector<RandomAccessFile::ReadRequest> reqs(FLAGS_batch_size);
+        AsyncState state;
+        for (int j = 0; j < FLAGS_batch_size; j++) {
+            reqs[j].scratch = &scratch[j][0];
+            state.free_reqs.push_back(&reqs[j]);
+        }
+        const uint64_t blocks = file_size / FLAGS_block_size;
+        Random rnd(1000);
+        uint64_t start = env_->nowTimeMicros();
+        for (int i = 0; i < FLAGS_reads; i++) {
+            RandomAccessFile::ReadRequest* req;
+            {
+                std::unique_lock<std::mutex> l(state.mu);
+                state.cv.wait(l, [&state] { return !state.free_reqs.empty(); });
+                req = state.free_reqs.back();
+                state.free_reqs.pop_back();
+            }
+            req->offset = rnd.uniform(blocks) * FLAGS_block_size;
+            req->len = FLAGS_block_size;
+            file->readAsync(req, &AsyncState::Done, &state);
+        }
+        {
+            std::unique_lock<std::mutex> l(state.mu);
+            state.cv.wait(l, [&state] { return state.free_reqs.size() == static_cast<size_t>(FLAGS_batch_size); });
+        }
+        uint64_t finish = env_->nowTimeMicros();
+        delete file;
+        check(state.status);
+        report(name, start, finish, FLAGS_reads, static_cast<int64_t>(FLAGS_reads) * FLAGS_block_size);
+        if (state.checksum == 0) {
+            std::fprintf(stderr, "unexpected checksum\n");
+        }
+    }
+
+    // 后台compaction的状态, stop之后compaction在当前的读写完成后退出
+    struct CompactionState {
+        Env* env;
+        EnvOptions env_options;
+        std::string input;
+        std::string output;
+        std::atomic<bool> stop{false};
+        std::mutex mu;
+        std::condition_variable cv;
+        bool done = false;
+        int64_t bytes = 0;  // 读取和写入的总字节数, 由mu保护
+        Status status;
+
+        static void Run(void* arg) {
+            CompactionState* state = static_cast<CompactionState*>(arg);
+            Status s;
+            int64_t bytes = 0;
+            AlignedBuffer scratch(4096, s_compaction_io_size);
+            while (s.ok() && !state->stop.load(std::memory_order_relaxed)) {
+                RandomAccessFile* in;
+                WritableFile* out;
+                s = state->env->newRandomAccessFile(state->input, state->env_options, &in);
+                if (!s.ok()) {
+                    break;
+                }
+                s = state->env->newWritableFile(state->output, state->env_options, &out);
+                if (!s.ok()) {
+                    delete in;
+                    break;
+                }
+                uint64_t offset = 0;
+                while (s.ok() && !state->stop.load(std::memory_order_relaxed)) {
+                    Slice result;
+                    s = in->read(offset, s_compaction_io_size, &result, scratch.data());
+                    if (!s.ok() || result.empty()) {
+                        break;
+                    }
+                    s = out->append(result);
+                    offset += result.size();
+                    bytes += 2 * result.size();
+                }
+                if (s.ok()) {
+                    s = out->close();
+                }
+                delete out;
+                delete in;
+            }
+            std::lock_guard<std::mutex> l(state->mu);
+            state->status = s;
+            state->bytes = bytes;
+            state->done = true;
+            state->cv.notify_all();
+        }
+    };
+
+    void readWhileCompacting(const std::string& name) {
+        std::unique_ptr<RateLimiter> rate_limiter;
+        Options options;
+        options.use_direct_io_for_flush_and_compaction = FLAGS_direct_io;
+        if (FLAGS_compaction_rate_mb > 0) {
+            rate_limiter.reset(NewGenericRateLimiter(static_cast<int64_t>(FLAGS_compaction_rate_mb) << 20,
+                                                     100 * 1000, 10, FLAGS_auto_tune_latency_us));
+        }
+        CompactionState state;
+        state.env = env_;
+        state.env_options = EnvOptionsForFlushAndCompaction(options);
+        state.input = fname_ + ".compaction_in";
+        state.output = fname_ + ".compaction_out";
+
+        // 准备compaction的输入文件, 不限速
+        {
+            WritableFile* file;
+            check(env_->newWritableFile(state.input, state.env_options, &file));
+            std::string block(s_compaction_io_size, 'c');
+            for (int i = 0; i < FLAGS_compaction_file_mb; i++) {
+                check(file->append(block));
+            }
+            check(file->close());
+            delete file;
+        }
+        options.rate_limiter = rate_limiter.get();
+        state.env_options = EnvOptionsForFlushAndCompaction(options);
+
+        uint64_t file_size;
+        check(env_->getFileSize(fname_, &file_size));
+        RandomAccessFile* file;
+        check(env_->newRandomAccessFile(fname_, &file));
+        std::string scratch(FLAGS_block_size, '\0');
+        const uint64_t blocks = file_size / FLAGS_block_size;
+        Random rnd(1000);
+        std::vector<uint64_t> latencies(FLAGS_reads);
+        uint64_t checksum = 0;
+
+        env_->schedule(&CompactionState::Run, &state, Env::Priority::Low);
+        uint64_t start = env_->nowTimeMicros();
+        for (int i = 0; i < FLAGS_reads; i++) {
+            Slice result;
+            uint64_t op_start = env_->nowTimeMicros();
+            check(file->read(rnd.uniform(blocks) * FLAGS_block_size, FLAGS_block_size, &result, &scratch[0]));
+            checksum += static_cast<uint8_t>(result[result.size() - 1]);
+            latencies[i] = env_->nowTimeMicros() - op_start;
+            if (rate_limiter != nullptr) {
+                rate_limiter->recordForegroundLatency(latencies[i]);
+            }
+        }
+        uint64_t finish = env_->nowTimeMicros();
+        state.stop.store(true, std::memory_order_relaxed);
+        {
+            std::unique_lock<std::mutex> l(state.mu);
+            state.cv.wait(l, [&state] { return state.done; });
+        }
+        delete file;
+        check(state.status);
+
+        const double cached_mb = ResidentMB(state.input) + ResidentMB(state.output);
+        env_->removeFile(state.input);
+        env_->removeFile(state.output);
+
+        std::sort(latencies.begin(), latencies.end());
+        const double micros = static_cast<double>(finish - start);
+        std::fprintf(stdout, "%-12s : %11.4f micros/op; p99 %llu micros; compaction %.1f MB/s; page cache %.1f MB\n",
+                     name.c_str(), micros / FLAGS_reads,
+                     static_cast<unsigned long long>(latencies[latencies.size() * 99 / 100]),
+                     (state.bytes / 1048576.0) / (micros / 1e6), cached_mb);
+        std::fflush(stdout);
+        if (checksum == 0) {
+            std::fprintf(stderr, "unexpected checksum\n");
+        }
+    }
+
+    Env* const env_;
+    std::string fname_;
+};
+
+}  // namespace
+
+}  // namespace kvstorage
+
+int main(int argc, char** argv) {
+    for (int i = 1; i < argc; i++) {
+        int n;
+        char junk;
+        if (std::strncmp(argv[i], "--benchmarks=", 13) == 0) {
+            kvstorage::FLAGS_benchmarks = argv[i] + 13;
+        } else if (std::strncmp(argv[i], "--env=", 6) == 0) {
+            kvstorage::FLAGS_env = argv[i] + 6;
+        } else if (std::sscanf(argv[i], "--batch_size=%d%c", &n, &junk) == 1 && n > 0) {
+            kvstorage::FLAGS_batch_size = n;
+        } else if (std::strncmp(argv[i], "--db=", 5) == 0) {
+            kvstorage::FLAGS_db = argv[i] + 5;
+        } else if (std::sscanf(argv[i], "--file_size_mb=%d%c", &n, &junk) == 1 && n > 0) {
+            kvstorage::FLAGS_file_size_mb = n;
+        } else if (std::sscanf(argv[i], "--block_size=%d%c", &n, &junk) == 1 && n > 0) {
+            kvstorage::FLAGS_block_size = n;
+        } else if (std::sscanf(argv[i], "--reads=%d%c", &n, &junk) == 1) {
+            kvstorage::FLAGS_reads = n;
+        } else if (std::sscanf(argv[i], "--direct_io=%d%c", &n, &junk) == 1 && (n == 0 || n == 1)) {
+            kvstorage::FLAGS_direct_io = n;
+        } else if (std::sscanf(argv[i], "--compaction_rate_mb=%d%c", &n, &junk) == 1 && n >= 0) {
+            kvstorage::FLAGS_compaction_rate_mb = n;
+        } else if (std::sscanf(argv[i], "--auto_tune_latency_us=%d%c", &n, &junk) == 1 && n >= 0) {
+            kvstorage::FLAGS_auto_tune_latency_us = n;
+        } else if (std::sscanf(argv[i], "--compaction_file_mb=%d%c", &n, &junk) == 1 && n > 0) {
+            kvstorage::FLAGS_compaction_file_mb = n;
+        } else if (std::sscanf(argv[i], "--mmap_limit=%d%c", &n, &junk) == 1) {
+            kvstorage::FLAGS_mmap_limit = n;
+        } else {
+            std::fprintf(stderr, "Invalid flag '%s'\n", argv[i]);
+            std::exit(1);
+        }
+    }
+    // 必须在第一次调用Env::defaultEnv()之前设置
+    if (kvstorage::FLAGS_mmap_limit >= 0) {
+        kvstorage::EnvPosixTestHelper::setReadOnlyMMapLimit(kvstorage::FLAGS_mmap_limit);
+    }
+    kvstorage::Benchmark benchmark;
+    benchmark.run();
+    return 0;
+}
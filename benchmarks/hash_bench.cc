@@ -0,0 +1,128 @@
+/*
+ * 哈希函数性能测试
+ * 用法: hash_bench [--benchmarks=hash32,hash64,hash128] [--key_sizes=16,64,1024] [--num=N]
+ *
+ * hash32  -- Hash(), 32位murmur变种, 每次处理4字节
+ * hash64  -- Hash64()
+ * hash128 -- Hash128()
+ *
+ * --key_sizes=S  逗号分隔的键长度
+ * --num=N        每个测试计算哈希的次数
+*/
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "hash.h"
+#include "util/random.h"
+
+namespace kvstorage {
+
+namespace {
+
+// 逗号分隔的测试列表
+const char* FLAGS_benchmarks = "hash32,hash64,hash128";
+
+// 逗号分隔的键长度
+const char* FLAGS_key_sizes = "16,64,1024";
+
+// 每个测试计算哈希的次数
+int FLAGS_num = 10000000;
+
+uint64_t NowMicros() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+std::vector<std::string> Split(const char* list) {
+    std::vector<std::string> result;
+    while (list != nullptr) {
+        const char* sep = std::strchr(list, ',');
+        if (sep == nullptr) {
+            result.emplace_back(list);
+            list = nullptr;
+        } else {
+            result.emplace_back(list, sep - list);
+            list = sep + 1;
+        }
+    }
+    return result;
+}
+
+void HashKeys(const std::string& name, size_t key_size) {
+    // 1024个不同的键轮流计算, 都在L1/L2缓存中
+    const size_t keys = 1024;
+    Random rnd(301);
+    std::string data(keys * key_size, '\0');
+    for (size_t i = 0; i < data.size(); i++) {
+        data[i] = static_cast<char>(rnd.next());
+    }
+
+    const int mode = (name == "hash32") ? 0 : (name == "hash64") ? 1 : 2;
+    uint64_t checksum = 0;
+    uint64_t start = NowMicros();
+    for (int i = 0; i < FLAGS_num; i++) {
+        const char* key = data.data() + (i % keys) * key_size;
+        if (mode == 0) {
+            checksum += Hash(key, key_size, 0xbc9f1d34);
+        } else if (mode == 1) {
+            checksum += Hash64(key, key_size);
+        } else {
+            const Hash128Value v = Hash128(key, key_size);
+            checksum += v.low ^ v.high;
+        }
+    }
+    uint64_t finish = NowMicros();
+
+    const double nanos = static_cast<double>(finish - start) * 1000.0 / FLAGS_num;
+    std::fprintf(stdout, "%-8s : %5zu bytes/key %8.2f ns/op %7.2f GB/s (checksum %016llx)\n", name.c_str(), key_size,
+                 nanos, key_size / nanos, static_cast<unsigned long long>(checksum));
+    std::fflush(stdout);
+}
+
+void Run() {
+    std::fprintf(stdout, "Hashes:     %d per benchmark\n", FLAGS_num);
+    std::fprintf(stdout, "------------------------------------------------\n");
+
+    const std::vector<std::string> key_sizes = Split(FLAGS_key_sizes);
+    for (const std::string& name : Split(FLAGS_benchmarks)) {
+        if (name != "hash32" && name != "hash64" && name != "hash128") {
+            if (!name.empty()) {
+                std::fprintf(stderr, "unknown benchmark '%s'\n", name.c_str());
+            }
+            continue;
+        }
+        for (const std::string& size : key_sizes) {
+            const size_t key_size = std::strtoul(size.c_str(), nullptr, 10);
+            if (key_size > 0) {
+                HashKeys(name, key_size);
+            }
+        }
+    }
+}
+
+}  // namespace
+
+}  // namespace kvstorage
+
+int main(int argc, char** argv) {
+    for (int i = 1; i < argc; i++) {
+        int n;
+        char junk;
+        if (std::strncmp(argv[i], "--benchmarks=", 13) == 0) {
+            kvstorage::FLAGS_benchmarks = argv[i] + 13;
+        } else if (std::strncmp(argv[i], "--key_sizes=", 12) == 0) {
+            kvstorage::FLAGS_key_sizes = argv[i] + 12;
+        } else if (std::sscanf(argv[i], "--num=%d%c", &n, &junk) == 1 && n > 0) {
+            kvstorage::FLAGS_num = n;
+        } else {
+            std::fprintf(stderr, "Invalid flag '%s'\n", argv[i]);
+            std::exit(1);
+        }
+    }
+    kvstorage::Run();
+    return 0;
+}
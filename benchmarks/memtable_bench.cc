@@ -0,0 +1,278 @@
+/*
+ * memtable性能测试
+ * 用法: memtable_bench [--benchmarks=fillrandom,readrandom,...] [--num=N] [--rep=skiplist|hash|art]
+ *
+ * fillrandom -- 按随机顺序写入N个键
+ * readrandom -- 写入N个键后, 通过get()随机查找reads次, 约一半的键存在, 值复制到std::string中
+ * readpinned -- 和readrandom相同, 但值通过PinnableSlice直接引用arena, 不复制
+ * iterate    -- 写入N个键后, 按顺序遍历所有记录, 相当于落盘时的访问方式
+ *
+ * --rep=R               memtable的索引结构, skiplist, hash或art
+ * --keys=K              键的格式, number为16位数字, path为tenant/table/row/col形式的路径, 有很长的公共前缀,
+ *                       uint64为8字节大端序整数
+ * --comparator=C        用户比较器, bytewise为BytewiseComparator(), 比较内联;
+ *                       virtual为转发到BytewiseComparator()的另一个比较器, 顺序相同, 但每次比较都是虚函数调用;
+ *                       uint64为Uint64KeyComparator(), 要求--keys=uint64
+ * --hash_bucket_count=B rep为hash时桶的数量
+ * --value_size=S        值的长度
+ * --reads=R             readrandom的查找次数, 默认等于num
+*/
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "coding.h"
+#include "comparator.h"
+#include "db_format.h"
+#include "iterator.h"
+#include "memtable.h"
+#include "options.h"
+#include "util/random.h"
+
+namespace kvstorage {
+
+namespace {
+
+// 逗号分隔的测试列表
+const char* FLAGS_benchmarks = "fillrandom,readrandom,readpinned,iterate";
+
+// 写入的键的数量
+int FLAGS_num = 1000000;
+
+// 查找的次数, 小于0时等于FLAGS_num
+int FLAGS_reads = -1;
+
+// 值的长度
+int FLAGS_value_size = 32;
+
+// memtable的索引结构
+const char* FLAGS_rep = "skiplist";
+
+// 键的格式
+const char* FLAGS_keys = "number";
+
+// rep为hash时桶的数量
+int FLAGS_hash_bucket_count = 1 << 20;
+
+// 用户比较器
+const char* FLAGS_comparator = "bytewise";
+
+uint64_t NowMicros() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void Report(const std::string& name, uint64_t start, uint64_t finish, int ops, const std::string& msg) {
+    double micros = static_cast<double>(finish - start);
+    std::fprintf(stdout, "%-12s : %11.4f micros/op; %s\n", name.c_str(), micros / ops, msg.c_str());
+    std::fflush(stdout);
+}
+
+// 编号为偶数的键会被写入
+std::string MakeKey(uint64_t i) {
+    char buf[100];
+    if (std::strcmp(FLAGS_keys, "uint64") == 0) {
+        EncodeBigEndian64(buf, i);
+        return std::string(buf, 8);
+    }
+    if (std::strcmp(FLAGS_keys, "path") == 0) {
+        // 同一个tenant和table下有大量的行, 每行有若干列
+        std::snprintf(buf, sizeof(buf), "tenant-%04llu/table-%06llu/row-%012llu/col-%02llu",
+                      static_cast<unsigned long long>(i % 4), static_cast<unsigned long long>((i / 4) % 16),
+                      static_cast<unsigned long long>(i / 64), static_cast<unsigned long long>(i % 8));
+    } else {
+        std::snprintf(buf, sizeof(buf), "%016llu", static_cast<unsigned long long>(i));
+    }
+    return buf;
+}
+
+// 顺序与BytewiseComparator()相同, 但memtable无法识别, 只能通过虚函数比较
+class ForwardingComparator : public Comparator {
+public:
+    const char* name() const override { return "memtable_bench.ForwardingComparator"; }
+    int compare(const Slice& a, const Slice& b) const override { return BytewiseComparator()->compare(a, b); }
+    void findShortestSeparator(std::string* start, const Slice& limit) const override {
+        BytewiseComparator()->findShortestSeparator(start, limit);
+    }
+    void findShortSuccessor(std::string* key) const override { BytewiseComparator()->findShortSuccessor(key); }
+};
+
+const Comparator* UserComparator() {
+    static ForwardingComparator forwarding;
+    if (std::strcmp(FLAGS_comparator, "virtual") == 0) {
+        return &forwarding;
+    }
+    if (std::strcmp(FLAGS_comparator, "uint64") == 0) {
+        return Uint64KeyComparator();
+    }
+    return BytewiseComparator();
+}
+
+class Benchmark {
+public:
+    Benchmark() : cmp_(UserComparator()), mem_(nullptr) {}
+    ~Benchmark() {
+        if (mem_ != nullptr) {
+            mem_->unref();
+        }
+    }
+
+    void run() {
+        std::fprintf(stdout, "Keys:       %d\n", FLAGS_num);
+        std::fprintf(stdout, "Values:     %d bytes\n", FLAGS_value_size);
+        std::fprintf(stdout, "MemTable:   %s\n", FLAGS_rep);
+        std::fprintf(stdout, "KeyFormat:  %s\n", FLAGS_keys);
+        std::fprintf(stdout, "Comparator: %s\n", FLAGS_comparator);
+        std::fprintf(stdout, "------------------------------------------------\n");
+
+        const char* benchmarks = FLAGS_benchmarks;
+        while (benchmarks != nullptr) {
+            const char* sep = std::strchr(benchmarks, ',');
+            std::string name;
+            if (sep == nullptr) {
+                name = benchmarks;
+                benchmarks = nullptr;
+            } else {
+                name = std::string(benchmarks, sep - benchmarks);
+                benchmarks = sep + 1;
+            }
+
+            if (name == "fillrandom") {
+                fillRandom(name);
+            } else if (name == "readrandom") {
+                if (mem_ == nullptr) fill();
+                readRandom(name, false);
+            } else if (name == "readpinned") {
+                if (mem_ == nullptr) fill();
+                readRandom(name, true);
+            } else if (name == "iterate") {
+                if (mem_ == nullptr) fill();
+                iterate(name);
+            } else if (!name.empty()) {
+                std::fprintf(stderr, "unknown benchmark '%s'\n", name.c_str());
+            }
+        }
+    }
+
+private:
+    void newMemTable() {
+        if (mem_ != nullptr) {
+            mem_->unref();
+        }
+        Options options;
+        options.write_buffer_size = 64 * 1024 * 1024;
+        if (std::strcmp(FLAGS_rep, "hash") == 0) {
+            options.memtable_rep = MemTableRepType::HashLinkList;
+            options.memtable_hash_bucket_count = FLAGS_hash_bucket_count;
+        } else if (std::strcmp(FLAGS_rep, "art") == 0) {
+            options.memtable_rep = MemTableRepType::AdaptiveRadixTree;
+        }
+        mem_ = new MemTable(cmp_, options);
+        mem_->ref();
+    }
+
+    // 按随机顺序写入所有偶数编号的键
+    void fill() {
+        newMemTable();
+        std::vector<uint64_t> order(FLAGS_num);
+        for (int i = 0; i < FLAGS_num; i++) {
+            order[i] = static_cast<uint64_t>(i) * 2;
+        }
+        Random rnd(301);
+        for (int i = FLAGS_num - 1; i > 0; i--) {
+            std::swap(order[i], order[rnd.uniform(i + 1)]);
+        }
+        std::string value(FLAGS_value_size, 'v');
+        for (int i = 0; i < FLAGS_num; i++) {
+            mem_->add(i + 1, ValueType::TypeValue, MakeKey(order[i]), value);
+        }
+    }
+
+    void fillRandom(const std::string& name) {
+        uint64_t start = NowMicros();
+        fill();
+        uint64_t finish = NowMicros();
+        char msg[100];
+        std::snprintf(msg, sizeof(msg), "(memtable %.1f MB)", mem_->approximateMemoryUsage() / 1048576.0);
+        Report(name, start, finish, FLAGS_num, msg);
+    }
+
+    void readRandom(const std::string& name, bool pinned) {
+        const int reads = FLAGS_reads < 0 ? FLAGS_num : FLAGS_reads;
+        Random rnd(1000);
+        std::string value;
+        PinnableSlice pinned_value;
+        int found = 0;
+        uint64_t start = NowMicros();
+        for (int i = 0; i < reads; i++) {
+            LookupKey lkey(MakeKey(rnd.uniform(2 * FLAGS_num)), s_max_sequence_number);
+            Status s;
+            if (pinned) {
+                pinned_value.reset();
+                if (mem_->get(lkey, &pinned_value, &s)) {
+                    found++;
+                }
+            } else if (mem_->get(lkey, &value, &s)) {
+                found++;
+            }
+        }
+        uint64_t finish = NowMicros();
+        char msg[100];
+        std::snprintf(msg, sizeof(msg), "(%d of %d found)", found, reads);
+        Report(name, start, finish, reads, msg);
+    }
+
+    void iterate(const std::string& name) {
+        Iterator* iter = mem_->newIterator();
+        int n = 0;
+        uint64_t start = NowMicros();
+        for (iter->seekToFirst(); iter->valid(); iter->next()) {
+            n++;
+        }
+        uint64_t finish = NowMicros();
+        delete iter;
+        char msg[100];
+        std::snprintf(msg, sizeof(msg), "(%d entries)", n);
+        Report(name, start, finish, n, msg);
+    }
+
+    InternalKeyComparator cmp_;
+    MemTable* mem_;
+};
+
+}  // namespace
+
+}  // namespace kvstorage
+
+int main(int argc, char** argv) {
+    for (int i = 1; i < argc; i++) {
+        int n;
+        char junk;
+        if (std::strncmp(argv[i], "--benchmarks=", 13) == 0) {
+            kvstorage::FLAGS_benchmarks = argv[i] + 13;
+        } else if (std::strncmp(argv[i], "--rep=", 6) == 0) {
+            kvstorage::FLAGS_rep = argv[i] + 6;
+        } else if (std::strncmp(argv[i], "--keys=", 7) == 0) {
+            kvstorage::FLAGS_keys = argv[i] + 7;
+        } else if (std::strncmp(argv[i], "--comparator=", 13) == 0) {
+            kvstorage::FLAGS_comparator = argv[i] + 13;
+        } else if (std::sscanf(argv[i], "--num=%d%c", &n, &junk) == 1) {
+            kvstorage::FLAGS_num = n;
+        } else if (std::sscanf(argv[i], "--reads=%d%c", &n, &junk) == 1) {
+            kvstorage::FLAGS_reads = n;
+        } else if (std::sscanf(argv[i], "--value_size=%d%c", &n, &junk) == 1) {
+            kvstorage::FLAGS_value_size = n;
+        } else if (std::sscanf(argv[i], "--hash_bucket_count=%d%c", &n, &junk) == 1) {
+            kvstorage::FLAGS_hash_bucket_count = n;
+        } else {
+            std::fprintf(stderr, "Invalid flag '%s'\n", argv[i]);
+            std::exit(1);
+        }
+    }
+    kvstorage::Benchmark benchmark;
+    benchmark.run();
+    return 0;
+}
@@ -0,0 +1,332 @@
+/*
+ * 跳表性能测试
+ * 用法: skiplist_bench [--benchmarks=fillseq,fillseqhint,...] [--num=N]
+ *
+ * fillseq        -- 使用insert()按顺序插入N个键
+ * fillseqhint    -- 使用insertWithHint()按顺序插入N个键
+ * fillrandom     -- 使用insert()按随机顺序插入N个键
+ * fillrandomhint -- 使用insertWithHint()按随机顺序插入N个键
+ * readrandom     -- 随机插入N个键后, 随机查找reads次, arena使用new[]分配的内存块
+ * readrandomhuge -- 同readrandom, arena使用mmap分配的大页内存块
+ * readrandomstr  -- 键为arena中带长度前缀的16字节字符串, 随机查找reads次
+ * readrandomprefix -- 同readrandomstr, 结点缓存键的8字节前缀
+ * readrandombatch  -- 同readrandomprefix, 每batch_size个键通过seekBatch()一起查找
+ * readseq        -- 随机插入N个键后, 从头到尾遍历
+ * readreverse    -- 随机插入N个键后, 从尾到头遍历, 每次prev()从head_查找前驱
+ * readreverselink -- 同readreverse, 跳表保存后向指针
+ *
+ * 编译时定义KVSTORAGE_SKIPLIST_PREFETCH=0可以关闭查找和遍历时的预取, 用于对比
+ *
+ * --arena_block_size=B  arena的内存块大小
+ * --reads=R             readrandom类测试的查找次数, 默认等于num
+ * --batch_size=S        readrandombatch每次查找的键的数量
+*/
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "skiplist.h"
+#include "slice.h"
+#include "util/arena.h"
+#include "util/random.h"
+
+namespace kvstorage {
+
+namespace {
+
+// 逗号分隔的测试列表
+const char* FLAGS_benchmarks =
+    "fillseq,fillseqhint,fillrandom,fillrandomhint,readrandom,readrandomhuge,readrandomstr,readrandomprefix,"
+    "readrandombatch,readseq,readreverse,readreverselink";
+
+// 插入的键的数量
+int FLAGS_num = 1000000;
+
+// 查找的次数, 小于0时等于FLAGS_num
+int FLAGS_reads = -1;
+
+// arena的内存块大小
+int FLAGS_arena_block_size = Arena::s_default_block_size;
+
+// readrandombatch每次查找的键的数量
+int FLAGS_batch_size = 16;
+
+using Key = uint64_t;
+
+struct KeyComparator {
+    int operator()(const Key& a, const Key& b) const {
+        if (a < b) {
+            return -1;
+        } else if (a > b) {
+            return +1;
+        } else {
+            return 0;
+        }
+    }
+};
+
+using List = SkipList<Key, KeyComparator>;
+
+// 字符串键, 格式为1字节长度 + 键, 和memtable一样保存在arena中, 比较时需要访问键指向的内存
+struct StringComparator {
+    int operator()(const char* a, const char* b) const {
+        return Slice(a + 1, static_cast<uint8_t>(a[0])).compare(Slice(b + 1, static_cast<uint8_t>(b[0])));
+    }
+};
+
+// 在StringComparator的基础上提供8字节的大端序前缀, 跳表结点缓存该前缀
+struct PrefixStringComparator : public StringComparator {
+    uint64_t keyPrefix(const char* k) const {
+        const uint8_t* u = reinterpret_cast<const uint8_t*>(k + 1);
+        uint64_t prefix = 0;
+        for (int i = 0; i < 8; i++) {
+            prefix = (prefix << 8) | u[i];  // 键固定为16字节
+        }
+        return prefix;
+    }
+};
+
+// 将i映射为16个十六进制字符, 不同的i得到不同的键, 且键的前8字节分布均匀
+void EncodeStringKey(uint64_t i, char* dst) {
+    static const char s_digits[] = "0123456789abcdef";
+    uint64_t v = i * 0x9e3779b97f4a7c15ull;
+    dst[0] = 16;
+    for (int j = 16; j >= 1; j--) {
+        dst[j] = s_digits[v & 0xf];
+        v >>= 4;
+    }
+}
+
+uint64_t NowMicros() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void Report(const std::string& name, uint64_t start, uint64_t finish, int ops, const std::string& msg) {
+    double micros = static_cast<double>(finish - start);
+    std::fprintf(stdout, "%-16s : %11.4f micros/op; %s\n", name.c_str(), micros / ops, msg.c_str());
+    std::fflush(stdout);
+}
+
+// 生成N个互不相同的键, sequential为false时随机打乱顺序
+std::vector<Key> GenerateKeys(int n, bool sequential) {
+    std::vector<Key> keys(n);
+    for (int i = 0; i < n; i++) {
+        keys[i] = static_cast<Key>(i) * 2 + 1;
+    }
+    if (!sequential) {
+        Random rnd(301);
+        for (int i = n - 1; i > 0; i--) {
+            std::swap(keys[i], keys[rnd.uniform(i + 1)]);
+        }
+    }
+    return keys;
+}
+
+void Fill(const std::string& name, bool sequential, bool use_hint) {
+    std::vector<Key> keys = GenerateKeys(FLAGS_num, sequential);
+    Arena arena;
+    List list(KeyComparator(), &arena);
+
+    uint64_t start = NowMicros();
+    if (use_hint) {
+        for (Key k : keys) {
+            list.insertWithHint(k);
+        }
+    } else {
+        for (Key k : keys) {
+            list.insert(k);
+        }
+    }
+    uint64_t finish = NowMicros();
+
+    char msg[100];
+    if (use_hint) {
+        std::snprintf(msg, sizeof(msg), "hint hit rate %.2f%%", list.hintHitRate() * 100.0);
+    } else {
+        msg[0] = '\0';
+    }
+    Report(name, start, finish, FLAGS_num, msg);
+}
+
+void ReadRandom(const std::string& name, bool use_huge_page) {
+    std::vector<Key> keys = GenerateKeys(FLAGS_num, false);
+    Arena arena(FLAGS_arena_block_size, use_huge_page);
+    List list(KeyComparator(), &arena);
+    for (Key k : keys) {
+        list.insert(k);
+    }
+
+    const int reads = FLAGS_reads < 0 ? FLAGS_num : FLAGS_reads;
+    Random rnd(1000);
+    int found = 0;
+    uint64_t start = NowMicros();
+    for (int i = 0; i < reads; i++) {
+        // 键都是奇数, 查找[0, 2 * num)中的随机数, 约一半可以找到
+        const Key k = rnd.uniform(2 * FLAGS_num);
+        if (list.contains(k)) {
+            found++;
+        }
+    }
+    uint64_t finish = NowMicros();
+
+    char msg[100];
+    std::snprintf(msg, sizeof(msg), "(%d of %d found, arena %.1f MB)", found, reads,
+                  arena.memoryUsage() / 1048576.0);
+    Report(name, start, finish, reads, msg);
+}
+
+template <typename Comparator>
+void ReadRandomString(const std::string& name, bool batch) {
+    Arena arena(FLAGS_arena_block_size);
+    SkipList<const char*, Comparator, Arena> list(Comparator(), &arena);
+    // 插入所有的奇数编号的键
+    for (int i = 0; i < FLAGS_num; i++) {
+        char* k = arena.allocate(17);
+        EncodeStringKey(static_cast<uint64_t>(i) * 2 + 1, k);
+        list.insert(k);
+    }
+
+    const int reads = FLAGS_reads < 0 ? FLAGS_num : FLAGS_reads;
+    Random rnd(1000);
+    int found = 0;
+    const int batch_size = batch ? std::max(FLAGS_batch_size, 1) : 1;
+    std::vector<char> buf(batch_size * 17);
+    std::vector<const char*> targets(batch_size);
+    for (int j = 0; j < batch_size; j++) {
+        targets[j] = &buf[j * 17];
+    }
+    using Iter = typename SkipList<const char*, Comparator, Arena>::Iterator;
+    std::vector<Iter> iters(batch_size, Iter(&list));
+    StringComparator cmp;
+    uint64_t start = NowMicros();
+    for (int i = 0; i < reads; i += batch_size) {
+        const int n = std::min(batch_size, reads - i);
+        for (int j = 0; j < n; j++) {
+            EncodeStringKey(rnd.uniform(2 * FLAGS_num), &buf[j * 17]);
+        }
+        if (batch) {
+            list.seekBatch(targets.data(), n, iters.data());
+        } else {
+            iters[0].seek(targets[0]);
+        }
+        for (int j = 0; j < n; j++) {
+            if (iters[j].valid() && cmp(iters[j].key(), targets[j]) == 0) {
+                found++;
+            }
+        }
+    }
+    uint64_t finish = NowMicros();
+
+    char msg[100];
+    std::snprintf(msg, sizeof(msg), "(%d of %d found, arena %.1f MB)", found, reads,
+                  arena.memoryUsage() / 1048576.0);
+    Report(name, start, finish, reads, msg);
+}
+
+// 正向或反向遍历整个跳表
+template <typename ListType>
+void Scan(const std::string& name, bool reverse) {
+    std::vector<Key> keys = GenerateKeys(FLAGS_num, false);
+    Arena arena(FLAGS_arena_block_size);
+    ListType list(KeyComparator(), &arena);
+    for (Key k : keys) {
+        list.insert(k);
+    }
+
+    typename ListType::Iterator iter(&list);
+    int n = 0;
+    uint64_t start = NowMicros();
+    if (reverse) {
+        for (iter.seekToLast(); iter.valid(); iter.prev()) {
+            n++;
+        }
+    } else {
+        for (iter.seekToFirst(); iter.valid(); iter.next()) {
+            n++;
+        }
+    }
+    uint64_t finish = NowMicros();
+
+    char msg[100];
+    std::snprintf(msg, sizeof(msg), "(%d keys, arena %.1f MB)", n, arena.memoryUsage() / 1048576.0);
+    Report(name, start, finish, n, msg);
+}
+
+void Run() {
+    std::fprintf(stdout, "Keys:       %d\n", FLAGS_num);
+    std::fprintf(stdout, "BlockSize:  %d bytes\n", FLAGS_arena_block_size);
+    std::fprintf(stdout, "------------------------------------------------\n");
+
+    const char* benchmarks = FLAGS_benchmarks;
+    while (benchmarks != nullptr) {
+        const char* sep = std::strchr(benchmarks, ',');
+        std::string name;
+        if (sep == nullptr) {
+            name = benchmarks;
+            benchmarks = nullptr;
+        } else {
+            name = std::string(benchmarks, sep - benchmarks);
+            benchmarks = sep + 1;
+        }
+
+        if (name == "fillseq") {
+            Fill(name, true, false);
+        } else if (name == "fillseqhint") {
+            Fill(name, true, true);
+        } else if (name == "fillrandom") {
+            Fill(name, false, false);
+        } else if (name == "fillrandomhint") {
+            Fill(name, false, true);
+        } else if (name == "readrandom") {
+            ReadRandom(name, false);
+        } else if (name == "readrandomhuge") {
+            ReadRandom(name, true);
+        } else if (name == "readrandomstr") {
+            ReadRandomString<StringComparator>(name, false);
+        } else if (name == "readrandomprefix") {
+            ReadRandomString<PrefixStringComparator>(name, false);
+        } else if (name == "readrandombatch") {
+            ReadRandomString<PrefixStringComparator>(name, true);
+        } else if (name == "readseq") {
+            Scan<List>(name, false);
+        } else if (name == "readreverse") {
+            Scan<List>(name, true);
+        } else if (name == "readreverselink") {
+            Scan<SkipList<Key, KeyComparator, Arena, true>>(name, true);
+        } else if (!name.empty()) {
+            std::fprintf(stderr, "unknown benchmark '%s'\n", name.c_str());
+        }
+    }
+}
+
+}  // namespace
+
+}  // namespace kvstorage
+
+int main(int argc, char** argv) {
+    for (int i = 1; i < argc; i++) {
+        int n;
+        char junk;
+        if (std::strncmp(argv[i], "--benchmarks=", 13) == 0) {
+            kvstorage::FLAGS_benchmarks = argv[i] + 13;
+        } else if (std::sscanf(argv[i], "--num=%d%c", &n, &junk) == 1) {
+            kvstorage::FLAGS_num = n;
+        } else if (std::sscanf(argv[i], "--reads=%d%c", &n, &junk) == 1) {
+            kvstorage::FLAGS_reads = n;
+        } else if (std::sscanf(argv[i], "--arena_block_size=%d%c", &n, &junk) == 1) {
+            kvstorage::FLAGS_arena_block_size = n;
+        } else if (std::sscanf(argv[i], "--batch_size=%d%c", &n, &junk) == 1) {
+            kvstorage::FLAGS_batch_size = n;
+        } else {
+            std::fprintf(stderr, "Invalid flag '%s'\n", argv[i]);
+            std::exit(1);
+        }
+    }
+    kvstorage::Run();
+    return 0;
+}
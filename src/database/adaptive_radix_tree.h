@@ -0,0 +1,825 @@
+/*
+ * 自适应基数树(ART), memtable的另一种有序索引结构
+ * 按比较器给出的字节串逐字节向下查找, 内部结点根据子结点数量在Node4/16/48/256之间切换,
+ * 只有一个子结点的路径压缩为结点的前缀; 查找时键的每个字节只比较一次, 适合有很长公共前缀的键
+ * 字节串相同的键(例如user_key相同, 序列号不同的记录)保存在同一个叶结点的有序链表中
+ *
+ * 单写者插入, 读者无锁: 结点的子结点只追加, 通过release写入的计数或下标发布;
+ * 结点需要扩容或拆分前缀时复制出新结点, 再替换父结点中的指针, 旧结点不再修改, 留在arena中直到树销毁
+*/
+#ifndef D_KVSTORAGE_ADAPTIVE_RADIX_TREE_H
+#define D_KVSTORAGE_ADAPTIVE_RADIX_TREE_H
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <new>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "slice.h"
+#include "util/arena.h"
+
+namespace kvstorage {
+
+// Comparator需要提供:
+//   Slice keyBytes(const Key&) const: 决定键顺序的字节串, 按字节序比较; 返回的内存在键的生命周期内有效
+//   int operator()(const Key&, const Key&) const: 所有键的全序, 字节串不同时必须与字节序一致,
+//   字节串相同时决定叶结点内的顺序
+// Allocator的要求和SkipList相同
+template <typename Key, class Comparator, class Allocator = Arena>
+class AdaptiveRadixTree {
+private:
+    struct Node;
+    struct Version;
+    struct Leaf;
+    struct Inner;
+    template <int N> struct NodeN;
+    struct Node48;
+    struct Node256;
+
+public:
+    AdaptiveRadixTree(Comparator cmp, Allocator* arena);
+    AdaptiveRadixTree(const AdaptiveRadixTree&) = delete;
+    AdaptiveRadixTree& operator=(const AdaptiveRadixTree&) = delete;
+
+public:
+    void insert(const Key& key);  // 需要外部同步, 同一时刻只能有一个写者
+    // 可以由多个写线程同时调用, 写者之间通过互斥锁串行化, 读者仍然无锁; 不能和insert()并发调用
+    void concurrentInsert(const Key& key);
+    bool contains(const Key& key) const;
+    // 在与target字节串相同的键中查找第一个 >= target的键, 找到时保存到result并返回true
+    bool find(const Key& target, Key* result) const;
+
+    class Iterator {
+    public:
+        explicit Iterator(const AdaptiveRadixTree* tree);
+        bool valid() const { return version_ != nullptr; }
+        const Key& key() const;
+        void next();
+        void prev();
+        void seek(const Key& target);  // 移动到第一个 >= target的键
+        void seekToFirst();
+        void seekToLast();
+        // 移动到第一个字节串以prefix开头的键, 之后移动到前缀范围之外时变为无效;
+        // 其他seek操作会取消前缀限制
+        void seekPrefix(const Slice& prefix);
+
+    private:
+        // 从根结点到当前叶结点的路径, pos为-1表示node的own_leaf, 否则为所在子结点对应的字节
+        struct Frame {
+            Inner* node;
+            int pos;
+        };
+
+        bool lowerBound(const Slice& bytes);  // 定位到第一个字节串 >= bytes的叶结点
+        bool leftmost(Node* n);
+        bool rightmost(Node* n);
+        bool nextLeaf();
+        bool prevLeaf();
+        void setVersion(Version* v);  // v为空或者leaf_超出前缀范围时变为无效
+
+        const AdaptiveRadixTree* tree_;
+        std::vector<Frame> stack_;
+        Leaf* leaf_;
+        Version* version_;
+        std::string prefix_;
+        bool prefix_mode_;
+    };
+
+private:
+    enum class NodeType : uint8_t { Leaf, Node4, Node16, Node48, Node256 };
+
+    template <typename T, typename... Args>
+    T* newNode(Args&&... args);
+    Leaf* newLeaf(const Slice& bytes, const Key& key);
+    Inner* newInner(NodeType type, const char* prefix, size_t prefix_size);
+    void insertLocked(const Key& key);
+    void addVersion(Leaf* leaf, const Key& key);
+    Leaf* findLeaf(const Slice& bytes) const;
+    // 把n的所有子结点和own_leaf复制到指定类型, 指定前缀的新结点中
+    Inner* copyInner(Inner* n, NodeType type, const char* prefix, size_t prefix_size);
+    // 在ref指向的结点n中添加子结点, n已满时先复制为更大的结点并替换ref
+    void addChild(std::atomic<Node*>* ref, Inner* n, uint8_t byte, Node* child);
+
+    static std::atomic<Node*>* findChild(Inner* n, uint8_t byte);
+    static void addChildInPlace(Inner* n, uint8_t byte, Node* child);
+    static bool isFull(Inner* n);
+    static Node* nextChild(Inner* n, int after, int* byte);   // 字节 > after的第一个子结点
+    static Node* prevChild(Inner* n, int before, int* byte);  // 字节 < before的最后一个子结点
+    static Version* lastVersion(Leaf* leaf);
+
+private:
+    Comparator const compare_;
+    Allocator* const arena_;
+    std::atomic<Node*> root_;
+    std::mutex mutex_;  // 串行化concurrentInsert的写者
+};
+
+template <typename Key, class Comparator, class Allocator>
+struct AdaptiveRadixTree<Key, Comparator, Allocator>::Node {
+    explicit Node(NodeType t) : type(t) {}
+    const NodeType type;
+};
+
+// 字节串相同的一个键, 叶结点内按compare_升序链接
+template <typename Key, class Comparator, class Allocator>
+struct AdaptiveRadixTree<Key, Comparator, Allocator>::Version {
+    explicit Version(const Key& k) : key(k), next(nullptr) {}
+    Key const key;
+    std::atomic<Version*> next;
+};
+
+template <typename Key, class Comparator, class Allocator>
+struct AdaptiveRadixTree<Key, Comparator, Allocator>::Leaf : public Node {
+    explicit Leaf(const Slice& b) : Node(NodeType::Leaf), bytes(b), versions(nullptr) {}
+    const Slice bytes;  // 指向第一个插入的键的字节串
+    std::atomic<Version*> versions;
+};
+
+template <typename Key, class Comparator, class Allocator>
+struct AdaptiveRadixTree<Key, Comparator, Allocator>::Inner : public Node {
+    Inner(NodeType t, const char* p, size_t n) : Node(t), prefix(p), prefix_size(n), own_leaf(nullptr) {}
+    const char* const prefix;  // 压缩的路径, 指向子树中某个键的字节串
+    const size_t prefix_size;
+    std::atomic<Leaf*> own_leaf;  // 字节串恰好在prefix之后结束的键, 排在所有子结点之前
+};
+
+// Node4和Node16, 子结点按插入顺序追加, 查找时遍历所有子结点
+template <typename Key, class Comparator, class Allocator>
+template <int N>
+struct AdaptiveRadixTree<Key, Comparator, Allocator>::NodeN : public Inner {
+    NodeN(const char* p, size_t n) : Inner(N == 4 ? NodeType::Node4 : NodeType::Node16, p, n), count(0) {
+        for (int i = 0; i < N; i++) {
+            children[i].store(nullptr, std::memory_order_relaxed);
+        }
+    }
+    std::atomic<uint8_t> count;  // 先写keys和children, 再通过release发布
+    uint8_t keys[N];
+    std::atomic<Node*> children[N];
+};
+
+template <typename Key, class Comparator, class Allocator>
+struct AdaptiveRadixTree<Key, Comparator, Allocator>::Node48 : public Inner {
+    Node48(const char* p, size_t n) : Inner(NodeType::Node48, p, n), count(0) {
+        for (int i = 0; i < 256; i++) {
+            child_index[i].store(0, std::memory_order_relaxed);
+        }
+        for (int i = 0; i < 48; i++) {
+            children[i].store(nullptr, std::memory_order_relaxed);
+        }
+    }
+    std::atomic<uint8_t> child_index[256];  // 0表示没有子结点, 否则为children中的下标 + 1
+    std::atomic<Node*> children[48];
+    uint8_t count;  // 只由写者访问
+};
+
+template <typename Key, class Comparator, class Allocator>
+struct AdaptiveRadixTree<Key, Comparator, Allocator>::Node256 : public Inner {
+    Node256(const char* p, size_t n) : Inner(NodeType::Node256, p, n) {
+        for (int i = 0; i < 256; i++) {
+            children[i].store(nullptr, std::memory_order_relaxed);
+        }
+    }
+    std::atomic<Node*> children[256];
+};
+
+template <typename Key, class Comparator, class Allocator>
+AdaptiveRadixTree<Key, Comparator, Allocator>::AdaptiveRadixTree(Comparator cmp, Allocator* arena)
+    : compare_(cmp), arena_(arena), root_(nullptr) {}
+
+template <typename Key, class Comparator, class Allocator>
+template <typename T, typename... Args>
+T* AdaptiveRadixTree<Key, Comparator, Allocator>::newNode(Args&&... args) {
+    char* mem = arena_->allocateAligned(sizeof(T));
+    return new (mem) T(std::forward<Args>(args)...);
+}
+
+template <typename Key, class Comparator, class Allocator>
+typename AdaptiveRadixTree<Key, Comparator, Allocator>::Leaf*
+AdaptiveRadixTree<Key, Comparator, Allocator>::newLeaf(const Slice& bytes, const Key& key) {
+    Leaf* leaf = newNode<Leaf>(bytes);
+    leaf->versions.store(newNode<Version>(key), std::memory_order_relaxed);  // 叶结点发布前设置
+    return leaf;
+}
+
+template <typename Key, class Comparator, class Allocator>
+typename AdaptiveRadixTree<Key, Comparator, Allocator>::Inner*
+AdaptiveRadixTree<Key, Comparator, Allocator>::newInner(NodeType type, const char* prefix, size_t prefix_size) {
+    switch (type) {
+        case NodeType::Node4:
+            return newNode<NodeN<4>>(prefix, prefix_size);
+        case NodeType::Node16:
+            return newNode<NodeN<16>>(prefix, prefix_size);
+        case NodeType::Node48:
+            return newNode<Node48>(prefix, prefix_size);
+        default:
+            assert(type == NodeType::Node256);
+            return newNode<Node256>(prefix, prefix_size);
+    }
+}
+
+template <typename Key, class Comparator, class Allocator>
+void AdaptiveRadixTree<Key, Comparator, Allocator>::insert(const Key& key) {
+    insertLocked(key);
+}
+
+template <typename Key, class Comparator, class Allocator>
+void AdaptiveRadixTree<Key, Comparator, Allocator>::concurrentInsert(const Key& key) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    insertLocked(key);
+}
+
+template <typename Key, class Comparator, class Allocator>
+void AdaptiveRadixTree<Key, Comparator, Allocator>::insertLocked(const Key& key) {
+    const Slice bytes = compare_.keyBytes(key);
+    std::atomic<Node*>* ref = &root_;
+    size_t depth = 0;
+    while (true) {
+        Node* n = ref->load(std::memory_order_relaxed);  // 只有写者修改树, 不需要同步
+        if (n == nullptr) {
+            ref->store(newLeaf(bytes, key), std::memory_order_release);
+            return;
+        }
+
+        if (n->type == NodeType::Leaf) {
+            Leaf* leaf = static_cast<Leaf*>(n);
+            if (leaf->bytes == bytes) {
+                addVersion(leaf, key);
+                return;
+            }
+            // 两个字节串在depth之后的公共部分成为新结点的前缀, 其中较短的可能恰好在前缀处结束
+            const size_t limit = std::min(leaf->bytes.size(), bytes.size());
+            size_t common = depth;
+            while (common < limit && leaf->bytes[common] == bytes[common]) {
+                common++;
+            }
+            Inner* parent = newInner(NodeType::Node4, bytes.data() + depth, common - depth);
+            Leaf* x = newLeaf(bytes, key);
+            if (common == leaf->bytes.size()) {
+                parent->own_leaf.store(leaf, std::memory_order_relaxed);
+            } else {
+                addChildInPlace(parent, static_cast<uint8_t>(leaf->bytes[common]), leaf);
+            }
+            if (common == bytes.size()) {
+                parent->own_leaf.store(x, std::memory_order_relaxed);
+            } else {
+                addChildInPlace(parent, static_cast<uint8_t>(bytes[common]), x);
+            }
+            ref->store(parent, std::memory_order_release);
+            return;
+        }
+
+        Inner* inner = static_cast<Inner*>(n);
+        const size_t limit = std::min(inner->prefix_size, bytes.size() - depth);
+        size_t p = 0;
+        while (p < limit && inner->prefix[p] == bytes[depth + p]) {
+            p++;
+        }
+        if (p < inner->prefix_size) {
+            // 在前缀的第p个字节处分叉, 把原结点复制到新结点之下, 复制的结点去掉前p + 1个字节的前缀
+            Inner* parent = newInner(NodeType::Node4, inner->prefix, p);
+            Inner* lower = copyInner(inner, inner->type, inner->prefix + p + 1, inner->prefix_size - p - 1);
+            addChildInPlace(parent, static_cast<uint8_t>(inner->prefix[p]), lower);
+            Leaf* x = newLeaf(bytes, key);
+            if (depth + p == bytes.size()) {
+                parent->own_leaf.store(x, std::memory_order_relaxed);
+            } else {
+                addChildInPlace(parent, static_cast<uint8_t>(bytes[depth + p]), x);
+            }
+            ref->store(parent, std::memory_order_release);
+            return;
+        }
+
+        depth += inner->prefix_size;
+        if (depth == bytes.size()) {
+            Leaf* own = inner->own_leaf.load(std::memory_order_relaxed);
+            if (own != nullptr) {
+                addVersion(own, key);
+            } else {
+                inner->own_leaf.store(newLeaf(bytes, key), std::memory_order_release);
+            }
+            return;
+        }
+        const uint8_t byte = static_cast<uint8_t>(bytes[depth]);
+        std::atomic<Node*>* child = findChild(inner, byte);
+        if (child == nullptr) {
+            addChild(ref, inner, byte, newLeaf(bytes, key));
+            return;
+        }
+        ref = child;
+        depth++;
+    }
+}
+
+template <typename Key, class Comparator, class Allocator>
+void AdaptiveRadixTree<Key, Comparator, Allocator>::addVersion(Leaf* leaf, const Key& key) {
+    std::atomic<Version*>* link = &leaf->versions;
+    Version* next;
+    while ((next = link->load(std::memory_order_relaxed)) != nullptr && compare_(next->key, key) < 0) {
+        link = &next->next;
+    }
+    assert(next == nullptr || compare_(next->key, key) != 0);  // 不允许插入重复的键
+    Version* v = newNode<Version>(key);
+    v->next.store(next, std::memory_order_relaxed);
+    link->store(v, std::memory_order_release);
+}
+
+template <typename Key, class Comparator, class Allocator>
+typename AdaptiveRadixTree<Key, Comparator, Allocator>::Inner*
+AdaptiveRadixTree<Key, Comparator, Allocator>::copyInner(Inner* n, NodeType type, const char* prefix,
+                                                        size_t prefix_size) {
+    Inner* copy = newInner(type, prefix, prefix_size);
+    copy->own_leaf.store(n->own_leaf.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    int byte = -1;
+    Node* child;
+    while ((child = nextChild(n, byte, &byte)) != nullptr) {
+        addChildInPlace(copy, static_cast<uint8_t>(byte), child);
+    }
+    return copy;
+}
+
+template <typename Key, class Comparator, class Allocator>
+void AdaptiveRadixTree<Key, Comparator, Allocator>::addChild(std::atomic<Node*>* ref, Inner* n, uint8_t byte,
+                                                            Node* child) {
+    if (!isFull(n)) {
+        addChildInPlace(n, byte, child);
+        return;
+    }
+    NodeType bigger;
+    switch (n->type) {
+        case NodeType::Node4:
+            bigger = NodeType::Node16;
+            break;
+        case NodeType::Node16:
+            bigger = NodeType::Node48;
+            break;
+        default:
+            assert(n->type == NodeType::Node48);
+            bigger = NodeType::Node256;
+            break;
+    }
+    Inner* grown = copyInner(n, bigger, n->prefix, n->prefix_size);
+    addChildInPlace(grown, byte, child);
+    ref->store(grown, std::memory_order_release);
+}
+
+template <typename Key, class Comparator, class Allocator>
+std::atomic<typename AdaptiveRadixTree<Key, Comparator, Allocator>::Node*>*
+AdaptiveRadixTree<Key, Comparator, Allocator>::findChild(Inner* n, uint8_t byte) {
+    switch (n->type) {
+        case NodeType::Node4: {
+            NodeN<4>* x = static_cast<NodeN<4>*>(n);
+            const int count = x->count.load(std::memory_order_acquire);
+            for (int i = 0; i < count; i++) {
+                if (x->keys[i] == byte) return &x->children[i];
+            }
+            return nullptr;
+        }
+        case NodeType::Node16: {
+            NodeN<16>* x = static_cast<NodeN<16>*>(n);
+            const int count = x->count.load(std::memory_order_acquire);
+            for (int i = 0; i < count; i++) {
+                if (x->keys[i] == byte) return &x->children[i];
+            }
+            return nullptr;
+        }
+        case NodeType::Node48: {
+            Node48* x = static_cast<Node48*>(n);
+            const uint8_t index = x->child_index[byte].load(std::memory_order_acquire);
+            return index == 0 ? nullptr : &x->children[index - 1];
+        }
+        default: {
+            Node256* x = static_cast<Node256*>(n);
+            std::atomic<Node*>* slot = &x->children[byte];
+            return slot->load(std::memory_order_acquire) == nullptr ? nullptr : slot;
+        }
+    }
+}
+
+template <typename Key, class Comparator, class Allocator>
+void AdaptiveRadixTree<Key, Comparator, Allocator>::addChildInPlace(Inner* n, uint8_t byte, Node* child) {
+    assert(!isFull(n));
+    switch (n->type) {
+        case NodeType::Node4: {
+            NodeN<4>* x = static_cast<NodeN<4>*>(n);
+            const uint8_t i = x->count.load(std::memory_order_relaxed);
+            x->keys[i] = byte;
+            x->children[i].store(child, std::memory_order_relaxed);
+            x->count.store(i + 1, std::memory_order_release);
+            break;
+        }
+        case NodeType::Node16: {
+            NodeN<16>* x = static_cast<NodeN<16>*>(n);
+            const uint8_t i = x->count.load(std::memory_order_relaxed);
+            x->keys[i] = byte;
+            x->children[i].store(child, std::memory_order_relaxed);
+            x->count.store(i + 1, std::memory_order_release);
+            break;
+        }
+        case NodeType::Node48: {
+            Node48* x = static_cast<Node48*>(n);
+            x->children[x->count].store(child, std::memory_order_relaxed);
+            x->count++;
+            x->child_index[byte].store(x->count, std::memory_order_release);
+            break;
+        }
+        default:
+            static_cast<Node256*>(n)->children[byte].store(child, std::memory_order_release);
+            break;
+    }
+}
+
+template <typename Key, class Comparator, class Allocator>
+bool AdaptiveRadixTree<Key, Comparator, Allocator>::isFull(Inner* n) {
+    switch (n->type) {
+        case NodeType::Node4:
+            return static_cast<NodeN<4>*>(n)->count.load(std::memory_order_relaxed) == 4;
+        case NodeType::Node16:
+            return static_cast<NodeN<16>*>(n)->count.load(std::memory_order_relaxed) == 16;
+        case NodeType::Node48:
+            return static_cast<Node48*>(n)->count == 48;
+        default:
+            return false;
+    }
+}
+
+template <typename Key, class Comparator, class Allocator>
+typename AdaptiveRadixTree<Key, Comparator, Allocator>::Node*
+AdaptiveRadixTree<Key, Comparator, Allocator>::nextChild(Inner* n, int after, int* byte) {
+    switch (n->type) {
+        case NodeType::Node4:
+        case NodeType::Node16: {
+            // 子结点没有排序, 遍历所有子结点找到大于after的最小字节
+            const uint8_t* keys;
+            std::atomic<Node*>* children;
+            int count;
+            if (n->type == NodeType::Node4) {
+                NodeN<4>* x = static_cast<NodeN<4>*>(n);
+                count = x->count.load(std::memory_order_acquire);
+                keys = x->keys;
+                children = x->children;
+            } else {
+                NodeN<16>* x = static_cast<NodeN<16>*>(n);
+                count = x->count.load(std::memory_order_acquire);
+                keys = x->keys;
+                children = x->children;
+            }
+            int best = -1;
+            for (int i = 0; i < count; i++) {
+                if (keys[i] > after && (best < 0 || keys[i] < keys[best])) {
+                    best = i;
+                }
+            }
+            if (best < 0) return nullptr;
+            *byte = keys[best];
+            return children[best].load(std::memory_order_acquire);
+        }
+        case NodeType::Node48: {
+            Node48* x = static_cast<Node48*>(n);
+            for (int b = after + 1; b < 256; b++) {
+                const uint8_t index = x->child_index[b].load(std::memory_order_acquire);
+                if (index != 0) {
+                    *byte = b;
+                    return x->children[index - 1].load(std::memory_order_acquire);
+                }
+            }
+            return nullptr;
+        }
+        default: {
+            Node256* x = static_cast<Node256*>(n);
+            for (int b = after + 1; b < 256; b++) {
+                Node* child = x->children[b].load(std::memory_order_acquire);
+                if (child != nullptr) {
+                    *byte = b;
+                    return child;
+                }
+            }
+            return nullptr;
+        }
+    }
+}
+
+template <typename Key, class Comparator, class Allocator>
+typename AdaptiveRadixTree<Key, Comparator, Allocator>::Node*
+AdaptiveRadixTree<Key, Comparator, Allocator>::prevChild(Inner* n, int before, int* byte) {
+    switch (n->type) {
+        case NodeType::Node4:
+        case NodeType::Node16: {
+            const uint8_t* keys;
+            std::atomic<Node*>* children;
+            int count;
+            if (n->type == NodeType::Node4) {
+                NodeN<4>* x = static_cast<NodeN<4>*>(n);
+                count = x->count.load(std::memory_order_acquire);
+                keys = x->keys;
+                children = x->children;
+            } else {
+                NodeN<16>* x = static_cast<NodeN<16>*>(n);
+                count = x->count.load(std::memory_order_acquire);
+                keys = x->keys;
+                children = x->children;
+            }
+            int best = -1;
+            for (int i = 0; i < count; i++) {
+                if (keys[i] < before && (best < 0 || keys[i] > keys[best])) {
+                    best = i;
+                }
+            }
+            if (best < 0) return nullptr;
+            *byte = keys[best];
+            return children[best].load(std::memory_order_acquire);
+        }
+        case NodeType::Node48: {
+            Node48* x = static_cast<Node48*>(n);
+            for (int b = before - 1; b >= 0; b--) {
+                const uint8_t index = x->child_index[b].load(std::memory_order_acquire);
+                if (index != 0) {
+                    *byte = b;
+                    return x->children[index - 1].load(std::memory_order_acquire);
+                }
+            }
+            return nullptr;
+        }
+        default: {
+            Node256* x = static_cast<Node256*>(n);
+            for (int b = before - 1; b >= 0; b--) {
+                Node* child = x->children[b].load(std::memory_order_acquire);
+                if (child != nullptr) {
+                    *byte = b;
+                    return child;
+                }
+            }
+            return nullptr;
+        }
+    }
+}
+
+template <typename Key, class Comparator, class Allocator>
+typename AdaptiveRadixTree<Key, Comparator, Allocator>::Version*
+AdaptiveRadixTree<Key, Comparator, Allocator>::lastVersion(Leaf* leaf) {
+    Version* v = leaf->versions.load(std::memory_order_acquire);
+    Version* next;
+    while ((next = v->next.load(std::memory_order_acquire)) != nullptr) {
+        v = next;
+    }
+    return v;
+}
+
+template <typename Key, class Comparator, class Allocator>
+typename AdaptiveRadixTree<Key, Comparator, Allocator>::Leaf*
+AdaptiveRadixTree<Key, Comparator, Allocator>::findLeaf(const Slice& bytes) const {
+    Node* n = root_.load(std::memory_order_acquire);
+    size_t depth = 0;
+    while (n != nullptr) {
+        if (n->type == NodeType::Leaf) {
+            Leaf* leaf = static_cast<Leaf*>(n);
+            return leaf->bytes == bytes ? leaf : nullptr;
+        }
+        Inner* inner = static_cast<Inner*>(n);
+        if (bytes.size() - depth < inner->prefix_size ||
+            std::memcmp(inner->prefix, bytes.data() + depth, inner->prefix_size) != 0) {
+            return nullptr;
+        }
+        depth += inner->prefix_size;
+        if (depth == bytes.size()) {
+            return inner->own_leaf.load(std::memory_order_acquire);
+        }
+        std::atomic<Node*>* child = findChild(inner, static_cast<uint8_t>(bytes[depth]));
+        if (child == nullptr) {
+            return nullptr;
+        }
+        n = child->load(std::memory_order_acquire);
+        depth++;
+    }
+    return nullptr;
+}
+
+template <typename Key, class Comparator, class Allocator>
+bool AdaptiveRadixTree<Key, Comparator, Allocator>::find(const Key& target, Key* result) const {
+    Leaf* leaf = findLeaf(compare_.keyBytes(target));
+    if (leaf == nullptr) {
+        return false;
+    }
+    for (Version* v = leaf->versions.load(std::memory_order_acquire); v != nullptr;
+         v = v->next.load(std::memory_order_acquire)) {
+        if (compare_(v->key, target) >= 0) {
+            *result = v->key;
+            return true;
+        }
+    }
+    return false;
+}
+
+template <typename Key, class Comparator, class Allocator>
+bool AdaptiveRadixTree<Key, Comparator, Allocator>::contains(const Key& key) const {
+    Key result;
+    return find(key, &result) && compare_(result, key) == 0;
+}
+
+template <typename Key, class Comparator, class Allocator>
+AdaptiveRadixTree<Key, Comparator, Allocator>::Iterator::Iterator(const AdaptiveRadixTree* tree)
+    : tree_(tree), leaf_(nullptr), version_(nullptr), prefix_mode_(false) {}
+
+template <typename Key, class Comparator, class Allocator>
+const Key& AdaptiveRadixTree<Key, Comparator, Allocator>::Iterator::key() const {
+    assert(valid());
+    return version_->key;
+}
+
+template <typename Key, class Comparator, class Allocator>
+void AdaptiveRadixTree<Key, Comparator, Allocator>::Iterator::setVersion(Version* v) {
+    version_ = v;
+    if (v != nullptr && prefix_mode_ && !leaf_->bytes.startsWith(prefix_)) {
+        version_ = nullptr;
+    }
+}
+
+template <typename Key, class Comparator, class Allocator>
+bool AdaptiveRadixTree<Key, Comparator, Allocator>::Iterator::leftmost(Node* n) {
+    while (n != nullptr) {
+        if (n->type == NodeType::Leaf) {
+            leaf_ = static_cast<Leaf*>(n);
+            return true;
+        }
+        Inner* inner = static_cast<Inner*>(n);
+        Leaf* own = inner->own_leaf.load(std::memory_order_acquire);
+        if (own != nullptr) {
+            stack_.push_back({inner, -1});
+            leaf_ = own;
+            return true;
+        }
+        int byte;
+        n = nextChild(inner, -1, &byte);
+        stack_.push_back({inner, byte});
+    }
+    return false;  // 只有空树的根结点为空
+}
+
+template <typename Key, class Comparator, class Allocator>
+bool AdaptiveRadixTree<Key, Comparator, Allocator>::Iterator::rightmost(Node* n) {
+    while (n != nullptr) {
+        if (n->type == NodeType::Leaf) {
+            leaf_ = static_cast<Leaf*>(n);
+            return true;
+        }
+        Inner* inner = static_cast<Inner*>(n);
+        int byte;
+        Node* child = prevChild(inner, 256, &byte);
+        if (child == nullptr) {
+            stack_.push_back({inner, -1});
+            leaf_ = inner->own_leaf.load(std::memory_order_acquire);
+            return true;
+        }
+        stack_.push_back({inner, byte});
+        n = child;
+    }
+    return false;
+}
+
+template <typename Key, class Comparator, class Allocator>
+bool AdaptiveRadixTree<Key, Comparator, Allocator>::Iterator::nextLeaf() {
+    while (!stack_.empty()) {
+        Frame& f = stack_.back();
+        int byte;
+        Node* child = nextChild(f.node, f.pos, &byte);
+        if (child != nullptr) {
+            f.pos = byte;
+            return leftmost(child);
+        }
+        stack_.pop_back();
+    }
+    return false;
+}
+
+template <typename Key, class Comparator, class Allocator>
+bool AdaptiveRadixTree<Key, Comparator, Allocator>::Iterator::prevLeaf() {
+    while (!stack_.empty()) {
+        Frame& f = stack_.back();
+        if (f.pos >= 0) {
+            int byte;
+            Node* child = prevChild(f.node, f.pos, &byte);
+            if (child != nullptr) {
+                f.pos = byte;
+                return rightmost(child);
+            }
+            Leaf* own = f.node->own_leaf.load(std::memory_order_acquire);
+            if (own != nullptr) {
+                f.pos = -1;
+                leaf_ = own;
+                return true;
+            }
+        }
+        stack_.pop_back();
+    }
+    return false;
+}
+
+template <typename Key, class Comparator, class Allocator>
+bool AdaptiveRadixTree<Key, Comparator, Allocator>::Iterator::lowerBound(const Slice& bytes) {
+    stack_.clear();
+    Node* n = tree_->root_.load(std::memory_order_acquire);
+    size_t depth = 0;
+    while (n != nullptr) {
+        if (n->type == NodeType::Leaf) {
+            leaf_ = static_cast<Leaf*>(n);
+            return leaf_->bytes.compare(bytes) >= 0 || nextLeaf();
+        }
+        Inner* inner = static_cast<Inner*>(n);
+        const size_t remaining = bytes.size() - depth;
+        const int r = std::memcmp(inner->prefix, bytes.data() + depth, std::min(remaining, inner->prefix_size));
+        if (r > 0 || (r == 0 && remaining <= inner->prefix_size)) {
+            return leftmost(inner);  // 子树中所有的键都 >= bytes
+        }
+        if (r < 0) {
+            return nextLeaf();  // 子树中所有的键都 < bytes
+        }
+        depth += inner->prefix_size;
+        const uint8_t byte = static_cast<uint8_t>(bytes[depth]);
+        std::atomic<Node*>* child = findChild(inner, byte);
+        stack_.push_back({inner, byte});
+        if (child == nullptr) {
+            return nextLeaf();  // own_leaf和字节小于byte的子树都 < bytes
+        }
+        n = child->load(std::memory_order_acquire);
+        depth++;
+    }
+    return false;
+}
+
+template <typename Key, class Comparator, class Allocator>
+void AdaptiveRadixTree<Key, Comparator, Allocator>::Iterator::next() {
+    assert(valid());
+    Version* v = version_->next.load(std::memory_order_acquire);
+    if (v == nullptr && nextLeaf()) {
+        v = leaf_->versions.load(std::memory_order_acquire);
+    }
+    setVersion(v);
+}
+
+template <typename Key, class Comparator, class Allocator>
+void AdaptiveRadixTree<Key, Comparator, Allocator>::Iterator::prev() {
+    assert(valid());
+    // 叶结点内是单向链表, 从头查找前一个键
+    Version* v = leaf_->versions.load(std::memory_order_acquire);
+    if (v == version_) {
+        setVersion(prevLeaf() ? lastVersion(leaf_) : nullptr);
+        return;
+    }
+    Version* next;
+    while ((next = v->next.load(std::memory_order_acquire)) != version_) {
+        v = next;
+    }
+    setVersion(v);
+}
+
+template <typename Key, class Comparator, class Allocator>
+void AdaptiveRadixTree<Key, Comparator, Allocator>::Iterator::seek(const Key& target) {
+    prefix_mode_ = false;
+    const Slice bytes = tree_->compare_.keyBytes(target);
+    if (!lowerBound(bytes)) {
+        setVersion(nullptr);
+        return;
+    }
+    Version* v = leaf_->versions.load(std::memory_order_acquire);
+    if (leaf_->bytes == bytes) {
+        while (v != nullptr && tree_->compare_(v->key, target) < 0) {
+            v = v->next.load(std::memory_order_acquire);
+        }
+        if (v == nullptr && nextLeaf()) {
+            v = leaf_->versions.load(std::memory_order_acquire);
+        }
+    }
+    setVersion(v);
+}
+
+template <typename Key, class Comparator, class Allocator>
+void AdaptiveRadixTree<Key, Comparator, Allocator>::Iterator::seekPrefix(const Slice& prefix) {
+    prefix_.assign(prefix.data(), prefix.size());
+    prefix_mode_ = true;
+    setVersion(lowerBound(prefix) ? leaf_->versions.load(std::memory_order_acquire) : nullptr);
+}
+
+template <typename Key, class Comparator, class Allocator>
+void AdaptiveRadixTree<Key, Comparator, Allocator>::Iterator::seekToFirst() {
+    prefix_mode_ = false;
+    stack_.clear();
+    setVersion(leftmost(tree_->root_.load(std::memory_order_acquire)) ?
+               leaf_->versions.load(std::memory_order_acquire) : nullptr);
+}
+
+template <typename Key, class Comparator, class Allocator>
+void AdaptiveRadixTree<Key, Comparator, Allocator>::Iterator::seekToLast() {
+    prefix_mode_ = false;
+    stack_.clear();
+    setVersion(rightmost(tree_->root_.load(std::memory_order_acquire)) ? lastVersion(leaf_) : nullptr);
+}
+
+}  // namespace kvstorage
+
+#endif
@@ -36,18 +36,13 @@ const char* InternalKeyComparator::name() const {
 int InternalKeyComparator::compare(const Slice& a, const Slice& b) const {
     // 比较两个InternalKey
     // 先比较user_key(使用用户提供的Comparator)，再比较sequence，type（降序）
-    int r = user_comparator_->compare(ExtractUserKey(a), ExtractUserKey(b));
-    if (r == 0) {
-        // 继续比较sequence和type
-        const uint64_t a_num = DecodeFixed64(a.data() + a.size() - 8);
-        const uint64_t b_num = DecodeFixed64(b.data() + b.size() - 8);
-        if (a_num > b_num) {
-            r = -1;
-        } else if (a_num < b_num) {
-            r = 1;
-        }
+    if (uint64_) {
+        return CompareInternalKeys(Uint64Compare(), a, b);
     }
-    return r;
+    if (bytewise_) {
+        return CompareInternalKeys(BytewiseCompare(), a, b);
+    }
+    return CompareInternalKeys(VirtualCompare(user_comparator_), a, b);
 }
 
 void InternalKeyComparator::findShortestSeparator(std::string* start, const Slice& limit) const {
@@ -66,18 +66,55 @@ inline Slice ExtractUserKey(const Slice& internal_key) {
     return Slice(internal_key.data(), internal_key.size() - 8);
 }
 
+// 比较两个InternalKey: 先用user_compare比较user_key(升序), 再比较sequence和type(降序)
+// UserCompare为BytewiseCompare时整个比较可以内联; sequence和type打包在同一个tag中, 小端序主机上
+// 各用一次8字节读取后直接比较, 不需要分别解析
+template <class UserCompare>
+inline int CompareInternalKeys(const UserCompare& user_compare, const Slice& a, const Slice& b) {
+    int r = user_compare(ExtractUserKey(a), ExtractUserKey(b));
+    if (r == 0) {
+        const uint64_t a_num = DecodeFixed64(a.data() + a.size() - 8);
+        const uint64_t b_num = DecodeFixed64(b.data() + b.size() - 8);
+        if (a_num > b_num) {
+            r = -1;
+        } else if (a_num < b_num) {
+            r = 1;
+        }
+    }
+    return r;
+}
+
+// 规范化的tag: 取反后按大端序保存, 按字节比较时sequence大的排在前面;
+// user_key定长时, user_key | 规范化tag 只需要一次按字节比较就得到InternalKey的顺序.
+// 变长的user_key互为前缀时tag会与另一个键的字节比较, 所以只用于定长的键
+inline void EncodeNormalizedTag(char* dst, uint64_t tag) {
+    EncodeBigEndian64(dst, ~tag);
+}
+
+inline uint64_t DecodeNormalizedTag(const char* ptr) {
+    return ~DecodeBigEndian64(ptr);
+}
+
 class InternalKeyComparator : public Comparator {
 public:
-    explicit InternalKeyComparator(const Comparator* c) : user_comparator_(c) {}
+    explicit InternalKeyComparator(const Comparator* c)
+        : user_comparator_(c), uint64_(c == Uint64KeyComparator()), bytewise_(uint64_ || c == BytewiseComparator()) {}
     const char* name() const override;
     int compare(const Slice& a, const Slice& b) const override;
     int compare(const InternalKey& a, const InternalKey& b) const;  // 未实现
     void findShortestSeparator(std::string* start, const Slice& limit) const override;
     void findShortSuccessor(std::string* key) const override;
     const Comparator* userComparator() const { return user_comparator_; }
+    // 用户键的顺序是否与按字节比较相同, 是时可以使用BytewiseCompare代替虚函数调用
+    // Uint64KeyComparator()的顺序也与按字节比较相同
+    bool isBytewise() const { return bytewise_; }
+    // 用户比较器是否是Uint64KeyComparator(), 是时所有的user_key都是8字节
+    bool isUint64() const { return uint64_; }
 
 private:
     const Comparator* user_comparator_;  // 提供用户比较器, 默认按字符序比较
+    bool uint64_;
+    bool bytewise_;
 };
 
 class InternalFilterPolicy : public FilterPolicy {
@@ -0,0 +1,160 @@
+/*
+ * 哈希链表, memtable除跳表之外的另一种索引结构
+ * 按比较器给出的哈希值把键分到固定数量的桶中, 每个桶是一个按比较器排序的单链表;
+ * 点查只需要访问目标键所在的桶, 有序遍历时需要先收集所有的键再排序
+*/
+#ifndef D_KVSTORAGE_HASH_LINK_LIST_H
+#define D_KVSTORAGE_HASH_LINK_LIST_H
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <vector>
+
+#include "util/arena.h"
+
+namespace kvstorage {
+
+// Comparator除了int operator()(const Key&, const Key&) const之外, 还需要提供
+// uint32_t keyHash(const Key&) const: seek()只在目标键所在的桶内查找, 所以查找时需要和目标键
+// 排在一起的键(例如user_key相同, 序列号不同的记录)必须有相同的哈希值
+// Allocator的要求和SkipList相同, 使用concurrentInsert时需要线程安全的分配器
+template <typename Key, class Comparator, class Allocator = Arena>
+class HashLinkList {
+private:
+    struct Node;
+
+public:
+    HashLinkList(Comparator cmp, Allocator* arena, size_t bucket_count);
+    HashLinkList(const HashLinkList&) = delete;
+    HashLinkList& operator=(const HashLinkList&) = delete;
+
+public:
+    void insert(const Key& key);  // 需要外部同步, 同一时刻只能有一个写者
+    // 多写者并发插入, 通过CAS链接到桶中, 失败时从原来的前驱继续查找; 不能和insert()并发调用
+    void concurrentInsert(const Key& key);
+    bool contains(const Key& key) const;
+    // 在target所在的桶中查找第一个 >= target的键, 找到时保存到result并返回true
+    // 桶中的其他键只是哈希冲突, 返回的键和target的关系需要调用者判断
+    bool seek(const Key& target, Key* result) const;
+    // 按顺序返回当前所有的键, 需要遍历所有的桶并排序
+    void sortedKeys(std::vector<Key>* keys) const;
+    size_t count() const { return count_.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<Node*>* bucket(const Key& key) const;
+    // 从link开始沿链表查找, 返回第一个 >= key的结点, *prev_link为指向该结点的链接
+    Node* findGreaterOrEqual(const Key& key, std::atomic<Node*>* link, std::atomic<Node*>** prev_link) const;
+
+private:
+    Comparator const compare_;
+    Allocator* const arena_;
+    const size_t bucket_count_;
+    std::atomic<Node*>* const buckets_;  // 分配在arena中, 每个桶是链表的第一个结点
+    std::atomic<size_t> count_;
+};
+
+template <typename Key, class Comparator, class Allocator>
+struct HashLinkList<Key, Comparator, Allocator>::Node {
+    explicit Node(const Key& k) : key(k) {}
+
+    Key const key;
+    std::atomic<Node*> next;
+};
+
+template <typename Key, class Comparator, class Allocator>
+HashLinkList<Key, Comparator, Allocator>::HashLinkList(Comparator cmp, Allocator* arena, size_t bucket_count)
+    : compare_(cmp), arena_(arena), bucket_count_(std::max<size_t>(bucket_count, 1)),
+      buckets_(reinterpret_cast<std::atomic<Node*>*>(
+          arena->allocateAligned(sizeof(std::atomic<Node*>) * bucket_count_))),
+      count_(0) {
+    for (size_t i = 0; i < bucket_count_; i++) {
+        new (&buckets_[i]) std::atomic<Node*>(nullptr);
+    }
+}
+
+template <typename Key, class Comparator, class Allocator>
+std::atomic<typename HashLinkList<Key, Comparator, Allocator>::Node*>*
+HashLinkList<Key, Comparator, Allocator>::bucket(const Key& key) const {
+    return &buckets_[compare_.keyHash(key) % bucket_count_];
+}
+
+template <typename Key, class Comparator, class Allocator>
+typename HashLinkList<Key, Comparator, Allocator>::Node*
+HashLinkList<Key, Comparator, Allocator>::findGreaterOrEqual(
+        const Key& key, std::atomic<Node*>* link, std::atomic<Node*>** prev_link) const {
+    while (true) {
+        Node* next = link->load(std::memory_order_acquire);  // 与插入时的release配对
+        if (next == nullptr || compare_(next->key, key) >= 0) {
+            if (prev_link != nullptr) *prev_link = link;
+            return next;
+        }
+        link = &next->next;
+    }
+}
+
+template <typename Key, class Comparator, class Allocator>
+void HashLinkList<Key, Comparator, Allocator>::insert(const Key& key) {
+    std::atomic<Node*>* link;
+    Node* next = findGreaterOrEqual(key, bucket(key), &link);
+    assert(next == nullptr || compare_(next->key, key) != 0);  // 不允许插入重复的键
+
+    Node* x = new (arena_->allocateAligned(sizeof(Node))) Node(key);
+    x->next.store(next, std::memory_order_relaxed);
+    link->store(x, std::memory_order_release);  // x初始化完成后才对读者可见
+    count_.fetch_add(1, std::memory_order_relaxed);
+}
+
+template <typename Key, class Comparator, class Allocator>
+void HashLinkList<Key, Comparator, Allocator>::concurrentInsert(const Key& key) {
+    Node* x = new (arena_->allocateAligned(sizeof(Node))) Node(key);
+    std::atomic<Node*>* link;
+    Node* next = findGreaterOrEqual(key, bucket(key), &link);
+    while (true) {
+        assert(next == nullptr || compare_(next->key, key) != 0);
+        x->next.store(next, std::memory_order_relaxed);
+        if (link->compare_exchange_strong(next, x, std::memory_order_release, std::memory_order_relaxed)) {
+            break;
+        }
+        // 其他写者在link和next之间插入了结点, link指向的结点仍小于key, 从它开始重新定位
+        next = findGreaterOrEqual(key, link, &link);
+    }
+    count_.fetch_add(1, std::memory_order_relaxed);
+}
+
+template <typename Key, class Comparator, class Allocator>
+bool HashLinkList<Key, Comparator, Allocator>::contains(const Key& key) const {
+    Node* x = findGreaterOrEqual(key, bucket(key), nullptr);
+    return x != nullptr && compare_(x->key, key) == 0;
+}
+
+template <typename Key, class Comparator, class Allocator>
+bool HashLinkList<Key, Comparator, Allocator>::seek(const Key& target, Key* result) const {
+    Node* x = findGreaterOrEqual(target, bucket(target), nullptr);
+    if (x == nullptr) {
+        return false;
+    }
+    *result = x->key;
+    return true;
+}
+
+template <typename Key, class Comparator, class Allocator>
+void HashLinkList<Key, Comparator, Allocator>::sortedKeys(std::vector<Key>* keys) const {
+    keys->clear();
+    keys->reserve(count());
+    for (size_t i = 0; i < bucket_count_; i++) {
+        for (Node* x = buckets_[i].load(std::memory_order_acquire); x != nullptr;
+             x = x->next.load(std::memory_order_acquire)) {
+            keys->push_back(x->key);
+        }
+    }
+    // 每个桶内已经有序, 这里不利用这一点, 直接整体排序
+    std::sort(keys->begin(), keys->end(), [this](const Key& a, const Key& b) { return compare_(a, b) < 0; });
+}
+
+}  // namespace kvstorage
+
+#endif
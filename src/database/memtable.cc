@@ -0,0 +1,437 @@
+#include "memtable.h"
+
+#include <algorithm>
+#include <vector>
+
+#include "coding.h"
+#include "comparator.h"
+#include "hash.h"
+#include "iterator.h"
+
+namespace kvstorage {
+
+// 解析data开头的长度前缀, 返回其后对应长度的数据
+static Slice GetLengthPrefixedSlice(const char* data) {
+    uint32_t len;
+    const char* p = data;
+    p = GetVarint32Ptr(p, p + 5, &len);  // varint32最多5字节, 这里假设数据是合法的
+    return Slice(p, len);
+}
+
+// 没有指定arena_block_size时, 取write_buffer_size的1/8并按4KB对齐,
+// 一个memtable大约使用8个内存块, 减少内存分配次数的同时避免最后一个块浪费过多内存
+static size_t ArenaBlockSize(const Options& options) {
+    static const size_t s_min_block_size = 4 * 1024;
+    static const size_t s_max_block_size = 64 * 1024 * 1024;
+    size_t block_size = options.arena_block_size;
+    if (block_size == 0) {
+        block_size = options.write_buffer_size / 8;
+    }
+    block_size = (block_size + s_min_block_size - 1) / s_min_block_size * s_min_block_size;
+    return std::max(s_min_block_size, std::min(block_size, s_max_block_size));
+}
+
+MemTable::MemTable(const InternalKeyComparator& comparator)
+    : MemTable(comparator, Arena::s_default_block_size, false) {}
+
+MemTable::MemTable(const InternalKeyComparator& comparator, const Options& options)
+    : MemTable(comparator, ArenaBlockSize(options), options.memtable_huge_page, options.arena_block_pool) {
+    if (options.memtable_rep == MemTableRepType::HashLinkList) {
+        hash_table_.reset(new HashTable(comparator_, &arena_, options.memtable_hash_bucket_count));
+    } else if (options.memtable_rep == MemTableRepType::AdaptiveRadixTree && comparator_.bytewise) {
+        art_table_.reset(new ArtTable(comparator_, &arena_));
+    }
+}
+
+MemTable::MemTable(const InternalKeyComparator& comparator, size_t arena_block_size, bool use_huge_page,
+                   ArenaBlockPool* pool)
+    : comparator_(comparator), refs_(0), arena_(arena_block_size, use_huge_page, pool),
+      table_(comparator_, &arena_) {}
+
+MemTable::~MemTable() { assert(refs_ == 0); }
+
+size_t MemTable::approximateMemoryUsage() { return arena_.memoryUsage(); }
+
+MemTable::KeyComparator::KeyComparator(const InternalKeyComparator& c)
+    : comparator(c), bytewise(c.isBytewise()), fixed_key(c.isUint64()) {}
+
+Slice MemTable::KeyComparator::entryKey(const char* entry, char* scratch) const {
+    if (fixed_key) {
+        std::memcpy(scratch, entry, 8);
+        EncodeFixed64(scratch + 8, DecodeNormalizedTag(entry + 8));
+        return Slice(scratch, s_fixed_key_size);
+    }
+    return GetLengthPrefixedSlice(entry);
+}
+
+Slice MemTable::KeyComparator::entryUserKey(const char* entry) const {
+    if (fixed_key) {
+        return Slice(entry, 8);
+    }
+    return ExtractUserKey(GetLengthPrefixedSlice(entry));
+}
+
+uint64_t MemTable::KeyComparator::entryTag(const char* entry) const {
+    if (fixed_key) {
+        return DecodeNormalizedTag(entry + 8);
+    }
+    const Slice internal_key = GetLengthPrefixedSlice(entry);
+    return DecodeFixed64(internal_key.data() + internal_key.size() - 8);
+}
+
+Slice MemTable::KeyComparator::entryValue(const char* entry) const {
+    if (fixed_key) {
+        return GetLengthPrefixedSlice(entry + s_fixed_key_size);
+    }
+    const Slice internal_key = GetLengthPrefixedSlice(entry);
+    return GetLengthPrefixedSlice(internal_key.data() + internal_key.size());
+}
+
+void MemTable::KeyComparator::encodeFixedKey(char* dst, const Slice& internal_key) const {
+    assert(internal_key.size() == s_fixed_key_size);
+    std::memcpy(dst, internal_key.data(), 8);
+    EncodeNormalizedTag(dst + 8, DecodeFixed64(internal_key.data() + 8));
+}
+
+const char* MemTable::KeyComparator::encodeTarget(std::string* scratch, const Slice& target) const {
+    scratch->clear();
+    if (fixed_key) {
+        scratch->resize(s_fixed_key_size);
+        encodeFixedKey(&(*scratch)[0], target);
+        return scratch->data();
+    }
+    PutVarint32(scratch, target.size());
+    scratch->append(target.data(), target.size());
+    return scratch->data();
+}
+
+uint64_t MemTable::KeyComparator::keyPrefix(const char* entry) const {
+    if (!bytewise) {
+        return 0;  // 前缀全部相等, 总是比较完整的键
+    }
+    if (fixed_key) {
+        return DecodeBigEndian64(entry);  // 前缀就是整个用户键
+    }
+    uint32_t key_length;
+    const char* p = GetVarint32Ptr(entry, entry + 5, &key_length);
+    const size_t n = key_length - 8;  // 去除sequence和type
+    const uint8_t* u = reinterpret_cast<const uint8_t*>(p);
+    if (n >= 8) {
+        return (static_cast<uint64_t>(u[0]) << 56) | (static_cast<uint64_t>(u[1]) << 48) |
+               (static_cast<uint64_t>(u[2]) << 40) | (static_cast<uint64_t>(u[3]) << 32) |
+               (static_cast<uint64_t>(u[4]) << 24) | (static_cast<uint64_t>(u[5]) << 16) |
+               (static_cast<uint64_t>(u[6]) << 8) | static_cast<uint64_t>(u[7]);
+    }
+    // 不足8字节时低位补0, 短键是长键的前缀时前缀相等, 由完整比较决定顺序
+    uint64_t prefix = 0;
+    for (size_t i = 0; i < 8; i++) {
+        prefix = (prefix << 8) | (i < n ? u[i] : 0);
+    }
+    return prefix;
+}
+
+uint32_t MemTable::KeyComparator::keyHash(const char* entry) const {
+    static const uint32_t s_hash_seed = 0xbc9f1d34;
+    const Slice user_key = entryUserKey(entry);
+    return Hash(user_key.data(), user_key.size(), s_hash_seed);  // 只对user_key计算哈希, 不包括sequence和type
+}
+
+Slice MemTable::KeyComparator::keyBytes(const char* entry) const {
+    return entryUserKey(entry);
+}
+
+int MemTable::KeyComparator::operator()(const char* aptr, const char* bptr) const {
+    if (fixed_key) {
+        // 规范化键按字节比较, 16字节分成两个大端序整数比较, 等价于memcmp
+        const uint64_t a_key = DecodeBigEndian64(aptr);
+        const uint64_t b_key = DecodeBigEndian64(bptr);
+        if (a_key != b_key) {
+            return a_key < b_key ? -1 : 1;
+        }
+        const uint64_t a_tag = DecodeBigEndian64(aptr + 8);
+        const uint64_t b_tag = DecodeBigEndian64(bptr + 8);
+        return a_tag < b_tag ? -1 : (a_tag > b_tag ? 1 : 0);
+    }
+    // 去除长度前缀, 按InternalKey比较
+    Slice a = GetLengthPrefixedSlice(aptr);
+    Slice b = GetLengthPrefixedSlice(bptr);
+    // 跳表和其他索引在同一个编译单元中实例化, 按字节比较时整个比较内联到查找循环中
+    if (bytewise) {
+        return CompareInternalKeys(BytewiseCompare(), a, b);
+    }
+    return CompareInternalKeys(VirtualCompare(comparator.userComparator()), a, b);
+}
+
+class MemTableIterator : public Iterator {
+public:
+    MemTableIterator(MemTable::Table* table, const MemTable::KeyComparator& comparator)
+        : iter_(table), comparator_(comparator) {}
+    MemTableIterator(const MemTableIterator&) = delete;
+    MemTableIterator& operator=(const MemTableIterator&) = delete;
+    ~MemTableIterator() override = default;
+
+    bool valid() const override { return iter_.valid(); }
+    void seek(const Slice& k) override { iter_.seek(comparator_.encodeTarget(&tmp_, k)); }
+    void seekToFirst() override { iter_.seekToFirst(); }
+    void seekToLast() override { iter_.seekToLast(); }
+    void next() override { iter_.next(); }
+    void prev() override { iter_.prev(); }
+    Slice key() const override { return comparator_.entryKey(iter_.key(), key_buf_); }
+    Slice value() const override { return comparator_.entryValue(iter_.key()); }
+
+    Status status() const override { return Status::success(); }
+
+private:
+    MemTable::Table::Iterator iter_;
+    const MemTable::KeyComparator& comparator_;
+    std::string tmp_;  // 用于seek时编码目标键
+    mutable char key_buf_[MemTable::KeyComparator::s_fixed_key_size];  // 用于还原规范化键
+};
+
+// 遍历HashLinkList, 第一次定位时收集当前所有的记录并排序, 之后在有序数组上移动,
+// 之后插入的记录对该迭代器不可见; 主要用于将memtable落盘
+class MemTableHashIterator : public Iterator {
+public:
+    MemTableHashIterator(const MemTable::HashTable* table, const MemTable::KeyComparator& comparator)
+        : table_(table), comparator_(comparator), built_(false), pos_(0) {}
+    MemTableHashIterator(const MemTableHashIterator&) = delete;
+    MemTableHashIterator& operator=(const MemTableHashIterator&) = delete;
+    ~MemTableHashIterator() override = default;
+
+    bool valid() const override { return pos_ < entries_.size(); }
+    void seek(const Slice& k) override {
+        build();
+        const char* target = comparator_.encodeTarget(&tmp_, k);
+        pos_ = std::lower_bound(entries_.begin(), entries_.end(), target,
+                                [this](const char* a, const char* b) { return comparator_(a, b) < 0; }) -
+               entries_.begin();
+    }
+    void seekToFirst() override {
+        build();
+        pos_ = 0;
+    }
+    void seekToLast() override {
+        build();
+        pos_ = entries_.empty() ? 0 : entries_.size() - 1;
+    }
+    void next() override {
+        assert(valid());
+        pos_++;
+    }
+    void prev() override {
+        assert(valid());
+        pos_ = (pos_ == 0) ? entries_.size() : pos_ - 1;  // 越过第一条记录后变为无效
+    }
+    Slice key() const override { return comparator_.entryKey(entries_[pos_], key_buf_); }
+    Slice value() const override { return comparator_.entryValue(entries_[pos_]); }
+
+    Status status() const override { return Status::success(); }
+
+private:
+    void build() {
+        if (!built_) {
+            table_->sortedKeys(&entries_);
+            built_ = true;
+        }
+    }
+
+    const MemTable::HashTable* const table_;
+    const MemTable::KeyComparator& comparator_;
+    bool built_;
+    std::vector<const char*> entries_;  // 按InternalKey排序的记录
+    size_t pos_;  // 等于entries_.size()时无效
+    std::string tmp_;  // 用于seek时编码目标键
+    mutable char key_buf_[MemTable::KeyComparator::s_fixed_key_size];  // 用于还原规范化键
+};
+
+class MemTableArtIterator : public Iterator {
+public:
+    MemTableArtIterator(MemTable::ArtTable* table, const MemTable::KeyComparator& comparator)
+        : iter_(table), comparator_(comparator) {}
+    MemTableArtIterator(const MemTableArtIterator&) = delete;
+    MemTableArtIterator& operator=(const MemTableArtIterator&) = delete;
+    ~MemTableArtIterator() override = default;
+
+    bool valid() const override { return iter_.valid(); }
+    void seek(const Slice& k) override { iter_.seek(comparator_.encodeTarget(&tmp_, k)); }
+    void seekToFirst() override { iter_.seekToFirst(); }
+    void seekToLast() override { iter_.seekToLast(); }
+    void next() override { iter_.next(); }
+    void prev() override { iter_.prev(); }
+    Slice key() const override { return comparator_.entryKey(iter_.key(), key_buf_); }
+    Slice value() const override { return comparator_.entryValue(iter_.key()); }
+
+    Status status() const override { return Status::success(); }
+
+private:
+    MemTable::ArtTable::Iterator iter_;
+    const MemTable::KeyComparator& comparator_;
+    std::string tmp_;  // 用于seek时编码目标键
+    mutable char key_buf_[MemTable::KeyComparator::s_fixed_key_size];  // 用于还原规范化键
+};
+
+Iterator* MemTable::newIterator() {
+    if (hash_table_ != nullptr) {
+        return new MemTableHashIterator(hash_table_.get(), comparator_);
+    }
+    if (art_table_ != nullptr) {
+        return new MemTableArtIterator(art_table_.get(), comparator_);
+    }
+    return new MemTableIterator(&table_, comparator_);
+}
+
+char* MemTable::encodeEntry(SequenceNumber seq, ValueType type, const Slice& key, const Slice& value) {
+    // 记录格式:
+    //  key_size     : varint32(internal_key.size()), 用户键固定为8字节时省略
+    //  key bytes    : char[internal_key.size()]
+    //  tag          : uint64((sequence << 8) | type), 用户键固定为8字节时为EncodeNormalizedTag(tag)
+    //  value_size   : varint32(value.size())
+    //  value bytes  : char[value.size()]
+    size_t key_size = key.size();
+    size_t val_size = value.size();
+    size_t internal_key_size = key_size + 8;
+    assert(!comparator_.fixed_key || internal_key_size == KeyComparator::s_fixed_key_size);  // 由checkKey()保证
+    const size_t key_prefix_len = comparator_.fixed_key ? 0 : VarintLength(internal_key_size);
+    const size_t encoded_len = key_prefix_len + internal_key_size + VarintLength(val_size) + val_size;
+    // 直接在arena中编码整条记录, 跳表只保存记录的起始地址
+    char* buf = arena_.allocate(encoded_len);
+    char* p = comparator_.fixed_key ? buf : EncodeVarint32(buf, internal_key_size);
+    std::memcpy(p, key.data(), key_size);
+    p += key_size;
+    const uint64_t tag = (seq << 8) | static_cast<uint64_t>(type);
+    if (comparator_.fixed_key) {
+        EncodeNormalizedTag(p, tag);
+    } else {
+        EncodeFixed64(p, tag);
+    }
+    p += 8;
+    p = EncodeVarint32(p, val_size);
+    std::memcpy(p, value.data(), val_size);
+    assert(p + val_size == buf + encoded_len);
+    return buf;
+}
+
+Status MemTable::checkKey(const Slice& key) const {
+    // 固定长度的记录格式没有键长度前缀, 其他长度的键写入后无法解码
+    if (comparator_.fixed_key && key.size() != 8) {
+        return Status::invalidArgument("user key must be 8 bytes with Uint64KeyComparator");
+    }
+    return Status::success();
+}
+
+Status MemTable::add(SequenceNumber seq, ValueType type, const Slice& key, const Slice& value) {
+    Status s = checkKey(key);
+    if (!s.ok()) {
+        return s;
+    }
+    const char* entry = encodeEntry(seq, type, key, value);
+    if (hash_table_ != nullptr) {
+        hash_table_->insert(entry);
+    } else if (art_table_ != nullptr) {
+        art_table_->insert(entry);
+    } else {
+        // 按时间顺序写入的键可以复用上一次插入的前驱
+        table_.insertWithHint(entry);
+    }
+    return s;
+}
+
+Status MemTable::concurrentAdd(SequenceNumber seq, ValueType type, const Slice& key, const Slice& value) {
+    Status s = checkKey(key);
+    if (!s.ok()) {
+        return s;
+    }
+    const char* entry = encodeEntry(seq, type, key, value);
+    if (hash_table_ != nullptr) {
+        hash_table_->concurrentInsert(entry);
+    } else if (art_table_ != nullptr) {
+        art_table_->concurrentInsert(entry);
+    } else {
+        table_.concurrentInsert(entry);
+    }
+    return s;
+}
+
+bool MemTable::get(const LookupKey& key, std::string* value, Status* s) {
+    Slice v;
+    bool deleted;
+    if (!getEntry(key, &v, &deleted)) {
+        return false;
+    }
+    if (deleted) {
+        *s = Status::notFound(Slice());
+    } else {
+        value->assign(v.data(), v.size());
+    }
+    return true;
+}
+
+static void UnrefMemTable(void* arg1, void* /*arg2*/) {
+    static_cast<MemTable*>(arg1)->unref();
+}
+
+bool MemTable::get(const LookupKey& key, PinnableSlice* value, Status* s) {
+    Slice v;
+    bool deleted;
+    if (!getEntry(key, &v, &deleted)) {
+        return false;
+    }
+    if (deleted) {
+        *s = Status::notFound(Slice());
+    } else {
+        // arena中的记录在memtable销毁之前不会移动或释放
+        ref();
+        value->pinSlice(v, &UnrefMemTable, this, nullptr);
+    }
+    return true;
+}
+
+bool MemTable::getEntry(const LookupKey& key, Slice* value, bool* deleted) {
+    if (comparator_.fixed_key && key.userKey().size() != 8) {
+        return false;  // 只可能保存8字节的键
+    }
+    // LookupKey已经是带长度前缀的编码, 直接seek, 不需要构造临时字符串; 用户键固定为8字节时在栈上编码规范化键
+    char fixed_key[KeyComparator::s_fixed_key_size];
+    Slice memkey = key.memtableKey();
+    if (comparator_.fixed_key) {
+        comparator_.encodeFixedKey(fixed_key, key.internalKey());
+        memkey = Slice(fixed_key, sizeof(fixed_key));
+    }
+    // 序列号按降序排列, seek得到的是序列号<=快照序列号的最新记录
+    const char* entry = nullptr;
+    if (hash_table_ != nullptr) {
+        // 同一个user_key的记录都在memkey所在的桶中
+        hash_table_->seek(memkey.data(), &entry);
+    } else if (art_table_ != nullptr) {
+        // 只查找user_key对应的叶结点, 不需要定位到后继
+        art_table_->find(memkey.data(), &entry);
+    } else {
+        Table::Iterator iter(&table_);
+        iter.seek(memkey.data());
+        if (iter.valid()) {
+            entry = iter.key();
+        }
+    }
+    if (entry != nullptr) {
+        // 检查找到的记录是否属于同一个user_key
+        const Slice user_key = comparator_.entryUserKey(entry);
+        const bool same_key = comparator_.bytewise
+                                  ? user_key == key.userKey()
+                                  : comparator_.comparator.userComparator()->compare(user_key, key.userKey()) == 0;
+        if (same_key) {
+            const uint64_t tag = comparator_.entryTag(entry);
+            switch (static_cast<ValueType>(tag & 0xff)) {
+                case ValueType::TypeValue:
+                    *value = comparator_.entryValue(entry);
+                    *deleted = false;
+                    return true;
+                case ValueType::TypeDeletion:
+                    *deleted = true;
+                    return true;
+            }
+        }
+    }
+    return false;
+}
+
+}
@@ -0,0 +1,128 @@
+/*
+ * 内存表, 写入的数据先保存在memtable中, 达到write_buffer_size后再落盘
+ * 每条记录只在arena中编码一次, 由跳表索引记录的起始地址
+*/
+#ifndef D_KVSTORAGE_MEMTABLE_H
+#define D_KVSTORAGE_MEMTABLE_H
+
+#include <atomic>
+#include <memory>
+#include <string>
+
+#include "adaptive_radix_tree.h"
+#include "db_format.h"
+#include "hash_link_list.h"
+#include "iterator.h"
+#include "options.h"
+#include "skiplist.h"
+#include "util/concurrent_arena.h"
+
+namespace kvstorage {
+
+class MemTableIterator;
+class MemTableHashIterator;
+class MemTableArtIterator;
+
+class MemTable {
+public:
+    // 使用引用计数管理生命周期, 初始引用计数为0, 调用者需要至少调用一次ref()
+    explicit MemTable(const InternalKeyComparator& comparator);
+    // 根据options中的arena_block_size, write_buffer_size和memtable_huge_page配置arena,
+    // 根据memtable_rep选择索引结构
+    MemTable(const InternalKeyComparator& comparator, const Options& options);
+    MemTable(const InternalKeyComparator& comparator, size_t arena_block_size, bool use_huge_page,
+             ArenaBlockPool* pool = nullptr);
+    MemTable(const MemTable&) = delete;
+    MemTable& operator=(const MemTable&) = delete;
+
+public:
+    // 引用计数是原子的, PinnableSlice可以在任意线程释放对memtable的引用
+    void ref() { refs_.fetch_add(1, std::memory_order_relaxed); }
+    void unref() {
+        const int refs = refs_.fetch_sub(1, std::memory_order_acq_rel) - 1;
+        assert(refs >= 0);
+        if (refs <= 0) {
+            delete this;
+        }
+    }
+
+    // 返回memtable占用的内存, 直接取arena已分配的内存, 超过write_buffer_size时应当切换memtable
+    // 可以在修改memtable时调用
+    size_t approximateMemoryUsage();
+
+    // 返回一个遍历memtable的迭代器, 迭代器存活期间memtable不能被销毁
+    // 迭代器返回的key是InternalKey
+    Iterator* newIterator();
+
+    // 添加一条记录, 将key映射到指定类型和序列号的value, type == TypeDeletion时value通常为空
+    // 用户比较器是Uint64KeyComparator时key必须是8字节, 否则不写入并返回InvalidArgument
+    Status add(SequenceNumber seq, ValueType type, const Slice& key, const Slice& value);
+
+    // 和add()相同, 但可以由多个写线程同时调用; 不能和add()同时调用
+    Status concurrentAdd(SequenceNumber seq, ValueType type, const Slice& key, const Slice& value);
+
+    // 如果memtable中有key对应的值, 保存到value中并返回true;
+    // 如果memtable中有key的删除标记, 在s中保存NotFound并返回true; 否则返回false
+    bool get(const LookupKey& key, std::string* value, Status* s);
+    // 和get()相同, 但value直接引用arena中的数据, 不复制; value持有memtable的一个引用, 释放时unref()
+    bool get(const LookupKey& key, PinnableSlice* value, Status* s);
+
+private:
+    friend class MemTableIterator;
+    friend class MemTableHashIterator;
+    friend class MemTableArtIterator;
+
+    // 比较跳表中的两条记录, 记录以varint32长度前缀 + InternalKey开头
+    // 用户比较器是Uint64KeyComparator时键的长度固定, 记录以16字节的规范化键开头:
+    // 8字节user_key | EncodeNormalizedTag(tag), 按字节比较即为InternalKey的顺序
+    struct KeyComparator {
+        static const size_t s_fixed_key_size = 8 + 8;  // 规范化键的长度
+
+        const InternalKeyComparator comparator;
+        const bool bytewise;  // 用户键是否按字节比较, 只有按字节比较时前缀才保序
+        const bool fixed_key;  // 用户键是否是8字节整数, 是时记录中没有键的长度前缀
+        explicit KeyComparator(const InternalKeyComparator& c);
+        int operator()(const char* a, const char* b) const;
+        // 返回记录中的InternalKey; 键定长时记录中保存的是规范化键, 还原到scratch(s_fixed_key_size字节)中
+        Slice entryKey(const char* entry, char* scratch) const;
+        Slice entryUserKey(const char* entry) const;
+        uint64_t entryTag(const char* entry) const;
+        Slice entryValue(const char* entry) const;
+        // 把8字节user_key的InternalKey编码为规范化键, dst至少有s_fixed_key_size字节
+        void encodeFixedKey(char* dst, const Slice& internal_key) const;
+        // 把seek的目标InternalKey编码为记录的格式, 需要时使用scratch保存编码结果
+        const char* encodeTarget(std::string* scratch, const Slice& target) const;
+        // user_key前8字节按大端序组成的整数, 跳表结点缓存该前缀, 前缀不同时不需要访问记录本身
+        uint64_t keyPrefix(const char* entry) const;
+        // user_key的哈希值, 同一个user_key的所有记录在HashLinkList的同一个桶中
+        uint32_t keyHash(const char* entry) const;
+        // 返回user_key, AdaptiveRadixTree按它的字节建立索引
+        Slice keyBytes(const char* entry) const;
+    };
+
+    // 保存最底层的后向指针, 反向遍历memtable时每一步只需要一次指针访问
+    using Table = SkipList<const char*, KeyComparator, ConcurrentArena, true>;
+    using HashTable = HashLinkList<const char*, KeyComparator, ConcurrentArena>;
+    using ArtTable = AdaptiveRadixTree<const char*, KeyComparator, ConcurrentArena>;
+
+    ~MemTable();  // 私有析构, 只能通过unref()销毁
+    // 检查key能否按当前的记录格式编码
+    Status checkKey(const Slice& key) const;
+    // 在arena中编码一条记录, 返回记录的起始地址
+    char* encodeEntry(SequenceNumber seq, ValueType type, const Slice& key, const Slice& value);
+    // 查找key, 找到值或删除标记时返回true, 找到值时value指向arena中的数据
+    bool getEntry(const LookupKey& key, Slice* value, bool* deleted);
+
+private:
+    KeyComparator comparator_;
+    std::atomic<int> refs_;
+    ConcurrentArena arena_;  // 单写者时分配只走分片的无锁路径, 同时支持并发写入
+    Table table_;
+    // 两者最多一个不为空, 不为空时使用对应的索引, 不再使用table_
+    std::unique_ptr<HashTable> hash_table_;
+    std::unique_ptr<ArtTable> art_table_;
+};
+
+}
+
+#endif
@@ -1,28 +1,93 @@
 #ifndef D_KVSTORAGE_SKIPLIST_H
 #define D_KVSTORAGE_SKIPLIST_H
 
+#include <algorithm>
 #include <atomic>
 #include <cassert>
+#include <cstdint>
 #include <cstdlib>
+#include <functional>
+#include <thread>
+#include <type_traits>
+#include <utility>
 
 #include "util/arena.h"
 #include "util/random.h"
 
+// 查找和遍历时预取后续要访问的结点, 编译时定义为0可以关闭
+#ifndef KVSTORAGE_SKIPLIST_PREFETCH
+#define KVSTORAGE_SKIPLIST_PREFETCH 1
+#endif
+
 namespace kvstorage {
 
-template <typename Key, class Comparator>
+// 比较器提供uint64_t keyPrefix(const Key&) const时, 跳表结点额外缓存键的前缀,
+// 要求前缀保序: keyPrefix(a) < keyPrefix(b)时a < b, 前缀相等时再比较完整的键
+template <typename Comparator, typename Key, typename = void>
+struct HasKeyPrefix : std::false_type {};
+
+template <typename Comparator, typename Key>
+struct HasKeyPrefix<Comparator, Key,
+        std::void_t<decltype(std::declval<const Comparator&>().keyPrefix(std::declval<const Key&>()))>>
+    : std::true_type {};
+
+// 跳表结点中的键前缀, 不使用前缀时为空基类, 不占用空间
+template <bool UsePrefix>
+struct SkipListNodePrefix {
+    uint64_t prefix() const { return 0; }
+    void setPrefix(uint64_t) {}
+};
+
+template <>
+struct SkipListNodePrefix<true> {
+    uint64_t prefix() const { return key_prefix; }
+    void setPrefix(uint64_t p) { key_prefix = p; }
+    uint64_t key_prefix;  // 和key, nexts_放在一起, 大部分比较不需要访问键指向的内存
+};
+
+// 跳表结点在最底层的后向指针, 不使用时为空基类, 不占用空间
+template <typename NodeT, bool UseBackLink>
+struct SkipListNodeBackLink {};
+
+template <typename NodeT>
+struct SkipListNodeBackLink<NodeT, true> {
+    NodeT* prevNode() const { return back_link.load(std::memory_order_acquire); }
+    void setPrevNode(NodeT* x) { back_link.store(x, std::memory_order_release); }
+    void noBarrierSetPrevNode(NodeT* x) { back_link.store(x, std::memory_order_relaxed); }
+    bool casPrevNode(NodeT* expected, NodeT* x) {
+        return back_link.compare_exchange_strong(expected, x, std::memory_order_release, std::memory_order_relaxed);
+    }
+    // 第一个结点指向head_; head_的后向指针指向最后一个结点, 跳表为空时指向自身
+    std::atomic<NodeT*> back_link;
+};
+
+// Allocator需要提供allocateAligned(size_t), 默认使用单线程的Arena;
+// 使用concurrentInsert时需要传入线程安全的分配器, 例如ConcurrentArena
+// Reversible为true时结点额外保存最底层的前驱, Iterator::prev()和seekToLast()不再需要从head_查找
+template <typename Key, class Comparator, class Allocator = Arena, bool Reversible = false>
 class SkipList {
 private:
     struct Node;
 
 public:
-    explicit SkipList(Comparator cmp, Arena* arena);
+    explicit SkipList(Comparator cmp, Allocator* arena);
     SkipList(const SkipList&) = delete;
     SkipList& operator=(const SkipList&) = delete;
 
 public:
-    void insert(const Key& key);
+    void insert(const Key& key);  // 需要外部同步, 同一时刻只能有一个写者
+    // 多写者并发插入, 各层通过CAS链接, 失败时重新定位前驱后重试; 不能和insert()并发调用
+    void concurrentInsert(const Key& key);
+    // 和insert()相同, 但key位于上一次插入的键之后时, 从上一次插入记录的各层前驱开始查找,
+    // 不再从head_重新下降, 适用于按顺序追加写入; 需要外部同步
+    void insertWithHint(const Key& key);
     bool contains(const Key& key) const;
+    uint64_t hintHits() const { return hint_hits_; }  // insertWithHint复用前驱的次数
+    uint64_t hintMisses() const { return hint_misses_; }  // insertWithHint从head_查找的次数
+    double hintHitRate() const;
+    // 检查每个结点的后向指针都指向它在最底层的直接前驱, head_的后向指针指向最后一个结点;
+    // Reversible为false时总是返回true; 不能和写入并发调用, 供测试使用
+    bool verifyBackLinks() const;
 
     class Iterator {
     public:
@@ -36,31 +101,59 @@ public:
         inline void seekToLast();   // 移动到最后一个结点
     
     private:
+        friend class SkipList;  // seekBatch直接设置node_
+
         const SkipList* list_;
         Node* node_;
     };
 
+    // 批量查找, 等价于对每个i调用iters[i].seek(targets[i]); 多个查找的下降过程交错进行,
+    // 每一步先为所有查找预取下一个结点再逐个比较, 使它们的cache miss重叠
+    void seekBatch(const Key* targets, int n, Iterator* iters) const;
+
 private:
     inline int getMaxHeight() const;
+    static void prefetch(const void* addr);
+    static void prefetchKey(const Key& key);  // Key是指针时预取它指向的内存
     Node* newNode(const Key& key, int height);  // 创建一个指定高度的跳表结点
     int randomHeight();
+    int concurrentRandomHeight();  // 使用线程局部的随机数生成器, 供并发插入使用
+    static int randomHeight(Random* rnd);
     bool equal(const Key& a, const Key& b) const;
-    bool keyIsAfterNode(const Key& key, Node* n) const;
+    uint64_t keyPrefix(const Key& key) const;  // 不使用前缀时返回0
+    // key_prefix是keyPrefix(key), 由调用者在一次查找中只计算一次
+    bool keyIsAfterNode(const Key& key, uint64_t key_prefix, Node* n) const;
     Node* findGreateOrEqual(const Key& key, Node** prev) const;
+    // 从hint_prev_开始查找>= key的结点, 要求hint_prev_中的结点都 < key
+    Node* findGreaterOrEqualWithHint(const Key& key, Node** prev) const;
+    void linkNode(const Key& key, Node** prev);  // 在prev记录的前驱之后插入新结点, 并更新hint_prev_
+    // 并发插入x后更新其后继(没有后继时为head_)的后向指针, 只在x比原来的前驱更靠后时更新
+    void raiseBackLink(Node* succ, Node* x);
     Node* findLessThan(const Key& key) const;
     Node* findLast() const;
+    // 从before开始沿level层向后查找, 得到key在该层的前驱和后继
+    void findSpliceForLevel(const Key& key, uint64_t key_prefix, Node* before, int level,
+                            Node** out_prev, Node** out_next) const;
 
 private:
     static constexpr int s_max_height_ = 12;
+    static constexpr int s_max_batch_size_ = 16;  // seekBatch每轮交错进行的查找数量
+    static constexpr bool s_use_key_prefix_ = HasKeyPrefix<Comparator, Key>::value;
     Comparator const compare_;
-    Arena* const arena_;
+    Allocator* const arena_;
     Node* const head_;  // 跳表的头节点, 不存数据
     std::atomic<int> max_height_;  // 当前的最大高度
     Random rnd_;
+    // 上一次单写者插入时每一层的前驱, 插入结点的高度以内为插入结点本身
+    // 所有结点的键都 <= hint_prev_[0]的键
+    Node* hint_prev_[s_max_height_];
+    uint64_t hint_hits_;
+    uint64_t hint_misses_;
 };
 
-template <typename Key, class Comparator>
-struct SkipList<Key, Comparator>::Node {
+template <typename Key, class Comparator, class Allocator, bool Reversible>
+struct SkipList<Key, Comparator, Allocator, Reversible>::Node
+    : public SkipListNodePrefix<s_use_key_prefix_>, public SkipListNodeBackLink<Node, Reversible> {
 public:
     Key const key;
     explicit Node(const Key& k) : key(k) {}
@@ -87,26 +180,83 @@ public:
         nexts_[n].store(x, std::memory_order_relaxed);
     }
 
+    // 只有当前后继仍为expected时才设置为x, 成功时使用release语义, 与next()的acquire配对
+    bool casNext(int n, Node* expected, Node* x) {
+        assert(n >= 0);
+        return nexts_[n].compare_exchange_strong(expected, x, std::memory_order_release, std::memory_order_relaxed);
+    }
+
 private:
     std::atomic<Node*> nexts_[1];  // 跳表结点，使用柔性数组, 给所有的next分配连续的内存
 };
 
-template <typename Key, class Comparator>
-SkipList<Key, Comparator>::SkipList(Comparator cmp, Arena* arena)
-    : compare_(cmp), arena_(arena), head_(newNode(0, s_max_height_)), max_height_(1), rnd_(0xdeadbeef) {
+template <typename Key, class Comparator, class Allocator, bool Reversible>
+SkipList<Key, Comparator, Allocator, Reversible>::SkipList(Comparator cmp, Allocator* arena)
+    : compare_(cmp), arena_(arena), head_(newNode(0, s_max_height_)), max_height_(1), rnd_(0xdeadbeef),
+      hint_hits_(0), hint_misses_(0) {
     for (int i = 0; i < s_max_height_; ++i) {
         head_->setNext(i, nullptr);  // 头节点层数为s_max_height_
+        hint_prev_[i] = head_;
+    }
+    if constexpr (Reversible) {
+        head_->noBarrierSetPrevNode(head_);
     }
 }
 
 
-template <typename Key, class Comparator>
-void SkipList<Key, Comparator>::insert(const Key& key) {
+template <typename Key, class Comparator, class Allocator, bool Reversible>
+void SkipList<Key, Comparator, Allocator, Reversible>::insert(const Key& key) {
     Node* prev[s_max_height_];  // 记录每一层的前驱
     Node* x = findGreateOrEqual(key, prev);  // 获取每一层的前驱
 
-    assert(x == nullptr || !equal(key, x->key));
+    assert(x == nullptr || !equal(key, x->key));  // 不允许插入重复的键
+    (void)x;  // 只在assert中使用
+    linkNode(key, prev);
+}
+
+template <typename Key, class Comparator, class Allocator, bool Reversible>
+void SkipList<Key, Comparator, Allocator, Reversible>::insertWithHint(const Key& key) {
+    Node* prev[s_max_height_];
+    Node* x;
+    Node* last = hint_prev_[0];
+    if (last != head_ && compare_(last->key, key) < 0) {
+        // key在上一次插入的键之后, hint_prev_中的结点都是key的前驱, 可以直接作为查找起点
+        ++hint_hits_;
+        x = findGreaterOrEqualWithHint(key, prev);
+    } else {
+        ++hint_misses_;
+        x = findGreateOrEqual(key, prev);
+    }
+
+    assert(x == nullptr || !equal(key, x->key));  // 不允许插入重复的键
+    (void)x;  // 只在assert中使用
+    linkNode(key, prev);
+}
+
+template <typename Key, class Comparator, class Allocator, bool Reversible>
+double SkipList<Key, Comparator, Allocator, Reversible>::hintHitRate() const {
+    const uint64_t total = hint_hits_ + hint_misses_;
+    return total == 0 ? 0.0 : static_cast<double>(hint_hits_) / total;
+}
 
+template <typename Key, class Comparator, class Allocator, bool Reversible>
+bool SkipList<Key, Comparator, Allocator, Reversible>::verifyBackLinks() const {
+    if constexpr (Reversible) {
+        Node* prev = head_;
+        for (Node* x = head_->next(0); x != nullptr; x = x->next(0)) {
+            if (x->prevNode() != prev) {
+                return false;
+            }
+            prev = x;
+        }
+        return head_->prevNode() == prev;
+    } else {
+        return true;
+    }
+}
+
+template <typename Key, class Comparator, class Allocator, bool Reversible>
+void SkipList<Key, Comparator, Allocator, Reversible>::linkNode(const Key& key, Node** prev) {
     int height = randomHeight();
     if (height > getMaxHeight()) {
         for (int i = getMaxHeight(); i < height; i++) {
@@ -115,17 +265,147 @@ void SkipList<Key, Comparator>::insert(const Key& key) {
         max_height_.store(height, std::memory_order_relaxed);
     }
 
-    x = newNode(key, height);
+    Node* x = newNode(key, height);
+    x->setPrefix(keyPrefix(key));
+    if constexpr (Reversible) {
+        x->noBarrierSetPrevNode(prev[0]);  // 在x对读者可见之前设置
+    }
     // 插入结点，更新每一层的前驱和后继
     for (int i = 0; i < height; i++) {
         x->noBarrierSetNext(i, prev[i]->noBarrierNext(i));  // 获取前驱原来的后继，设置为插入结点的后继
         prev[i]->setNext(i, x);  // 设置前驱的后继为插入结点
+        hint_prev_[i] = x;  // 下一个更大的键在这一层的前驱就是x
+    }
+    if constexpr (Reversible) {
+        // x已经在最底层可见, 读者通过后向指针访问到x时x一定已经初始化
+        Node* succ = x->noBarrierNext(0);
+        (succ == nullptr ? head_ : succ)->setPrevNode(x);
+    }
+    for (int i = height; i < getMaxHeight(); i++) {
+        hint_prev_[i] = prev[i];
+    }
+}
+
+template <typename Key, class Comparator, class Allocator, bool Reversible>
+void SkipList<Key, Comparator, Allocator, Reversible>::concurrentInsert(const Key& key) {
+    int height = concurrentRandomHeight();
+    // 使用CAS提升max_height_, 其他写者可能同时提升, 失败时max_height重新加载为最新值
+    int max_height = max_height_.load(std::memory_order_relaxed);
+    while (height > max_height) {
+        if (max_height_.compare_exchange_weak(max_height, height, std::memory_order_relaxed)) {
+            break;
+        }
+    }
+
+    // 自顶向下计算每一层的前驱和后继, 高于旧max_height的层前驱为head_
+    Node* prev[s_max_height_];
+    Node* next[s_max_height_];
+    Node* before = head_;
+    const uint64_t key_prefix = keyPrefix(key);
+    for (int level = std::max(height, getMaxHeight()) - 1; level >= 0; --level) {
+        findSpliceForLevel(key, key_prefix, before, level, &prev[level], &next[level]);
+        before = prev[level];
+    }
+    assert(next[0] == nullptr || !equal(key, next[0]->key));
+
+    Node* x = newNode(key, height);
+    x->setPrefix(key_prefix);
+    // 自底向上链接, 保证读者在高层看到x时, x在低层中也已经可见
+    for (int i = 0; i < height; i++) {
+        while (true) {
+            x->noBarrierSetNext(i, next[i]);
+            if constexpr (Reversible) {
+                if (i == 0) {
+                    x->noBarrierSetPrevNode(prev[0]);
+                }
+            }
+            if (prev[i]->casNext(i, next[i], x)) {
+                break;
+            }
+            // CAS失败说明其他写者在prev[i]和next[i]之间插入了结点, prev[i]仍小于key, 从它开始重新定位
+            findSpliceForLevel(key, key_prefix, prev[i], i, &prev[i], &next[i]);
+        }
+        if constexpr (Reversible) {
+            if (i == 0) {
+                raiseBackLink(next[0], x);
+            }
+        }
+    }
+}
+
+template <typename Key, class Comparator, class Allocator, bool Reversible>
+void SkipList<Key, Comparator, Allocator, Reversible>::raiseBackLink(Node* succ, Node* x) {
+    // 其他写者可能同时在succ之前插入结点, 后向指针只向更靠后的结点移动,
+    // 所有写者完成后succ的后向指针就是它在最底层的直接前驱
+    Node* target = (succ == nullptr) ? head_ : succ;
+    while (true) {
+        Node* cur = target->prevNode();
+        if (cur != head_ && compare_(cur->key, x->key) > 0) {
+            return;
+        }
+        if (target->casPrevNode(cur, x)) {
+            return;
+        }
     }
 }
 
-template <typename Key, class Comparator>
-bool SkipList<Key, Comparator>::contains(const Key& key) const {
-    Node* x = findGreaterOrEqual(key, nullptr);
+template <typename Key, class Comparator, class Allocator, bool Reversible>
+void SkipList<Key, Comparator, Allocator, Reversible>::seekBatch(const Key* targets, int n, Iterator* iters) const {
+    while (n > 0) {
+        const int m = std::min(n, s_max_batch_size_);
+        Node* x[s_max_batch_size_];
+        Node* next[s_max_batch_size_];
+        int level[s_max_batch_size_];
+        uint64_t prefix[s_max_batch_size_];
+        bool done[s_max_batch_size_];
+        const int max_level = getMaxHeight() - 1;
+        for (int i = 0; i < m; i++) {
+            x[i] = head_;
+            level[i] = max_level;
+            prefix[i] = keyPrefix(targets[i]);
+            done[i] = false;
+        }
+        int remaining = m;
+        while (remaining > 0) {
+            // 先发出所有查找下一步要访问的结点的预取, 这些访问互不依赖, 可以同时进行
+            for (int i = 0; i < m; i++) {
+                if (!done[i]) {
+                    next[i] = x[i]->next(level[i]);
+                    prefetch(next[i]);
+                }
+            }
+            // 结点的预取同时进行时发出各自键的预取, Key不是指针时没有操作
+            for (int i = 0; i < m; i++) {
+                if (!done[i] && next[i] != nullptr) {
+                    prefetchKey(next[i]->key);
+                }
+            }
+            // 再逐个完成比较, 每个查找前进一步
+            for (int i = 0; i < m; i++) {
+                if (done[i]) {
+                    continue;
+                }
+                if (keyIsAfterNode(targets[i], prefix[i], next[i])) {
+                    x[i] = next[i];
+                } else if (level[i] == 0) {
+                    assert(iters[i].list_ == this);
+                    iters[i].node_ = next[i];
+                    done[i] = true;
+                    remaining--;
+                } else {
+                    level[i]--;
+                }
+            }
+        }
+        targets += m;
+        iters += m;
+        n -= m;
+    }
+}
+
+template <typename Key, class Comparator, class Allocator, bool Reversible>
+bool SkipList<Key, Comparator, Allocator, Reversible>::contains(const Key& key) const {
+    Node* x = findGreateOrEqual(key, nullptr);
     if (x != nullptr && equal(key, x->key)) {
         return true;
     } else {
@@ -133,22 +413,34 @@ bool SkipList<Key, Comparator>::contains(const Key& key) const {
     }
 }
 
-template <typename Key, class Comparator>
-int SkipList<Key, Comparator>::getMaxHeight() const { return max_height_.load(std::memory_order_relaxed); }
+template <typename Key, class Comparator, class Allocator, bool Reversible>
+int SkipList<Key, Comparator, Allocator, Reversible>::getMaxHeight() const { return max_height_.load(std::memory_order_relaxed); }
 
-template <typename Key, class Comparator>
-typename SkipList<Key, Comparator>::Node* SkipList<Key, Comparator>::newNode(const Key& key, int height) {
+template <typename Key, class Comparator, class Allocator, bool Reversible>
+typename SkipList<Key, Comparator, Allocator, Reversible>::Node* SkipList<Key, Comparator, Allocator, Reversible>::newNode(const Key& key, int height) {
     char* const node_memory = arena_->allocateAligned(
         sizeof(Node) + sizeof(std::atomic<Node*>) * (height - 1));
     return new (node_memory) Node(key);  // 定位new, 配合柔性数组，创建长度为height的nexts_
 }
 
-template <typename Key, class Comparator>
-int SkipList<Key, Comparator>::randomHeight() {
+template <typename Key, class Comparator, class Allocator, bool Reversible>
+int SkipList<Key, Comparator, Allocator, Reversible>::randomHeight() {
+    return randomHeight(&rnd_);
+}
+
+template <typename Key, class Comparator, class Allocator, bool Reversible>
+int SkipList<Key, Comparator, Allocator, Reversible>::concurrentRandomHeight() {
+    // rnd_不是线程安全的, 每个写线程使用各自的随机数生成器
+    static thread_local Random rnd(static_cast<uint32_t>(std::hash<std::thread::id>()(std::this_thread::get_id())));
+    return randomHeight(&rnd);
+}
+
+template <typename Key, class Comparator, class Allocator, bool Reversible>
+int SkipList<Key, Comparator, Allocator, Reversible>::randomHeight(Random* rnd) {
     static const unsigned int kBranching = 4;
     int height = 1;
     // oneIn(kBranching) 以约1/kBranching的概率返回true, 所以75%的概率 height = 1, 1/4 * 3/4的概率h = 2;
-    while (height < s_max_height_ && rnd_.oneIn(kBranching)) {
+    while (height < s_max_height_ && rnd->oneIn(kBranching)) {
       height++;
     }
     assert(height > 0);
@@ -156,24 +448,66 @@ int SkipList<Key, Comparator>::randomHeight() {
     return height;
 }
 
-template <typename Key, class Comparator>
-bool SkipList<Key, Comparator>::equal(const Key& a, const Key& b) const {
+template <typename Key, class Comparator, class Allocator, bool Reversible>
+bool SkipList<Key, Comparator, Allocator, Reversible>::equal(const Key& a, const Key& b) const {
     return (compare_(a, b) == 0);
 }
 
-template <typename Key, class Comparator>
-bool SkipList<Key, Comparator>::keyIsAfterNode(const Key& key, Node* n) const {
-    return (n != nullptr) && (compare_(n->key, key) < 0);
+template <typename Key, class Comparator, class Allocator, bool Reversible>
+void SkipList<Key, Comparator, Allocator, Reversible>::prefetch(const void* addr) {
+#if KVSTORAGE_SKIPLIST_PREFETCH && (defined(__GNUC__) || defined(__clang__))
+    __builtin_prefetch(addr, 0, 3);  // 只读, 尽量保留在各级缓存中
+#else
+    (void)addr;
+#endif
+}
+
+template <typename Key, class Comparator, class Allocator, bool Reversible>
+void SkipList<Key, Comparator, Allocator, Reversible>::prefetchKey(const Key& key) {
+    if constexpr (std::is_pointer<Key>::value) {
+        prefetch(key);
+    } else {
+        (void)key;
+    }
+}
+
+template <typename Key, class Comparator, class Allocator, bool Reversible>
+uint64_t SkipList<Key, Comparator, Allocator, Reversible>::keyPrefix(const Key& key) const {
+    if constexpr (s_use_key_prefix_) {
+        return compare_.keyPrefix(key);
+    } else {
+        return 0;
+    }
 }
 
-template <typename Key, class Comparator>
-typename SkipList<Key, Comparator>::Node* 
-SkipList<Key, Comparator>::findGreateOrEqual(const Key& key, Node** prev) const {
+template <typename Key, class Comparator, class Allocator, bool Reversible>
+bool SkipList<Key, Comparator, Allocator, Reversible>::keyIsAfterNode(const Key& key, uint64_t key_prefix, Node* n) const {
+    if (n == nullptr) {
+        return false;
+    }
+    if constexpr (s_use_key_prefix_) {
+        // 前缀不同时可以直接确定顺序, 不需要访问完整的键
+        if (n->prefix() != key_prefix) {
+            return n->prefix() < key_prefix;
+        }
+    }
+    return compare_(n->key, key) < 0;
+}
+
+template <typename Key, class Comparator, class Allocator, bool Reversible>
+typename SkipList<Key, Comparator, Allocator, Reversible>::Node* 
+SkipList<Key, Comparator, Allocator, Reversible>::findGreateOrEqual(const Key& key, Node** prev) const {
     Node* x = head_;
     int level = getMaxHeight() - 1;
+    const uint64_t key_prefix = keyPrefix(key);
     while (true) {
         Node* next = x->next(level);
-        if (keyIsAfterNode(key, next)) {
+        if (next != nullptr) {
+            // Key是指针时(例如memtable中指向arena的记录)键和结点不在同一缓存行, 先发出键的预取再比较前缀
+            prefetchKey(next->key);
+            prefetch(next->noBarrierNext(level));  // 和next的比较同时进行, 如果继续向后查找, 下一个结点已经在缓存中
+        }
+        if (keyIsAfterNode(key, key_prefix, next)) {
             // key在next结点之后，则更新next直到找到 >= key的结点或者nullptr
             x = next;
         } else {
@@ -187,15 +521,38 @@ SkipList<Key, Comparator>::findGreateOrEqual(const Key& key, Node** prev) const
     }
 }
 
-template <typename Key, class Comparator>
-typename SkipList<Key, Comparator>::Node* 
-SkipList<Key, Comparator>::findLessThan(const Key& key) const {
+template <typename Key, class Comparator, class Allocator, bool Reversible>
+typename SkipList<Key, Comparator, Allocator, Reversible>::Node* 
+SkipList<Key, Comparator, Allocator, Reversible>::findGreaterOrEqualWithHint(const Key& key, Node** prev) const {
+    Node* next = nullptr;
+    Node* below = head_;  // 上一层找到的前驱, 在当前层同样存在
+    const uint64_t key_prefix = keyPrefix(key);
+    for (int level = getMaxHeight() - 1; level >= 0; --level) {
+        // 在上一次的前驱和上一层找到的前驱中取靠后的一个作为起点, 两者都 < key
+        Node* x = hint_prev_[level];
+        if (x == head_ || (below != head_ && compare_(x->key, below->key) < 0)) {
+            x = below;
+        }
+        findSpliceForLevel(key, key_prefix, x, level, &prev[level], &next);
+        below = prev[level];
+    }
+    return next;
+}
+
+template <typename Key, class Comparator, class Allocator, bool Reversible>
+typename SkipList<Key, Comparator, Allocator, Reversible>::Node* 
+SkipList<Key, Comparator, Allocator, Reversible>::findLessThan(const Key& key) const {
     Node* x = head_;
     int level = getMaxHeight() - 1;
+    const uint64_t key_prefix = keyPrefix(key);
     while (true) {
         assert(x == head_ || compare_(x->key, key) < 0);
         Node* next = x->next(level);
-        if (next == nullptr || compare_(next->key, key) >= 0) {
+        if (next != nullptr) {
+            prefetchKey(next->key);
+            prefetch(next->noBarrierNext(level));
+        }
+        if (!keyIsAfterNode(key, key_prefix, next)) {
             // 当前遍历到的结点的next为nullptr或者next->key >= key
             if (level == 0) {
               return x;  // level == 0, 则找到了 <= key的最大结点
@@ -208,9 +565,9 @@ SkipList<Key, Comparator>::findLessThan(const Key& key) const {
     }
 }
 
-template <typename Key, class Comparator>
-typename SkipList<Key, Comparator>::Node* 
-SkipList<Key, Comparator>::findLast() const {
+template <typename Key, class Comparator, class Allocator, bool Reversible>
+typename SkipList<Key, Comparator, Allocator, Reversible>::Node* 
+SkipList<Key, Comparator, Allocator, Reversible>::findLast() const {
     Node* x = head_;
     int level = getMaxHeight() - 1;
     while (true) {
@@ -227,52 +584,90 @@ SkipList<Key, Comparator>::findLast() const {
     }
 }
 
+template <typename Key, class Comparator, class Allocator, bool Reversible>
+void SkipList<Key, Comparator, Allocator, Reversible>::findSpliceForLevel(
+        const Key& key, uint64_t key_prefix, Node* before, int level, Node** out_prev, Node** out_next) const {
+    while (true) {
+        Node* after = before->next(level);
+        if (keyIsAfterNode(key, key_prefix, after)) {
+            before = after;
+        } else {
+            *out_prev = before;
+            *out_next = after;
+            return;
+        }
+    }
+}
 
-template <typename Key, class Comparator>
-SkipList<Key, Comparator>::Iterator::Iterator(const SkipList* list) {
+template <typename Key, class Comparator, class Allocator, bool Reversible>
+SkipList<Key, Comparator, Allocator, Reversible>::Iterator::Iterator(const SkipList* list) {
     list_ = list;
     node_ = nullptr;
 }
 
-template <typename Key, class Comparator>
-bool SkipList<Key, Comparator>::Iterator::valid() const {
+template <typename Key, class Comparator, class Allocator, bool Reversible>
+bool SkipList<Key, Comparator, Allocator, Reversible>::Iterator::valid() const {
     return node_ != nullptr;
 }
 
-template <typename Key, class Comparator>
-const Key& SkipList<Key, Comparator>::Iterator::key() const {
+template <typename Key, class Comparator, class Allocator, bool Reversible>
+const Key& SkipList<Key, Comparator, Allocator, Reversible>::Iterator::key() const {
     assert(valid());
     return node_->key;
 }
 
-template <typename Key, class Comparator>
-void SkipList<Key, Comparator>::Iterator::next() {
+template <typename Key, class Comparator, class Allocator, bool Reversible>
+void SkipList<Key, Comparator, Allocator, Reversible>::Iterator::next() {
     assert(valid());
     node_ = node_->next(0);  // 在最底层进行移动
+    if (node_ != nullptr) {
+        // 调用者接下来通常会访问当前结点的键并继续向后遍历
+        prefetchKey(node_->key);
+        prefetch(node_->noBarrierNext(0));
+    }
 }
 
-template <typename Key, class Comparator>
-void SkipList<Key, Comparator>::Iterator::prev() {
+template <typename Key, class Comparator, class Allocator, bool Reversible>
+void SkipList<Key, Comparator, Allocator, Reversible>::Iterator::prev() {
     assert(valid());
-    node_ = list_->findLessThan(node_->key);
+    if constexpr (Reversible) {
+        // 并发插入时后向指针可能暂时指向更靠前的结点, 沿最底层向后移动到node_的直接前驱
+        Node* x = node_->prevNode();
+        Node* next;
+        while ((next = x->next(0)) != node_) {
+            x = next;
+        }
+        node_ = x;
+    } else {
+        node_ = list_->findLessThan(node_->key);
+    }
     if (node_ == list_->head_) {
         node_ = nullptr;
     }
 }
 
-template <typename Key, class Comparator>
-void SkipList<Key, Comparator>::Iterator::seek(const Key& target) {
-    node_ = list_->findGreaterOrEqual(target, nullptr);
+template <typename Key, class Comparator, class Allocator, bool Reversible>
+void SkipList<Key, Comparator, Allocator, Reversible>::Iterator::seek(const Key& target) {
+    node_ = list_->findGreateOrEqual(target, nullptr);
 }
 
-template <typename Key, class Comparator>
-void SkipList<Key, Comparator>::Iterator::seekToFirst() {
+template <typename Key, class Comparator, class Allocator, bool Reversible>
+void SkipList<Key, Comparator, Allocator, Reversible>::Iterator::seekToFirst() {
     node_ = list_->head_->next(0);
 }
 
-template <typename Key, class Comparator>
-void SkipList<Key, Comparator>::Iterator::seekToLast() {
-    node_ = list_->findLast();
+template <typename Key, class Comparator, class Allocator, bool Reversible>
+void SkipList<Key, Comparator, Allocator, Reversible>::Iterator::seekToLast() {
+    if constexpr (Reversible) {
+        Node* x = list_->head_->prevNode();
+        Node* next;
+        while ((next = x->next(0)) != nullptr) {
+            x = next;
+        }
+        node_ = x;
+    } else {
+        node_ = list_->findLast();
+    }
     if (node_ == list_->head_) {
         node_ = nullptr;
     }
@@ -0,0 +1,42 @@
+#include "cleanable.h"
+
+namespace kvstorage {
+
+Cleanable::Cleanable() {
+    cleanup_head_.func = nullptr;
+    cleanup_head_.next = nullptr;
+}
+
+Cleanable::~Cleanable() { runCleanups(); }
+
+void Cleanable::runCleanups() {
+    if (cleanup_head_.isEmpty()) {
+        return;
+    }
+    cleanup_head_.run();
+    for (CleanupNode* node = cleanup_head_.next; node != nullptr;) {
+        node->run();
+        CleanupNode* next = node->next;
+        delete node;
+        node = next;
+    }
+    cleanup_head_.func = nullptr;
+    cleanup_head_.next = nullptr;
+}
+
+void Cleanable::registerCleanup(CleanupFunction func, void* arg1, void* arg2) {
+    assert(func != nullptr);
+    CleanupNode* node;
+    if (cleanup_head_.isEmpty()) {
+        node = &cleanup_head_;
+    } else {
+        node = new CleanupNode();
+        node->next = cleanup_head_.next;
+        cleanup_head_.next = node;
+    }
+    node->func = func;
+    node->arg1 = arg1;
+    node->arg2 = arg2;
+}
+
+}
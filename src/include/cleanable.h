@@ -0,0 +1,45 @@
+/*
+ * 可注册清理函数的对象, 析构时调用所有注册的清理函数
+ * Iterator用它释放迭代器持有的资源, PinnableSlice用它释放被引用的内存(memtable, 缓存项等)
+*/
+#ifndef D_KVSTORAGE_CLEANABLE_H
+#define D_KVSTORAGE_CLEANABLE_H
+
+#include <cassert>
+
+namespace kvstorage {
+
+class Cleanable {
+public:
+    Cleanable();
+    Cleanable(const Cleanable&) = delete;
+    Cleanable& operator=(const Cleanable&) = delete;
+    ~Cleanable();
+
+    using CleanupFunction = void (*)(void* arg1, void* args2);
+    // 注册一个清理函数, 对象析构或reset()时调用(*func)(arg1, arg2)
+    void registerCleanup(CleanupFunction func, void* arg1, void* arg2);
+
+protected:
+    // 立即调用所有清理函数, 之后可以重新注册
+    void runCleanups();
+
+private:
+    struct CleanupNode {
+        bool isEmpty() const { return func == nullptr; }
+        void run() {
+            assert(func != nullptr);
+            (*func)(arg1, arg2);
+        }
+        CleanupFunction func;
+        void* arg1;
+        void* arg2;
+        CleanupNode* next;
+    };
+    // 第一个节点内联保存, 只有一个清理函数时不需要分配内存
+    CleanupNode cleanup_head_;
+};
+
+}
+
+#endif
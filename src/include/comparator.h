@@ -6,9 +6,9 @@
 
 #include "string"
 
-namespace kvstorage {
+#include "slice.h"
 
-class Slice;
+namespace kvstorage {
 
 class Comparator {
 public:
@@ -26,6 +26,43 @@ public:
 
 const Comparator* BytewiseComparator();
 
+// 8字节大端序无符号整数键的比较器, 顺序与BytewiseComparator()相同, 比较时只需要一次字节序转换和整数比较;
+// 使用该比较器时所有的user_key都必须是8字节, memtable中的记录会省略键的长度前缀
+const Comparator* Uint64KeyComparator();
+
+// 以下两个比较函数对象作为模板参数使用, 用户比较器是BytewiseComparator()时使用BytewiseCompare,
+// 比较直接内联为memcmp, 不经过虚函数调用; 其他比较器使用VirtualCompare
+struct BytewiseCompare {
+    int operator()(const Slice& a, const Slice& b) const { return a.compare(b); }
+};
+
+// 两个键都是8字节时按大端序整数比较, 否则按字节比较, 两者的顺序一致
+struct Uint64Compare {
+    static uint64_t decode(const Slice& key) {
+        const uint8_t* const u = reinterpret_cast<const uint8_t*>(key.data());
+        return (static_cast<uint64_t>(u[0]) << 56) | (static_cast<uint64_t>(u[1]) << 48) |
+               (static_cast<uint64_t>(u[2]) << 40) | (static_cast<uint64_t>(u[3]) << 32) |
+               (static_cast<uint64_t>(u[4]) << 24) | (static_cast<uint64_t>(u[5]) << 16) |
+               (static_cast<uint64_t>(u[6]) << 8) | static_cast<uint64_t>(u[7]);
+    }
+
+    int operator()(const Slice& a, const Slice& b) const {
+        if (a.size() == 8 && b.size() == 8) {
+            const uint64_t x = decode(a);
+            const uint64_t y = decode(b);
+            return (x < y) ? -1 : (x > y) ? 1 : 0;
+        }
+        return a.compare(b);
+    }
+};
+
+struct VirtualCompare {
+    explicit VirtualCompare(const Comparator* c) : comparator(c) {}
+    int operator()(const Slice& a, const Slice& b) const { return comparator->compare(a, b); }
+
+    const Comparator* const comparator;
+};
+
 }
 
 #endif
\ No newline at end of file
@@ -50,6 +50,17 @@ public:
     virtual Status write(const WriteOptions& options, WriteBatch* updates) = 0;
     // 获取指定key的value
     virtual Status getValue(const ReadOptions& options, const Slice& key, std::string& value) = 0;
+    // 获取指定key的value, 尽可能直接引用memtable或块缓存中的数据而不复制,
+    // value析构或reset()之前被引用的数据不会释放; 默认实现复制到value自身的缓冲区中
+    // 子类只覆盖上面的重载时, 这个重载会被名字隐藏, 需要在子类中声明using DataBase::getValue;
+    virtual Status getValue(const ReadOptions& options, const Slice& key, PinnableSlice* value) {
+        value->reset();
+        Status s = getValue(options, key, *value->getSelf());
+        if (s.ok()) {
+            value->pinSelf();
+        }
+        return s;
+    }
     // 返回一个堆分配的迭代器，使用迭代器前需要先调用seek方法
     virtual Iterator* newIterator(const ReadOptions& options) = 0;  
     // 返回当前数据库状态的句柄，迭代器创建后，使用该句柄创建的迭代器将看到数据库的稳定快照
@@ -5,6 +5,9 @@
 #define D_KVSTORAGE_ENV_H
 
 #include <cstdarg>
+#include <cstdint>
+#include <string>
+#include <vector>
 
 #include "status.h"
 
@@ -12,13 +15,34 @@ namespace kvstorage {
 
 class FileLock;
 class Logger;
+struct Options;
 class RandomAccessFile;
+class RateLimiter;
 class SequentialFile;
 class Slice;
 class WritableFile;
 
+// 一个后台线程池的统计信息
+struct ThreadPoolStats {
+    int threads = 0;  // 线程数量的上限
+    size_t queue_len = 0;  // 正在等待执行的任务数量
+    uint64_t scheduled = 0;  // 提交的任务总数
+    uint64_t unscheduled = 0;  // 执行前被取消的任务总数
+    uint64_t run = 0;  // 开始执行的任务总数
+    uint64_t total_wait_micros = 0;  // 开始执行的任务在队列中等待的总时间
+    uint64_t max_wait_micros = 0;  // 单个任务在队列中等待的最长时间
+};
+
+struct EnvOptions;
+
 class Env {
 public:
+    // 后台任务的优先级, 每个优先级有独立的线程池, 互不阻塞;
+    // High用于memtable落盘, Low用于compaction, 防止耗时的compaction推迟落盘而阻塞写入
+    enum class Priority { Low = 0, High, Total };
+    // RateLimiter中I/O请求的优先级, 每次补充令牌时先满足High; Total表示不限速, 例如WAL的写入
+    enum class IOPriority { Low = 0, High, Total };
+
     Env() = default;
     Env(const Env&) = delete;
     Env& operator=(const Env&) = delete;
@@ -34,6 +58,9 @@ public:
     virtual Status newWritableFile(const std::string& fname, WritableFile** res) = 0;
     // 创建一个对象，用于追加写入指定文件, 如果文件不存在，则创建一个新文件
     virtual Status newAppendableFile(const std::string& fname, WritableFile** res) = 0;  // 还未实现，
+    // 按options打开文件, 默认实现忽略options, 调用上面的版本
+    virtual Status newRandomAccessFile(const std::string& fname, const EnvOptions& options, RandomAccessFile** res);
+    virtual Status newWritableFile(const std::string& fname, const EnvOptions& options, WritableFile** res);
     virtual bool fileExists(const std::string& fname) = 0;  // 检查指定文件是否存在
     // 获取指定目录下的所有子目录名和文件名，存到res中
     virtual Status getChildren(const std::string& dir, std::vector<std::string>* res) = 0;
@@ -48,7 +75,17 @@ public:
     virtual Status renameFile(const std::string& src, const std::string& target) = 0;
     virtual Status lockFile(const std::string& fname, FileLock** lock) = 0;  // 锁定指定的文件, 防止多个进程同时访问
     virtual Status unlockFile(FileLock* lock) = 0;  // 释放使用lockFile获取的锁
-    virtual void schedule(void(*function)(void* arg), void* arg) = 0;  // 安排在后台线程执行, 可能并发
+    // 安排在pri对应的线程池中执行function(arg), 可能并发; tag不为空时可以通过unschedule(tag, pri)取消,
+    // 取消时如果unschedule_function不为空, 调用unschedule_function(arg)让调用者释放arg
+    virtual void schedule(void (*function)(void* arg), void* arg, Priority pri = Priority::Low, void* tag = nullptr,
+                          void (*unschedule_function)(void* arg) = nullptr) = 0;
+    // 取消pri线程池中还未开始执行的, tag相同的任务, 返回取消的数量; 已经开始执行的任务不受影响
+    virtual int unschedule(void* tag, Priority pri);
+    // 设置pri线程池的线程数量, 减少时多余的线程在执行完当前任务后退出
+    virtual void setBackgroundThreads(int num, Priority pri);
+    virtual int getBackgroundThreads(Priority pri);
+    // 获取pri线程池的队列长度和等待时间等统计信息
+    virtual void getThreadPoolStats(Priority pri, ThreadPoolStats* stats);
     virtual void startThread(void(*function)(void* arg), void* arg) = 0;  // 启动一个线程，执行function(arg), 返回时销毁线程
     virtual Status getTestDirectory(std::string* path) = 0;  // 返回一个临时目录，用于测试
     virtual Status newLogger(const std::string& fname, Logger** res) = 0;  // 创建返回一个日志文件存消息
@@ -56,6 +93,25 @@ public:
     virtual void sleepForMicroseconds(int micros) = 0;  // 线程延迟指定时间
 };
 
+// 打开文件时的选项, 不支持direct I/O的Env可以忽略use_direct_reads和use_direct_writes
+struct EnvOptions {
+    EnvOptions() = default;
+    // 前台读取使用的选项, use_direct_reads取自options.use_direct_reads
+    explicit EnvOptions(const Options& options);
+
+    // RandomAccessFile使用O_DIRECT, 绕过page cache, 读取时按块对齐, 不使用mmap
+    bool use_direct_reads = false;
+    // WritableFile使用O_DIRECT, 绕过page cache, 数据在对齐的缓冲区中积累成整块后写出
+    bool use_direct_writes = false;
+    // 不为空时每次读写之前先从rate_limiter申请io_priority优先级的令牌, io_priority为Total时不限速
+    RateLimiter* rate_limiter = nullptr;
+    Env::IOPriority io_priority = Env::IOPriority::Total;
+};
+
+// 落盘和compaction读写文件时使用的选项, options.use_direct_io_for_flush_and_compaction为true时读写都使用O_DIRECT;
+// 读写经过options.rate_limiter限速, 落盘使用IOPriority::High, compaction使用IOPriority::Low
+EnvOptions EnvOptionsForFlushAndCompaction(const Options& options, Env::IOPriority pri = Env::IOPriority::Low);
+
 // 顺序文件的抽象
 class SequentialFile {
 public:
@@ -77,6 +133,23 @@ public:
     virtual ~RandomAccessFile() = default;
 
     virtual Status read(uint64_t offset, size_t n, Slice* res, char* scrath) = 0;  // 从文件中读取n字节, 线程安全
+
+    // 一次读取请求, 调用者填写offset, len和scratch(至少len字节), 完成后result和status保存结果
+    struct ReadRequest {
+        uint64_t offset;
+        size_t len;
+        char* scratch;
+        Slice result;
+        Status status;
+    };
+    using ReadCallback = void (*)(void* arg, ReadRequest* req);
+
+    // 读取n个请求, 返回第一个失败的请求的状态; 支持时在一次系统调用中提交所有请求,
+    // 默认实现逐个调用read()
+    virtual Status multiRead(ReadRequest* reqs, size_t n);
+    // 异步读取, 完成后在任意线程中调用(*callback)(arg, req), 回调返回之前req和scratch必须有效;
+    // 默认实现同步读取后在当前线程中调用callback
+    virtual void readAsync(ReadRequest* req, ReadCallback callback, void* arg);
 };
 
 class WritableFile {
@@ -148,6 +221,14 @@ public:
         return target_->newAppendableFile(f, r);
     }
 
+    Status newRandomAccessFile(const std::string& f, const EnvOptions& o, RandomAccessFile** r) override {
+        return target_->newRandomAccessFile(f, o, r);
+    }
+
+    Status newWritableFile(const std::string& f, const EnvOptions& o, WritableFile** r) override {
+        return target_->newWritableFile(f, o, r);
+    }
+
     bool fileExists(const std::string& f) override { return target_->fileExists(f); }
 
     Status getChildren(const std::string& dir, std::vector<std::string>* r) override {
@@ -161,7 +242,16 @@ public:
     Status renameFile(const std::string& s, const std::string& t) override { return target_->renameFile(s, t); }
     Status lockFile(const std::string& f, FileLock** l) override { return target_->lockFile(f, l); }
     Status unlockFile(FileLock* l) override { return target_->unlockFile(l); }
-    void schedule(void (*f)(void*), void* a) override { return target_->schedule(f, a); }
+    void schedule(void (*f)(void*), void* a, Priority pri = Priority::Low, void* tag = nullptr,
+                  void (*u)(void*) = nullptr) override {
+        return target_->schedule(f, a, pri, tag, u);
+    }
+    int unschedule(void* tag, Priority pri) override { return target_->unschedule(tag, pri); }
+    void setBackgroundThreads(int num, Priority pri) override { return target_->setBackgroundThreads(num, pri); }
+    int getBackgroundThreads(Priority pri) override { return target_->getBackgroundThreads(pri); }
+    void getThreadPoolStats(Priority pri, ThreadPoolStats* stats) override {
+        return target_->getThreadPoolStats(pri, stats);
+    }
     void startThread(void (*f)(void*), void* a) override { return target_->startThread(f, a); }
     Status getTestDirectory(std::string* path) override { return target_->getTestDirectory(path); }
     Status newLogger(const std::string& fname, Logger** result) override { return target_->newLogger(fname, result); }
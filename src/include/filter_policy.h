@@ -0,0 +1,28 @@
+/*
+ * FilterPolicy 过滤器策略的基类, 为一组键生成过滤器(例如布隆过滤器), 读取时用过滤器排除不可能存在的键,
+ * 减少磁盘读取; 通过Options::filter_policy设置
+*/
+#ifndef D_KVSTORAGE_FILTER_POLICY_H
+#define D_KVSTORAGE_FILTER_POLICY_H
+
+#include <string>
+
+#include "slice.h"
+
+namespace kvstorage {
+
+class FilterPolicy {
+public:
+    FilterPolicy() = default;
+    virtual ~FilterPolicy() = default;
+    // 返回过滤器策略的名称, 名称写入表文件, 过滤器的格式改变时名称也必须改变
+    virtual const char* name() const = 0;
+    // keys[0, n-1]中可能有重复的键, 为它们生成过滤器并追加到dst
+    virtual void createFilter(const Slice* keys, int n, std::string* dst) const = 0;
+    // key在生成filter的键中时必须返回true, 不在时应当尽量返回false
+    virtual bool keyMayMatch(const Slice& key, const Slice& filter) const = 0;
+};
+
+}  // namespace kvstorage
+
+#endif  // D_KVSTORAGE_FILTER_POLICY_H
@@ -4,12 +4,14 @@
 #ifndef D_KVSTORAGE_ITERATOR_H
 #define D_KVSTORAGE_ITERATOR_H
 
+#include "cleanable.h"
 #include "slice.h"
 #include "status.h"
 
 namespace kvstorage {
 
-class Iterator {
+// 通过Cleanable::registerCleanup注册的函数在迭代器析构时调用
+class Iterator : public Cleanable {
 public:
     Iterator() = default;
     Iterator(const Iterator&) = delete;
@@ -26,23 +28,6 @@ public:
     virtual Slice key() const = 0;
     virtual Slice value() const = 0;
     virtual Status status() const = 0;  // 返回状态码
-
-    using CleanupFunction = void (*)(void* arg1, void* args2);
-    void registerCleanup(CleanupFunction func, void* arg1, void* arg2);
-
-private:
-    struct CleanupNode {
-        bool isEmpty() const { return func == nullptr; }
-        void run() {
-            assert(func != nullptr);
-            (*func)(arg1, arg2);
-        }
-        CleanupFunction func;
-        void* arg1;
-        void* arg2;
-        CleanupNode* next;
-    };
-    CleanupNode cleanup_head_;
 };
 }
 
@@ -8,11 +8,13 @@
 
 namespace kvstorage {
 
+class ArenaBlockPool;
 class Cache;
 class Comparator;
 class Env;
 class FilterPolicy;
 class Logger;
+class RateLimiter;
 class Snapshot;
 
 // 数据库内容存储再一组块中，每个块包含一系列的键值对，每个块存储到文件前可能会被压缩
@@ -23,6 +25,17 @@ enum class CompressionType {
     ZstdCompression = 0x2,
 };
 
+// memtable的索引结构
+enum class MemTableRepType {
+    SkipList = 0x0,  // 跳表, 查找O(log n), 可以直接有序遍历
+    // 按user_key的哈希分桶, 桶内是按InternalKey排序的链表; 点查只访问一个桶, 有序遍历时需要先排序
+    // 要求用户比较器只在两个键的字节完全相同时才认为相等
+    HashLinkList = 0x1,
+    // 按user_key的字节建立的自适应基数树, 键的公共前缀只比较一次, 适合路径形式的长键
+    // 只支持BytewiseComparator, 使用其他比较器时退化为SkipList
+    AdaptiveRadixTree = 0x2,
+};
+
 struct Options {
     Options();
 
@@ -35,7 +48,20 @@ struct Options {
     Logger* info_log = nullptr;  // 用于记录数据库生成的任何内部进度/错误信息
     // 影响性能的参数
     size_t write_buffer_size = 4 * 1024 * 1024;  // 写缓冲区大小
+    size_t arena_block_size = 0;  // memtable中arena的内存块大小, 为0则取write_buffer_size / 8
+    bool memtable_huge_page = false;  // memtable的arena是否使用mmap分配并尽量使用大页
+    // 回收已销毁的memtable的arena内存块供新的memtable复用, 为空则不回收
+    // 可以使用ArenaBlockPool::defaultPool()在进程内共享, 或为每个数据库单独创建
+    ArenaBlockPool* arena_block_pool = nullptr;
+    MemTableRepType memtable_rep = MemTableRepType::SkipList;  // memtable的索引结构
+    size_t memtable_hash_bucket_count = 64 * 1024;  // memtable_rep为HashLinkList时桶的数量
     int max_open_files = 1000;  // db可以打开的数据库文件数量
+    // 前台读取数据库文件时使用O_DIRECT, 绕过page cache, 由block_cache负责缓存
+    bool use_direct_reads = false;
+    // 落盘和compaction读写文件时使用O_DIRECT, 这些数据只读写一次, 经过page cache会挤出前台读取的热数据
+    bool use_direct_io_for_flush_and_compaction = false;
+    // 限制落盘和compaction的读写速率, 防止突发的后台I/O影响前台的延迟; WAL的写入不限速; 为空则不限速
+    RateLimiter* rate_limiter = nullptr;
     Cache* block_cache = nullptr;  // 块缓存, 为空则使用默认创建的8MB缓存
     size_t block_size = 4 * 1024;  // 对应的未压缩数据的块的近似大小
     int block_restart_interval = 16;  // 重启点的间隔
@@ -0,0 +1,56 @@
+/*
+ * 后台I/O的令牌桶限速器
+ * 每个refill_period_us补充rate * refill_period_us / 1e6字节的令牌, 令牌不足的请求排队等待下次补充;
+ * 补充时先满足IOPriority::High(落盘)的请求, 再满足Low(compaction)的请求, IOPriority::Total不限速(WAL)
+*/
+#ifndef D_KVSTORAGE_RATE_LIMITER_H
+#define D_KVSTORAGE_RATE_LIMITER_H
+
+#include <cstdint>
+
+#include "env.h"
+
+namespace kvstorage {
+
+class RandomAccessFile;
+class WritableFile;
+
+class RateLimiter {
+public:
+    RateLimiter() = default;
+    RateLimiter(const RateLimiter&) = delete;
+    RateLimiter& operator=(const RateLimiter&) = delete;
+    virtual ~RateLimiter() = default;
+
+    // 运行时调整速率, 下次补充令牌时生效; 自动调整模式下设置的是速率的上限
+    virtual void setBytesPerSecond(int64_t bytes_per_second) = 0;
+    // 当前的速率, 自动调整模式下可能小于上限
+    virtual int64_t getBytesPerSecond() const = 0;
+    // 申请bytes字节的令牌, 令牌不足时阻塞; bytes可以是任意大小, 超过一个补充周期的令牌数时在多个周期中分次得到
+    virtual void request(int64_t bytes, Env::IOPriority pri) = 0;
+    // 一个补充周期的令牌数, 随速率变化; 调用者可以按它拆分读写使I/O更平滑, 但不需要保证申请的字节数不超过它
+    virtual int64_t getSingleBurstBytes() const = 0;
+    // 通过的总字节数和请求数, pri为Total时返回所有优先级的总和
+    virtual int64_t getTotalBytesThrough(Env::IOPriority pri = Env::IOPriority::Total) const = 0;
+    virtual int64_t getTotalRequests(Env::IOPriority pri = Env::IOPriority::Total) const = 0;
+    // 报告一次前台操作的延迟, 自动调整模式下用于调整速率, 否则忽略
+    virtual void recordForegroundLatency(uint64_t micros) = 0;
+};
+
+// rate_bytes_per_sec: 每秒允许的字节数
+// refill_period_us: 补充令牌的周期, 越小突发越小, 但补充的开销越大
+// fairness: 每次补充时以1/fairness的概率先满足Low的请求, 防止持续的High请求让Low饿死
+// auto_tune_latency_us: 不为0时开启自动调整, 每10个补充周期检查一次前台的平均延迟,
+//                       超过auto_tune_latency_us时速率减半, 否则在令牌不足时把速率提高上限的1/20,
+//                       速率保持在[rate_bytes_per_sec / 20, rate_bytes_per_sec]之间
+RateLimiter* NewGenericRateLimiter(int64_t rate_bytes_per_sec, int64_t refill_period_us = 100 * 1000,
+                                   int32_t fairness = 10, uint64_t auto_tune_latency_us = 0);
+
+// 返回包装file的对象, 每次读写之前先从limiter申请pri优先级的令牌, 写入按单次上限拆分成多次申请;
+// 返回的对象拥有file, limiter必须比它存活更久; pri为Total时不限速, 直接返回file
+RandomAccessFile* NewRateLimitedRandomAccessFile(RandomAccessFile* file, RateLimiter* limiter, Env::IOPriority pri);
+WritableFile* NewRateLimitedWritableFile(WritableFile* file, RateLimiter* limiter, Env::IOPriority pri);
+
+}  // namespace kvstorage
+
+#endif  // D_KVSTORAGE_RATE_LIMITER_H
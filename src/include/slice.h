@@ -9,6 +9,8 @@
 #include <cstring>
 #include <string>
 
+#include "cleanable.h"
+
 namespace kvstorage {
 
 class Slice {
@@ -72,6 +74,54 @@ inline bool operator==(const Slice& lhs, const Slice& rhs) {
 
 inline bool operator!=(const Slice& lhs, const Slice& rhs) { return !(lhs == rhs); }
 
+// 可以直接引用其他对象内存的Slice, 读取较大的值时不需要复制;
+// 被引用的内存(memtable, 块缓存项等)由pinSlice()注册的函数释放, 在析构或reset()时调用;
+// 无法引用时把值复制到自身的缓冲区中, 由pinSelf()指向缓冲区
+class PinnableSlice : public Slice, public Cleanable {
+public:
+    PinnableSlice() : pinned_(false), buf_(&self_space_) {}
+    // 使用调用者提供的缓冲区, 可以在多次读取之间复用
+    explicit PinnableSlice(std::string* buf) : pinned_(false), buf_(buf) {}
+    PinnableSlice(const PinnableSlice&) = delete;
+    PinnableSlice& operator=(const PinnableSlice&) = delete;
+
+    // 引用s指向的内存, 直到调用(*release)(arg1, arg2)之前该内存必须有效
+    void pinSlice(const Slice& s, CleanupFunction release, void* arg1, void* arg2) {
+        assert(!pinned_);
+        pinned_ = true;
+        Slice::operator=(s);
+        registerCleanup(release, arg1, arg2);
+    }
+
+    // 把s复制到缓冲区中
+    void pinSelf(const Slice& s) {
+        assert(!pinned_);
+        buf_->assign(s.data(), s.size());
+        Slice::operator=(*buf_);
+    }
+
+    // 值已经写入getSelf()返回的缓冲区
+    void pinSelf() {
+        assert(!pinned_);
+        Slice::operator=(*buf_);
+    }
+
+    std::string* getSelf() { return buf_; }
+    bool isPinned() const { return pinned_; }
+
+    // 释放被引用的内存, 之后可以重新使用
+    void reset() {
+        runCleanups();
+        pinned_ = false;
+        clear();
+    }
+
+private:
+    bool pinned_;
+    std::string self_space_;
+    std::string* const buf_;
+};
+
 }
 
 #endif
\ No newline at end of file
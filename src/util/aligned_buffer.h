@@ -0,0 +1,48 @@
+/*
+ * 起始地址按指定边界对齐的堆内存, 用于O_DIRECT读写
+ * O_DIRECT要求缓冲区地址, 文件偏移和长度都按设备的逻辑块大小对齐, Arena只保证指针大小的对齐, 不能使用
+*/
+#ifndef KVSTORAGE_UTIL_ALIGNED_BUFFER_H_
+#define KVSTORAGE_UTIL_ALIGNED_BUFFER_H_
+
+#include <cassert>
+#include <cstddef>
+#include <new>
+
+namespace kvstorage {
+
+inline size_t RoundDown(size_t x, size_t alignment) { return x - (x & (alignment - 1)); }
+inline size_t RoundUp(size_t x, size_t alignment) { return RoundDown(x + alignment - 1, alignment); }
+inline bool IsAligned(size_t x, size_t alignment) { return (x & (alignment - 1)) == 0; }
+
+class AlignedBuffer {
+public:
+    // alignment必须是2的幂; capacity向上取整为alignment的整数倍
+    AlignedBuffer(size_t alignment, size_t capacity)
+        : alignment_(alignment), capacity_(RoundUp(capacity, alignment)), buf_(nullptr) {
+        assert(alignment != 0 && (alignment & (alignment - 1)) == 0);
+        if (capacity_ > 0) {
+            buf_ = static_cast<char*>(::operator new(capacity_, std::align_val_t(alignment_)));
+        }
+    }
+    AlignedBuffer(const AlignedBuffer&) = delete;
+    AlignedBuffer& operator=(const AlignedBuffer&) = delete;
+    ~AlignedBuffer() {
+        if (buf_ != nullptr) {
+            ::operator delete(buf_, std::align_val_t(alignment_));
+        }
+    }
+
+    char* data() const { return buf_; }
+    size_t capacity() const { return capacity_; }
+    size_t alignment() const { return alignment_; }
+
+private:
+    const size_t alignment_;
+    const size_t capacity_;
+    char* buf_;
+};
+
+}  // namespace kvstorage
+
+#endif  // KVSTORAGE_UTIL_ALIGNED_BUFFER_H_
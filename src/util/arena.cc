@@ -1,28 +1,50 @@
 #include "arena.h"
 
+#if defined(__linux__)
+#include <sys/mman.h>
+#endif
+
+#include "arena_block_pool.h"
+
 namespace kvstorage {
 
-static const int kBlockSize = 4096;
+// 使用大页时块大小向上取整为大页大小的整数倍
+static size_t RoundBlockSize(size_t block_size, bool use_huge_page) {
+    if (!use_huge_page) {
+        return block_size;
+    }
+    return (block_size + Arena::s_huge_page_size - 1) / Arena::s_huge_page_size * Arena::s_huge_page_size;
+}
 
-Arena::Arena() : alloc_ptr_(nullptr), alloc_bytes_remaining_(0), memory_usage_(0) {}
+Arena::Arena(size_t block_size, bool use_huge_page, ArenaBlockPool* pool)
+    : alloc_ptr_(nullptr), alloc_bytes_remaining_(0),
+      block_size_(RoundBlockSize(block_size, use_huge_page)), use_huge_page_(use_huge_page),
+      pool_(pool), memory_usage_(0) {
+    assert(block_size_ > 0);
+}
 
 Arena::~Arena() {
     for (size_t i = 0; i < blocks_.size(); ++i) {
-        delete[] blocks_[i];
+        const Block& b = blocks_[i];
+        if (pool_ != nullptr && b.size == block_size_) {
+            pool_->release(b.data, b.size, b.mmapped);  // 由pool决定保留还是释放
+        } else {
+            freeBlock(b.data, b.size, b.mmapped);
+        }
     }
 }
 
 size_t Arena::memoryUsage() const { return memory_usage_.load(std::memory_order_relaxed); }
 
 char* Arena::allocateFallback(size_t bytes) {
-    if (bytes > kBlockSize / 4) {
+    if (bytes > block_size_ / 4) {
         // 请求的内存大于1/4个block，则直接分配新的block, 避免内存碎片
         char* result = allocateNewBlock(bytes);
         return result;
     }
 
-    alloc_ptr_ = allocateNewBlock(kBlockSize);
-    alloc_bytes_remaining_ = kBlockSize;
+    alloc_ptr_ = allocateRegularBlock();
+    alloc_bytes_remaining_ = block_size_;
 
     char* result = alloc_ptr_;
     alloc_ptr_ += bytes;
@@ -49,11 +71,80 @@ char* Arena::allocateAligned(size_t bytes) {
     return res;
 }
 
+char* Arena::allocateRegularBlock() {
+    char* res = nullptr;
+    if (pool_ != nullptr) {
+        // 优先复用之前的arena归还的内存块, 大页模式下只复用mmap分配的块
+        res = pool_->acquire(block_size_, use_huge_page_);
+        if (res != nullptr) {
+            addBlock(res, block_size_, use_huge_page_);
+            return res;
+        }
+    }
+    if (use_huge_page_) {
+        res = allocateHugePageBlock(block_size_);
+    }
+    if (res == nullptr) {
+        res = allocateNewBlock(block_size_);
+    }
+    return res;
+}
+
 char* Arena::allocateNewBlock(size_t block_bytes) {
     char* res = new char[block_bytes];
-    blocks_.push_back(res);
-    memory_usage_.fetch_add(block_bytes + sizeof(char*), std::memory_order_relaxed);
+    addBlock(res, block_bytes, false);
     return res;
 }
 
-}  // namespace kvstorage
\ No newline at end of file
+char* Arena::allocateHugePageBlock(size_t block_bytes) {
+#if defined(__linux__)
+    assert(block_bytes % s_huge_page_size == 0);
+    void* p = MAP_FAILED;
+#if defined(MAP_HUGETLB)
+    // 优先使用预留的大页(hugetlbfs), 系统没有预留大页时mmap会失败
+    p = mmap(nullptr, block_bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+#endif
+    if (p == MAP_FAILED) {
+        // 使用透明大页, 多映射一个大页的空间, 裁剪出按大页对齐的区域, 否则内核无法使用大页
+        size_t mapped = block_bytes + s_huge_page_size;
+        char* raw = static_cast<char*>(
+            mmap(nullptr, mapped, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0));
+        if (raw == MAP_FAILED) {
+            return nullptr;
+        }
+        uintptr_t addr = reinterpret_cast<uintptr_t>(raw);
+        char* aligned = reinterpret_cast<char*>((addr + s_huge_page_size - 1) & ~(s_huge_page_size - 1));
+        size_t head = aligned - raw;
+        size_t tail = mapped - head - block_bytes;
+        if (head > 0) munmap(raw, head);
+        if (tail > 0) munmap(aligned + block_bytes, tail);
+        p = aligned;
+#if defined(MADV_HUGEPAGE)
+        madvise(p, block_bytes, MADV_HUGEPAGE);  // 失败时仍然可以使用普通页
+#endif
+    }
+    char* res = static_cast<char*>(p);
+    addBlock(res, block_bytes, true);
+    return res;
+#else
+    (void)block_bytes;
+    return nullptr;  // 不支持mmap的平台使用new[]分配
+#endif
+}
+
+void Arena::addBlock(char* data, size_t size, bool mmapped) {
+    blocks_.push_back(Block{data, size, mmapped});
+    memory_usage_.fetch_add(size + sizeof(Block), std::memory_order_relaxed);
+}
+
+void Arena::freeBlock(char* data, size_t size, bool mmapped) {
+    if (mmapped) {
+#if defined(__linux__)
+        munmap(data, size);
+#endif
+    } else {
+        delete[] data;
+    }
+}
+
+}  // namespace kvstorage
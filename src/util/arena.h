@@ -13,9 +13,19 @@
 
 namespace kvstorage {
 
+class ArenaBlockPool;
+
 class Arena {
 public:
-    Arena();
+    static constexpr size_t s_default_block_size = 4096;
+    static constexpr size_t s_huge_page_size = 2 * 1024 * 1024;
+
+    // block_size: 每次向系统申请的内存块大小
+    // use_huge_page: 使用匿名mmap分配内存块并尽量使用大页, 块大小向上取整为大页大小的整数倍,
+    //                大页不可用时退化为普通页, mmap失败时退化为new[]
+    // pool: 不为空时优先从pool中取内存块, 析构时把块大小为block_size的内存块归还给pool
+    explicit Arena(size_t block_size = s_default_block_size, bool use_huge_page = false,
+                   ArenaBlockPool* pool = nullptr);
     Arena(const Arena&) = delete;
     Arena& operator=(const Arena&) = delete;
     ~Arena();
@@ -24,15 +34,31 @@ public:
     char* allocate(size_t bytes);
     char* allocateAligned(size_t bytes);
     size_t memoryUsage() const;
+    size_t blockSize() const { return block_size_; }
 
 private:
+    friend class ArenaBlockPool;
+
+    struct Block {
+        char* data;
+        size_t size;
+        bool mmapped;  // 是否通过mmap分配, 决定释放的方式
+    };
+
     char* allocateFallback(size_t bytes);  // 当前内存块剩余空间不足时，分配请求的内存
+    char* allocateRegularBlock();  // 分配一个block_size_大小的内存块, 优先从pool_中获取
     char* allocateNewBlock(size_t block_bytes);  // 创建新的内存块
+    char* allocateHugePageBlock(size_t block_bytes);  // 使用mmap创建新的内存块, 失败时返回nullptr
+    void addBlock(char* data, size_t size, bool mmapped);
+    static void freeBlock(char* data, size_t size, bool mmapped);
 
 private:
     char* alloc_ptr_;  // 当前正在进行分配的内存块的当前指针位置
     size_t alloc_bytes_remaining_;  // 当前正在进行分配的内存块的剩余空间
-    std::vector<char*> blocks_;  // 当前已经分配的所有内存块的地址
+    const size_t block_size_;
+    const bool use_huge_page_;
+    ArenaBlockPool* const pool_;
+    std::vector<Block> blocks_;  // 当前已经分配的所有内存块
     std::atomic<size_t> memory_usage_;  // 当前累计分配的内存
 };
 
@@ -0,0 +1,76 @@
+#include "arena_block_pool.h"
+
+#include "arena.h"
+#include "no_destructor.h"
+
+namespace kvstorage {
+
+ArenaBlockPool::ArenaBlockPool(size_t capacity)
+    : capacity_(capacity), retained_bytes_(0), hits_(0), misses_(0) {}
+
+ArenaBlockPool::~ArenaBlockPool() {
+    for (auto& group : free_blocks_) {
+        for (char* block : group.second) {
+            Arena::freeBlock(block, group.first.first, group.first.second);
+        }
+    }
+}
+
+ArenaBlockPool* ArenaBlockPool::defaultPool() {
+    static NoDestructor<ArenaBlockPool> singleton(s_default_capacity);
+    return singleton.get();
+}
+
+char* ArenaBlockPool::acquire(size_t block_bytes, bool mmapped) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = free_blocks_.find(BlockKey(block_bytes, mmapped));
+    if (it == free_blocks_.end() || it->second.empty()) {
+        misses_.fetch_add(1, std::memory_order_relaxed);
+        return nullptr;
+    }
+    // 后进先出, 最近归还的内存块更可能还在缓存和TLB中
+    char* block = it->second.back();
+    it->second.pop_back();
+    retained_bytes_ -= block_bytes;
+    hits_.fetch_add(1, std::memory_order_relaxed);
+    return block;
+}
+
+void ArenaBlockPool::release(char* block, size_t block_bytes, bool mmapped) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (retained_bytes_ + block_bytes > capacity_) {
+        Arena::freeBlock(block, block_bytes, mmapped);
+        return;
+    }
+    free_blocks_[BlockKey(block_bytes, mmapped)].push_back(block);
+    retained_bytes_ += block_bytes;
+}
+
+void ArenaBlockPool::setCapacity(size_t capacity) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    capacity_ = capacity;
+    evictLocked();
+}
+
+size_t ArenaBlockPool::capacity() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return capacity_;
+}
+
+size_t ArenaBlockPool::retainedBytes() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return retained_bytes_;
+}
+
+void ArenaBlockPool::evictLocked() {
+    for (auto it = free_blocks_.begin(); it != free_blocks_.end() && retained_bytes_ > capacity_; ++it) {
+        std::vector<char*>& blocks = it->second;
+        while (!blocks.empty() && retained_bytes_ > capacity_) {
+            Arena::freeBlock(blocks.back(), it->first.first, it->first.second);
+            blocks.pop_back();
+            retained_bytes_ -= it->first.first;
+        }
+    }
+}
+
+}  // namespace kvstorage
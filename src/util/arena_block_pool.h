@@ -0,0 +1,57 @@
+/*
+* Arena内存块回收池
+* memtable落盘后arena被销毁, 其内存块归还到池中, 下一个memtable的arena优先复用这些块,
+* 减少每次切换memtable时重新分配内存和缺页的开销; 池中保留的内存不超过capacity
+*/
+#ifndef KVSTORAGE_UTIL_ARENA_BLOCK_POOL_H_
+#define KVSTORAGE_UTIL_ARENA_BLOCK_POOL_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+namespace kvstorage {
+
+class ArenaBlockPool {
+public:
+    explicit ArenaBlockPool(size_t capacity);
+    ArenaBlockPool(const ArenaBlockPool&) = delete;
+    ArenaBlockPool& operator=(const ArenaBlockPool&) = delete;
+    ~ArenaBlockPool();  // 释放池中保留的所有内存块, 必须在使用它的所有Arena销毁之后析构
+
+public:
+    static ArenaBlockPool* defaultPool();  // 进程级别共享的池, 容量为s_default_capacity
+
+    // 取一个指定大小和分配方式的内存块, 池中没有时返回nullptr, 线程安全
+    char* acquire(size_t block_bytes, bool mmapped);
+    // 归还一个内存块, 超过容量时直接释放, 线程安全
+    void release(char* block, size_t block_bytes, bool mmapped);
+
+    void setCapacity(size_t capacity);  // 调小容量时立即释放多余的内存块
+    size_t capacity() const;
+    size_t retainedBytes() const;  // 池中当前保留的内存
+    uint64_t hits() const { return hits_.load(std::memory_order_relaxed); }
+    uint64_t misses() const { return misses_.load(std::memory_order_relaxed); }
+
+private:
+    static constexpr size_t s_default_capacity = 64 * 1024 * 1024;
+
+    using BlockKey = std::pair<size_t, bool>;  // 内存块大小, 是否通过mmap分配
+
+    void evictLocked();  // 释放内存块直到保留的内存不超过容量, 需要持有mutex_
+
+private:
+    mutable std::mutex mutex_;
+    size_t capacity_;
+    size_t retained_bytes_;
+    std::map<BlockKey, std::vector<char*>> free_blocks_;  // 按大小和分配方式分组的空闲内存块
+    std::atomic<uint64_t> hits_;
+    std::atomic<uint64_t> misses_;
+};
+
+}  // namespace kvstorage
+#endif
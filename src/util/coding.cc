@@ -1,8 +1,17 @@
 #include "coding.h"
 #include "slice.h"
 
+#include <algorithm>
+#include <cassert>
 #include <string>
 
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#include <tmmintrin.h>
+#define KVSTORAGE_GROUP_VARINT_SSSE3 1
+#else
+#define KVSTORAGE_GROUP_VARINT_SSSE3 0
+#endif
+
 namespace kvstorage {
 
 // 将4
@@ -78,8 +87,69 @@ void PutLengthPrefixedSlice(std::string* dst, const Slice& value) {
     dst->append(value.data(), value.size());
 }
 
+// 8字节中每个字节的最高位, 为0的位置是varint的结束字节
+static const uint64_t s_varint_stop_bits = 0x8080808080808080ull;
+
+// 长度为1到5字节的varint32对应的掩码
+static const uint64_t s_varint_length_masks[6] = {
+    0, 0xffull, 0xffffull, 0xffffffull, 0xffffffffull, 0xffffffffffull
+};
+
+static inline int CountTrailingZeros(uint64_t x) {
+    assert(x != 0);
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_ctzll(x);
+#else
+    int n = 0;
+    while ((x & 1) == 0) {
+        x >>= 1;
+        n++;
+    }
+    return n;
+#endif
+}
+
+// 只保留word中到第一个结束字节为止的字节, stop是word中结束字节的最高位组成的掩码, 不能为0
+static inline uint64_t KeepThroughStop(uint64_t word, uint64_t stop) {
+    const uint64_t lowest = stop & (~stop + 1);  // 第一个结束字节的最高位
+    return word & ((lowest << 1) - 1);  // 结束字节是第8个字节时左移得到0, 减1后保留全部字节
+}
+
+// 去掉每个字节的最高位, 把各字节的低7位拼接起来, word中最多5个字节有效, 超过32位的部分被截断
+static inline uint32_t CompactVarint32(uint64_t word) {
+    return static_cast<uint32_t>((word & 0x7f) | ((word >> 1) & (0x7full << 7)) | ((word >> 2) & (0x7full << 14)) |
+                                 ((word >> 3) & (0x7full << 21)) | ((word >> 4) & (0x7full << 28)));
+}
+
+static inline uint64_t CompactVarint64(uint64_t word) {
+    return (word & 0x7f) | ((word >> 1) & (0x7full << 7)) | ((word >> 2) & (0x7full << 14)) |
+           ((word >> 3) & (0x7full << 21)) | ((word >> 4) & (0x7full << 28)) | ((word >> 5) & (0x7full << 35)) |
+           ((word >> 6) & (0x7full << 42)) | ((word >> 7) & (0x7full << 49));
+}
+
 // 解码变长整数，p中的一个char存了一个u8，从低位解码到高位, 返回解码后剩余的p
 const char* GetVarint32PtrFallback(const char* p, const char* limit, uint32_t* value) {
+    if (limit - p >= 2 && (p[0] & 128) != 0 && (p[1] & 128) == 0) {
+        // 2字节的值最常见, 长度可以预测时分支比下面的掩码计算更快; 1字节的值由GetVarint32Ptr处理,
+        // 直接调用时p[0]的最高位为0, 走下面的通用路径
+        *value = (static_cast<uint8_t>(p[0]) & 127) | (static_cast<uint32_t>(static_cast<uint8_t>(p[1])) << 7);
+        return p + 2;
+    }
+    if (limit - p >= 8) {
+        // 一次读取8字节, 最低的结束字节决定长度, 不需要逐字节判断
+        const uint64_t word = DecodeFixed64(p);
+        const uint64_t stop = ~word & s_varint_stop_bits;
+        if (stop == 0) {
+            return nullptr;
+        }
+        const int length = (CountTrailingZeros(stop) >> 3) + 1;
+        if (length > 5) {
+            return nullptr;  // varint32最多5字节
+        }
+        *value = CompactVarint32(word & s_varint_length_masks[length]);
+        return p + length;
+    }
+
     uint32_t result = 0;
     for (uint32_t shift = 0; shift <= 28 && p < limit; shift += 7) {
         uint32_t byte = *(reinterpret_cast<const uint8_t*>(p));
@@ -134,20 +204,25 @@ bool GetLengthPrefixedSlice(Slice* input, Slice* result) {
     }
 }
 
-const char* GetVarint32Ptr(const char* p, const char* limit, uint32_t* value) {
-    if (p < limit) {
-        uint32_t result = *(reinterpret_cast<const uint8_t*>(p));
-        if ((result & 128) == 0) {
-            // 如果p有效，且最高位为0，则说明解码的数据<2^7直接解码返回, 优化性能
-            *value = result;
-            return p + 1;
+const char* GetVarint64Ptr(const char* p, const char* limit, uint64_t* value) {
+    if (p < limit && (p[0] & 128) == 0) {
+        *value = static_cast<uint8_t>(p[0]);
+        return p + 1;
+    }
+    if (limit - p >= 2 && (p[1] & 128) == 0) {
+        *value = (static_cast<uint8_t>(p[0]) & 127) | (static_cast<uint64_t>(static_cast<uint8_t>(p[1])) << 7);
+        return p + 2;
+    }
+    if (limit - p >= 8) {
+        const uint64_t word = DecodeFixed64(p);
+        const uint64_t stop = ~word & s_varint_stop_bits;
+        if (stop != 0) {
+            *value = CompactVarint64(KeepThroughStop(word, stop));
+            return p + (CountTrailingZeros(stop) >> 3) + 1;
         }
+        // 超过8字节的值很少见, 逐字节解码
     }
-    return GetVarint32PtrFallback(p, limit, value);
-}
 
-// 解码u64，优化收益小，不优化了
-const char* GetVarint64Ptr(const char* p, const char* limit, uint64_t* value) {
     uint64_t result = 0;
     for (uint32_t shift = 0; shift <= 63 && p < limit; shift += 7) {
         uint64_t byte = *(reinterpret_cast<const uint8_t*>(p));
@@ -163,6 +238,243 @@ const char* GetVarint64Ptr(const char* p, const char* limit, uint64_t* value) {
     return nullptr;
 }
 
+const char* DecodeVarint32Batch(const char* p, const char* limit, uint32_t* values, size_t n) {
+    size_t i = 0;
+    while (i < n && limit - p >= 8) {
+        const uint64_t word = DecodeFixed64(p);
+        uint64_t stop = ~word & s_varint_stop_bits;
+        if (stop == 0) {
+            return nullptr;
+        }
+        // 依次解码这8字节中所有完整的varint, 最后一个不完整的varint从下一次读取的位置开始
+        if (stop == s_varint_stop_bits && n - i >= 8) {
+            // 8个单字节的值
+            for (int j = 0; j < 8; j++) {
+                values[i++] = static_cast<uint8_t>(p[j]);
+            }
+            p += 8;
+            continue;
+        }
+        int consumed = 0;
+        while (stop != 0 && i < n) {
+            const int end = (CountTrailingZeros(stop) >> 3) + 1;
+            const int length = end - consumed;
+            if (length > 5) {
+                return nullptr;
+            }
+            values[i++] = CompactVarint32((word >> (consumed * 8)) & s_varint_length_masks[length]);
+            consumed = end;
+            stop &= stop - 1;
+        }
+        p += consumed;
+    }
+    // 剩余不足8字节时逐个解码
+    for (; i < n; i++) {
+        p = GetVarint32Ptr(p, limit, &values[i]);
+        if (p == nullptr) {
+            return nullptr;
+        }
+    }
+    return p;
+}
+
+// 组中每个值按字节数截断时使用的掩码, 下标为标签中保存的字节数减1
+static const uint32_t s_group_varint_masks[4] = {0xffu, 0xffffu, 0xffffffu, 0xffffffffu};
+
+// 按标签查找的表, 编译期生成
+struct GroupVarintTables {
+    uint8_t length[256] = {};  // 完整的一组4个值的数据长度, 不含标签
+#if KVSTORAGE_GROUP_VARINT_SSSE3
+    alignas(16) uint8_t shuffle[256][16] = {};  // 把数据字节移动到4个u32中对应位置的shuffle掩码, 0x80表示填0
+#endif
+
+    constexpr GroupVarintTables() {
+        for (int tag = 0; tag < 256; tag++) {
+            int offset = 0;
+            for (int j = 0; j < 4; j++) {
+                const int len = ((tag >> (j * 2)) & 3) + 1;
+#if KVSTORAGE_GROUP_VARINT_SSSE3
+                for (int k = 0; k < 4; k++) {
+                    shuffle[tag][j * 4 + k] = static_cast<uint8_t>(k < len ? offset + k : 0x80);
+                }
+#endif
+                offset += len;
+            }
+            length[tag] = static_cast<uint8_t>(offset);
+        }
+    }
+};
+
+static constexpr GroupVarintTables s_group_varint_tables{};
+
+static inline int GroupVarintLength(uint32_t value) {
+    return value < (1u << 8) ? 1 : value < (1u << 16) ? 2 : value < (1u << 24) ? 3 : 4;
+}
+
+void PutGroupVarint32(std::string* dst, const uint32_t* values, size_t n) {
+    char buf[1 + 4 * 4];
+    for (size_t i = 0; i < n; i += 4) {
+        const size_t count = std::min<size_t>(n - i, 4);
+        uint8_t tag = 0;
+        char* ptr = buf + 1;
+        for (size_t j = 0; j < count; j++) {
+            const int len = GroupVarintLength(values[i + j]);
+            tag |= static_cast<uint8_t>((len - 1) << (j * 2));
+            EncodeFixed32(ptr, values[i + j]);  // 写入4字节, 只保留前len字节, 之后的字节被下一个值覆盖
+            ptr += len;
+        }
+        buf[0] = static_cast<char>(tag);
+        dst->append(buf, ptr - buf);
+    }
+}
+
+// 接近limit时逐字节解码, 最后一组可能不足4个值; i为已经解码的值的数量
+static const char* GetGroupVarint32Tail(const char* p, const char* limit, uint32_t* values, size_t i, size_t n) {
+    while (i < n) {
+        if (p >= limit) {
+            return nullptr;
+        }
+        const uint8_t tag = static_cast<uint8_t>(*p++);
+        const size_t count = std::min<size_t>(n - i, 4);
+        for (size_t j = 0; j < count; j++) {
+            const int len = ((tag >> (j * 2)) & 3) + 1;
+            if (limit - p < len) {
+                return nullptr;
+            }
+            uint32_t value = 0;
+            for (int k = 0; k < len; k++) {
+                value |= static_cast<uint32_t>(static_cast<uint8_t>(p[k])) << (k * 8);
+            }
+            values[i++] = value;
+            p += len;
+        }
+    }
+    return p;
+}
+
+const char* GetGroupVarint32PtrPortable(const char* p, const char* limit, uint32_t* values, size_t n) {
+    size_t i = 0;
+    // 一组最长17字节, 剩余至少17字节时可以不检查边界, 每个值直接读取4字节再截断
+    while (n - i >= 4 && limit - p >= 17) {
+        const uint8_t tag = static_cast<uint8_t>(p[0]);
+        const char* q = p + 1;
+        for (int j = 0; j < 4; j++) {
+            const int len = (tag >> (j * 2)) & 3;
+            values[i + j] = DecodeFixed32(q) & s_group_varint_masks[len];
+            q += len + 1;
+        }
+        p += 1 + s_group_varint_tables.length[tag];
+        i += 4;
+    }
+    return GetGroupVarint32Tail(p, limit, values, i, n);
+}
+
+#if KVSTORAGE_GROUP_VARINT_SSSE3
+
+// 与GetGroupVarint32PtrPortable相同, 每组通过一次pshufb把数据字节移动到4个u32中
+__attribute__((target("ssse3"))) static const char* GetGroupVarint32PtrSsse3(const char* p, const char* limit,
+                                                                             uint32_t* values, size_t n) {
+    size_t i = 0;
+    while (n - i >= 4 && limit - p >= 17) {
+        const uint8_t tag = static_cast<uint8_t>(p[0]);
+        const __m128i data = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 1));
+        const __m128i mask = _mm_load_si128(reinterpret_cast<const __m128i*>(s_group_varint_tables.shuffle[tag]));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(values + i), _mm_shuffle_epi8(data, mask));
+        p += 1 + s_group_varint_tables.length[tag];
+        i += 4;
+    }
+    return GetGroupVarint32Tail(p, limit, values, i, n);
+}
+
+static bool CanUseSsse3() {
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("ssse3");
+}
+
+#endif  // KVSTORAGE_GROUP_VARINT_SSSE3
+
+typedef const char* (*GroupVarintDecodeFunction)(const char*, const char*, uint32_t*, size_t);
+
+// 第一次调用时检测CPU并选择实现, 局部静态变量的初始化是线程安全的
+static GroupVarintDecodeFunction ChooseGroupVarintDecode() {
+#if KVSTORAGE_GROUP_VARINT_SSSE3
+    if (CanUseSsse3()) {
+        return GetGroupVarint32PtrSsse3;
+    }
+#endif
+    return GetGroupVarint32PtrPortable;
+}
+
+static GroupVarintDecodeFunction GetGroupVarintDecode() {
+    static const GroupVarintDecodeFunction decode = ChooseGroupVarintDecode();
+    return decode;
+}
+
+const char* GetGroupVarint32Ptr(const char* p, const char* limit, uint32_t* values, size_t n) {
+    return GetGroupVarintDecode()(p, limit, values, n);
+}
+
+bool IsGroupVarintHardwareAccelerated() { return GetGroupVarintDecode() != GetGroupVarint32PtrPortable; }
+
+bool GetGroupVarint32(Slice* input, uint32_t* values, size_t n) {
+    const char* p = input->data();
+    const char* limit = p + input->size();
+    const char* q = GetGroupVarint32Ptr(p, limit, values, n);
+    if (q == nullptr) {
+        return false;
+    } else {
+        *input = Slice(q, limit - q);
+        return true;
+    }
+}
+
+void PutUint32Array(std::string* dst, const uint32_t* values, size_t n, IntArrayEncoding encoding) {
+    dst->push_back(static_cast<char>(encoding));
+    PutVarint32(dst, static_cast<uint32_t>(n));
+    switch (encoding) {
+        case IntArrayEncoding::Varint:
+            for (size_t i = 0; i < n; i++) {
+                PutVarint32(dst, values[i]);
+            }
+            break;
+        case IntArrayEncoding::GroupVarint:
+            PutGroupVarint32(dst, values, n);
+            break;
+    }
+}
+
+bool GetUint32Array(Slice* input, std::vector<uint32_t>* values) {
+    if (input->empty()) {
+        return false;
+    }
+    const IntArrayEncoding encoding = static_cast<IntArrayEncoding>((*input)[0]);
+    input->removePrefix(1);
+    uint32_t n;
+    // 两种编码中每个值至少占1字节, 个数超过剩余字节数时数据一定损坏, 不需要分配内存
+    if (!GetVarint32(input, &n) || n > input->size()) {
+        return false;
+    }
+    values->resize(n);
+    const char* p = input->data();
+    const char* limit = p + input->size();
+    const char* q;
+    switch (encoding) {
+        case IntArrayEncoding::Varint:
+            q = DecodeVarint32Batch(p, limit, values->data(), n);
+            break;
+        case IntArrayEncoding::GroupVarint:
+            q = GetGroupVarint32Ptr(p, limit, values->data(), n);
+            break;
+        default:
+            return false;  // 未知的编码方式
+    }
+    if (q == nullptr) {
+        return false;
+    }
+    *input = Slice(q, limit - q);
+    return true;
+}
+
 int VarintLength(uint64_t v) {
     int len = 1;
     while (v >= 128) {
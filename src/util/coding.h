@@ -14,6 +14,7 @@
 #include <cstdint>
 #include <cstring>
 #include <string>
+#include <vector>
 
 #include "slice.h"
 
@@ -28,18 +29,56 @@ void PutLengthPrefixedSlice(std::string* dst, const Slice& value);
 bool GetVarint32(Slice* input, uint32_t* value);
 bool GetVarint64(Slice* input, uint64_t* value);
 bool GetLengthPrefixedSlice(Slice* input, Slice* result);
+// 解码p开始的变长整数, 返回解码后的下一个位置, 数据不完整或格式错误时返回nullptr
+// 1, 2字节的值直接判断; 更长的值在limit - p >= 8时一次读取8字节, 通过掩码找到结束字节, 否则逐字节解码
 const char* GetVarint32PtrFallback(const char* p, const char* limit, uint32_t* value);
-
-const char* GetVarint32Ptr(const char* p, const char* limit, uint32_t* value);
+inline const char* GetVarint32Ptr(const char* p, const char* limit, uint32_t* value);
 const char* GetVarint64Ptr(const char* p, const char* limit, uint64_t* value);
+// 连续解码n个varint32保存到values中, 返回最后一个之后的位置, 任意一个失败时返回nullptr
+// 8字节中的多个短varint只需要读取一次
+const char* DecodeVarint32Batch(const char* p, const char* limit, uint32_t* values, size_t n);
+
+// Group varint: 每4个u32为一组, 组首的1字节标签中每2位保存一个值的字节数减1, 之后是各值的小端字节(1~4字节);
+// 解码时根据标签一次得到整组的长度, 不需要逐字节判断, CPU支持SSSE3时通过一次shuffle解码一组;
+// 最后一组不足4个值时, 标签中多余的位为0且没有对应的字节, 所以解码时需要知道值的数量
+void PutGroupVarint32(std::string* dst, const uint32_t* values, size_t n);
+// 解码n个值保存到values中, 返回最后一组之后的位置, 数据不完整时返回nullptr
+const char* GetGroupVarint32Ptr(const char* p, const char* limit, uint32_t* values, size_t n);
+// 不使用SIMD指令的实现, 与GetGroupVarint32Ptr()结果相同, 供测试和性能对比使用
+const char* GetGroupVarint32PtrPortable(const char* p, const char* limit, uint32_t* values, size_t n);
+// GetGroupVarint32Ptr()是否使用了SSSE3的shuffle, 运行时根据CPU选择
+bool IsGroupVarintHardwareAccelerated();
+bool GetGroupVarint32(Slice* input, uint32_t* values, size_t n);
+
+// 整数数组的编码方式, 供表格式和日志格式中的内部数组(重启点, 块句柄, 长度等)选择
+enum class IntArrayEncoding : uint8_t {
+    Varint = 0x0,  // 每个值单独varint编码, 短数组更紧凑
+    GroupVarint = 0x1,  // 4个值一组, 长数组解码更快
+};
+
+// 数组的格式: 1字节编码方式 | varint32个数 | 编码后的值, 读取时不需要预先知道编码方式
+void PutUint32Array(std::string* dst, const uint32_t* values, size_t n, IntArrayEncoding encoding);
+bool GetUint32Array(Slice* input, std::vector<uint32_t>* values);
 
 int VarintLength(uint64_t v);
 
 char* EncodeVarint32(char* dst, uint32_t value);
 char* EncodeVarint64(char* dst, uint64_t value);
 
+// 主机是否为小端序; 是时Fixed编码与内存中的表示相同, 编解码只需要一次(非对齐的)读写,
+// 否则逐字节移位, 两个分支都参与编译, 由编译器根据常量消除
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+static constexpr bool s_little_endian = true;
+#else
+static constexpr bool s_little_endian = false;
+#endif
+
 // 将4字节的value按字节编码到buffer数组中的不同位置
 inline void EncodeFixed32(char* dst, uint32_t value) {
+    if (s_little_endian) {
+        std::memcpy(dst, &value, sizeof(value));
+        return;
+    }
     uint8_t* const buffer = reinterpret_cast<uint8_t*>(dst);
 
     buffer[0] = static_cast<uint8_t>(value);  // 强制转换时发生高位截断
@@ -49,6 +88,10 @@ inline void EncodeFixed32(char* dst, uint32_t value) {
 }
 
 inline void EncodeFixed64(char* dst, uint64_t value) {
+    if (s_little_endian) {
+        std::memcpy(dst, &value, sizeof(value));
+        return;
+    }
     uint8_t* const buffer = reinterpret_cast<uint8_t*>(dst);
 
     buffer[0] = static_cast<uint8_t>(value);
@@ -62,6 +105,11 @@ inline void EncodeFixed64(char* dst, uint64_t value) {
 }
 
 inline uint32_t DecodeFixed32(const char* ptr) {
+    if (s_little_endian) {
+        uint32_t result;
+        std::memcpy(&result, ptr, sizeof(result));  // 编译为一条mov, 不要求对齐
+        return result;
+    }
     const uint8_t* const buffer = reinterpret_cast<const uint8_t*>(ptr);
 
     return (static_cast<uint32_t>(buffer[0]))
@@ -71,6 +119,11 @@ inline uint32_t DecodeFixed32(const char* ptr) {
 }
 
 inline uint64_t DecodeFixed64(const char* ptr) {
+    if (s_little_endian) {
+        uint64_t result;
+        std::memcpy(&result, ptr, sizeof(result));
+        return result;
+    }
     const uint8_t* const buffer = reinterpret_cast<const uint8_t*>(ptr);
 
     return (static_cast<uint64_t>(buffer[0]))
@@ -83,6 +136,27 @@ inline uint64_t DecodeFixed64(const char* ptr) {
            | (static_cast<uint64_t>(buffer[7]) << 56);
 }
 
+// 大端序, 编码结果按字节比较的顺序与整数顺序相同, 用于整数键
+inline void EncodeBigEndian64(char* dst, uint64_t value) {
+    EncodeFixed64(dst, __builtin_bswap64(value));
+}
+
+inline uint64_t DecodeBigEndian64(const char* ptr) {
+    return __builtin_bswap64(DecodeFixed64(ptr));
+}
+
+inline const char* GetVarint32Ptr(const char* p, const char* limit, uint32_t* value) {
+    if (p < limit) {
+        uint32_t result = *(reinterpret_cast<const uint8_t*>(p));
+        if ((result & 128) == 0) {
+            // 如果p有效，且最高位为0，则说明解码的数据<2^7直接解码返回, 优化性能
+            *value = result;
+            return p + 1;
+        }
+    }
+    return GetVarint32PtrFallback(p, limit, value);
+}
+
 }
 
 #endif
\ No newline at end of file
@@ -60,6 +60,25 @@ public:
     }
 
 };
+
+// 8字节整数键比较器, 键的长度固定, 不能缩短, 所以分隔符和后继都保持原样
+class Uint64KeyComparatorImpl : public Comparator {
+public:
+    Uint64KeyComparatorImpl() = default;
+    ~Uint64KeyComparatorImpl() = default;
+
+public:
+    const char* name() const override { return "kvstorage.Uint64KeyComparator"; }
+    int compare(const Slice& a, const Slice& b) const override {
+        return Uint64Compare()(a, b);
+    }
+
+    // 键是定长的, 截断后不再是8字节; start本身就是满足条件的分隔符
+    void findShortestSeparator(std::string* /*start*/, const Slice& /*limit*/) const override {}
+
+    // 键是定长的, 不能缩短, key本身就是后继
+    void findShortSuccessor(std::string* /*key*/) const override {}
+};
 }
 
 const Comparator* BytewiseComparator() {
@@ -67,4 +86,9 @@ const Comparator* BytewiseComparator() {
     return singleton.get();
 }
 
+const Comparator* Uint64KeyComparator() {
+    static NoDestructor<Uint64KeyComparatorImpl> singleton;
+    return singleton.get();
+}
+
 }
\ No newline at end of file
@@ -0,0 +1,55 @@
+#include "concurrent_arena.h"
+
+#include <algorithm>
+#include <new>
+#include <thread>
+
+namespace kvstorage {
+
+// 分片数量取大于等于CPU核数的最小的2的幂
+static size_t ShardCount() {
+    size_t cores = std::thread::hardware_concurrency();
+    size_t n = 1;
+    while (n < cores) {
+        n <<= 1;
+    }
+    return n;
+}
+
+// 分片的内存块不超过Arena块大小的1/4, 保证能从Arena的内存块中切分出来
+static size_t ShardBlockSize(size_t block_size, size_t max_size, size_t align) {
+    size_t size = std::min(block_size / 4, max_size);
+    size &= ~(align - 1);
+    return std::max(size, align);
+}
+
+ConcurrentArena::ConcurrentArena(size_t block_size, bool use_huge_page, ArenaBlockPool* pool)
+    : shard_block_size_(ShardBlockSize(block_size, s_max_shard_block_size, s_align)),
+      shard_mask_(ShardCount() - 1), shards_(new Shard[shard_mask_ + 1]),
+      arena_(block_size, use_huge_page, pool) {}
+
+char* ConcurrentArena::allocateFallback(Shard* shard, size_t bytes) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (bytes > shard_block_size_ / 4) {
+        // 请求的内存较大, 直接从共享Arena分配, 不丢弃分片中剩余的空间
+        return arena_.allocateAligned(bytes);
+    }
+
+    // 加锁期间其他线程可能已经为这个分片换了新的内存块, 先重试一次
+    ShardBlock* block = shard->block.load(std::memory_order_relaxed);
+    if (block != nullptr) {
+        size_t offset = block->used.fetch_add(bytes, std::memory_order_relaxed);
+        if (offset + bytes <= block->size) {
+            return block->base + offset;
+        }
+    }
+
+    // 旧内存块剩余的空间被丢弃, 新内存块的描述信息同样分配在arena_中
+    char* base = arena_.allocateAligned(shard_block_size_);
+    char* meta = arena_.allocateAligned(sizeof(ShardBlock));
+    block = new (meta) ShardBlock(base, shard_block_size_, bytes);
+    shard->block.store(block, std::memory_order_release);  // 与快速路径中的acquire配对
+    return base;
+}
+
+}  // namespace kvstorage
@@ -0,0 +1,86 @@
+/*
+* 线程安全的内存分配器
+* 共享的Arena保存所有内存块, 每个分片从中取一小块内存, 线程通过自己的分片无锁地分配;
+* 分片的内存块用完时才加锁从Arena中取新块, 供多个写线程并发向跳表插入结点时使用
+*/
+#ifndef KVSTORAGE_UTIL_CONCURRENT_ARENA_H_
+#define KVSTORAGE_UTIL_CONCURRENT_ARENA_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+
+#include "arena.h"
+
+namespace kvstorage {
+
+class ConcurrentArena {
+public:
+    // block_size, use_huge_page和pool传给共享的Arena, 分片每次从中取block_size / 4(最多128KB)的内存
+    explicit ConcurrentArena(size_t block_size = Arena::s_default_block_size, bool use_huge_page = false,
+                             ArenaBlockPool* pool = nullptr);
+    ConcurrentArena(const ConcurrentArena&) = delete;
+    ConcurrentArena& operator=(const ConcurrentArena&) = delete;
+    ~ConcurrentArena() = default;
+
+public:
+    // 分片内的分配统一按s_align对齐, 所以allocate和allocateAligned的行为相同
+    char* allocate(size_t bytes) { return allocateAligned(bytes); }
+    char* allocateAligned(size_t bytes);
+    // 返回从系统分配的全部内存, 包括各分片中还未使用的部分
+    size_t memoryUsage() const { return arena_.memoryUsage(); }
+
+private:
+    static constexpr size_t s_max_shard_block_size = 128 * 1024;
+    static constexpr size_t s_align = (sizeof(void*) > 8) ? sizeof(void*) : 8;
+    static_assert((s_align & (s_align - 1)) == 0, "Pointer size should be a power of 2");
+
+    // 分片当前持有的内存块, 通过fetch_add移动used实现无锁分配
+    struct ShardBlock {
+        ShardBlock(char* b, size_t s, size_t u) : base(b), size(s), used(u) {}
+        char* const base;
+        const size_t size;
+        std::atomic<size_t> used;  // 可能超过size, 超过说明内存块已经用完
+    };
+
+    // 按cache line对齐, 避免不同分片之间的伪共享
+    struct alignas(64) Shard {
+        std::atomic<ShardBlock*> block{nullptr};
+    };
+
+    Shard* currentShard();
+    char* allocateFallback(Shard* shard, size_t bytes);  // 分片空间不足时, 加锁从共享Arena中分配
+
+private:
+    const size_t shard_block_size_;
+    size_t shard_mask_;  // 分片数量 - 1, 分片数量是2的幂
+    std::unique_ptr<Shard[]> shards_;
+    std::mutex mutex_;  // 保护arena_的分配
+    Arena arena_;  // 共享的内存块链表, 所有分片的内存都从这里分配
+};
+
+inline ConcurrentArena::Shard* ConcurrentArena::currentShard() {
+    // 线程第一次分配时按顺序确定分片编号, 之后固定使用同一个分片
+    static std::atomic<size_t> next_index{0};
+    static thread_local size_t index = next_index.fetch_add(1, std::memory_order_relaxed);
+    return &shards_[index & shard_mask_];
+}
+
+inline char* ConcurrentArena::allocateAligned(size_t bytes) {
+    assert(bytes > 0);
+    bytes = (bytes + s_align - 1) & ~(s_align - 1);  // 向上取整, 保证分片内的下一次分配仍然对齐
+    Shard* shard = currentShard();
+    ShardBlock* block = shard->block.load(std::memory_order_acquire);
+    if (block != nullptr) {
+        size_t offset = block->used.fetch_add(bytes, std::memory_order_relaxed);
+        if (offset + bytes <= block->size) {
+            return block->base + offset;
+        }
+    }
+    return allocateFallback(shard, bytes);
+}
+
+}  // namespace kvstorage
+#endif
@@ -0,0 +1,228 @@
+/*
+ *  CRC32C的两种实现:
+ *  slicing-by-8: 8张256项的表, 每次处理8字节, 查8次表
+ *  SSE4.2: crc32指令每次处理8字节, 但有3个周期的延迟, 长数据分成3段交错计算, 再把3段的crc合并
+*/
+#include "crc32c.h"
+#include "coding.h"
+
+#include <cstdint>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#include <nmmintrin.h>
+#define KVSTORAGE_CRC32C_SSE42 1
+#else
+#define KVSTORAGE_CRC32C_SSE42 0
+#endif
+
+namespace kvstorage {
+
+namespace crc32c {
+
+// Castagnoli多项式的反转表示
+static const uint32_t s_poly = 0x82f63b78u;
+
+// slicing-by-8的表, 编译期生成; table[0]为逐字节的表, table[k][i]相当于字节i之后再跟k个0字节
+struct SlicingTables {
+    uint32_t table[8][256] = {};
+
+    constexpr SlicingTables() {
+        for (uint32_t i = 0; i < 256; i++) {
+            uint32_t crc = i;
+            for (int j = 0; j < 8; j++) {
+                crc = (crc >> 1) ^ ((crc & 1) ? s_poly : 0);
+            }
+            table[0][i] = crc;
+        }
+        for (int k = 1; k < 8; k++) {
+            for (int i = 0; i < 256; i++) {
+                table[k][i] = (table[k - 1][i] >> 8) ^ table[0][table[k - 1][i] & 0xff];
+            }
+        }
+    }
+};
+
+static constexpr SlicingTables s_slicing{};
+
+uint32_t ExtendPortable(uint32_t init_crc, const char* data, size_t n) {
+    const uint32_t (*t)[256] = s_slicing.table;
+    const uint8_t* p = reinterpret_cast<const uint8_t*>(data);
+    const uint8_t* const limit = p + n;
+    uint32_t crc = init_crc ^ 0xffffffffu;
+
+    while (limit - p >= 8) {
+        const uint32_t lo = crc ^ DecodeFixed32(reinterpret_cast<const char*>(p));
+        const uint32_t hi = DecodeFixed32(reinterpret_cast<const char*>(p + 4));
+        crc = t[7][lo & 0xff] ^ t[6][(lo >> 8) & 0xff] ^ t[5][(lo >> 16) & 0xff] ^ t[4][lo >> 24] ^
+              t[3][hi & 0xff] ^ t[2][(hi >> 8) & 0xff] ^ t[1][(hi >> 16) & 0xff] ^ t[0][hi >> 24];
+        p += 8;
+    }
+    while (p < limit) {
+        crc = t[0][(crc ^ *p++) & 0xff] ^ (crc >> 8);
+    }
+    return crc ^ 0xffffffffu;
+}
+
+#if KVSTORAGE_CRC32C_SSE42
+
+// 交错计算时每段的长度, 超过3 * s_long_block的数据使用长段, 剩余部分超过3 * s_short_block时使用短段
+static const size_t s_long_block = 8192;
+static const size_t s_short_block = 256;
+
+// 在crc之后追加若干个0字节相当于一个32x32的GF(2)矩阵, 这里把矩阵按crc的4个字节展开成4张表
+struct ZerosTable {
+    uint32_t table[4][256];
+};
+
+// GF(2)上的矩阵乘向量, mat的每一项是矩阵的一列
+static uint32_t Gf2MatrixTimes(const uint32_t* mat, uint32_t vec) {
+    uint32_t sum = 0;
+    while (vec != 0) {
+        if (vec & 1) {
+            sum ^= *mat;
+        }
+        vec >>= 1;
+        mat++;
+    }
+    return sum;
+}
+
+static void Gf2MatrixSquare(uint32_t* square, const uint32_t* mat) {
+    for (int n = 0; n < 32; n++) {
+        square[n] = Gf2MatrixTimes(mat, mat[n]);
+    }
+}
+
+// 生成追加len个0字节的表, len必须是2的幂
+static void MakeZerosTable(ZerosTable* zeros, size_t len) {
+    uint32_t odd[32];  // 追加奇数个2的幂个0位的矩阵
+    uint32_t even[32];
+    odd[0] = s_poly;  // 1个0位
+    uint32_t row = 1;
+    for (int n = 1; n < 32; n++) {
+        odd[n] = row;
+        row <<= 1;
+    }
+    Gf2MatrixSquare(even, odd);  // 2个0位
+    Gf2MatrixSquare(odd, even);  // 4个0位
+
+    // 每次平方使0位的数量翻倍, 第一次得到1个0字节
+    const uint32_t* op = nullptr;
+    while (true) {
+        Gf2MatrixSquare(even, odd);
+        len >>= 1;
+        if (len == 0) {
+            op = even;
+            break;
+        }
+        Gf2MatrixSquare(odd, even);
+        len >>= 1;
+        if (len == 0) {
+            op = odd;
+            break;
+        }
+    }
+
+    for (uint32_t n = 0; n < 256; n++) {
+        zeros->table[0][n] = Gf2MatrixTimes(op, n);
+        zeros->table[1][n] = Gf2MatrixTimes(op, n << 8);
+        zeros->table[2][n] = Gf2MatrixTimes(op, n << 16);
+        zeros->table[3][n] = Gf2MatrixTimes(op, n << 24);
+    }
+}
+
+static inline uint32_t Shift(const ZerosTable& zeros, uint32_t crc) {
+    return zeros.table[0][crc & 0xff] ^ zeros.table[1][(crc >> 8) & 0xff] ^ zeros.table[2][(crc >> 16) & 0xff] ^
+           zeros.table[3][crc >> 24];
+}
+
+static ZerosTable s_long_zeros;
+static ZerosTable s_short_zeros;
+
+__attribute__((target("sse4.2"))) static uint32_t ExtendSse42(uint32_t init_crc, const char* data, size_t n) {
+    const char* p = data;
+    const char* const limit = data + n;
+    uint64_t crc0 = init_crc ^ 0xffffffffu;
+
+    // 对齐到8字节
+    while (p < limit && (reinterpret_cast<uintptr_t>(p) & 7) != 0) {
+        crc0 = _mm_crc32_u8(static_cast<uint32_t>(crc0), static_cast<uint8_t>(*p++));
+    }
+
+    // 3段同时计算, 第2, 3段从0开始, 最后把前一段的crc移过一段的长度后与下一段合并
+    while (static_cast<size_t>(limit - p) >= s_long_block * 3) {
+        uint64_t crc1 = 0;
+        uint64_t crc2 = 0;
+        const char* const end = p + s_long_block;
+        do {
+            crc0 = _mm_crc32_u64(crc0, DecodeFixed64(p));
+            crc1 = _mm_crc32_u64(crc1, DecodeFixed64(p + s_long_block));
+            crc2 = _mm_crc32_u64(crc2, DecodeFixed64(p + 2 * s_long_block));
+            p += 8;
+        } while (p < end);
+        crc0 = Shift(s_long_zeros, static_cast<uint32_t>(crc0)) ^ crc1;
+        crc0 = Shift(s_long_zeros, static_cast<uint32_t>(crc0)) ^ crc2;
+        p += 2 * s_long_block;
+    }
+    while (static_cast<size_t>(limit - p) >= s_short_block * 3) {
+        uint64_t crc1 = 0;
+        uint64_t crc2 = 0;
+        const char* const end = p + s_short_block;
+        do {
+            crc0 = _mm_crc32_u64(crc0, DecodeFixed64(p));
+            crc1 = _mm_crc32_u64(crc1, DecodeFixed64(p + s_short_block));
+            crc2 = _mm_crc32_u64(crc2, DecodeFixed64(p + 2 * s_short_block));
+            p += 8;
+        } while (p < end);
+        crc0 = Shift(s_short_zeros, static_cast<uint32_t>(crc0)) ^ crc1;
+        crc0 = Shift(s_short_zeros, static_cast<uint32_t>(crc0)) ^ crc2;
+        p += 2 * s_short_block;
+    }
+
+    while (limit - p >= 8) {
+        crc0 = _mm_crc32_u64(crc0, DecodeFixed64(p));
+        p += 8;
+    }
+    while (p < limit) {
+        crc0 = _mm_crc32_u8(static_cast<uint32_t>(crc0), static_cast<uint8_t>(*p++));
+    }
+    return static_cast<uint32_t>(crc0) ^ 0xffffffffu;
+}
+
+static bool CanUseSse42() {
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("sse4.2");
+}
+
+#endif  // KVSTORAGE_CRC32C_SSE42
+
+typedef uint32_t (*ExtendFunction)(uint32_t, const char*, size_t);
+
+// 第一次调用时检测CPU并选择实现, 局部静态变量的初始化是线程安全的
+static ExtendFunction ChooseExtend() {
+#if KVSTORAGE_CRC32C_SSE42
+    if (CanUseSse42()) {
+        MakeZerosTable(&s_long_zeros, s_long_block);
+        MakeZerosTable(&s_short_zeros, s_short_block);
+        return ExtendSse42;
+    }
+#endif
+    return ExtendPortable;
+}
+
+static ExtendFunction GetExtend() {
+    static const ExtendFunction extend = ChooseExtend();
+    return extend;
+}
+
+uint32_t Extend(uint32_t init_crc, const char* data, size_t n) {
+    return GetExtend()(init_crc, data, n);
+}
+
+bool IsHardwareAccelerated() {
+    return GetExtend() != ExtendPortable;
+}
+
+}  // namespace crc32c
+
+}  // namespace kvstorage
@@ -0,0 +1,45 @@
+/*
+ * CRC32C(Castagnoli多项式)校验和, 用于数据块和日志记录的校验
+ * x86-64上CPU支持SSE4.2时使用crc32指令, 否则使用slicing-by-8查表, 在第一次调用时通过cpuid选择
+*/
+#ifndef KVSTORAGE_UTIL_CRC32C_H_
+#define KVSTORAGE_UTIL_CRC32C_H_
+
+#include <cstddef>
+#include <cstdint>
+
+namespace kvstorage {
+
+namespace crc32c {
+
+// 返回 concat(A, data[0,n-1]) 的crc32c, init_crc为某个字符串A的crc32c; 用于分段计算校验和
+uint32_t Extend(uint32_t init_crc, const char* data, size_t n);
+
+// 返回data[0,n-1]的crc32c
+inline uint32_t Value(const char* data, size_t n) { return Extend(0, data, n); }
+
+// slicing-by-8的实现, 与Extend()结果相同, 供测试和性能对比使用
+uint32_t ExtendPortable(uint32_t init_crc, const char* data, size_t n);
+
+// Extend()是否使用了硬件指令
+bool IsHardwareAccelerated();
+
+static const uint32_t s_mask_delta = 0xa282ead8ul;
+
+// 对包含crc的数据再计算crc容易出问题(例如数据中嵌入了crc), 所以存储的crc先经过变换
+inline uint32_t Mask(uint32_t crc) {
+    // 循环右移15位再加上一个常量
+    return ((crc >> 15) | (crc << 17)) + s_mask_delta;
+}
+
+// 返回Mask()之前的crc
+inline uint32_t Unmask(uint32_t masked_crc) {
+    uint32_t rot = masked_crc - s_mask_delta;
+    return ((rot >> 17) | (rot << 15));
+}
+
+}  // namespace crc32c
+
+}  // namespace kvstorage
+
+#endif  // KVSTORAGE_UTIL_CRC32C_H_
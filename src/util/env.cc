@@ -2,11 +2,66 @@
 
 #include <cstdarg>
 
+#include "options.h"
+#include "rate_limiter.h"
+
 namespace kvstorage {
 
 Status Env::deleteDir(const std::string& fname) { return removeDir(fname); }
 Status Env::deleteFile(const std::string& fname) { return removeFile(fname); }
 
+Status Env::newRandomAccessFile(const std::string& fname, const EnvOptions& options, RandomAccessFile** res) {
+    Status s = newRandomAccessFile(fname, res);
+    if (s.ok() && options.rate_limiter != nullptr) {
+        *res = NewRateLimitedRandomAccessFile(*res, options.rate_limiter, options.io_priority);
+    }
+    return s;
+}
+
+Status Env::newWritableFile(const std::string& fname, const EnvOptions& options, WritableFile** res) {
+    Status s = newWritableFile(fname, res);
+    if (s.ok() && options.rate_limiter != nullptr) {
+        *res = NewRateLimitedWritableFile(*res, options.rate_limiter, options.io_priority);
+    }
+    return s;
+}
+
+EnvOptions::EnvOptions(const Options& options) : use_direct_reads(options.use_direct_reads) {}
+
+EnvOptions EnvOptionsForFlushAndCompaction(const Options& options, Env::IOPriority pri) {
+    EnvOptions env_options(options);
+    if (options.use_direct_io_for_flush_and_compaction) {
+        env_options.use_direct_reads = true;
+        env_options.use_direct_writes = true;
+    }
+    env_options.rate_limiter = options.rate_limiter;
+    env_options.io_priority = pri;
+    return env_options;
+}
+
+// 默认实现不支持取消和调整线程数量, 由有线程池的Env重写
+int Env::unschedule(void* /*tag*/, Priority /*pri*/) { return 0; }
+void Env::setBackgroundThreads(int /*num*/, Priority /*pri*/) {}
+int Env::getBackgroundThreads(Priority /*pri*/) { return 1; }
+void Env::getThreadPoolStats(Priority /*pri*/, ThreadPoolStats* stats) { *stats = ThreadPoolStats(); }
+
+Status RandomAccessFile::multiRead(ReadRequest* reqs, size_t n) {
+    Status s;
+    for (size_t i = 0; i < n; i++) {
+        ReadRequest* req = &reqs[i];
+        req->status = read(req->offset, req->len, &req->result, req->scratch);
+        if (!req->status.ok() && s.ok()) {
+            s = req->status;
+        }
+    }
+    return s;
+}
+
+void RandomAccessFile::readAsync(ReadRequest* req, ReadCallback callback, void* arg) {
+    req->status = read(req->offset, req->len, &req->result, req->scratch);
+    (*callback)(arg, req);
+}
+
 void Log(Logger* info_log, const char* format, ...) {
     if (info_log != nullptr) {
         std::va_list ap;
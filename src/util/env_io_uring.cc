@@ -0,0 +1,480 @@
+/*
+ *  io_uring的Env实现, 直接使用io_uring_setup/io_uring_enter系统调用, 不依赖liburing
+ *  提交队列(SQ)和完成队列(CQ)是与内核共享的环形缓冲区, 用户态写SQ的tail, 读CQ的head,
+ *  内核写SQ的head和CQ的tail, 双方通过acquire/release顺序同步
+ *  multiRead: 每个线程一个私有的ring, 批量提交后在同一次io_uring_enter中等待全部完成
+ *  readAsync: Env共享一个ring, 提交由互斥锁保护, 完成事件由后台线程处理
+*/
+#include "env_io_uring.h"
+#include "env_io_uring_test_helper.h"
+
+#include <fcntl.h>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <condition_variable>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace kvstorage {
+
+namespace {
+
+// multiRead每批提交的请求数量, 也是每个ring的SQ长度
+static const unsigned s_ring_entries = 64;
+
+// 析构时提交的NOP请求的user_data, 通知后台线程退出
+static const uint64_t s_shutdown_user_data = 0;
+
+// io_uring_enter失败后等待已提交请求完成时, 两次检查CQ之间的间隔
+static const int s_enter_retry_micros = 100;
+
+Status IoUringError(const std::string& context, int error_number) {
+    if (error_number == ENOENT) {
+        return Status::notFound(context, std::strerror(error_number));
+    }
+    return Status::ioError(context, std::strerror(error_number));
+}
+
+// 一个io_uring实例, 提交(nextSqe, publish)需要外部同步; enter和popCqe可以在另一个线程中调用,
+// 但同一时间只能有一个线程处理完成事件
+class IoUring {
+public:
+    IoUring()
+        : ring_fd_(-1), sq_ring_ptr_(MAP_FAILED), sq_ring_size_(0), cq_ring_ptr_(MAP_FAILED), cq_ring_size_(0),
+          sqes_(static_cast<io_uring_sqe*>(MAP_FAILED)), sqes_size_(0), sqe_head_(0), sqe_tail_(0),
+          injected_enter_failures_(0) {}
+    IoUring(const IoUring&) = delete;
+    IoUring& operator=(const IoUring&) = delete;
+
+    ~IoUring() {
+        if (sqes_ != MAP_FAILED) {
+            ::munmap(sqes_, sqes_size_);
+        }
+        if (cq_ring_ptr_ != MAP_FAILED && cq_ring_ptr_ != sq_ring_ptr_) {
+            ::munmap(cq_ring_ptr_, cq_ring_size_);
+        }
+        if (sq_ring_ptr_ != MAP_FAILED) {
+            ::munmap(sq_ring_ptr_, sq_ring_size_);
+        }
+        if (ring_fd_ >= 0) {
+            ::close(ring_fd_);
+        }
+    }
+
+    Status init(unsigned entries) {
+        io_uring_params params;
+        std::memset(&params, 0, sizeof(params));
+        ring_fd_ = static_cast<int>(::syscall(__NR_io_uring_setup, entries, &params));
+        if (ring_fd_ < 0) {
+            ring_fd_ = -1;
+            return Status::notSupported("io_uring_setup", std::strerror(errno));
+        }
+        // IORING_FEAT_RW_CUR_POS和IORING_OP_READ同时出现在5.6中
+        if ((params.features & IORING_FEAT_RW_CUR_POS) == 0) {
+            return Status::notSupported("io_uring", "IORING_OP_READ is not supported");
+        }
+
+        sq_ring_size_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        cq_ring_size_ = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        const bool single_mmap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+        if (single_mmap) {
+            sq_ring_size_ = cq_ring_size_ = std::max(sq_ring_size_, cq_ring_size_);
+        }
+        sq_ring_ptr_ = ::mmap(nullptr, sq_ring_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd_,
+                              IORING_OFF_SQ_RING);
+        if (sq_ring_ptr_ == MAP_FAILED) {
+            return IoUringError("io_uring mmap", errno);
+        }
+        if (single_mmap) {
+            cq_ring_ptr_ = sq_ring_ptr_;
+        } else {
+            cq_ring_ptr_ = ::mmap(nullptr, cq_ring_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                                  ring_fd_, IORING_OFF_CQ_RING);
+            if (cq_ring_ptr_ == MAP_FAILED) {
+                return IoUringError("io_uring mmap", errno);
+            }
+        }
+        sqes_size_ = params.sq_entries * sizeof(io_uring_sqe);
+        sqes_ = static_cast<io_uring_sqe*>(::mmap(nullptr, sqes_size_, PROT_READ | PROT_WRITE,
+                                                  MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_SQES));
+        if (sqes_ == MAP_FAILED) {
+            return IoUringError("io_uring mmap", errno);
+        }
+
+        char* sq = static_cast<char*>(sq_ring_ptr_);
+        sq_head_ = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+        sq_tail_ = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+        sq_mask_ = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+        sq_entries_ = params.sq_entries;
+        sq_array_ = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+        char* cq = static_cast<char*>(cq_ring_ptr_);
+        cq_head_ = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+        cq_tail_ = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+        cq_mask_ = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+        cqes_ = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+        sqe_head_ = sqe_tail_ = *sq_tail_;
+        return Status::success();
+    }
+
+    unsigned sqEntries() const { return sq_entries_; }
+
+    // 返回下一个空闲的SQE, SQ已满时返回nullptr; 填写后调用publish()使内核可见
+    io_uring_sqe* nextSqe() {
+        const unsigned head = __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE);
+        if (sqe_tail_ - head >= sq_entries_) {
+            return nullptr;
+        }
+        io_uring_sqe* sqe = &sqes_[sqe_tail_ & sq_mask_];
+        sqe_tail_++;
+        std::memset(sqe, 0, sizeof(*sqe));
+        return sqe;
+    }
+
+    // 把填写好的SQE放入SQ, 更新tail之后内核才能看到
+    void publish() {
+        unsigned tail = *sq_tail_;
+        while (sqe_head_ != sqe_tail_) {
+            sq_array_[tail & sq_mask_] = sqe_head_ & sq_mask_;
+            tail++;
+            sqe_head_++;
+        }
+        __atomic_store_n(sq_tail_, tail, __ATOMIC_RELEASE);
+    }
+
+    // 提交SQ中所有还未被内核取走的请求, wait_nr > 0时等待CQ中至少有wait_nr个完成事件;
+    // 返回提交的数量, 失败时返回-errno
+    int enter(unsigned wait_nr) {
+        if (injected_enter_failures_.load(std::memory_order_relaxed) > 0 &&
+            injected_enter_failures_.fetch_sub(1, std::memory_order_relaxed) > 0) {
+            return -EAGAIN;
+        }
+        while (true) {
+            const unsigned to_submit = __atomic_load_n(sq_tail_, __ATOMIC_ACQUIRE) -
+                                       __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE);
+            const unsigned flags = (wait_nr > 0) ? IORING_ENTER_GETEVENTS : 0;
+            const int ret = static_cast<int>(::syscall(__NR_io_uring_enter, ring_fd_, to_submit, wait_nr, flags,
+                                                       nullptr, 0));
+            if (ret < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                return -errno;
+            }
+            return ret;
+        }
+    }
+
+    // 之后n次enter()在进入内核之前返回-EAGAIN, 只影响这个ring
+    void failNextEnters(int n) { injected_enter_failures_.store(n, std::memory_order_relaxed); }
+
+    // SQ中还未被内核取走的请求数量
+    unsigned unsubmitted() const {
+        return __atomic_load_n(sq_tail_, __ATOMIC_ACQUIRE) - __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE);
+    }
+
+    // 从SQ中撤回还未被内核取走的请求, 返回撤回的数量; 只有提交线程会调用enter()时才能使用,
+    // 内核只在enter()中读取SQ, 撤回之后这些请求不会再被提交
+    unsigned discardUnsubmitted() {
+        const unsigned head = __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE);
+        const unsigned discarded = *sq_tail_ - head;
+        __atomic_store_n(sq_tail_, head, __ATOMIC_RELEASE);
+        sqe_head_ = sqe_tail_ = head;
+        return discarded;
+    }
+
+    // 取出一个完成事件, 没有时返回false
+    bool popCqe(uint64_t* user_data, int32_t* res) {
+        const unsigned head = *cq_head_;
+        if (head == __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE)) {
+            return false;
+        }
+        const io_uring_cqe& cqe = cqes_[head & cq_mask_];
+        *user_data = cqe.user_data;
+        *res = cqe.res;
+        __atomic_store_n(cq_head_, head + 1, __ATOMIC_RELEASE);
+        return true;
+    }
+
+private:
+    int ring_fd_;
+    void* sq_ring_ptr_;
+    size_t sq_ring_size_;
+    void* cq_ring_ptr_;
+    size_t cq_ring_size_;
+    io_uring_sqe* sqes_;
+    size_t sqes_size_;
+
+    unsigned* sq_head_;
+    unsigned* sq_tail_;
+    unsigned sq_mask_;
+    unsigned sq_entries_;
+    unsigned* sq_array_;
+    unsigned* cq_head_;
+    unsigned* cq_tail_;
+    unsigned cq_mask_;
+    io_uring_cqe* cqes_;
+
+    unsigned sqe_head_;  // 已放入SQ的SQE
+    unsigned sqe_tail_;  // 已分配的SQE, [sqe_head_, sqe_tail_)已填写但还未publish
+    std::atomic<int> injected_enter_failures_;  // 测试中注入的失败次数, 见EnvIoUringTestHelper
+};
+
+void PrepareRead(io_uring_sqe* sqe, int fd, const RandomAccessFile::ReadRequest& req, uint64_t user_data) {
+    sqe->opcode = IORING_OP_READ;
+    sqe->fd = fd;
+    sqe->off = req.offset;
+    sqe->addr = reinterpret_cast<uint64_t>(req.scratch);
+    sqe->len = static_cast<uint32_t>(req.len);
+    sqe->user_data = user_data;
+}
+
+// 和pread一样, 读到文件末尾时结果可能短于请求的长度
+void CompleteRead(RandomAccessFile::ReadRequest* req, int32_t res, const std::string& filename) {
+    if (res < 0) {
+        req->result = Slice();
+        req->status = IoUringError(filename, -res);
+    } else {
+        req->result = Slice(req->scratch, res);
+        req->status = Status::success();
+    }
+}
+
+// 每个线程一个私有的ring, 第一次multiRead时创建; 创建失败时ring为nullptr
+IoUring* ThreadLocalRing() {
+    struct Holder {
+        Holder() : ring(new IoUring()) {
+            if (!ring->init(s_ring_entries).ok()) {
+                delete ring;
+                ring = nullptr;
+            }
+        }
+        ~Holder() { delete ring; }
+        IoUring* ring;
+    };
+    static thread_local Holder holder;
+    return holder.ring;
+}
+
+class IoUringEnv;
+
+class IoUringRandomAccessFile final : public RandomAccessFile {
+public:
+    IoUringRandomAccessFile(std::string filename, int fd, IoUringEnv* env)
+        : fd_(fd), filename_(std::move(filename)), env_(env) {}
+    ~IoUringRandomAccessFile() override { ::close(fd_); }
+
+    Status read(uint64_t offset, size_t n, Slice* result, char* scratch) override {
+        Status status;
+        ::ssize_t read_size = ::pread(fd_, scratch, n, static_cast<off_t>(offset));
+        *result = Slice(scratch, (read_size < 0) ? 0 : read_size);
+        if (read_size < 0) {
+            status = IoUringError(filename_, errno);
+        }
+        return status;
+    }
+
+    Status multiRead(ReadRequest* reqs, size_t n) override;
+    void readAsync(ReadRequest* req, ReadCallback callback, void* arg) override;
+
+private:
+    const int fd_;
+    const std::string filename_;
+    IoUringEnv* const env_;
+};
+
+class IoUringEnv final : public EnvWrapper {
+public:
+    explicit IoUringEnv(Env* base_env) : EnvWrapper(base_env), reaper_started_(false), in_flight_(0) {
+        supported_ = ring_.init(s_ring_entries).ok();
+    }
+
+    ~IoUringEnv() override {
+        std::unique_lock<std::mutex> lock(mu_);
+        if (!reaper_started_) {
+            return;
+        }
+        // 等待所有异步读取完成后, 提交一个NOP通知后台线程退出
+        cv_.wait(lock, [this] { return in_flight_ == 0; });
+        io_uring_sqe* sqe = ring_.nextSqe();
+        sqe->opcode = IORING_OP_NOP;
+        sqe->user_data = s_shutdown_user_data;
+        ring_.publish();
+        submitAll();
+        lock.unlock();
+        reaper_.join();
+    }
+
+    Status newRandomAccessFile(const std::string& filename, RandomAccessFile** result) override {
+        if (!supported_) {
+            return target()->newRandomAccessFile(filename, result);
+        }
+        *result = nullptr;
+        int fd = ::open(filename.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            return IoUringError(filename, errno);
+        }
+        *result = new IoUringRandomAccessFile(filename, fd, this);
+        return Status::success();
+    }
+
+    // direct I/O的读取需要对齐的缓冲区, 交给base_env处理; 否则由Env的默认实现打开并按需包装限速
+    Status newRandomAccessFile(const std::string& filename, const EnvOptions& options,
+                               RandomAccessFile** result) override {
+        if (options.use_direct_reads) {
+            return target()->newRandomAccessFile(filename, options, result);
+        }
+        return Env::newRandomAccessFile(filename, options, result);
+    }
+
+    // 提交一个异步读取, 完成时由后台线程调用回调
+    void submitRead(int fd, const std::string* filename, RandomAccessFile::ReadRequest* req,
+                    RandomAccessFile::ReadCallback callback, void* arg) {
+        AsyncRead* async = new AsyncRead{req, callback, arg, filename};
+        std::unique_lock<std::mutex> lock(mu_);
+        if (!reaper_started_) {
+            reaper_started_ = true;
+            reaper_ = std::thread(&IoUringEnv::reapLoop, this);
+        }
+        // 未完成的请求不超过SQ的长度, CQ(SQ的2倍)不会溢出, nextSqe()也总能成功
+        cv_.wait(lock, [this] { return in_flight_ < ring_.sqEntries(); });
+        in_flight_++;
+        PrepareRead(ring_.nextSqe(), fd, *req, reinterpret_cast<uint64_t>(async));
+        ring_.publish();
+        submitAll();
+    }
+
+private:
+    friend class kvstorage::EnvIoUringTestHelper;
+
+    struct AsyncRead {
+        RandomAccessFile::ReadRequest* req;
+        RandomAccessFile::ReadCallback callback;
+        void* arg;
+        const std::string* filename;
+    };
+
+    // 提交SQ中的所有请求, 由mu_保护; 失败(例如EAGAIN)时请求留在SQ中, 等待后重试,
+    // 不能留到之后, 否则后台线程可能一直等待一个没有提交的请求
+    void submitAll() {
+        while (ring_.unsubmitted() > 0) {
+            if (ring_.enter(0) < 0) {
+                ::usleep(s_enter_retry_micros);
+            }
+        }
+    }
+
+    void reapLoop() {
+        while (true) {
+            if (ring_.enter(1) < 0) {
+                // 已提交的请求总会完成, 等待后再检查CQ, 避免在失败的系统调用上空转
+                ::usleep(s_enter_retry_micros);
+            }
+            uint64_t user_data;
+            int32_t res;
+            while (ring_.popCqe(&user_data, &res)) {
+                if (user_data == s_shutdown_user_data) {
+                    return;
+                }
+                {
+                    // 先释放名额再调用回调, 回调中可以再次调用readAsync
+                    std::lock_guard<std::mutex> lock(mu_);
+                    in_flight_--;
+                    cv_.notify_all();
+                }
+                AsyncRead* async = reinterpret_cast<AsyncRead*>(user_data);
+                CompleteRead(async->req, res, *async->filename);
+                (*async->callback)(async->arg, async->req);
+                delete async;
+            }
+        }
+    }
+
+    bool supported_;
+    IoUring ring_;  // readAsync共享的ring, 提交由mu_保护, 完成事件只由reaper_处理
+
+    std::mutex mu_;
+    std::condition_variable cv_;
+    bool reaper_started_;  // 由mu_保护
+    unsigned in_flight_;  // 由mu_保护
+    std::thread reaper_;
+};
+
+Status IoUringRandomAccessFile::multiRead(ReadRequest* reqs, size_t n) {
+    IoUring* ring = ThreadLocalRing();
+    if (ring == nullptr) {
+        return RandomAccessFile::multiRead(reqs, n);
+    }
+    Status s;
+    size_t done = 0;
+    while (done < n) {
+        // 每批最多填满SQ, user_data为请求的下标
+        const size_t batch = std::min<size_t>(n - done, ring->sqEntries());
+        for (size_t i = done; i < done + batch; i++) {
+            PrepareRead(ring->nextSqe(), fd_, reqs[i], i);
+        }
+        ring->publish();
+        ring->enter(static_cast<unsigned>(batch));
+
+        // enter()失败或只提交了一部分时, 撤回没有提交的请求, 不能留给下一次multiRead;
+        // 内核按顺序取走SQ中的请求, 所以没有提交的是这一批的最后几个
+        const size_t submitted = batch - ring->discardUnsubmitted();
+        size_t completed = 0;
+        while (completed < submitted) {
+            uint64_t user_data;
+            int32_t res;
+            if (!ring->popCqe(&user_data, &res)) {
+                // 返回之前必须等到所有已提交的请求完成, 否则内核会在之后写入调用者可能已经释放的scratch
+                if (ring->enter(static_cast<unsigned>(submitted - completed)) < 0) {
+                    ::usleep(s_enter_retry_micros);
+                }
+                continue;
+            }
+            CompleteRead(&reqs[user_data], res, filename_);
+            completed++;
+        }
+        if (submitted < batch) {
+            RandomAccessFile::multiRead(reqs + done + submitted, batch - submitted);
+        }
+        for (size_t i = done; i < done + batch; i++) {
+            if (!reqs[i].status.ok() && s.ok()) {
+                s = reqs[i].status;
+            }
+        }
+        done += batch;
+    }
+    return s;
+}
+
+void IoUringRandomAccessFile::readAsync(ReadRequest* req, ReadCallback callback, void* arg) {
+    env_->submitRead(fd_, &filename_, req, callback, arg);
+}
+
+}  // namespace
+
+bool IoUringSupported() {
+    IoUring ring;
+    return ring.init(1).ok();
+}
+
+Env* NewIoUringEnv(Env* base_env) { return new IoUringEnv(base_env); }
+
+void EnvIoUringTestHelper::failNextMultiReadEnters(int n) {
+    IoUring* ring = ThreadLocalRing();
+    if (ring != nullptr) {
+        ring->failNextEnters(n);
+    }
+}
+
+void EnvIoUringTestHelper::failNextAsyncEnters(Env* env, int n) {
+    static_cast<IoUringEnv*>(env)->ring_.failNextEnters(n);
+}
+
+}  // namespace kvstorage
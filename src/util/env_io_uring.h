@@ -0,0 +1,21 @@
+/*
+ * 基于io_uring的Env, RandomAccessFile的multiRead()在一次系统调用中提交所有读请求,
+ * readAsync()提交后立即返回, 由后台线程收割完成事件并调用回调; 其他操作转发给base_env
+*/
+#ifndef KVSTORAGE_UTIL_ENV_IO_URING_H_
+#define KVSTORAGE_UTIL_ENV_IO_URING_H_
+
+#include "env.h"
+
+namespace kvstorage {
+
+// 当前内核是否支持io_uring以及IORING_OP_READ(Linux 5.6+), 也可能被seccomp等禁止
+bool IoUringSupported();
+
+// 返回一个新的Env, 调用者负责delete, base_env必须比它存活更久;
+// 不支持io_uring时所有操作都转发给base_env, 行为与base_env相同
+Env* NewIoUringEnv(Env* base_env);
+
+}  // namespace kvstorage
+
+#endif  // KVSTORAGE_UTIL_ENV_IO_URING_H_
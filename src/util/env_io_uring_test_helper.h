@@ -0,0 +1,22 @@
+/*
+ * 测试用的辅助类, 向io_uring的Env注入错误
+*/
+#ifndef KVSTORAGE_UTIL_ENV_IO_URING_TEST_HELPER_H_
+#define KVSTORAGE_UTIL_ENV_IO_URING_TEST_HELPER_H_
+
+namespace kvstorage {
+
+class Env;
+
+class EnvIoUringTestHelper {
+public:
+    // 当前线程之后n次multiRead的io_uring_enter在进入内核之前返回EAGAIN, 只影响当前线程的ring
+    static void failNextMultiReadEnters(int n);
+    // env的readAsync共享的ring之后n次io_uring_enter返回EAGAIN, 提交和后台线程都可能遇到;
+    // env必须由NewIoUringEnv()创建
+    static void failNextAsyncEnters(Env* env, int n);
+};
+
+}  // namespace kvstorage
+
+#endif  // KVSTORAGE_UTIL_ENV_IO_URING_TEST_HELPER_H_
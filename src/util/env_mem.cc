@@ -0,0 +1,392 @@
+/*
+ *  内存中的Env实现
+ *  每个文件是一个FileState, 数据存放在固定大小的内存块中, 追加写入时只分配新块, 已写入的数据不会移动,
+ *  所以读取时可以直接返回指向内存块的Slice; 读取范围跨越块边界时才复制到scratch
+ *  打开的文件对象持有FileState的引用, 文件被删除或重写之后已打开的对象仍然可以读取原来的数据
+*/
+#include "env_mem.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace kvstorage {
+
+namespace {
+
+// 文件内存块的大小, 常见的4KB读取大多落在一个块内, 可以不复制直接返回
+constexpr const size_t s_block_size = 64 * 1024;
+
+class FileState {
+public:
+    FileState() : refs_(0), size_(0) {}
+    FileState(const FileState&) = delete;
+    FileState& operator=(const FileState&) = delete;
+
+    void ref() {
+        std::lock_guard<std::mutex> lock(refs_mutex_);
+        ++refs_;
+    }
+
+    // 引用计数为0时删除自己
+    void unref() {
+        bool do_delete = false;
+        {
+            std::lock_guard<std::mutex> lock(refs_mutex_);
+            --refs_;
+            assert(refs_ >= 0);
+            do_delete = refs_ <= 0;
+        }
+        if (do_delete) {
+            delete this;
+        }
+    }
+
+    uint64_t size() const {
+        std::lock_guard<std::mutex> lock(blocks_mutex_);
+        return size_;
+    }
+
+    // 读取[offset, offset + n), 超过文件末尾的部分被截断; 范围在一个块内时result直接指向块
+    Status read(uint64_t offset, size_t n, Slice* result, char* scratch) const {
+        std::lock_guard<std::mutex> lock(blocks_mutex_);
+        if (offset > size_) {
+            *result = Slice();
+            return Status::ioError("Offset greater than file size.");
+        }
+        const uint64_t available = size_ - offset;
+        if (n > available) {
+            n = static_cast<size_t>(available);
+        }
+        if (n == 0) {
+            *result = Slice();
+            return Status::success();
+        }
+
+        size_t block = static_cast<size_t>(offset / s_block_size);
+        size_t block_offset = static_cast<size_t>(offset % s_block_size);
+        if (block_offset + n <= s_block_size) {
+            *result = Slice(blocks_[block] + block_offset, n);
+            return Status::success();
+        }
+
+        size_t bytes_to_copy = n;
+        char* dst = scratch;
+        while (bytes_to_copy > 0) {
+            const size_t avail = std::min(s_block_size - block_offset, bytes_to_copy);
+            std::memcpy(dst, blocks_[block] + block_offset, avail);
+            bytes_to_copy -= avail;
+            dst += avail;
+            block++;
+            block_offset = 0;
+        }
+        *result = Slice(scratch, n);
+        return Status::success();
+    }
+
+    Status append(const Slice& data) {
+        const char* src = data.data();
+        size_t src_len = data.size();
+
+        std::lock_guard<std::mutex> lock(blocks_mutex_);
+        while (src_len > 0) {
+            size_t offset = static_cast<size_t>(size_ % s_block_size);
+            if (offset == 0) {
+                // 最后一个块已满或还没有块, 分配新块
+                blocks_.push_back(new char[s_block_size]);
+            }
+            const size_t avail = std::min(s_block_size - offset, src_len);
+            std::memcpy(blocks_.back() + offset, src, avail);
+            src_len -= avail;
+            src += avail;
+            size_ += avail;
+        }
+        return Status::success();
+    }
+
+private:
+    // 只能通过unref()删除
+    ~FileState() {
+        for (char* block : blocks_) {
+            delete[] block;
+        }
+    }
+
+    std::mutex refs_mutex_;
+    int refs_;  // 由refs_mutex_保护
+
+    mutable std::mutex blocks_mutex_;
+    std::vector<char*> blocks_;  // 由blocks_mutex_保护
+    uint64_t size_;  // 由blocks_mutex_保护
+};
+
+class MemSequentialFile final : public SequentialFile {
+public:
+    explicit MemSequentialFile(FileState* file) : file_(file), pos_(0) { file_->ref(); }
+    ~MemSequentialFile() override { file_->unref(); }
+
+    Status read(size_t n, Slice* result, char* scratch) override {
+        Status s = file_->read(pos_, n, result, scratch);
+        if (s.ok()) {
+            pos_ += result->size();
+        }
+        return s;
+    }
+
+    Status skip(uint64_t n) override {
+        if (pos_ > file_->size()) {
+            return Status::ioError("pos_ > file_->size()");
+        }
+        const uint64_t available = file_->size() - pos_;
+        pos_ += std::min(n, available);
+        return Status::success();
+    }
+
+private:
+    FileState* const file_;
+    uint64_t pos_;
+};
+
+// 返回的Slice在对象销毁之前有效, 与mmap的文件相同
+class MemRandomAccessFile final : public RandomAccessFile {
+public:
+    explicit MemRandomAccessFile(FileState* file) : file_(file) { file_->ref(); }
+    ~MemRandomAccessFile() override { file_->unref(); }
+
+    Status read(uint64_t offset, size_t n, Slice* result, char* scratch) override {
+        return file_->read(offset, n, result, scratch);
+    }
+
+private:
+    FileState* const file_;
+};
+
+class MemWritableFile final : public WritableFile {
+public:
+    explicit MemWritableFile(FileState* file) : file_(file) { file_->ref(); }
+    ~MemWritableFile() override { file_->unref(); }
+
+    Status append(const Slice& data) override { return file_->append(data); }
+    Status close() override { return Status::success(); }
+    Status flush() override { return Status::success(); }
+    Status sync() override { return Status::success(); }
+
+private:
+    FileState* const file_;
+};
+
+class NoOpLogger : public Logger {
+public:
+    void logv(const char* /*format*/, std::va_list /*ap*/) override {}
+};
+
+class MemFileLock : public FileLock {
+public:
+    explicit MemFileLock(std::string filename) : filename_(std::move(filename)) {}
+
+    const std::string& filename() const { return filename_; }
+
+private:
+    const std::string filename_;
+};
+
+class InMemoryEnv : public EnvWrapper {
+public:
+    explicit InMemoryEnv(Env* base_env) : EnvWrapper(base_env) {}
+
+    ~InMemoryEnv() override {
+        for (const auto& kvp : file_map_) {
+            kvp.second->unref();
+        }
+    }
+
+    Status newSequentialFile(const std::string& fname, SequentialFile** result) override {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = file_map_.find(fname);
+        if (it == file_map_.end()) {
+            *result = nullptr;
+            return Status::notFound(fname, "File not found");
+        }
+        *result = new MemSequentialFile(it->second);
+        return Status::success();
+    }
+
+    Status newRandomAccessFile(const std::string& fname, RandomAccessFile** result) override {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = file_map_.find(fname);
+        if (it == file_map_.end()) {
+            *result = nullptr;
+            return Status::notFound(fname, "File not found");
+        }
+        *result = new MemRandomAccessFile(it->second);
+        return Status::success();
+    }
+
+    // 已存在的文件被替换, 已打开的对象仍然持有原来的数据
+    Status newWritableFile(const std::string& fname, WritableFile** result) override {
+        std::lock_guard<std::mutex> lock(mutex_);
+        FileState* file = new FileState();
+        file->ref();
+        auto it = file_map_.find(fname);
+        if (it != file_map_.end()) {
+            it->second->unref();
+            it->second = file;
+        } else {
+            file_map_[fname] = file;
+        }
+        *result = new MemWritableFile(file);
+        return Status::success();
+    }
+
+    Status newAppendableFile(const std::string& fname, WritableFile** result) override {
+        std::lock_guard<std::mutex> lock(mutex_);
+        FileState** sptr = &file_map_[fname];
+        if (*sptr == nullptr) {
+            *sptr = new FileState();
+            (*sptr)->ref();
+        }
+        *result = new MemWritableFile(*sptr);
+        return Status::success();
+    }
+
+    // 内存中没有page cache, 忽略direct I/O; 由Env的默认实现包装限速
+    Status newRandomAccessFile(const std::string& fname, const EnvOptions& options,
+                               RandomAccessFile** result) override {
+        return Env::newRandomAccessFile(fname, options, result);
+    }
+
+    Status newWritableFile(const std::string& fname, const EnvOptions& options, WritableFile** result) override {
+        return Env::newWritableFile(fname, options, result);
+    }
+
+    bool fileExists(const std::string& fname) override {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return file_map_.find(fname) != file_map_.end() || dirs_.find(fname) != dirs_.end();
+    }
+
+    // 返回以dir + "/"开头的文件和目录, 不包括更深层的
+    Status getChildren(const std::string& dir, std::vector<std::string>* result) override {
+        std::lock_guard<std::mutex> lock(mutex_);
+        result->clear();
+        auto add_child = [&dir, result](const std::string& path) {
+            if (path.size() > dir.size() + 1 && path[dir.size()] == '/' && path.compare(0, dir.size(), dir) == 0 &&
+                path.find('/', dir.size() + 1) == std::string::npos) {
+                result->push_back(path.substr(dir.size() + 1));
+            }
+        };
+        for (const auto& kvp : file_map_) {
+            add_child(kvp.first);
+        }
+        for (const std::string& d : dirs_) {
+            add_child(d);
+        }
+        return Status::success();
+    }
+
+    Status removeFile(const std::string& fname) override {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = file_map_.find(fname);
+        if (it == file_map_.end()) {
+            return Status::notFound(fname, "File not found");
+        }
+        it->second->unref();
+        file_map_.erase(it);
+        return Status::success();
+    }
+
+    // 与mkdir -p相同, 目录已存在时也返回成功
+    Status createDir(const std::string& dirname) override {
+        std::lock_guard<std::mutex> lock(mutex_);
+        dirs_.insert(dirname);
+        return Status::success();
+    }
+
+    Status removeDir(const std::string& dirname) override {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (dirs_.erase(dirname) == 0) {
+            return Status::notFound(dirname, "Directory not found");
+        }
+        return Status::success();
+    }
+
+    Status getFileSize(const std::string& fname, uint64_t* file_size) override {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = file_map_.find(fname);
+        if (it == file_map_.end()) {
+            return Status::notFound(fname, "File not found");
+        }
+        *file_size = it->second->size();
+        return Status::success();
+    }
+
+    Status renameFile(const std::string& src, const std::string& target) override {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = file_map_.find(src);
+        if (it == file_map_.end()) {
+            return Status::notFound(src, "File not found");
+        }
+        FileState* file = it->second;
+        file_map_.erase(it);
+        auto target_it = file_map_.find(target);
+        if (target_it != file_map_.end()) {
+            target_it->second->unref();
+            target_it->second = file;
+        } else {
+            file_map_[target] = file;
+        }
+        return Status::success();
+    }
+
+    // 同一个文件同时只能被锁定一次, 文件不存在时创建一个空文件
+    Status lockFile(const std::string& fname, FileLock** lock) override {
+        std::lock_guard<std::mutex> guard(mutex_);
+        if (!locked_files_.insert(fname).second) {
+            *lock = nullptr;
+            return Status::ioError("lock " + fname, "already held by process");
+        }
+        FileState** sptr = &file_map_[fname];
+        if (*sptr == nullptr) {
+            *sptr = new FileState();
+            (*sptr)->ref();
+        }
+        *lock = new MemFileLock(fname);
+        return Status::success();
+    }
+
+    Status unlockFile(FileLock* lock) override {
+        MemFileLock* mem_lock = static_cast<MemFileLock*>(lock);
+        {
+            std::lock_guard<std::mutex> guard(mutex_);
+            locked_files_.erase(mem_lock->filename());
+        }
+        delete mem_lock;
+        return Status::success();
+    }
+
+    Status getTestDirectory(std::string* path) override {
+        *path = "/test";
+        return createDir(*path);
+    }
+
+    Status newLogger(const std::string& /*fname*/, Logger** result) override {
+        *result = new NoOpLogger;
+        return Status::success();
+    }
+
+private:
+    std::mutex mutex_;
+    std::map<std::string, FileState*> file_map_;  // 以下由mutex_保护
+    std::set<std::string> dirs_;
+    std::set<std::string> locked_files_;
+};
+
+}  // namespace
+
+Env* NewMemEnv(Env* base_env) { return new InMemoryEnv(base_env); }
+
+}  // namespace kvstorage
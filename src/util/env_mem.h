@@ -0,0 +1,17 @@
+/*
+ * 完全在内存中的Env, 文件, 目录和文件锁都只存在于这个Env对象中, 用于测试和排除磁盘影响的性能测试
+ * 读取不复制数据, 返回的Slice直接指向文件的内存块; 线程, 时间等其他操作转发给base_env
+*/
+#ifndef KVSTORAGE_UTIL_ENV_MEM_H_
+#define KVSTORAGE_UTIL_ENV_MEM_H_
+
+#include "env.h"
+
+namespace kvstorage {
+
+// 返回一个新的Env, 调用者负责delete, base_env必须比它存活更久
+Env* NewMemEnv(Env* base_env);
+
+}  // namespace kvstorage
+
+#endif  // KVSTORAGE_UTIL_ENV_MEM_H_
@@ -0,0 +1,823 @@
+/*
+ *  POSIX平台的Env实现
+ *  SequentialFile: read + posix_fadvise(SEQUENTIAL), 由内核预读
+ *  RandomAccessFile: mmap的只读文件数量不超过限制时整个文件mmap, 读取时直接返回映射的内存; 超过时使用pread
+ *  WritableFile: 64KB的用户态缓冲区, 缓冲区满或flush时才调用write
+ *  Direct I/O: EnvOptions要求时以O_DIRECT打开, 读取时把请求扩展到对齐的块, 写入时在1MB的对齐缓冲区中积累整块
+ *  限速: EnvOptions::rate_limiter不为空时用RateLimiter包装打开的文件
+ *  文件锁: fcntl(F_SETLK), 同一进程内重复加锁由锁表检查
+ *  后台任务: 每个优先级一个ThreadPool, 默认各1个线程
+*/
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+
+#include "aligned_buffer.h"
+#include "env.h"
+#include "env_posix_test_helper.h"
+#include "no_destructor.h"
+#include "posix_logger.h"
+#include "rate_limiter.h"
+#include "thread_pool.h"
+
+namespace kvstorage {
+
+namespace {
+
+// 64位系统上默认最多mmap 1000个只读文件, 32位系统上地址空间有限, 不使用mmap
+static const int s_default_mmap_limit = (sizeof(void*) >= 8) ? 1000 : 0;
+
+// 可以mmap的只读文件数量, 通过EnvPosixTestHelper修改
+int g_mmap_limit = s_default_mmap_limit;
+
+// WritableFile的缓冲区大小
+constexpr const size_t s_writable_file_buffer_size = 65536;
+
+// 打开文件时使用O_CLOEXEC, 防止文件描述符泄漏到子进程
+constexpr const int s_open_base_flags = O_CLOEXEC;
+
+// O_DIRECT要求缓冲区地址, 文件偏移和长度按设备的逻辑块大小对齐, 4KB满足常见的设备
+constexpr const size_t s_direct_io_alignment = 4096;
+
+// direct I/O的WritableFile的缓冲区大小, 每次写入都直接到达设备, 较大的缓冲区减少写入次数
+constexpr const size_t s_direct_writable_file_buffer_size = 1024 * 1024;
+
+Status PosixError(const std::string& context, int error_number) {
+    if (error_number == ENOENT) {
+        return Status::notFound(context, std::strerror(error_number));
+    }
+    return Status::ioError(context, std::strerror(error_number));
+}
+
+// 限制某种资源的使用数量, 这里用于限制mmap的文件数量
+class Limiter {
+public:
+    explicit Limiter(int max_acquires) : acquires_allowed_(max_acquires) { assert(max_acquires >= 0); }
+    Limiter(const Limiter&) = delete;
+    Limiter& operator=(const Limiter&) = delete;
+
+    // 还有剩余资源时占用一个并返回true, 否则返回false
+    bool acquire() {
+        int old_acquires_allowed = acquires_allowed_.fetch_sub(1, std::memory_order_relaxed);
+        if (old_acquires_allowed > 0) {
+            return true;
+        }
+        acquires_allowed_.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    // 释放acquire()成功占用的资源
+    void release() { acquires_allowed_.fetch_add(1, std::memory_order_relaxed); }
+
+private:
+    std::atomic<int> acquires_allowed_;
+};
+
+class PosixSequentialFile final : public SequentialFile {
+public:
+    PosixSequentialFile(std::string filename, int fd) : fd_(fd), filename_(std::move(filename)) {}
+    ~PosixSequentialFile() override { ::close(fd_); }
+
+    Status read(size_t n, Slice* result, char* scratch) override {
+        Status status;
+        while (true) {
+            ::ssize_t read_size = ::read(fd_, scratch, n);
+            if (read_size < 0) {
+                if (errno == EINTR) {
+                    continue;  // 被信号中断, 重试
+                }
+                status = PosixError(filename_, errno);
+                break;
+            }
+            *result = Slice(scratch, read_size);
+            break;
+        }
+        return status;
+    }
+
+    Status skip(uint64_t n) override {
+        if (::lseek(fd_, n, SEEK_CUR) == static_cast<off_t>(-1)) {
+            return PosixError(filename_, errno);
+        }
+        return Status::success();
+    }
+
+private:
+    const int fd_;
+    const std::string filename_;
+};
+
+// 通过pread读取, 不改变文件偏移, 可以被多个线程同时调用
+class PosixRandomAccessFile final : public RandomAccessFile {
+public:
+    PosixRandomAccessFile(std::string filename, int fd) : fd_(fd), filename_(std::move(filename)) {}
+    ~PosixRandomAccessFile() override { ::close(fd_); }
+
+    Status read(uint64_t offset, size_t n, Slice* result, char* scratch) override {
+        Status status;
+        ::ssize_t read_size = ::pread(fd_, scratch, n, static_cast<off_t>(offset));
+        *result = Slice(scratch, (read_size < 0) ? 0 : read_size);
+        if (read_size < 0) {
+            status = PosixError(filename_, errno);
+        }
+        return status;
+    }
+
+private:
+    const int fd_;
+    const std::string filename_;
+};
+
+// 整个文件映射到内存中, 读取时不需要系统调用和复制, 返回的Slice直接指向映射的内存
+class PosixMmapReadableFile final : public RandomAccessFile {
+public:
+    // mmap_base[0, length - 1]是filename映射的内存, 析构时munmap并释放limiter中的一个名额
+    PosixMmapReadableFile(std::string filename, char* mmap_base, size_t length, Limiter* mmap_limiter)
+        : mmap_base_(mmap_base), length_(length), mmap_limiter_(mmap_limiter), filename_(std::move(filename)) {}
+
+    ~PosixMmapReadableFile() override {
+        ::munmap(static_cast<void*>(mmap_base_), length_);
+        mmap_limiter_->release();
+    }
+
+    Status read(uint64_t offset, size_t n, Slice* result, char* /*scratch*/) override {
+        if (offset + n > length_) {
+            *result = Slice();
+            return PosixError(filename_, EINVAL);
+        }
+        *result = Slice(mmap_base_ + offset, n);
+        return Status::success();
+    }
+
+private:
+    char* const mmap_base_;
+    const size_t length_;
+    Limiter* const mmap_limiter_;
+    const std::string filename_;
+};
+
+// 以O_DIRECT打开, 读取时把[offset, offset + n)扩展到对齐的块, 读入对齐的临时缓冲区后复制到scratch;
+// offset, n和scratch都已对齐时直接读入scratch
+class PosixDirectRandomAccessFile final : public RandomAccessFile {
+public:
+    PosixDirectRandomAccessFile(std::string filename, int fd) : fd_(fd), filename_(std::move(filename)) {}
+    ~PosixDirectRandomAccessFile() override { ::close(fd_); }
+
+    Status read(uint64_t offset, size_t n, Slice* result, char* scratch) override {
+        size_t read_size = 0;
+        Status status;
+        if (IsAligned(offset, s_direct_io_alignment) && IsAligned(n, s_direct_io_alignment) &&
+            IsAligned(reinterpret_cast<uintptr_t>(scratch), s_direct_io_alignment)) {
+            status = readAligned(offset, n, scratch, &read_size);
+            *result = Slice(scratch, read_size);
+            return status;
+        }
+
+        const uint64_t aligned_offset = RoundDown(offset, s_direct_io_alignment);
+        const size_t prefix = offset - aligned_offset;
+        AlignedBuffer buf(s_direct_io_alignment, prefix + n);
+        status = readAligned(aligned_offset, buf.capacity(), buf.data(), &read_size);
+        // 文件尾部不足一块时read_size可能小于prefix + n
+        const size_t available = (read_size > prefix) ? std::min(read_size - prefix, n) : 0;
+        std::memcpy(scratch, buf.data() + prefix, available);
+        *result = Slice(scratch, available);
+        return status;
+    }
+
+private:
+    // offset, n和buf都已对齐, 读到文件末尾时*read_size小于n
+    Status readAligned(uint64_t offset, size_t n, char* buf, size_t* read_size) {
+        *read_size = 0;
+        while (*read_size < n) {
+            ::ssize_t r = ::pread(fd_, buf + *read_size, n - *read_size, static_cast<off_t>(offset + *read_size));
+            if (r < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                return PosixError(filename_, errno);
+            }
+            *read_size += r;
+            if (r == 0 || !IsAligned(r, s_direct_io_alignment)) {
+                break;  // 到达文件末尾
+            }
+        }
+        return Status::success();
+    }
+
+    const int fd_;
+    const std::string filename_;
+};
+
+// 以O_DIRECT打开, 数据在对齐的缓冲区中积累, 只按整块写出; 不足一块的尾部留在缓冲区中,
+// sync()和close()时补零写出整块, 再把文件截断到实际长度, 之后的写入会重新写这个块
+class PosixDirectWritableFile final : public WritableFile {
+public:
+    PosixDirectWritableFile(std::string filename, int fd)
+        : buf_(s_direct_io_alignment, s_direct_writable_file_buffer_size), pos_(0), file_offset_(0), fd_(fd),
+          filename_(std::move(filename)) {}
+
+    ~PosixDirectWritableFile() override {
+        if (fd_ >= 0) {
+            close();  // 忽略错误, 析构时无法返回
+        }
+    }
+
+    Status append(const Slice& data) override {
+        const char* write_data = data.data();
+        size_t write_size = data.size();
+        while (write_size > 0) {
+            const size_t copy_size = std::min(write_size, buf_.capacity() - pos_);
+            std::memcpy(buf_.data() + pos_, write_data, copy_size);
+            write_data += copy_size;
+            write_size -= copy_size;
+            pos_ += copy_size;
+            if (pos_ == buf_.capacity()) {
+                Status status = writeFullBlocks();
+                if (!status.ok()) {
+                    return status;
+                }
+            }
+        }
+        return Status::success();
+    }
+
+    Status close() override {
+        Status status = writeFullBlocks();
+        if (status.ok()) {
+            status = writeTail();
+        }
+        const int close_result = ::close(fd_);
+        if (close_result < 0 && status.ok()) {
+            status = PosixError(filename_, errno);
+        }
+        fd_ = -1;
+        return status;
+    }
+
+    // 只写出完整的块, 尾部留到sync()或close()
+    Status flush() override { return writeFullBlocks(); }
+
+    Status sync() override {
+        Status status = writeFullBlocks();
+        if (status.ok()) {
+            status = writeTail();
+        }
+        if (status.ok() && ::fdatasync(fd_) != 0) {
+            status = PosixError(filename_, errno);
+        }
+        return status;
+    }
+
+private:
+    // 写出缓冲区中所有完整的块, 剩余不足一块的数据移到缓冲区开头
+    Status writeFullBlocks() {
+        const size_t aligned_size = RoundDown(pos_, s_direct_io_alignment);
+        if (aligned_size == 0) {
+            return Status::success();
+        }
+        Status status = writeAt(buf_.data(), aligned_size, file_offset_);
+        if (!status.ok()) {
+            return status;
+        }
+        file_offset_ += aligned_size;
+        pos_ -= aligned_size;
+        std::memmove(buf_.data(), buf_.data() + aligned_size, pos_);
+        return status;
+    }
+
+    // 尾部补零成一整块写出, 再截断到实际长度; 尾部仍然留在缓冲区中
+    Status writeTail() {
+        if (pos_ == 0) {
+            return Status::success();
+        }
+        const size_t padded_size = RoundUp(pos_, s_direct_io_alignment);
+        std::memset(buf_.data() + pos_, 0, padded_size - pos_);
+        Status status = writeAt(buf_.data(), padded_size, file_offset_);
+        if (status.ok() && ::ftruncate(fd_, static_cast<off_t>(file_offset_ + pos_)) != 0) {
+            status = PosixError(filename_, errno);
+        }
+        return status;
+    }
+
+    Status writeAt(const char* data, size_t size, uint64_t offset) {
+        while (size > 0) {
+            ::ssize_t write_result = ::pwrite(fd_, data, size, static_cast<off_t>(offset));
+            if (write_result < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                return PosixError(filename_, errno);
+            }
+            data += write_result;
+            size -= write_result;
+            offset += write_result;
+        }
+        return Status::success();
+    }
+
+    AlignedBuffer buf_;
+    size_t pos_;  // buf_中有效数据的长度
+    uint64_t file_offset_;  // buf_[0]在文件中的偏移, 总是对齐的
+    int fd_;
+    const std::string filename_;
+};
+
+class PosixWritableFile final : public WritableFile {
+public:
+    PosixWritableFile(std::string filename, int fd)
+        : pos_(0), fd_(fd), is_manifest_(isManifest(filename)), filename_(std::move(filename)),
+          dirname_(dirname(filename_)) {}
+
+    ~PosixWritableFile() override {
+        if (fd_ >= 0) {
+            close();  // 忽略错误, 析构时无法返回
+        }
+    }
+
+    Status append(const Slice& data) override {
+        size_t write_size = data.size();
+        const char* write_data = data.data();
+
+        // 尽可能多地复制到缓冲区中
+        size_t copy_size = std::min(write_size, s_writable_file_buffer_size - pos_);
+        std::memcpy(buf_ + pos_, write_data, copy_size);
+        write_data += copy_size;
+        write_size -= copy_size;
+        pos_ += copy_size;
+        if (write_size == 0) {
+            return Status::success();
+        }
+
+        // 缓冲区已满, 写出后剩余部分较小时放入缓冲区, 否则直接写入文件
+        Status status = flushBuffer();
+        if (!status.ok()) {
+            return status;
+        }
+        if (write_size < s_writable_file_buffer_size) {
+            std::memcpy(buf_, write_data, write_size);
+            pos_ = write_size;
+            return Status::success();
+        }
+        return writeUnbuffered(write_data, write_size);
+    }
+
+    Status close() override {
+        Status status = flushBuffer();
+        const int close_result = ::close(fd_);
+        if (close_result < 0 && status.ok()) {
+            status = PosixError(filename_, errno);
+        }
+        fd_ = -1;
+        return status;
+    }
+
+    Status flush() override { return flushBuffer(); }
+
+    Status sync() override {
+        // MANIFEST中引用的新文件必须已经在目录中持久化, 所以先同步目录
+        Status status = syncDirIfManifest();
+        if (!status.ok()) {
+            return status;
+        }
+        status = flushBuffer();
+        if (!status.ok()) {
+            return status;
+        }
+        return syncFd(fd_, filename_);
+    }
+
+private:
+    Status flushBuffer() {
+        Status status = writeUnbuffered(buf_, pos_);
+        pos_ = 0;
+        return status;
+    }
+
+    Status writeUnbuffered(const char* data, size_t size) {
+        while (size > 0) {
+            ssize_t write_result = ::write(fd_, data, size);
+            if (write_result < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                return PosixError(filename_, errno);
+            }
+            data += write_result;
+            size -= write_result;
+        }
+        return Status::success();
+    }
+
+    Status syncDirIfManifest() {
+        Status status;
+        if (!is_manifest_) {
+            return status;
+        }
+        int fd = ::open(dirname_.c_str(), O_RDONLY | s_open_base_flags);
+        if (fd < 0) {
+            status = PosixError(dirname_, errno);
+        } else {
+            status = syncFd(fd, dirname_);
+            ::close(fd);
+        }
+        return status;
+    }
+
+    // 只同步数据和读取数据所需的元数据, 不需要同步修改时间等
+    static Status syncFd(int fd, const std::string& fd_path) {
+        bool sync_success = ::fdatasync(fd) == 0;
+        if (sync_success) {
+            return Status::success();
+        }
+        return PosixError(fd_path, errno);
+    }
+
+    static std::string dirname(const std::string& filename) {
+        std::string::size_type separator_pos = filename.rfind('/');
+        if (separator_pos == std::string::npos) {
+            return std::string(".");
+        }
+        assert(filename.find('/', separator_pos + 1) == std::string::npos);
+        return filename.substr(0, separator_pos);
+    }
+
+    static Slice basename(const std::string& filename) {
+        std::string::size_type separator_pos = filename.rfind('/');
+        if (separator_pos == std::string::npos) {
+            return Slice(filename);
+        }
+        assert(filename.find('/', separator_pos + 1) == std::string::npos);
+        return Slice(filename.data() + separator_pos + 1, filename.length() - separator_pos - 1);
+    }
+
+    static bool isManifest(const std::string& filename) { return basename(filename).startsWith("MANIFEST"); }
+
+    char buf_[s_writable_file_buffer_size];
+    size_t pos_;
+    int fd_;
+
+    const bool is_manifest_;
+    const std::string filename_;
+    const std::string dirname_;
+};
+
+int LockOrUnlock(int fd, bool lock) {
+    errno = 0;
+    struct ::flock file_lock_info;
+    std::memset(&file_lock_info, 0, sizeof(file_lock_info));
+    file_lock_info.l_type = (lock ? F_WRLCK : F_UNLCK);
+    file_lock_info.l_whence = SEEK_SET;
+    file_lock_info.l_start = 0;
+    file_lock_info.l_len = 0;  // 锁定整个文件
+    return ::fcntl(fd, F_SETLK, &file_lock_info);
+}
+
+class PosixFileLock : public FileLock {
+public:
+    PosixFileLock(int fd, std::string filename) : fd_(fd), filename_(std::move(filename)) {}
+
+    int fd() const { return fd_; }
+    const std::string& filename() const { return filename_; }
+
+private:
+    const int fd_;
+    const std::string filename_;
+};
+
+// fcntl的锁属于进程, 同一进程内再次加锁总是成功, 所以另外记录本进程已经锁定的文件
+class PosixLockTable {
+public:
+    bool insert(const std::string& fname) {
+        std::lock_guard<std::mutex> lock(mu_);
+        return locked_files_.insert(fname).second;
+    }
+
+    void remove(const std::string& fname) {
+        std::lock_guard<std::mutex> lock(mu_);
+        locked_files_.erase(fname);
+    }
+
+private:
+    std::mutex mu_;
+    std::set<std::string> locked_files_;
+};
+
+class PosixEnv : public Env {
+public:
+    PosixEnv();
+    ~PosixEnv() override {
+        static const char s_msg[] = "PosixEnv singleton destroyed. Unsupported behavior!\n";
+        std::fwrite(s_msg, 1, sizeof(s_msg), stderr);
+        std::abort();
+    }
+
+    Status newSequentialFile(const std::string& filename, SequentialFile** result) override {
+        int fd = ::open(filename.c_str(), O_RDONLY | s_open_base_flags);
+        if (fd < 0) {
+            *result = nullptr;
+            return PosixError(filename, errno);
+        }
+        // 顺序读取整个文件, 内核可以加大预读窗口
+        ::posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+        *result = new PosixSequentialFile(filename, fd);
+        return Status::success();
+    }
+
+    Status newRandomAccessFile(const std::string& filename, RandomAccessFile** result) override {
+        *result = nullptr;
+        int fd = ::open(filename.c_str(), O_RDONLY | s_open_base_flags);
+        if (fd < 0) {
+            return PosixError(filename, errno);
+        }
+
+        if (!mmap_limiter_.acquire()) {
+            *result = new PosixRandomAccessFile(filename, fd);
+            return Status::success();
+        }
+
+        uint64_t file_size;
+        Status status = getFileSize(filename, &file_size);
+        if (status.ok() && file_size == 0) {
+            // 空文件无法mmap
+            mmap_limiter_.release();
+            *result = new PosixRandomAccessFile(filename, fd);
+            return status;
+        }
+        if (status.ok()) {
+            void* mmap_base = ::mmap(nullptr, file_size, PROT_READ, MAP_SHARED, fd, 0);
+            if (mmap_base != MAP_FAILED) {
+                *result = new PosixMmapReadableFile(filename, reinterpret_cast<char*>(mmap_base), file_size,
+                                                    &mmap_limiter_);
+            } else {
+                status = PosixError(filename, errno);
+            }
+        }
+        ::close(fd);  // 映射之后不再需要文件描述符
+        if (!status.ok()) {
+            mmap_limiter_.release();
+        }
+        return status;
+    }
+
+    Status newWritableFile(const std::string& filename, WritableFile** result) override {
+        int fd = ::open(filename.c_str(), O_TRUNC | O_WRONLY | O_CREAT | s_open_base_flags, 0644);
+        if (fd < 0) {
+            *result = nullptr;
+            return PosixError(filename, errno);
+        }
+        *result = new PosixWritableFile(filename, fd);
+        return Status::success();
+    }
+
+    Status newRandomAccessFile(const std::string& filename, const EnvOptions& options,
+                               RandomAccessFile** result) override {
+        Status status;
+        if (!options.use_direct_reads) {
+            status = newRandomAccessFile(filename, result);
+        } else {
+            int fd;
+            status = openDirect(filename, O_RDONLY, &fd);
+            *result = status.ok() ? new PosixDirectRandomAccessFile(filename, fd) : nullptr;
+        }
+        if (status.ok() && options.rate_limiter != nullptr) {
+            *result = NewRateLimitedRandomAccessFile(*result, options.rate_limiter, options.io_priority);
+        }
+        return status;
+    }
+
+    Status newWritableFile(const std::string& filename, const EnvOptions& options, WritableFile** result) override {
+        Status status;
+        if (!options.use_direct_writes) {
+            status = newWritableFile(filename, result);
+        } else {
+            int fd;
+            status = openDirect(filename, O_TRUNC | O_WRONLY | O_CREAT, &fd);
+            *result = status.ok() ? new PosixDirectWritableFile(filename, fd) : nullptr;
+        }
+        if (status.ok() && options.rate_limiter != nullptr) {
+            *result = NewRateLimitedWritableFile(*result, options.rate_limiter, options.io_priority);
+        }
+        return status;
+    }
+
+    Status newAppendableFile(const std::string& filename, WritableFile** result) override {
+        int fd = ::open(filename.c_str(), O_APPEND | O_WRONLY | O_CREAT | s_open_base_flags, 0644);
+        if (fd < 0) {
+            *result = nullptr;
+            return PosixError(filename, errno);
+        }
+        *result = new PosixWritableFile(filename, fd);
+        return Status::success();
+    }
+
+    bool fileExists(const std::string& filename) override { return ::access(filename.c_str(), F_OK) == 0; }
+
+    Status getChildren(const std::string& directory_path, std::vector<std::string>* result) override {
+        result->clear();
+        ::DIR* dir = ::opendir(directory_path.c_str());
+        if (dir == nullptr) {
+            return PosixError(directory_path, errno);
+        }
+        struct ::dirent* entry;
+        while ((entry = ::readdir(dir)) != nullptr) {
+            result->emplace_back(entry->d_name);
+        }
+        ::closedir(dir);
+        return Status::success();
+    }
+
+    Status removeFile(const std::string& filename) override {
+        if (::unlink(filename.c_str()) != 0) {
+            return PosixError(filename, errno);
+        }
+        return Status::success();
+    }
+
+    Status createDir(const std::string& dirname) override {
+        if (::mkdir(dirname.c_str(), 0755) != 0) {
+            return PosixError(dirname, errno);
+        }
+        return Status::success();
+    }
+
+    Status removeDir(const std::string& dirname) override {
+        if (::rmdir(dirname.c_str()) != 0) {
+            return PosixError(dirname, errno);
+        }
+        return Status::success();
+    }
+
+    Status getFileSize(const std::string& filename, uint64_t* size) override {
+        struct ::stat file_stat;
+        if (::stat(filename.c_str(), &file_stat) != 0) {
+            *size = 0;
+            return PosixError(filename, errno);
+        }
+        *size = file_stat.st_size;
+        return Status::success();
+    }
+
+    Status renameFile(const std::string& from, const std::string& to) override {
+        if (std::rename(from.c_str(), to.c_str()) != 0) {
+            return PosixError(from, errno);
+        }
+        return Status::success();
+    }
+
+    Status lockFile(const std::string& filename, FileLock** lock) override {
+        *lock = nullptr;
+
+        int fd = ::open(filename.c_str(), O_RDWR | O_CREAT | s_open_base_flags, 0644);
+        if (fd < 0) {
+            return PosixError(filename, errno);
+        }
+
+        if (!locks_.insert(filename)) {
+            ::close(fd);
+            return Status::ioError("lock " + filename, "already held by process");
+        }
+
+        if (LockOrUnlock(fd, true) == -1) {
+            int lock_errno = errno;
+            ::close(fd);
+            locks_.remove(filename);
+            return PosixError("lock " + filename, lock_errno);
+        }
+
+        *lock = new PosixFileLock(fd, filename);
+        return Status::success();
+    }
+
+    Status unlockFile(FileLock* lock) override {
+        PosixFileLock* posix_file_lock = static_cast<PosixFileLock*>(lock);
+        if (LockOrUnlock(posix_file_lock->fd(), false) == -1) {
+            return PosixError("unlock " + posix_file_lock->filename(), errno);
+        }
+        locks_.remove(posix_file_lock->filename());
+        ::close(posix_file_lock->fd());
+        delete posix_file_lock;
+        return Status::success();
+    }
+
+    void schedule(void (*function)(void* arg), void* arg, Priority pri = Priority::Low, void* tag = nullptr,
+                  void (*unschedule_function)(void* arg) = nullptr) override {
+        threadPool(pri)->schedule(function, arg, tag, unschedule_function);
+    }
+
+    int unschedule(void* tag, Priority pri) override { return threadPool(pri)->unschedule(tag); }
+    void setBackgroundThreads(int num, Priority pri) override { threadPool(pri)->setBackgroundThreads(num); }
+    int getBackgroundThreads(Priority pri) override { return threadPool(pri)->getBackgroundThreads(); }
+    void getThreadPoolStats(Priority pri, ThreadPoolStats* stats) override { threadPool(pri)->getStats(stats); }
+
+    void startThread(void (*thread_main)(void* thread_main_arg), void* thread_main_arg) override {
+        std::thread new_thread(thread_main, thread_main_arg);
+        new_thread.detach();
+    }
+
+    Status getTestDirectory(std::string* result) override {
+        const char* env = std::getenv("TEST_TMPDIR");
+        if (env && env[0] != '\0') {
+            *result = env;
+        } else {
+            char buf[100];
+            std::snprintf(buf, sizeof(buf), "/tmp/kvstoragetest-%d", static_cast<int>(::geteuid()));
+            *result = buf;
+        }
+        createDir(*result);  // 目录可能已经存在, 忽略错误
+        return Status::success();
+    }
+
+    Status newLogger(const std::string& filename, Logger** result) override {
+        int fd = ::open(filename.c_str(), O_APPEND | O_WRONLY | O_CREAT | s_open_base_flags, 0644);
+        if (fd < 0) {
+            *result = nullptr;
+            return PosixError(filename, errno);
+        }
+        std::FILE* fp = ::fdopen(fd, "w");
+        if (fp == nullptr) {
+            ::close(fd);
+            *result = nullptr;
+            return PosixError(filename, errno);
+        }
+        *result = new PosixLogger(fp);
+        return Status::success();
+    }
+
+    uint64_t nowTimeMicros() override {
+        static constexpr uint64_t s_usecs_per_second = 1000000;
+        struct ::timeval tv;
+        ::gettimeofday(&tv, nullptr);
+        return static_cast<uint64_t>(tv.tv_sec) * s_usecs_per_second + tv.tv_usec;
+    }
+
+    void sleepForMicroseconds(int micros) override {
+        std::this_thread::sleep_for(std::chrono::microseconds(micros));
+    }
+
+private:
+    // 以O_DIRECT打开文件; 文件系统不支持O_DIRECT(例如tmpfs)时返回NotSupported, 调用者可以改用普通的文件
+    static Status openDirect(const std::string& filename, int flags, int* fd) {
+#ifdef O_DIRECT
+        *fd = ::open(filename.c_str(), flags | O_DIRECT | s_open_base_flags, 0644);
+        if (*fd >= 0) {
+            return Status::success();
+        }
+        if (errno == EINVAL) {
+            return Status::notSupported("direct I/O", filename);
+        }
+        return PosixError(filename, errno);
+#else
+        *fd = -1;
+        return Status::notSupported("direct I/O", filename);
+#endif
+    }
+
+    ThreadPool* threadPool(Priority pri) {
+        assert(pri >= Priority::Low && pri < Priority::Total);
+        return &thread_pools_[static_cast<int>(pri)];
+    }
+
+    ThreadPool thread_pools_[static_cast<int>(Priority::Total)];
+    PosixLockTable locks_;
+    Limiter mmap_limiter_;
+};
+
+PosixEnv::PosixEnv() : mmap_limiter_(g_mmap_limit) {}
+
+#ifndef NDEBUG
+std::atomic<bool> g_env_initialized(false);
+#endif
+
+}  // namespace
+
+void EnvPosixTestHelper::setReadOnlyMMapLimit(int limit) {
+    assert(!g_env_initialized.load(std::memory_order_relaxed));
+    g_mmap_limit = limit;
+}
+
+Env* Env::defaultEnv() {
+    // 进程退出时不析构, 后台线程可能仍在使用
+    static NoDestructor<PosixEnv> env_container;
+#ifndef NDEBUG
+    g_env_initialized.store(true, std::memory_order_relaxed);
+#endif
+    return env_container.get();
+}
+
+}  // namespace kvstorage
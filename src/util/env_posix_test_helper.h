@@ -0,0 +1,17 @@
+/*
+ * 测试用的辅助类, 修改PosixEnv的内部限制, 必须在第一次调用Env::defaultEnv()之前调用
+*/
+#ifndef KVSTORAGE_UTIL_ENV_POSIX_TEST_HELPER_H_
+#define KVSTORAGE_UTIL_ENV_POSIX_TEST_HELPER_H_
+
+namespace kvstorage {
+
+class EnvPosixTestHelper {
+public:
+    // 设置可以同时mmap的只读文件数量, 超过后RandomAccessFile改用pread
+    static void setReadOnlyMMapLimit(int limit);
+};
+
+}  // namespace kvstorage
+
+#endif  // KVSTORAGE_UTIL_ENV_POSIX_TEST_HELPER_H_
@@ -4,6 +4,12 @@
 #include "hash.h"
 #include "coding.h"
 
+#include <cstring>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
 // fall-through：在 switch 语句中, 执行完一个 case 后, 继续执行下一个 case
 // 使用自定义的 FALLTHROUGH_INTENDED 宏, 或者 [[fallthrough]] 属性，提高代码可读性
 
@@ -40,4 +46,274 @@ uint32_t Hash(const char* data, size_t n, uint32_t seed) {
     return h;
 }
 
+// 以下为Hash64()和Hash128()的实现
+
+static const uint64_t s_prime32_1 = 0x9e3779b1u;
+static const uint64_t s_prime32_2 = 0x85ebca77u;
+static const uint64_t s_prime32_3 = 0xc2b2ae3du;
+static const uint64_t s_prime64_1 = 0x9e3779b185ebca87ull;
+static const uint64_t s_prime64_2 = 0xc2b2ae3d27d4eb4full;
+static const uint64_t s_prime64_3 = 0x165667b19e3779f9ull;
+static const uint64_t s_prime64_4 = 0x85ebca77c2b2ae63ull;
+static const uint64_t s_prime64_5 = 0x27d4eb2f165667c5ull;
+
+// 长键每条带64字节, 8个64位通道
+static const int s_stripe_lanes = 8;
+static const size_t s_stripe_len = 64;
+// 每条带使用的密钥向后移动一个字, 每块的最后用密钥的最后8个字打乱累加器
+static const int s_secret_words = 32;
+static const int s_stripes_per_block = 16;
+static const size_t s_block_len = s_stripe_len * s_stripes_per_block;
+static const int s_scramble_offset = s_secret_words - s_stripe_lanes;
+
+// 默认密钥, 由splitmix64在编译期生成
+struct HashSecret {
+    uint64_t words[s_secret_words] = {};
+
+    constexpr HashSecret() {
+        uint64_t x = 0x6a09e667f3bcc908ull;
+        for (int i = 0; i < s_secret_words; i++) {
+            x += 0x9e3779b97f4a7c15ull;
+            uint64_t z = x;
+            z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+            z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+            words[i] = z ^ (z >> 31);
+        }
+    }
+};
+
+static constexpr HashSecret s_secret{};
+
+static inline uint64_t Mul128Fold64(uint64_t a, uint64_t b) {
+#if defined(__SIZEOF_INT128__)
+    const __uint128_t product = static_cast<__uint128_t>(a) * b;
+    return static_cast<uint64_t>(product) ^ static_cast<uint64_t>(product >> 64);
+#else
+    const uint64_t lo_lo = (a & 0xffffffff) * (b & 0xffffffff);
+    const uint64_t hi_lo = (a >> 32) * (b & 0xffffffff);
+    const uint64_t lo_hi = (a & 0xffffffff) * (b >> 32);
+    const uint64_t hi_hi = (a >> 32) * (b >> 32);
+    const uint64_t cross = (lo_lo >> 32) + (hi_lo & 0xffffffff) + lo_hi;
+    const uint64_t upper = (hi_lo >> 32) + (cross >> 32) + hi_hi;
+    const uint64_t lower = (cross << 32) | (lo_lo & 0xffffffff);
+    return lower ^ upper;
+#endif
+}
+
+static inline uint64_t Avalanche(uint64_t h) {
+    h ^= h >> 37;
+    h *= 0x165667919e3779f9ull;
+    h ^= h >> 32;
+    return h;
+}
+
+// 短键的输入位数少, 使用更强的混合函数
+static inline uint64_t Fmix64(uint64_t h) {
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdull;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ull;
+    h ^= h >> 33;
+    return h;
+}
+
+static inline uint64_t Mix16(const char* p, const uint64_t* key, uint64_t seed) {
+    return Mul128Fold64(DecodeFixed64(p) ^ (key[0] + seed), DecodeFixed64(p + 8) ^ (key[1] - seed));
+}
+
+// 0~16字节, 读取首尾的字节, 长度不同时读取的位置有重叠
+static uint64_t HashShort(const char* p, size_t n, const uint64_t* secret, uint64_t seed) {
+    if (n > 8) {
+        const uint64_t lo = DecodeFixed64(p) ^ ((secret[0] ^ secret[1]) + seed);
+        const uint64_t hi = DecodeFixed64(p + n - 8) ^ ((secret[2] ^ secret[3]) - seed);
+        const uint64_t acc = n + __builtin_bswap64(lo) + hi + Mul128Fold64(lo, hi);
+        return Avalanche(acc);
+    }
+    if (n >= 4) {
+        const uint64_t lo = DecodeFixed32(p);
+        const uint64_t hi = DecodeFixed32(p + n - 4);
+        const uint64_t keyed = (lo | (hi << 32)) ^ ((secret[4] ^ secret[5]) - seed);
+        return Fmix64(keyed + n * s_prime64_1);
+    }
+    if (n > 0) {
+        // 1~3字节: 首, 中, 尾字节和长度拼成32位
+        const uint32_t c1 = static_cast<uint8_t>(p[0]);
+        const uint32_t c2 = static_cast<uint8_t>(p[n >> 1]);
+        const uint32_t c3 = static_cast<uint8_t>(p[n - 1]);
+        const uint64_t combined = (c1 << 16) | (c2 << 24) | c3 | (static_cast<uint32_t>(n) << 8);
+        return Fmix64(combined ^ ((secret[6] ^ secret[7]) + seed));
+    }
+    return Fmix64(seed ^ secret[8] ^ secret[9]);
+}
+
+// 17~128字节, 从首尾两端各取16字节的块
+static uint64_t HashMedium(const char* p, size_t n, const uint64_t* secret, uint64_t seed) {
+    uint64_t acc = n * s_prime64_1;
+    if (n > 32) {
+        if (n > 64) {
+            if (n > 96) {
+                acc += Mix16(p + 48, secret + 12, seed);
+                acc += Mix16(p + n - 64, secret + 14, seed);
+            }
+            acc += Mix16(p + 32, secret + 8, seed);
+            acc += Mix16(p + n - 48, secret + 10, seed);
+        }
+        acc += Mix16(p + 16, secret + 4, seed);
+        acc += Mix16(p + n - 32, secret + 6, seed);
+    }
+    acc += Mix16(p, secret, seed);
+    acc += Mix16(p + n - 16, secret + 2, seed);
+    return Avalanche(acc);
+}
+
+// 129~240字节, 前8个16字节块之后先混合一次
+static uint64_t HashLarge(const char* p, size_t n, const uint64_t* secret, uint64_t seed) {
+    const int rounds = static_cast<int>(n / 16);
+    uint64_t acc = n * s_prime64_1;
+    for (int i = 0; i < 8; i++) {
+        acc += Mix16(p + 16 * i, secret + 2 * i, seed);
+    }
+    acc = Avalanche(acc);
+    for (int i = 8; i < rounds; i++) {
+        acc += Mix16(p + 16 * i, secret + 2 * (i - 8) + 1, seed);
+    }
+    acc += Mix16(p + n - 16, secret + 17, seed);
+    return Avalanche(acc);
+}
+
+static const size_t s_short_max = 16;
+static const size_t s_medium_max = 128;
+static const size_t s_large_max = 240;
+
+#if defined(__SSE2__)
+
+// 每个128位寄存器处理2个通道
+static inline void Accumulate512(uint64_t* acc, const char* p, const uint64_t* key) {
+    __m128i* const xacc = reinterpret_cast<__m128i*>(acc);
+    for (int i = 0; i < s_stripe_lanes / 2; i++) {
+        const __m128i data = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p) + i);
+        const __m128i k = _mm_loadu_si128(reinterpret_cast<const __m128i*>(key) + i);
+        const __m128i data_key = _mm_xor_si128(data, k);
+        const __m128i data_key_hi = _mm_shuffle_epi32(data_key, _MM_SHUFFLE(0, 3, 0, 1));
+        const __m128i product = _mm_mul_epu32(data_key, data_key_hi);  // 每个通道的低32位乘高32位
+        const __m128i data_swap = _mm_shuffle_epi32(data, _MM_SHUFFLE(1, 0, 3, 2));  // 交换相邻通道
+        const __m128i sum = _mm_add_epi64(_mm_load_si128(xacc + i), data_swap);
+        _mm_store_si128(xacc + i, _mm_add_epi64(product, sum));
+    }
+}
+
+static inline void Scramble(uint64_t* acc, const uint64_t* key) {
+    __m128i* const xacc = reinterpret_cast<__m128i*>(acc);
+    const __m128i prime = _mm_set1_epi32(static_cast<int>(s_prime32_1));
+    for (int i = 0; i < s_stripe_lanes / 2; i++) {
+        __m128i a = _mm_load_si128(xacc + i);
+        a = _mm_xor_si128(a, _mm_srli_epi64(a, 47));
+        a = _mm_xor_si128(a, _mm_loadu_si128(reinterpret_cast<const __m128i*>(key) + i));
+        // 64位乘32位常量, 分别计算低32位和高32位的乘积
+        const __m128i lo = _mm_mul_epu32(a, prime);
+        const __m128i hi = _mm_mul_epu32(_mm_srli_epi64(a, 32), prime);
+        _mm_store_si128(xacc + i, _mm_add_epi64(lo, _mm_slli_epi64(hi, 32)));
+    }
+}
+
+#else
+
+static inline void Accumulate512(uint64_t* acc, const char* p, const uint64_t* key) {
+    for (int i = 0; i < s_stripe_lanes; i++) {
+        const uint64_t data = DecodeFixed64(p + 8 * i);
+        const uint64_t data_key = data ^ key[i];
+        acc[i ^ 1] += data;
+        acc[i] += (data_key & 0xffffffff) * (data_key >> 32);
+    }
+}
+
+static inline void Scramble(uint64_t* acc, const uint64_t* key) {
+    for (int i = 0; i < s_stripe_lanes; i++) {
+        uint64_t a = acc[i];
+        a ^= a >> 47;
+        a ^= key[i];
+        acc[i] = a * s_prime32_1;
+    }
+}
+
+#endif
+
+// 大于240字节, 按64字节的条带累加到8个通道, 每1KB打乱一次
+static void HashLong(const char* p, size_t n, const uint64_t* secret, uint64_t* acc) {
+    const size_t blocks = (n - 1) / s_block_len;
+    for (size_t b = 0; b < blocks; b++) {
+        for (int s = 0; s < s_stripes_per_block; s++) {
+            Accumulate512(acc, p + b * s_block_len + s * s_stripe_len, secret + s);
+        }
+        Scramble(acc, secret + s_scramble_offset);
+    }
+
+    // 最后一块中完整的条带, 以及与之前的数据重叠的最后64字节
+    const char* const tail = p + blocks * s_block_len;
+    const size_t stripes = ((n - 1) - blocks * s_block_len) / s_stripe_len;
+    for (size_t s = 0; s < stripes; s++) {
+        Accumulate512(acc, tail + s * s_stripe_len, secret + s);
+    }
+    Accumulate512(acc, p + n - s_stripe_len, secret + 9);
+}
+
+static uint64_t MergeAccumulators(const uint64_t* acc, const uint64_t* key, uint64_t start) {
+    uint64_t result = start;
+    for (int i = 0; i < 4; i++) {
+        result += Mul128Fold64(acc[2 * i] ^ key[2 * i], acc[2 * i + 1] ^ key[2 * i + 1]);
+    }
+    return Avalanche(result);
+}
+
+// 长键的种子不为0时, 把种子加到密钥上, 不影响每条带的计算量
+static void InitLong(uint64_t seed, const uint64_t** secret, uint64_t* custom, uint64_t* acc) {
+    if (seed == 0) {
+        *secret = s_secret.words;
+    } else {
+        for (int i = 0; i < s_secret_words; i += 2) {
+            custom[i] = s_secret.words[i] + seed;
+            custom[i + 1] = s_secret.words[i + 1] - seed;
+        }
+        *secret = custom;
+    }
+    const uint64_t init[s_stripe_lanes] = {s_prime32_3, s_prime64_1, s_prime64_2, s_prime64_3,
+                                           s_prime64_4, s_prime32_2, s_prime64_5, s_prime32_1};
+    std::memcpy(acc, init, sizeof(init));
+}
+
+uint64_t Hash64(const char* data, size_t n, uint64_t seed) {
+    if (n <= s_short_max) {
+        return HashShort(data, n, s_secret.words, seed);
+    } else if (n <= s_medium_max) {
+        return HashMedium(data, n, s_secret.words, seed);
+    } else if (n <= s_large_max) {
+        return HashLarge(data, n, s_secret.words, seed);
+    }
+    alignas(16) uint64_t acc[s_stripe_lanes];
+    uint64_t custom[s_secret_words];
+    const uint64_t* secret;
+    InitLong(seed, &secret, custom, acc);
+    HashLong(data, n, secret, acc);
+    return MergeAccumulators(acc, secret + 1, n * s_prime64_1);
+}
+
+// 高64位使用密钥中不同位置的字, 短键需要计算两次
+Hash128Value Hash128(const char* data, size_t n, uint64_t seed) {
+    const uint64_t* const high_secret = s_secret.words + 12;
+    if (n <= s_short_max) {
+        return {HashShort(data, n, s_secret.words, seed), HashShort(data, n, high_secret, seed)};
+    } else if (n <= s_medium_max) {
+        return {HashMedium(data, n, s_secret.words, seed), HashMedium(data, n, high_secret, seed)};
+    } else if (n <= s_large_max) {
+        return {HashLarge(data, n, s_secret.words, seed), HashLarge(data, n, high_secret, seed)};
+    }
+    alignas(16) uint64_t acc[s_stripe_lanes];
+    uint64_t custom[s_secret_words];
+    const uint64_t* secret;
+    InitLong(seed, &secret, custom, acc);
+    HashLong(data, n, secret, acc);
+    return {MergeAccumulators(acc, secret + 1, n * s_prime64_1),
+            MergeAccumulators(acc, secret + 14, ~(n * s_prime64_2))};
+}
+
 }  // namespace kvstorage
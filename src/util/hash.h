@@ -8,6 +8,17 @@ namespace kvstorage {
 
 uint32_t Hash(const char* data, size_t n, uint32_t seed);
 
+struct Hash128Value {
+    uint64_t low;
+    uint64_t high;
+};
+
+// 64位和128位哈希, 结构与XXH3相同: 短键直接读取首尾的字节, 长键每次处理64字节的8个64位通道, 支持SSE2时向量化
+// 比Hash()有更多的熵, 用于布隆过滤器, 缓存分片和一致性哈希; 结果可能被持久化, 不能修改算法
+// 结果与XXH3不兼容
+uint64_t Hash64(const char* data, size_t n, uint64_t seed = 0);
+Hash128Value Hash128(const char* data, size_t n, uint64_t seed = 0);
+
 }  // namespace kvstorage
 
 #endif  // KVSTORAGE_UTIL_HASH_H_
\ No newline at end of file
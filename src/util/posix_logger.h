@@ -0,0 +1,94 @@
+/*
+ * 基于FILE*的Logger, 每条记录带有时间和线程id, 先在栈上格式化, 过长时再分配堆内存
+*/
+#ifndef KVSTORAGE_UTIL_POSIX_LOGGER_H_
+#define KVSTORAGE_UTIL_POSIX_LOGGER_H_
+
+#include <sys/time.h>
+
+#include <cassert>
+#include <cstdarg>
+#include <cstdio>
+#include <ctime>
+#include <sstream>
+#include <thread>
+
+#include "env.h"
+
+namespace kvstorage {
+
+class PosixLogger final : public Logger {
+public:
+    // 接管fp, 析构时关闭
+    explicit PosixLogger(std::FILE* fp) : fp_(fp) { assert(fp != nullptr); }
+    ~PosixLogger() override { std::fclose(fp_); }
+
+    void logv(const char* format, std::va_list arguments) override {
+        struct ::timeval now_timeval;
+        ::gettimeofday(&now_timeval, nullptr);
+        const std::time_t now_seconds = now_timeval.tv_sec;
+        struct std::tm now_components;
+        ::localtime_r(&now_seconds, &now_components);
+
+        // 线程id只保留前32个字符
+        constexpr const int s_max_thread_id_size = 32;
+        std::ostringstream thread_stream;
+        thread_stream << std::this_thread::get_id();
+        std::string thread_id = thread_stream.str();
+        if (thread_id.size() > s_max_thread_id_size) {
+            thread_id.resize(s_max_thread_id_size);
+        }
+
+        // 第一次使用栈上的缓冲区, 不够时按需要的长度在堆上分配后重新格式化
+        constexpr const int s_stack_buffer_size = 512;
+        char stack_buffer[s_stack_buffer_size];
+        int dynamic_buffer_size = 0;
+        for (int iteration = 0; iteration < 2; ++iteration) {
+            const int buffer_size = (iteration == 0) ? s_stack_buffer_size : dynamic_buffer_size;
+            char* const buffer = (iteration == 0) ? stack_buffer : new char[dynamic_buffer_size];
+
+            int buffer_offset = std::snprintf(
+                buffer, buffer_size, "%04d/%02d/%02d-%02d:%02d:%02d.%06d %s ", now_components.tm_year + 1900,
+                now_components.tm_mon + 1, now_components.tm_mday, now_components.tm_hour, now_components.tm_min,
+                now_components.tm_sec, static_cast<int>(now_timeval.tv_usec), thread_id.c_str());
+            assert(buffer_offset <= s_stack_buffer_size - 1);
+
+            std::va_list arguments_copy;
+            va_copy(arguments_copy, arguments);
+            buffer_offset += std::vsnprintf(buffer + buffer_offset, buffer_size - buffer_offset, format,
+                                            arguments_copy);
+            va_end(arguments_copy);
+
+            // 需要额外的一个字节保存换行符
+            if (buffer_offset >= buffer_size - 1) {
+                if (iteration == 0) {
+                    dynamic_buffer_size = buffer_offset + 2;
+                    continue;
+                }
+                assert(false);  // 第二次使用的缓冲区长度一定足够
+                buffer_offset = buffer_size - 1;
+            }
+
+            if (buffer[buffer_offset - 1] != '\n') {
+                buffer[buffer_offset] = '\n';
+                ++buffer_offset;
+            }
+
+            assert(buffer_offset <= buffer_size);
+            std::fwrite(buffer, 1, buffer_offset, fp_);
+            std::fflush(fp_);
+
+            if (iteration != 0) {
+                delete[] buffer;
+            }
+            break;
+        }
+    }
+
+private:
+    std::FILE* const fp_;
+};
+
+}  // namespace kvstorage
+
+#endif  // KVSTORAGE_UTIL_POSIX_LOGGER_H_
@@ -0,0 +1,329 @@
+#include "rate_limiter.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+
+#include "random.h"
+#include "slice.h"
+
+namespace kvstorage {
+
+namespace {
+
+// 自动调整时每隔多少个补充周期检查一次前台延迟
+constexpr const int s_auto_tune_refill_periods = 10;
+
+// 自动调整时速率的下限和每次提高的幅度都是上限的1/s_auto_tune_step_divisor
+constexpr const int64_t s_auto_tune_step_divisor = 20;
+
+constexpr const int s_num_priorities = static_cast<int>(Env::IOPriority::Total);
+
+class GenericRateLimiter final : public RateLimiter {
+public:
+    GenericRateLimiter(int64_t rate_bytes_per_sec, int64_t refill_period_us, int32_t fairness,
+                       uint64_t auto_tune_latency_us)
+        : refill_period_us_(refill_period_us), fairness_(std::max(fairness, 1)),
+          auto_tune_latency_us_(auto_tune_latency_us), stop_(false), waiters_(0),
+          max_bytes_per_second_(rate_bytes_per_sec), available_bytes_(0), next_refill_us_(NowMicros()), rnd_(301),
+          refills_since_tune_(0), drains_since_tune_(0), latency_sum_(0), latency_count_(0) {
+        assert(rate_bytes_per_sec > 0 && refill_period_us > 0);
+        for (int i = 0; i < s_num_priorities; i++) {
+            total_bytes_through_[i] = 0;
+            total_requests_[i] = 0;
+        }
+        setRateLocked(rate_bytes_per_sec);
+    }
+
+    // 唤醒所有等待的请求, 等它们返回后才能析构
+    ~GenericRateLimiter() override {
+        std::unique_lock<std::mutex> lock(mu_);
+        stop_ = true;
+        cv_.notify_all();
+        cv_.wait(lock, [this] { return waiters_ == 0; });
+    }
+
+    void setBytesPerSecond(int64_t bytes_per_second) override {
+        assert(bytes_per_second > 0);
+        std::lock_guard<std::mutex> lock(mu_);
+        max_bytes_per_second_ = bytes_per_second;
+        if (auto_tune_latency_us_ == 0) {
+            setRateLocked(bytes_per_second);
+        } else {
+            setRateLocked(std::min(rate_bytes_per_sec_.load(std::memory_order_relaxed), bytes_per_second));
+        }
+    }
+
+    int64_t getBytesPerSecond() const override { return rate_bytes_per_sec_.load(std::memory_order_relaxed); }
+
+    int64_t getSingleBurstBytes() const override { return refill_bytes_per_period_.load(std::memory_order_relaxed); }
+
+    void request(int64_t bytes, Env::IOPriority pri) override;
+
+    int64_t getTotalBytesThrough(Env::IOPriority pri) const override {
+        std::lock_guard<std::mutex> lock(mu_);
+        return totalOf(total_bytes_through_, pri);
+    }
+
+    int64_t getTotalRequests(Env::IOPriority pri) const override {
+        std::lock_guard<std::mutex> lock(mu_);
+        return totalOf(total_requests_, pri);
+    }
+
+    void recordForegroundLatency(uint64_t micros) override {
+        if (auto_tune_latency_us_ != 0) {
+            latency_sum_.fetch_add(micros, std::memory_order_relaxed);
+            latency_count_.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+private:
+    // 一个等待令牌的请求, 在请求线程的栈上
+    struct Req {
+        Req(int64_t bytes, Env::IOPriority pri) : request_bytes(bytes), bytes(bytes), pri(pri), granted(false) {}
+
+        int64_t request_bytes;  // 还需要的字节数, 补充时可能只满足一部分, 超过单次上限的请求跨越多个周期
+        const int64_t bytes;
+        const Env::IOPriority pri;
+        bool granted;
+    };
+
+    static uint64_t NowMicros() {
+        return std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    static int64_t totalOf(const int64_t* values, Env::IOPriority pri) {
+        if (pri != Env::IOPriority::Total) {
+            return values[static_cast<int>(pri)];
+        }
+        int64_t total = 0;
+        for (int i = 0; i < s_num_priorities; i++) {
+            total += values[i];
+        }
+        return total;
+    }
+
+    // 需要持有mu_
+    void setRateLocked(int64_t bytes_per_second) {
+        rate_bytes_per_sec_.store(bytes_per_second, std::memory_order_relaxed);
+        refill_bytes_per_period_.store(std::max<int64_t>(bytes_per_second * refill_period_us_ / 1000000, 1),
+                                       std::memory_order_relaxed);
+    }
+
+    void refillBytesAndGrantRequests(uint64_t now);
+    void autoTune();
+
+    const int64_t refill_period_us_;
+    const int32_t fairness_;
+    const uint64_t auto_tune_latency_us_;  // 为0时不自动调整
+
+    mutable std::mutex mu_;
+    std::condition_variable cv_;
+    bool stop_;  // 以下由mu_保护
+    int waiters_;  // 正在等待令牌的请求数量
+    int64_t max_bytes_per_second_;  // setBytesPerSecond()设置的速率, 自动调整时是上限
+    int64_t available_bytes_;
+    uint64_t next_refill_us_;
+    Random rnd_;
+    std::deque<Req*> queue_[s_num_priorities];
+    int64_t total_bytes_through_[s_num_priorities];
+    int64_t total_requests_[s_num_priorities];
+    int refills_since_tune_;
+    int drains_since_tune_;  // 补充的令牌被全部用完的次数, 说明后台I/O被限速
+
+    // 修改时持有mu_, 读取时不需要
+    std::atomic<int64_t> rate_bytes_per_sec_;
+    std::atomic<int64_t> refill_bytes_per_period_;
+
+    // recordForegroundLatency()在前台线程中调用, 不加锁
+    std::atomic<uint64_t> latency_sum_;
+    std::atomic<uint64_t> latency_count_;
+};
+
+void GenericRateLimiter::request(int64_t bytes, Env::IOPriority pri) {
+    if (pri == Env::IOPriority::Total) {
+        return;
+    }
+    const int p = static_cast<int>(pri);
+
+    std::unique_lock<std::mutex> lock(mu_);
+    if (stop_) {
+        return;
+    }
+    total_requests_[p]++;
+    if (available_bytes_ >= bytes) {
+        available_bytes_ -= bytes;
+        total_bytes_through_[p] += bytes;
+        return;
+    }
+
+    // 令牌不足, 排队等待补充; 到达补充时间时由正在等待的线程负责补充
+    Req r(bytes, pri);
+    queue_[p].push_back(&r);
+    waiters_++;
+    while (!r.granted && !stop_) {
+        const uint64_t now = NowMicros();
+        if (now >= next_refill_us_) {
+            refillBytesAndGrantRequests(now);
+        } else {
+            cv_.wait_for(lock, std::chrono::microseconds(next_refill_us_ - now));
+        }
+    }
+    if (!r.granted) {
+        // 析构时还没有得到令牌, 直接返回
+        queue_[p].erase(std::find(queue_[p].begin(), queue_[p].end(), &r));
+    }
+    waiters_--;
+    if (stop_ && waiters_ == 0) {
+        cv_.notify_all();
+    }
+}
+
+void GenericRateLimiter::refillBytesAndGrantRequests(uint64_t now) {
+    next_refill_us_ = now + refill_period_us_;
+    // 空闲时令牌最多积累一个周期, 限制突发
+    const int64_t refill_bytes = getSingleBurstBytes();
+    available_bytes_ = std::min(available_bytes_ + refill_bytes, refill_bytes);
+
+    // 通常先满足High, 以1/fairness_的概率先满足Low
+    const bool low_first = rnd_.oneIn(fairness_);
+    const Env::IOPriority order[s_num_priorities] = {
+        low_first ? Env::IOPriority::Low : Env::IOPriority::High,
+        low_first ? Env::IOPriority::High : Env::IOPriority::Low,
+    };
+    for (Env::IOPriority pri : order) {
+        std::deque<Req*>* queue = &queue_[static_cast<int>(pri)];
+        while (!queue->empty() && available_bytes_ > 0) {
+            Req* next = queue->front();
+            if (available_bytes_ < next->request_bytes) {
+                // 只满足一部分, 剩余的等下次补充
+                next->request_bytes -= available_bytes_;
+                available_bytes_ = 0;
+                break;
+            }
+            available_bytes_ -= next->request_bytes;
+            next->request_bytes = 0;
+            next->granted = true;
+            total_bytes_through_[static_cast<int>(pri)] += next->bytes;
+            queue->pop_front();
+        }
+    }
+
+    // 令牌全部用完说明后台I/O的需求不低于当前速率
+    if (available_bytes_ == 0) {
+        drains_since_tune_++;
+    }
+    if (auto_tune_latency_us_ != 0 && ++refills_since_tune_ >= s_auto_tune_refill_periods) {
+        autoTune();
+    }
+    cv_.notify_all();
+}
+
+// 前台平均延迟超过目标时速率减半; 否则如果后台I/O被限速, 速率提高上限的1/20
+void GenericRateLimiter::autoTune() {
+    const uint64_t count = latency_count_.exchange(0, std::memory_order_relaxed);
+    const uint64_t sum = latency_sum_.exchange(0, std::memory_order_relaxed);
+    const int64_t step = std::max<int64_t>(max_bytes_per_second_ / s_auto_tune_step_divisor, 1);
+    int64_t rate = rate_bytes_per_sec_.load(std::memory_order_relaxed);
+    if (count > 0 && sum > auto_tune_latency_us_ * count) {
+        rate = std::max(rate / 2, step);
+    } else if (drains_since_tune_ > 0) {
+        rate = std::min(rate + step, max_bytes_per_second_);
+    }
+    refills_since_tune_ = 0;
+    drains_since_tune_ = 0;
+    setRateLocked(rate);
+}
+
+class RateLimitedRandomAccessFile final : public RandomAccessFile {
+public:
+    RateLimitedRandomAccessFile(RandomAccessFile* file, RateLimiter* limiter, Env::IOPriority pri)
+        : file_(file), limiter_(limiter), pri_(pri) {}
+    ~RateLimitedRandomAccessFile() override { delete file_; }
+
+    Status read(uint64_t offset, size_t n, Slice* result, char* scratch) override {
+        limiter_->request(n, pri_);
+        return file_->read(offset, n, result, scratch);
+    }
+
+    Status multiRead(ReadRequest* reqs, size_t n) override {
+        int64_t bytes = 0;
+        for (size_t i = 0; i < n; i++) {
+            bytes += reqs[i].len;
+        }
+        limiter_->request(bytes, pri_);
+        return file_->multiRead(reqs, n);
+    }
+
+    void readAsync(ReadRequest* req, ReadCallback callback, void* arg) override {
+        limiter_->request(req->len, pri_);
+        file_->readAsync(req, callback, arg);
+    }
+
+private:
+    RandomAccessFile* const file_;
+    RateLimiter* const limiter_;
+    const Env::IOPriority pri_;
+};
+
+class RateLimitedWritableFile final : public WritableFile {
+public:
+    RateLimitedWritableFile(WritableFile* file, RateLimiter* limiter, Env::IOPriority pri)
+        : file_(file), limiter_(limiter), pri_(pri) {}
+    ~RateLimitedWritableFile() override { delete file_; }
+
+    // 按单次上限拆分, 每申请到一部分令牌就写入一部分, 使写入更平滑; 拆分之后速率被调低时,
+    // request()在多个补充周期中满足这一部分, 写入的字节仍然全部计入限速
+    Status append(const Slice& data) override {
+        const char* p = data.data();
+        size_t left = data.size();
+        while (left > 0) {
+            const size_t n = std::min<size_t>(left, limiter_->getSingleBurstBytes());
+            limiter_->request(n, pri_);
+            Status s = file_->append(Slice(p, n));
+            if (!s.ok()) {
+                return s;
+            }
+            p += n;
+            left -= n;
+        }
+        return Status::success();
+    }
+
+    Status close() override { return file_->close(); }
+    Status flush() override { return file_->flush(); }
+    Status sync() override { return file_->sync(); }
+
+private:
+    WritableFile* const file_;
+    RateLimiter* const limiter_;
+    const Env::IOPriority pri_;
+};
+
+}  // namespace
+
+RateLimiter* NewGenericRateLimiter(int64_t rate_bytes_per_sec, int64_t refill_period_us, int32_t fairness,
+                                   uint64_t auto_tune_latency_us) {
+    return new GenericRateLimiter(rate_bytes_per_sec, refill_period_us, fairness, auto_tune_latency_us);
+}
+
+RandomAccessFile* NewRateLimitedRandomAccessFile(RandomAccessFile* file, RateLimiter* limiter, Env::IOPriority pri) {
+    if (pri == Env::IOPriority::Total) {
+        return file;
+    }
+    return new RateLimitedRandomAccessFile(file, limiter, pri);
+}
+
+WritableFile* NewRateLimitedWritableFile(WritableFile* file, RateLimiter* limiter, Env::IOPriority pri) {
+    if (pri == Env::IOPriority::Total) {
+        return file;
+    }
+    return new RateLimitedWritableFile(file, limiter, pri);
+}
+
+}  // namespace kvstorage
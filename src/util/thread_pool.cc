@@ -0,0 +1,128 @@
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+
+namespace kvstorage {
+
+ThreadPool::ThreadPool(int num_threads) : total_threads_limit_(std::max(num_threads, 1)), exit_all_threads_(false) {}
+
+ThreadPool::~ThreadPool() {
+    std::vector<std::thread> threads;
+    {
+        std::lock_guard<std::mutex> lock(mu_);
+        exit_all_threads_ = true;
+        threads.swap(threads_);
+        cv_.notify_all();
+    }
+    for (std::thread& t : threads) {
+        t.join();
+    }
+}
+
+uint64_t ThreadPool::NowMicros() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void ThreadPool::schedule(void (*function)(void* arg), void* arg, void* tag, void (*unschedule_function)(void* arg)) {
+    std::lock_guard<std::mutex> lock(mu_);
+    assert(!exit_all_threads_);
+    startThreadsIfNeeded();
+    queue_.push_back(BackgroundItem{function, arg, tag, unschedule_function, NowMicros()});
+    stats_.scheduled++;
+    cv_.notify_one();
+}
+
+int ThreadPool::unschedule(void* tag) {
+    if (tag == nullptr) {
+        return 0;
+    }
+    std::vector<BackgroundItem> removed;
+    {
+        std::lock_guard<std::mutex> lock(mu_);
+        for (auto it = queue_.begin(); it != queue_.end();) {
+            if (it->tag == tag) {
+                removed.push_back(*it);
+                it = queue_.erase(it);
+            } else {
+                ++it;
+            }
+        }
+        stats_.unscheduled += removed.size();
+    }
+    // 在锁外回调, 允许回调中再次提交任务
+    for (const BackgroundItem& item : removed) {
+        if (item.unschedule_function != nullptr) {
+            (*item.unschedule_function)(item.arg);
+        }
+    }
+    return static_cast<int>(removed.size());
+}
+
+void ThreadPool::setBackgroundThreads(int num) {
+    std::lock_guard<std::mutex> lock(mu_);
+    total_threads_limit_ = std::max(num, 1);
+    if (threads_.size() > static_cast<size_t>(total_threads_limit_)) {
+        cv_.notify_all();  // 唤醒多余的线程退出
+    } else if (!queue_.empty()) {
+        startThreadsIfNeeded();
+    }
+}
+
+int ThreadPool::getBackgroundThreads() {
+    std::lock_guard<std::mutex> lock(mu_);
+    return total_threads_limit_;
+}
+
+void ThreadPool::getStats(ThreadPoolStats* stats) {
+    std::lock_guard<std::mutex> lock(mu_);
+    *stats = stats_;
+    stats->threads = total_threads_limit_;
+    stats->queue_len = queue_.size();
+}
+
+void ThreadPool::startThreadsIfNeeded() {
+    while (threads_.size() < static_cast<size_t>(total_threads_limit_)) {
+        threads_.emplace_back(&ThreadPool::backgroundThreadMain, this, threads_.size());
+    }
+}
+
+bool ThreadPool::isLastExcessiveThread(size_t thread_id) const {
+    return !exit_all_threads_ && threads_.size() > static_cast<size_t>(total_threads_limit_) &&
+           thread_id == threads_.size() - 1;
+}
+
+void ThreadPool::backgroundThreadMain(size_t thread_id) {
+    while (true) {
+        std::unique_lock<std::mutex> lock(mu_);
+        cv_.wait(lock, [this, thread_id] {
+            return exit_all_threads_ || !queue_.empty() || isLastExcessiveThread(thread_id);
+        });
+
+        if (isLastExcessiveThread(thread_id)) {
+            // 从threads_中移除自己, 之后没有线程会join它
+            threads_.back().detach();
+            threads_.pop_back();
+            cv_.notify_all();  // 下一个编号最大的线程可能也是多余的
+            return;
+        }
+        if (queue_.empty()) {
+            assert(exit_all_threads_);
+            return;
+        }
+
+        BackgroundItem item = queue_.front();
+        queue_.pop_front();
+        const uint64_t wait_micros = NowMicros() - item.enqueue_micros;
+        stats_.run++;
+        stats_.total_wait_micros += wait_micros;
+        stats_.max_wait_micros = std::max(stats_.max_wait_micros, wait_micros);
+
+        lock.unlock();
+        (*item.function)(item.arg);
+    }
+}
+
+}  // namespace kvstorage
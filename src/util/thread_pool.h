@@ -0,0 +1,65 @@
+/*
+ * 固定优先级的后台线程池, Env的每个优先级对应一个ThreadPool
+ * 任务按提交顺序执行, 线程在第一次提交任务时才启动, 数量可以在运行时调整;
+ * 还未执行的任务可以按tag取消, 同时记录队列长度和任务的等待时间
+*/
+#ifndef KVSTORAGE_UTIL_THREAD_POOL_H_
+#define KVSTORAGE_UTIL_THREAD_POOL_H_
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "env.h"
+
+namespace kvstorage {
+
+class ThreadPool {
+public:
+    explicit ThreadPool(int num_threads = 1);
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+    // 等待队列中的所有任务执行完, 然后回收所有线程
+    ~ThreadPool();
+
+    // 参数的含义见Env::schedule()
+    void schedule(void (*function)(void* arg), void* arg, void* tag, void (*unschedule_function)(void* arg));
+    // 取消还未执行的, tag相同的任务, 返回取消的数量
+    int unschedule(void* tag);
+    // 设置线程数量, 至少为1; 增加时如果有等待的任务立即启动新线程, 否则在下次提交任务时启动
+    void setBackgroundThreads(int num);
+    int getBackgroundThreads();
+    void getStats(ThreadPoolStats* stats);
+
+private:
+    struct BackgroundItem {
+        void (*function)(void*);
+        void* arg;
+        void* tag;
+        void (*unschedule_function)(void*);
+        uint64_t enqueue_micros;  // 提交时间, 用于计算等待时间
+    };
+
+    static uint64_t NowMicros();
+
+    void backgroundThreadMain(size_t thread_id);
+    // 线程数量少于上限时启动新线程, 需要持有mu_
+    void startThreadsIfNeeded();
+    // thread_id是否是需要退出的多余线程, 每次只让编号最大的线程退出, 保证编号连续, 需要持有mu_
+    bool isLastExcessiveThread(size_t thread_id) const;
+
+    std::mutex mu_;
+    std::condition_variable cv_;
+    int total_threads_limit_;  // 以下由mu_保护
+    bool exit_all_threads_;
+    std::vector<std::thread> threads_;
+    std::deque<BackgroundItem> queue_;
+    ThreadPoolStats stats_;  // queue_len和threads在getStats()时填写
+};
+
+}  // namespace kvstorage
+
+#endif  // KVSTORAGE_UTIL_THREAD_POOL_H_
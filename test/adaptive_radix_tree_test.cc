@@ -0,0 +1,240 @@
+#include "adaptive_radix_tree.h"
+
+#include <cstring>
+#include <deque>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "util/arena.h"
+#include "util/concurrent_arena.h"
+#include "util/random.h"
+
+namespace kvstorage {
+
+// 键的格式为"字节串#版本", '#'之前的部分决定在树中的位置, 之后的部分决定叶结点内的顺序
+typedef const char* Key;
+
+struct Comparator {
+  Slice keyBytes(Key k) const { return Slice(k, std::strchr(k, '#') - k); }
+  int operator()(Key a, Key b) const {
+    int r = keyBytes(a).compare(keyBytes(b));
+    if (r == 0) {
+      r = std::strcmp(std::strchr(a, '#'), std::strchr(b, '#'));
+    }
+    return r;
+  }
+};
+
+struct ModelLess {
+  bool operator()(const std::string& a, const std::string& b) const {
+    return Comparator()(a.c_str(), b.c_str()) < 0;
+  }
+};
+
+typedef AdaptiveRadixTree<Key, Comparator> Tree;
+
+class AdaptiveRadixTreeTest : public testing::Test {
+ public:
+  AdaptiveRadixTreeTest() : tree_(Comparator(), &arena_) {}
+
+  void Insert(const std::string& k) {
+    if (model_.insert(k).second) {
+      keys_.push_back(k);
+      tree_.insert(keys_.back().c_str());
+    }
+  }
+
+  // 生成有较长公共前缀的路径形式的键, 包括互为前缀的键
+  std::string RandomPathKey(Random* rnd) {
+    std::string k = "t" + std::to_string(rnd->uniform(3));
+    const int depth = rnd->uniform(4);
+    for (int i = 0; i < depth; i++) {
+      k += "/" + std::to_string(rnd->uniform(i == 0 ? 5 : 300));
+    }
+    return k + "#" + std::to_string(rnd->uniform(3));
+  }
+
+  Arena arena_;
+  Tree tree_;
+  std::deque<std::string> keys_;  // 树中的键指向这里的字符串
+  std::set<std::string, ModelLess> model_;
+};
+
+TEST_F(AdaptiveRadixTreeTest, Empty) {
+  ASSERT_TRUE(!tree_.contains("a#0"));
+  Tree::Iterator iter(&tree_);
+  iter.seekToFirst();
+  ASSERT_TRUE(!iter.valid());
+  iter.seekToLast();
+  ASSERT_TRUE(!iter.valid());
+  iter.seek("a#0");
+  ASSERT_TRUE(!iter.valid());
+  iter.seekPrefix("a");
+  ASSERT_TRUE(!iter.valid());
+}
+
+TEST_F(AdaptiveRadixTreeTest, PrefixKeys) {
+  // 空字节串, 互为前缀的字节串, 以及在压缩路径中间分叉的字节串
+  const char* keys[] = {"abcdef#0", "#0", "abc#0", "abcdef#1", "abcxyz#0", "ab#0", "abcdefg#0", "b#0", "a#0"};
+  for (const char* k : keys) {
+    Insert(k);
+  }
+  for (const char* k : keys) {
+    ASSERT_TRUE(tree_.contains(k)) << k;
+  }
+  ASSERT_TRUE(!tree_.contains("abcd#0"));
+  ASSERT_TRUE(!tree_.contains("abc#1"));
+
+  Tree::Iterator iter(&tree_);
+  iter.seekToFirst();
+  for (const std::string& k : model_) {
+    ASSERT_TRUE(iter.valid());
+    ASSERT_EQ(k, iter.key());
+    iter.next();
+  }
+  ASSERT_TRUE(!iter.valid());
+
+  iter.seekToLast();
+  for (auto it = model_.rbegin(); it != model_.rend(); ++it) {
+    ASSERT_TRUE(iter.valid());
+    ASSERT_EQ(*it, iter.key());
+    iter.prev();
+  }
+  ASSERT_TRUE(!iter.valid());
+
+  Key result;
+  ASSERT_TRUE(tree_.find("abcdef#", &result));  // '#'之后为空, 小于所有版本
+  ASSERT_EQ(std::string("abcdef#0"), result);
+  ASSERT_TRUE(!tree_.find("abcdef#2", &result));
+}
+
+// 随机插入路径形式的键后, 与std::set比较seek, 遍历和前缀查找的结果
+TEST_F(AdaptiveRadixTreeTest, RandomAgainstModel) {
+  Random rnd(301);
+  for (int i = 0; i < 20000; i++) {
+    Insert(RandomPathKey(&rnd));
+  }
+
+  Tree::Iterator iter(&tree_);
+  iter.seekToFirst();
+  for (const std::string& k : model_) {
+    ASSERT_TRUE(iter.valid());
+    ASSERT_EQ(k, iter.key());
+    iter.next();
+  }
+  ASSERT_TRUE(!iter.valid());
+
+  for (int i = 0; i < 2000; i++) {
+    std::string target = RandomPathKey(&rnd);
+    auto model = model_.lower_bound(target);
+    iter.seek(target.c_str());
+    if (model == model_.end()) {
+      ASSERT_TRUE(!iter.valid());
+      continue;
+    }
+    ASSERT_TRUE(iter.valid());
+    ASSERT_EQ(*model, iter.key());
+    ASSERT_EQ(model_.count(target) == 1, tree_.contains(target.c_str()));
+
+    // 前后移动几步
+    for (int j = 0; j < 3 && model != model_.begin(); j++) {
+      --model;
+      iter.prev();
+      ASSERT_TRUE(iter.valid());
+      ASSERT_EQ(*model, iter.key());
+    }
+    for (int j = 0; j < 5 && std::next(model) != model_.end(); j++) {
+      ++model;
+      iter.next();
+      ASSERT_TRUE(iter.valid());
+      ASSERT_EQ(*model, iter.key());
+    }
+  }
+
+  // 前缀查找只返回字节串以前缀开头的键
+  const char* prefixes[] = {"t1/", "t0/3", "t2/4/1", "t1/2/100/", "x"};
+  for (const char* prefix : prefixes) {
+    std::vector<std::string> expected;
+    for (const std::string& k : model_) {
+      if (Comparator().keyBytes(k.c_str()).startsWith(prefix)) {
+        expected.push_back(k);
+      }
+    }
+    std::vector<std::string> actual;
+    for (iter.seekPrefix(prefix); iter.valid(); iter.next()) {
+      actual.push_back(iter.key());
+    }
+    ASSERT_EQ(expected, actual) << prefix;
+  }
+}
+
+// 同一个结点下有上百个子结点, 覆盖Node48和Node256
+TEST_F(AdaptiveRadixTreeTest, WideFanout) {
+  Random rnd(1000);
+  for (int i = 0; i < 5000; i++) {
+    std::string k = "p";
+    const int len = 1 + rnd.uniform(3);
+    for (int j = 0; j < len; j++) {
+      char c = static_cast<char>(1 + rnd.uniform(255));  // 不包括'\0'和'#'
+      k.push_back(c == '#' ? 'x' : c);
+    }
+    Insert(k + "#0");
+  }
+
+  Tree::Iterator iter(&tree_);
+  iter.seekToLast();
+  for (auto it = model_.rbegin(); it != model_.rend(); ++it) {
+    ASSERT_TRUE(iter.valid());
+    ASSERT_EQ(*it, iter.key());
+    iter.prev();
+  }
+  ASSERT_TRUE(!iter.valid());
+  for (const std::string& k : model_) {
+    ASSERT_TRUE(tree_.contains(k.c_str()));
+    iter.seek(k.c_str());
+    ASSERT_TRUE(iter.valid());
+    ASSERT_EQ(k, iter.key());
+  }
+}
+
+TEST_F(AdaptiveRadixTreeTest, ConcurrentInsert) {
+  const int kWriters = 4;
+  const int kPerWriter = 2000;
+  ConcurrentArena arena;
+  AdaptiveRadixTree<Key, Comparator, ConcurrentArena> tree(Comparator(), &arena);
+  std::vector<std::vector<std::string>> keys(kWriters);
+  for (int t = 0; t < kWriters; t++) {
+    for (int i = 0; i < kPerWriter; i++) {
+      keys[t].push_back("k/" + std::to_string(i) + "/" + std::to_string(t) + "#0");
+    }
+  }
+
+  std::vector<std::thread> writers;
+  for (int t = 0; t < kWriters; t++) {
+    writers.emplace_back([&tree, &keys, t] {
+      for (const std::string& k : keys[t]) {
+        tree.concurrentInsert(k.c_str());
+      }
+    });
+  }
+  for (auto& w : writers) {
+    w.join();
+  }
+
+  int count = 0;
+  AdaptiveRadixTree<Key, Comparator, ConcurrentArena>::Iterator iter(&tree);
+  for (iter.seekToFirst(); iter.valid(); iter.next()) {
+    count++;
+  }
+  ASSERT_EQ(kWriters * kPerWriter, count);
+  for (int t = 0; t < kWriters; t++) {
+    for (const std::string& k : keys[t]) {
+      ASSERT_TRUE(tree.contains(k.c_str())) << k;
+    }
+  }
+}
+
+}  // namespace kvstorage
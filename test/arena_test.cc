@@ -1,6 +1,9 @@
 #include "util/arena.h"
 
+#include <cstring>
+
 #include "gtest/gtest.h"
+#include "util/arena_block_pool.h"
 #include "util/random.h"
 
 namespace kvstorage {
@@ -54,4 +57,76 @@ TEST(ArenaTest, Simple) {
   }
 }
 
-}  // namespace kvstorage
\ No newline at end of file
+TEST(ArenaTest, BlockSize) {
+  Arena arena(64 * 1024);
+  ASSERT_EQ(64 * 1024, arena.blockSize());
+  arena.allocate(100);
+  // 小块分配在同一个内存块中完成
+  const size_t usage = arena.memoryUsage();
+  ASSERT_GE(usage, 64 * 1024);
+  for (int i = 0; i < 100; i++) {
+    arena.allocate(100);
+  }
+  ASSERT_EQ(usage, arena.memoryUsage());
+}
+
+TEST(ArenaTest, HugePage) {
+  Arena arena(64 * 1024, true);
+  // 使用大页时块大小向上取整为大页大小
+  ASSERT_EQ(Arena::s_huge_page_size, arena.blockSize());
+  std::vector<std::pair<size_t, char*>> allocated;
+  Random rnd(301);
+  for (int i = 0; i < 50000; i++) {
+    size_t s = rnd.oneIn(100) ? rnd.uniform(10000) + 1 : rnd.uniform(100) + 1;
+    char* r = rnd.oneIn(2) ? arena.allocateAligned(s) : arena.allocate(s);
+    std::memset(r, i % 256, s);
+    allocated.push_back(std::make_pair(s, r));
+  }
+  for (size_t i = 0; i < allocated.size(); i++) {
+    for (size_t b = 0; b < allocated[i].first; b++) {
+      ASSERT_EQ(int(allocated[i].second[b]) & 0xff, i % 256);
+    }
+  }
+  ASSERT_GE(arena.memoryUsage(), Arena::s_huge_page_size);
+}
+
+TEST(ArenaTest, BlockPool) {
+  ArenaBlockPool pool(1 << 20);
+  {
+    Arena arena(4096, false, &pool);
+    for (int i = 0; i < 100; i++) {
+      arena.allocate(1000);  // 每个块放4次, 共25个块
+    }
+    arena.allocate(5000);  // 大于块大小的1/4, 单独分配, 不归还到池中
+  }
+  ASSERT_EQ(0, pool.hits());
+  ASSERT_EQ(25, pool.misses());
+  ASSERT_EQ(25 * 4096, pool.retainedBytes());
+
+  {
+    Arena arena(4096, false, &pool);
+    for (int i = 0; i < 40; i++) {
+      char* p = arena.allocate(1000);
+      std::memset(p, i, 1000);
+    }
+    // 块大小不同, 不能复用
+    Arena other(8192, false, &pool);
+    other.allocate(100);
+  }
+  ASSERT_EQ(10, pool.hits());
+  ASSERT_EQ(26, pool.misses());
+  ASSERT_EQ(25 * 4096 + 8192, pool.retainedBytes());
+
+  // 调小容量时释放多余的块, 超过容量的块直接释放
+  pool.setCapacity(10 * 4096);
+  ASSERT_LE(pool.retainedBytes(), 10 * 4096);
+  {
+    Arena arena(4096, false, &pool);
+    for (int i = 0; i < 100; i++) {
+      arena.allocate(1000);
+    }
+  }
+  ASSERT_LE(pool.retainedBytes(), 10 * 4096);
+}
+
+}  // namespace kvstorage
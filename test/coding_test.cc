@@ -166,6 +166,209 @@ TEST(Coding, Varint64Truncation) {
   ASSERT_EQ(large_value, result);
 }
 
+// 各种长度的值放在缓冲区的不同位置, 覆盖8字节快速路径, 以及靠近limit时的逐字节路径
+static std::vector<uint32_t> BoundaryValues32() {
+  std::vector<uint32_t> values = {0, 1, 0xffffffffu};
+  for (int shift = 7; shift < 32; shift += 7) {
+    values.push_back((1u << shift) - 1);
+    values.push_back(1u << shift);
+  }
+  return values;
+}
+
+TEST(Coding, Varint32Boundary) {
+  for (uint32_t v : BoundaryValues32()) {
+    for (size_t offset = 0; offset < 12; offset++) {
+      for (size_t padding = 0; padding < 10; padding++) {
+        std::string s(offset, '\xff');
+        PutVarint32(&s, v);
+        const size_t end = s.size();
+        s.append(padding, '\xff');  // 结束字节之后的数据不影响解码
+        uint32_t actual;
+        const char* p = GetVarint32Ptr(s.data() + offset, s.data() + s.size(), &actual);
+        ASSERT_TRUE(p != nullptr) << v << " " << offset << " " << padding;
+        ASSERT_EQ(v, actual);
+        ASSERT_EQ(s.data() + end, p);
+      }
+    }
+  }
+}
+
+TEST(Coding, Varint32OverflowWithPadding) {
+  // 快速路径同样拒绝超过5字节的varint32, 以及8字节内没有结束字节的数据
+  uint32_t result;
+  std::string input("\x81\x82\x83\x84\x85\x11\x00\x00\x00", 9);
+  ASSERT_TRUE(GetVarint32Ptr(input.data(), input.data() + input.size(), &result) == nullptr);
+  std::string all_continue(16, '\x80');
+  ASSERT_TRUE(GetVarint32Ptr(all_continue.data(), all_continue.data() + all_continue.size(), &result) == nullptr);
+}
+
+// 直接调用GetVarint32PtrFallback解码1字节的值, 后面跟着最高位为0的字节时只消耗1个字节
+TEST(Coding, Varint32FallbackSingleByte) {
+  for (uint32_t v = 0; v < 128; v++) {
+    for (size_t padding = 0; padding < 10; padding++) {
+      std::string s;
+      PutVarint32(&s, v);
+      for (size_t i = 0; i < padding; i++) {
+        s.push_back(static_cast<char>(i + 1));
+      }
+      uint32_t actual;
+      const char* p = GetVarint32PtrFallback(s.data(), s.data() + s.size(), &actual);
+      ASSERT_TRUE(p != nullptr) << v << " " << padding;
+      ASSERT_EQ(v, actual);
+      ASSERT_EQ(s.data() + 1, p);
+    }
+  }
+  const char input[] = {0x05, 0x01};
+  uint32_t actual;
+  ASSERT_EQ(input + 1, GetVarint32PtrFallback(input, input + 2, &actual));
+  ASSERT_EQ(5u, actual);
+}
+
+TEST(Coding, Varint64Boundary) {
+  std::vector<uint64_t> values = {0, 1, ~static_cast<uint64_t>(0)};
+  for (int shift = 7; shift < 64; shift += 7) {
+    values.push_back((1ull << shift) - 1);
+    values.push_back(1ull << shift);
+  }
+  for (uint64_t v : values) {
+    for (size_t padding = 0; padding < 10; padding++) {
+      std::string s;
+      PutVarint64(&s, v);
+      const size_t end = s.size();
+      s.append(padding, '\xff');
+      uint64_t actual;
+      const char* p = GetVarint64Ptr(s.data(), s.data() + s.size(), &actual);
+      ASSERT_TRUE(p != nullptr) << v << " " << padding;
+      ASSERT_EQ(v, actual);
+      ASSERT_EQ(s.data() + end, p);
+    }
+  }
+}
+
+TEST(Coding, DecodeVarint32Batch) {
+  std::vector<uint32_t> values;
+  for (uint32_t v : BoundaryValues32()) {
+    values.push_back(v);
+  }
+  for (uint32_t i = 0; i < 1000; i++) {
+    values.push_back(i * i * 13);  // 长度混合的值, 一个8字节中有多个varint
+  }
+  std::string s;
+  for (uint32_t v : values) {
+    PutVarint32(&s, v);
+  }
+
+  // 分别解码全部和前n个, 覆盖在8字节中间停止的情况
+  for (size_t n : {values.size(), size_t(1), size_t(3), size_t(17), values.size() - 1}) {
+    std::vector<uint32_t> actual(n);
+    const char* p = DecodeVarint32Batch(s.data(), s.data() + s.size(), actual.data(), n);
+    ASSERT_TRUE(p != nullptr);
+    const char* expected_end = s.data();
+    for (size_t i = 0; i < n; i++) {
+      ASSERT_EQ(values[i], actual[i]) << i;
+      uint32_t unused;
+      expected_end = GetVarint32Ptr(expected_end, s.data() + s.size(), &unused);
+    }
+    ASSERT_EQ(expected_end, p);
+  }
+
+  // 数据不足或最后一个不完整
+  std::vector<uint32_t> actual(values.size() + 1);
+  ASSERT_TRUE(DecodeVarint32Batch(s.data(), s.data() + s.size(), actual.data(), values.size() + 1) == nullptr);
+  std::string truncated = s.substr(0, s.size() - 1);
+  ASSERT_TRUE(DecodeVarint32Batch(truncated.data(), truncated.data() + truncated.size(), actual.data(),
+                                  values.size()) == nullptr);
+  std::string overflow = s + std::string("\x81\x82\x83\x84\x85\x11\x00\x00\x00", 9);
+  ASSERT_TRUE(DecodeVarint32Batch(overflow.data(), overflow.data() + overflow.size(), actual.data(),
+                                  values.size() + 1) == nullptr);
+}
+
+TEST(Coding, GroupVarint32) {
+  std::vector<uint32_t> values;
+  for (uint32_t v : {0u, 1u, 0xffu, 0x100u, 0xffffu, 0x10000u, 0xffffffu, 0x1000000u, 0xffffffffu}) {
+    values.push_back(v);
+  }
+  for (uint32_t i = 0; i < 1000; i++) {
+    values.push_back(i * i * i * 7);
+  }
+
+  // 个数不是4的倍数时最后一组不完整
+  for (size_t n : {size_t(0), size_t(1), size_t(3), size_t(4), size_t(5), size_t(19), values.size()}) {
+    std::string s;
+    PutGroupVarint32(&s, values.data(), n);
+    s.append("tail");
+    Slice input(s);
+    std::vector<uint32_t> actual(n);
+    ASSERT_TRUE(GetGroupVarint32(&input, actual.data(), n)) << n;
+    ASSERT_EQ(std::vector<uint32_t>(values.begin(), values.begin() + n), actual);
+    ASSERT_EQ("tail", input.toString());
+
+    // 截断的数据在快速路径和逐字节路径上都返回失败
+    for (size_t len = 0; n > 0 && len < s.size() - 4; len++) {
+      ASSERT_TRUE(GetGroupVarint32Ptr(s.data(), s.data() + len, actual.data(), n) == nullptr) << n << " " << len;
+    }
+  }
+}
+
+// 所有256种标签下, 运行时选择的实现(支持SSSE3时为shuffle)与逐值截断的实现结果相同
+TEST(Coding, GroupVarint32MatchesPortable) {
+#if defined(__x86_64__)
+  ASSERT_EQ(__builtin_cpu_supports("ssse3") != 0, IsGroupVarintHardwareAccelerated());
+#endif
+  std::vector<uint32_t> values;
+  for (uint32_t tag = 0; tag < 256; tag++) {
+    for (int j = 0; j < 4; j++) {
+      const int len = ((tag >> (j * 2)) & 3) + 1;
+      const uint32_t high = len == 4 ? 0xffffffffu : (1u << (len * 8)) - 1;
+      values.push_back(len == 1 ? (tag * 31 + j) & 0xff : high - tag * 7 - j);
+    }
+  }
+  for (size_t n : {size_t(4), size_t(7), size_t(33), values.size()}) {
+    std::string s;
+    PutGroupVarint32(&s, values.data(), n);
+    std::vector<uint32_t> expected(n);
+    std::vector<uint32_t> actual(n);
+    const char* q = GetGroupVarint32PtrPortable(s.data(), s.data() + s.size(), expected.data(), n);
+    const char* p = GetGroupVarint32Ptr(s.data(), s.data() + s.size(), actual.data(), n);
+    ASSERT_EQ(s.data() + s.size(), q);
+    ASSERT_EQ(q, p);
+    ASSERT_EQ(std::vector<uint32_t>(values.begin(), values.begin() + n), expected);
+    ASSERT_EQ(expected, actual);
+  }
+}
+
+TEST(Coding, Uint32Array) {
+  std::vector<uint32_t> values;
+  for (uint32_t i = 0; i < 100; i++) {
+    values.push_back(i * 1000);
+  }
+  for (IntArrayEncoding encoding : {IntArrayEncoding::Varint, IntArrayEncoding::GroupVarint}) {
+    std::string s;
+    PutUint32Array(&s, values.data(), values.size(), encoding);
+    PutUint32Array(&s, nullptr, 0, encoding);
+    Slice input(s);
+    std::vector<uint32_t> actual;
+    ASSERT_TRUE(GetUint32Array(&input, &actual));
+    ASSERT_EQ(values, actual);
+    ASSERT_TRUE(GetUint32Array(&input, &actual));
+    ASSERT_TRUE(actual.empty());
+    ASSERT_TRUE(input.empty());
+
+    Slice truncated(s.data(), s.size() / 2);
+    ASSERT_TRUE(!GetUint32Array(&truncated, &actual));
+  }
+
+  // 未知的编码方式和明显错误的个数
+  std::string bad("\x7f\x01\x00", 3);
+  Slice input(bad);
+  std::vector<uint32_t> actual;
+  ASSERT_TRUE(!GetUint32Array(&input, &actual));
+  std::string too_many("\x01\xff\xff\x03\x00", 5);
+  input = Slice(too_many);
+  ASSERT_TRUE(!GetUint32Array(&input, &actual));
+}
+
 TEST(Coding, Strings) {
   std::string s;
   PutLengthPrefixedSlice(&s, Slice(""));
@@ -0,0 +1,73 @@
+#include "util/concurrent_arena.h"
+
+#include <cstdint>
+#include <cstring>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "util/random.h"
+
+namespace kvstorage {
+
+TEST(ConcurrentArenaTest, Empty) { ConcurrentArena arena; }
+
+TEST(ConcurrentArenaTest, Simple) {
+  ConcurrentArena arena;
+  size_t bytes = 0;
+  Random rnd(301);
+  std::vector<std::pair<size_t, char*>> allocated;
+  for (int i = 0; i < 10000; i++) {
+    size_t s = rnd.oneIn(100) ? rnd.uniform(3000) + 1 : rnd.uniform(50) + 1;
+    char* r = rnd.oneIn(2) ? arena.allocate(s) : arena.allocateAligned(s);
+    ASSERT_EQ(0, reinterpret_cast<uintptr_t>(r) & (sizeof(void*) - 1));
+    for (size_t b = 0; b < s; b++) {
+      r[b] = i % 256;
+    }
+    bytes += s;
+    allocated.push_back(std::make_pair(s, r));
+    ASSERT_GE(arena.memoryUsage(), bytes);
+  }
+  for (size_t i = 0; i < allocated.size(); i++) {
+    for (size_t b = 0; b < allocated[i].first; b++) {
+      ASSERT_EQ(int(allocated[i].second[b]) & 0xff, i % 256);
+    }
+  }
+}
+
+// 多个线程同时分配并写入各自的数据, 检查分配出的内存没有重叠
+TEST(ConcurrentArenaTest, MultiThread) {
+  const int kThreads = 8;
+  const int kAllocs = 20000;
+  ConcurrentArena arena;
+  std::vector<std::vector<std::pair<size_t, char*>>> allocated(kThreads);
+  std::vector<std::thread> threads;
+  for (int t = 0; t < kThreads; t++) {
+    threads.emplace_back([&arena, &allocated, t] {
+      Random rnd(1000 + t);
+      for (int i = 0; i < kAllocs; i++) {
+        size_t s = rnd.oneIn(500) ? rnd.uniform(2000) + 1 : rnd.uniform(64) + 1;
+        char* r = arena.allocateAligned(s);
+        std::memset(r, t, s);
+        allocated[t].push_back(std::make_pair(s, r));
+      }
+    });
+  }
+  for (auto& th : threads) {
+    th.join();
+  }
+
+  size_t bytes = 0;
+  for (int t = 0; t < kThreads; t++) {
+    for (const auto& a : allocated[t]) {
+      bytes += a.first;
+      for (size_t b = 0; b < a.first; b++) {
+        ASSERT_EQ(t, a.second[b]);
+      }
+    }
+  }
+  ASSERT_GE(arena.memoryUsage(), bytes);
+}
+
+}  // namespace kvstorage
@@ -0,0 +1,84 @@
+#include "crc32c.h"
+
+#include <algorithm>
+#include <cstring>
+#include <string>
+
+#include "gtest/gtest.h"
+#include "util/random.h"
+
+namespace kvstorage {
+namespace crc32c {
+
+TEST(CRC, StandardResults) {
+  // 来自rfc3720第B.4节
+  char buf[32];
+
+  std::memset(buf, 0, sizeof(buf));
+  ASSERT_EQ(0x8a9136aa, Value(buf, sizeof(buf)));
+
+  std::memset(buf, 0xff, sizeof(buf));
+  ASSERT_EQ(0x62a8ab43, Value(buf, sizeof(buf)));
+
+  for (int i = 0; i < 32; i++) {
+    buf[i] = i;
+  }
+  ASSERT_EQ(0x46dd794e, Value(buf, sizeof(buf)));
+
+  for (int i = 0; i < 32; i++) {
+    buf[i] = 31 - i;
+  }
+  ASSERT_EQ(0x113fdb5c, Value(buf, sizeof(buf)));
+
+  uint8_t data[48] = {
+      0x01, 0xc0, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+      0x00, 0x00, 0x00, 0x00, 0x14, 0x00, 0x00, 0x00, 0x00, 0x00, 0x04, 0x00,
+      0x00, 0x00, 0x00, 0x14, 0x00, 0x00, 0x00, 0x18, 0x28, 0x00, 0x00, 0x00,
+      0x00, 0x00, 0x00, 0x00, 0x02, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  };
+  ASSERT_EQ(0xd9963a56, Value(reinterpret_cast<char*>(data), sizeof(data)));
+  ASSERT_EQ(0xd9963a56, ExtendPortable(0, reinterpret_cast<char*>(data), sizeof(data)));
+}
+
+TEST(CRC, Values) { ASSERT_NE(Value("a", 1), Value("foo", 3)); }
+
+TEST(CRC, Extend) {
+  ASSERT_EQ(Value("hello world", 11), Extend(Value("hello ", 6), "world", 5));
+}
+
+// 各种长度和起始位置, 覆盖对齐处理, 长段和短段的交错计算, 以及剩余字节的处理
+TEST(CRC, MatchesPortable) {
+  Random rnd(301);
+  std::string data(3 * 8192 * 2 + 1000, '\0');
+  for (size_t i = 0; i < data.size(); i++) {
+    data[i] = static_cast<char>(rnd.next());
+  }
+  const size_t lengths[] = {0, 1, 7, 8, 9, 767, 768, 769, 4096, 3 * 8192 - 1, 3 * 8192, 3 * 8192 + 777,
+                            data.size() - 8};
+  for (size_t offset = 0; offset < 8; offset++) {
+    for (size_t n : lengths) {
+      ASSERT_EQ(ExtendPortable(0, data.data() + offset, n), Value(data.data() + offset, n)) << offset << " " << n;
+      ASSERT_EQ(ExtendPortable(0x12345678, data.data() + offset, n), Extend(0x12345678, data.data() + offset, n));
+    }
+  }
+
+  // 分段计算与整体计算的结果相同
+  uint32_t crc = 0;
+  for (size_t pos = 0; pos < data.size();) {
+    const size_t n = std::min<size_t>(rnd.uniform(20000), data.size() - pos);
+    crc = Extend(crc, data.data() + pos, n);
+    pos += n;
+  }
+  ASSERT_EQ(Value(data.data(), data.size()), crc);
+}
+
+TEST(CRC, Mask) {
+  uint32_t crc = Value("foo", 3);
+  ASSERT_NE(crc, Mask(crc));
+  ASSERT_NE(crc, Mask(Mask(crc)));
+  ASSERT_EQ(crc, Unmask(Mask(crc)));
+  ASSERT_EQ(crc, Unmask(Unmask(Mask(Mask(crc)))));
+}
+
+}  // namespace crc32c
+}  // namespace kvstorage
@@ -0,0 +1,171 @@
+#include "util/env_io_uring.h"
+
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "util/env_io_uring_test_helper.h"
+#include "util/random.h"
+
+namespace kvstorage {
+
+class EnvIoUringTest : public testing::Test {
+ public:
+  EnvIoUringTest() : env_(NewIoUringEnv(Env::defaultEnv())) {
+    std::string test_dir;
+    env_->getTestDirectory(&test_dir);
+    fname_ = test_dir + "/io_uring_test.dat";
+    Random rnd(301);
+    for (int i = 0; i < 1 << 20; i++) {
+      data_.push_back(static_cast<char>(rnd.uniform(256)));
+    }
+    EXPECT_TRUE(WriteStringToFile(env_, data_, fname_).ok());
+  }
+  ~EnvIoUringTest() override {
+    env_->removeFile(fname_);
+    delete env_;
+  }
+
+  Env* env_;
+  std::string fname_;
+  std::string data_;
+};
+
+// 不支持io_uring时退回到base_env的实现, 结果相同
+TEST_F(EnvIoUringTest, MultiRead) {
+  RandomAccessFile* file;
+  ASSERT_TRUE(env_->newRandomAccessFile(fname_, &file).ok());
+
+  // 超过一批(64个)的请求, 包括读到文件末尾的短读和长度为0的请求
+  const int n = 200;
+  Random rnd(1000);
+  std::vector<std::string> scratch(n);
+  std::vector<RandomAccessFile::ReadRequest> reqs(n);
+  for (int i = 0; i < n; i++) {
+    reqs[i].offset = (i == n - 1) ? data_.size() - 100 : rnd.uniform(data_.size() - 4096);
+    reqs[i].len = (i == 0) ? 0 : 1 + rnd.uniform(4096);
+    scratch[i].resize(4096);
+    reqs[i].scratch = &scratch[i][0];
+  }
+  ASSERT_TRUE(file->multiRead(reqs.data(), n).ok());
+  for (int i = 0; i < n; i++) {
+    ASSERT_TRUE(reqs[i].status.ok());
+    const size_t expected_len = std::min<size_t>(reqs[i].len, data_.size() - reqs[i].offset);
+    ASSERT_EQ(data_.substr(reqs[i].offset, expected_len), reqs[i].result.toString()) << i;
+  }
+  delete file;
+}
+
+TEST_F(EnvIoUringTest, ReadAsync) {
+  RandomAccessFile* file;
+  ASSERT_TRUE(env_->newRandomAccessFile(fname_, &file).ok());
+
+  struct State {
+    std::mutex mu;
+    std::condition_variable cv;
+    int completed = 0;
+
+    static void Done(void* arg, RandomAccessFile::ReadRequest* /*req*/) {
+      State* state = static_cast<State*>(arg);
+      std::lock_guard<std::mutex> l(state->mu);
+      state->completed++;
+      state->cv.notify_one();
+    }
+  };
+
+  // 超过SQ长度的未完成请求, 提交时需要等待之前的请求完成
+  const int n = 500;
+  State state;
+  std::vector<std::string> scratch(n, std::string(512, '\0'));
+  std::vector<RandomAccessFile::ReadRequest> reqs(n);
+  for (int i = 0; i < n; i++) {
+    reqs[i].offset = static_cast<uint64_t>(i) * 1000;
+    reqs[i].len = 512;
+    reqs[i].scratch = &scratch[i][0];
+    file->readAsync(&reqs[i], &State::Done, &state);
+  }
+  {
+    std::unique_lock<std::mutex> l(state.mu);
+    state.cv.wait(l, [&state] { return state.completed == n; });
+  }
+  for (int i = 0; i < n; i++) {
+    ASSERT_TRUE(reqs[i].status.ok());
+    ASSERT_EQ(data_.substr(reqs[i].offset, 512), reqs[i].result.toString()) << i;
+  }
+  delete file;
+}
+
+// io_uring_enter失败时没有提交的请求退回到逐个读取, 不能留在线程的ring中被下一次multiRead提交
+TEST_F(EnvIoUringTest, MultiReadEnterFailure) {
+  RandomAccessFile* file;
+  ASSERT_TRUE(env_->newRandomAccessFile(fname_, &file).ok());
+  Random rnd(1000);
+  for (int failures = 0; failures < 4; failures++) {
+    const int n = 100;
+    std::vector<std::string> scratch(n, std::string(4096, '\0'));
+    std::vector<RandomAccessFile::ReadRequest> reqs(n);
+    for (int i = 0; i < n; i++) {
+      reqs[i].offset = rnd.uniform(data_.size() - 4096);
+      reqs[i].len = 1 + rnd.uniform(4096);
+      reqs[i].scratch = &scratch[i][0];
+    }
+    EnvIoUringTestHelper::failNextMultiReadEnters(failures);
+    ASSERT_TRUE(file->multiRead(reqs.data(), n).ok()) << failures;
+    EnvIoUringTestHelper::failNextMultiReadEnters(0);
+    for (int i = 0; i < n; i++) {
+      ASSERT_TRUE(reqs[i].status.ok());
+      ASSERT_EQ(data_.substr(reqs[i].offset, reqs[i].len), reqs[i].result.toString()) << failures << " " << i;
+    }
+  }
+  delete file;
+}
+
+// 提交或收割时io_uring_enter失败, 重试之后所有回调仍然被调用
+TEST_F(EnvIoUringTest, ReadAsyncEnterFailure) {
+  RandomAccessFile* file;
+  ASSERT_TRUE(env_->newRandomAccessFile(fname_, &file).ok());
+
+  struct State {
+    std::mutex mu;
+    std::condition_variable cv;
+    int completed = 0;
+
+    static void Done(void* arg, RandomAccessFile::ReadRequest* /*req*/) {
+      State* state = static_cast<State*>(arg);
+      std::lock_guard<std::mutex> l(state->mu);
+      state->completed++;
+      state->cv.notify_one();
+    }
+  };
+
+  const int n = 20;
+  State state;
+  std::vector<std::string> scratch(n, std::string(512, '\0'));
+  std::vector<RandomAccessFile::ReadRequest> reqs(n);
+  for (int i = 0; i < n; i++) {
+    reqs[i].offset = static_cast<uint64_t>(i) * 1000;
+    reqs[i].len = 512;
+    reqs[i].scratch = &scratch[i][0];
+    EnvIoUringTestHelper::failNextAsyncEnters(env_, 2);
+    file->readAsync(&reqs[i], &State::Done, &state);
+  }
+  {
+    std::unique_lock<std::mutex> l(state.mu);
+    state.cv.wait(l, [&state] { return state.completed == n; });
+  }
+  EnvIoUringTestHelper::failNextAsyncEnters(env_, 0);
+  for (int i = 0; i < n; i++) {
+    ASSERT_TRUE(reqs[i].status.ok());
+    ASSERT_EQ(data_.substr(reqs[i].offset, 512), reqs[i].result.toString()) << i;
+  }
+  delete file;
+}
+
+TEST_F(EnvIoUringTest, NonExistentFile) {
+  RandomAccessFile* file;
+  ASSERT_TRUE(env_->newRandomAccessFile(fname_ + ".missing", &file).isNotFound());
+}
+
+}  // namespace kvstorage
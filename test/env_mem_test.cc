@@ -0,0 +1,267 @@
+#include "util/env_mem.h"
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "util/random.h"
+
+namespace kvstorage {
+
+class MemEnvTest : public testing::Test {
+ public:
+  MemEnvTest() : env_(NewMemEnv(Env::defaultEnv())) {}
+  ~MemEnvTest() override { delete env_; }
+
+  Env* env_;
+};
+
+TEST_F(MemEnvTest, Basics) {
+  uint64_t file_size;
+  WritableFile* writable_file;
+  std::vector<std::string> children;
+
+  ASSERT_TRUE(env_->createDir("/dir").ok());
+
+  // 检查目录是否为空
+  ASSERT_TRUE(!env_->fileExists("/dir/non_existent"));
+  ASSERT_TRUE(!env_->getFileSize("/dir/non_existent", &file_size).ok());
+  ASSERT_TRUE(env_->getChildren("/dir", &children).ok());
+  ASSERT_EQ(0u, children.size());
+
+  // 创建一个文件
+  ASSERT_TRUE(env_->newWritableFile("/dir/f", &writable_file).ok());
+  ASSERT_TRUE(env_->getFileSize("/dir/f", &file_size).ok());
+  ASSERT_EQ(0u, file_size);
+  delete writable_file;
+
+  // 检查文件是否存在
+  ASSERT_TRUE(env_->fileExists("/dir/f"));
+  ASSERT_TRUE(env_->getFileSize("/dir/f", &file_size).ok());
+  ASSERT_EQ(0u, file_size);
+  ASSERT_TRUE(env_->getChildren("/dir", &children).ok());
+  ASSERT_EQ(1u, children.size());
+  ASSERT_EQ("f", children[0]);
+
+  // 写入文件
+  ASSERT_TRUE(env_->newWritableFile("/dir/f", &writable_file).ok());
+  ASSERT_TRUE(writable_file->append("abc").ok());
+  delete writable_file;
+
+  // 检查追加写入是否成功
+  ASSERT_TRUE(env_->newAppendableFile("/dir/f", &writable_file).ok());
+  ASSERT_TRUE(env_->getFileSize("/dir/f", &file_size).ok());
+  ASSERT_EQ(3u, file_size);
+  ASSERT_TRUE(writable_file->append("hello").ok());
+  delete writable_file;
+
+  // 检查文件大小
+  ASSERT_TRUE(env_->getFileSize("/dir/f", &file_size).ok());
+  ASSERT_EQ(8u, file_size);
+
+  // 检查重命名
+  ASSERT_TRUE(!env_->renameFile("/dir/non_existent", "/dir/g").ok());
+  ASSERT_TRUE(env_->renameFile("/dir/f", "/dir/g").ok());
+  ASSERT_TRUE(!env_->fileExists("/dir/f"));
+  ASSERT_TRUE(env_->fileExists("/dir/g"));
+  ASSERT_TRUE(env_->getFileSize("/dir/g", &file_size).ok());
+  ASSERT_EQ(8u, file_size);
+
+  // 检查打开不存在的文件
+  SequentialFile* seq_file;
+  RandomAccessFile* rand_file;
+  ASSERT_TRUE(env_->newSequentialFile("/dir/non_existent", &seq_file).isNotFound());
+  ASSERT_TRUE(!seq_file);
+  ASSERT_TRUE(env_->newRandomAccessFile("/dir/non_existent", &rand_file).isNotFound());
+  ASSERT_TRUE(!rand_file);
+
+  // 检查删除文件和目录
+  ASSERT_TRUE(!env_->removeFile("/dir/non_existent").ok());
+  ASSERT_TRUE(env_->removeFile("/dir/g").ok());
+  ASSERT_TRUE(!env_->fileExists("/dir/g"));
+  ASSERT_TRUE(env_->getChildren("/dir", &children).ok());
+  ASSERT_EQ(0u, children.size());
+  ASSERT_TRUE(env_->removeDir("/dir").ok());
+  ASSERT_TRUE(!env_->fileExists("/dir"));
+}
+
+TEST_F(MemEnvTest, ReadWrite) {
+  WritableFile* writable_file;
+  SequentialFile* seq_file;
+  RandomAccessFile* rand_file;
+  Slice result;
+  char scratch[100];
+
+  ASSERT_TRUE(env_->createDir("/dir").ok());
+
+  ASSERT_TRUE(env_->newWritableFile("/dir/f", &writable_file).ok());
+  ASSERT_TRUE(writable_file->append("hello ").ok());
+  ASSERT_TRUE(writable_file->append("world").ok());
+  delete writable_file;
+
+  // 顺序读取
+  ASSERT_TRUE(env_->newSequentialFile("/dir/f", &seq_file).ok());
+  ASSERT_TRUE(seq_file->read(5, &result, scratch).ok());  // 读取"hello"
+  ASSERT_EQ(0, result.compare("hello"));
+  ASSERT_TRUE(seq_file->skip(1).ok());
+  ASSERT_TRUE(seq_file->read(1000, &result, scratch).ok());  // 读取"world"
+  ASSERT_EQ(0, result.compare("world"));
+  ASSERT_TRUE(seq_file->read(1000, &result, scratch).ok());  // 文件末尾
+  ASSERT_EQ(0u, result.size());
+  ASSERT_TRUE(seq_file->skip(100).ok());  // 跳过超过文件末尾也成功
+  ASSERT_TRUE(seq_file->read(1000, &result, scratch).ok());
+  ASSERT_EQ(0u, result.size());
+  delete seq_file;
+
+  // 随机读取
+  ASSERT_TRUE(env_->newRandomAccessFile("/dir/f", &rand_file).ok());
+  ASSERT_TRUE(rand_file->read(6, 5, &result, scratch).ok());  // 读取"world"
+  ASSERT_EQ(0, result.compare("world"));
+  ASSERT_TRUE(rand_file->read(0, 5, &result, scratch).ok());  // 读取"hello"
+  ASSERT_EQ(0, result.compare("hello"));
+  ASSERT_TRUE(rand_file->read(10, 100, &result, scratch).ok());  // 读取"d"
+  ASSERT_EQ(0, result.compare("d"));
+
+  // 读取超过文件末尾的位置失败
+  ASSERT_TRUE(!rand_file->read(1000, 5, &result, scratch).ok());
+  delete rand_file;
+}
+
+// 块内的读取直接返回指向文件内存的Slice, 跨越块边界时复制到scratch
+TEST_F(MemEnvTest, ZeroCopyRead) {
+  Random rnd(301);
+  std::string data;
+  for (int i = 0; i < 3 * 64 * 1024 + 100; i++) {
+    data.push_back(static_cast<char>(' ' + rnd.uniform(95)));
+  }
+  ASSERT_TRUE(WriteStringToFile(env_, data, "/f").ok());
+
+  RandomAccessFile* rand_file;
+  ASSERT_TRUE(env_->newRandomAccessFile("/f", &rand_file).ok());
+  std::string scratch(8192, '\0');
+  Slice result;
+  ASSERT_TRUE(rand_file->read(4096, 4096, &result, &scratch[0]).ok());
+  ASSERT_EQ(data.substr(4096, 4096), result.toString());
+  ASSERT_NE(&scratch[0], result.data());
+
+  ASSERT_TRUE(rand_file->read(64 * 1024 - 10, 20, &result, &scratch[0]).ok());
+  ASSERT_EQ(data.substr(64 * 1024 - 10, 20), result.toString());
+  ASSERT_EQ(&scratch[0], result.data());
+
+  for (int i = 0; i < 1000; i++) {
+    const size_t offset = rnd.uniform(data.size());
+    const size_t len = std::min<size_t>(rnd.skewed(13), data.size() - offset);
+    ASSERT_TRUE(rand_file->read(offset, len, &result, &scratch[0]).ok());
+    ASSERT_EQ(data.substr(offset, len), result.toString());
+  }
+  delete rand_file;
+}
+
+TEST_F(MemEnvTest, Locks) {
+  FileLock* lock;
+  FileLock* lock2;
+
+  // 同一个文件不能重复锁定, 解锁后可以再次锁定
+  ASSERT_TRUE(env_->lockFile("some file", &lock).ok());
+  ASSERT_TRUE(env_->fileExists("some file"));
+  ASSERT_TRUE(env_->lockFile("some file", &lock2).isIOError());
+  ASSERT_TRUE(env_->unlockFile(lock).ok());
+  ASSERT_TRUE(env_->lockFile("some file", &lock2).ok());
+  ASSERT_TRUE(env_->unlockFile(lock2).ok());
+}
+
+TEST_F(MemEnvTest, Misc) {
+  std::string test_dir;
+  ASSERT_TRUE(env_->getTestDirectory(&test_dir).ok());
+  ASSERT_TRUE(!test_dir.empty());
+
+  WritableFile* writable_file;
+  ASSERT_TRUE(env_->newWritableFile("/a/b", &writable_file).ok());
+
+  // 这些操作在内存中没有效果, 只检查不会失败
+  ASSERT_TRUE(writable_file->sync().ok());
+  ASSERT_TRUE(writable_file->flush().ok());
+  ASSERT_TRUE(writable_file->close().ok());
+  delete writable_file;
+}
+
+TEST_F(MemEnvTest, LargeWrite) {
+  const size_t kWriteSize = 300 * 1024;
+  char* scratch = new char[kWriteSize * 2];
+
+  std::string write_data;
+  for (size_t i = 0; i < kWriteSize; ++i) {
+    write_data.append(1, static_cast<char>(i));
+  }
+
+  WritableFile* writable_file;
+  ASSERT_TRUE(env_->newWritableFile("/dir/f", &writable_file).ok());
+  ASSERT_TRUE(writable_file->append("foo").ok());
+  ASSERT_TRUE(writable_file->append(write_data).ok());
+  delete writable_file;
+
+  SequentialFile* seq_file;
+  Slice result;
+  ASSERT_TRUE(env_->newSequentialFile("/dir/f", &seq_file).ok());
+  ASSERT_TRUE(seq_file->read(3, &result, scratch).ok());  // 读取"foo"
+  ASSERT_EQ(0, result.compare("foo"));
+
+  size_t read = 0;
+  std::string read_data;
+  while (read < kWriteSize) {
+    ASSERT_TRUE(seq_file->read(kWriteSize - read, &result, scratch).ok());
+    read_data.append(result.data(), result.size());
+    read += result.size();
+  }
+  ASSERT_TRUE(write_data == read_data);
+  delete seq_file;
+  delete[] scratch;
+}
+
+// 文件被重写或删除之后, 已经打开的对象仍然读取原来的数据
+TEST_F(MemEnvTest, OverwriteOpenFile) {
+  const char kWrite1Data[] = "Write #1 data";
+  const size_t kFileDataLen = sizeof(kWrite1Data) - 1;
+  const std::string kTestFileName = "/tmp/overwrite-test";
+
+  ASSERT_TRUE(WriteStringToFile(env_, kWrite1Data, kTestFileName).ok());
+
+  RandomAccessFile* rand_file;
+  ASSERT_TRUE(env_->newRandomAccessFile(kTestFileName, &rand_file).ok());
+
+  const char kWrite2Data[] = "Write #2 data";
+  ASSERT_TRUE(WriteStringToFile(env_, kWrite2Data, kTestFileName).ok());
+
+  char scratch[kFileDataLen];
+  Slice result;
+  ASSERT_TRUE(rand_file->read(0, kFileDataLen, &result, scratch).ok());
+  ASSERT_EQ(0, result.compare(kWrite1Data));
+
+  ASSERT_TRUE(env_->removeFile(kTestFileName).ok());
+  ASSERT_TRUE(rand_file->read(0, kFileDataLen, &result, scratch).ok());
+  ASSERT_EQ(0, result.compare(kWrite1Data));
+  delete rand_file;
+}
+
+// 带EnvOptions打开时忽略direct I/O
+TEST_F(MemEnvTest, IgnoresDirectIO) {
+  EnvOptions env_options;
+  env_options.use_direct_reads = true;
+  env_options.use_direct_writes = true;
+  WritableFile* writable_file;
+  ASSERT_TRUE(env_->newWritableFile("/f", env_options, &writable_file).ok());
+  ASSERT_TRUE(writable_file->append("abc").ok());
+  ASSERT_TRUE(writable_file->close().ok());
+  delete writable_file;
+
+  RandomAccessFile* rand_file;
+  ASSERT_TRUE(env_->newRandomAccessFile("/f", env_options, &rand_file).ok());
+  char scratch[3];
+  Slice result;
+  ASSERT_TRUE(rand_file->read(0, 3, &result, scratch).ok());
+  ASSERT_EQ(0, result.compare("abc"));
+  delete rand_file;
+}
+
+}  // namespace kvstorage
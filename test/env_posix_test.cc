@@ -0,0 +1,63 @@
+#include "env.h"
+
+#include <string>
+
+#include "gtest/gtest.h"
+#include "util/env_posix_test_helper.h"
+
+namespace kvstorage {
+
+static const int kMMapLimit = 1;
+
+class EnvPosixTest : public testing::Test {
+ public:
+  // 必须在第一次调用Env::defaultEnv()之前设置
+  static void SetFileLimits(int mmap_limit) { EnvPosixTestHelper::setReadOnlyMMapLimit(mmap_limit); }
+
+  EnvPosixTest() : env_(Env::defaultEnv()) {}
+
+  Env* env_;
+};
+
+// mmap的文件达到上限后改用pread, 关闭mmap的文件后可以再次mmap
+TEST_F(EnvPosixTest, MMapLimit) {
+  std::string test_dir;
+  ASSERT_TRUE(env_->getTestDirectory(&test_dir).ok());
+  const std::string fname = test_dir + "/mmap_limit.txt";
+  const std::string data(100000, 'x');
+  ASSERT_TRUE(WriteStringToFile(env_, data, fname).ok());
+
+  char scratch[100];
+  Slice result;
+  RandomAccessFile* mapped;
+  ASSERT_TRUE(env_->newRandomAccessFile(fname, &mapped).ok());
+  ASSERT_TRUE(mapped->read(90000, sizeof(scratch), &result, scratch).ok());
+  ASSERT_EQ(std::string(sizeof(scratch), 'x'), result.toString());
+  ASSERT_TRUE(result.data() != scratch);  // 直接指向映射的内存
+  ASSERT_TRUE(!mapped->read(data.size() - 10, sizeof(scratch), &result, scratch).ok());
+
+  RandomAccessFile* unmapped;
+  ASSERT_TRUE(env_->newRandomAccessFile(fname, &unmapped).ok());
+  ASSERT_TRUE(unmapped->read(90000, sizeof(scratch), &result, scratch).ok());
+  ASSERT_EQ(std::string(sizeof(scratch), 'x'), result.toString());
+  ASSERT_TRUE(result.data() == scratch);
+  // pread读到文件末尾时返回较短的结果
+  ASSERT_TRUE(unmapped->read(data.size() - 10, sizeof(scratch), &result, scratch).ok());
+  ASSERT_EQ(10u, result.size());
+  delete unmapped;
+
+  delete mapped;
+  ASSERT_TRUE(env_->newRandomAccessFile(fname, &mapped).ok());
+  ASSERT_TRUE(mapped->read(0, sizeof(scratch), &result, scratch).ok());
+  ASSERT_TRUE(result.data() != scratch);
+  delete mapped;
+  ASSERT_TRUE(env_->removeFile(fname).ok());
+}
+
+}  // namespace kvstorage
+
+int main(int argc, char** argv) {
+  kvstorage::EnvPosixTest::SetFileLimits(kvstorage::kMMapLimit);
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -1,12 +1,12 @@
 #include "env.h"
 
 #include <algorithm>
+#include <condition_variable>
+#include <mutex>
 
 #include "gtest/gtest.h"
-// #include "port/port.h"
-#include "port/thread_annotations.h"
-#include "util/mutexlock.h"
-#include "util/testutil.h"
+#include "util/aligned_buffer.h"
+#include "util/random.h"
 
 namespace kvstorage {
 
@@ -14,46 +14,52 @@ class EnvTest : public testing::Test {
  public:
   EnvTest() : env_(Env::defaultEnv()) {}
 
+  static std::string RandomString(Random* rnd, int len) {
+    std::string r;
+    for (int i = 0; i < len; i++) {
+      r.push_back(static_cast<char>(' ' + rnd->uniform(95)));
+    }
+    return r;
+  }
+
   Env* env_;
 };
 
 TEST_F(EnvTest, ReadWrite) {
-  Random rnd(test::RandomSeed());
+  Random rnd(301);
 
-  // Get file to use for testing.
   std::string test_dir;
-  ASSERT_LEVELDB_OK(env_->getTestDirectory(&test_dir));
+  ASSERT_TRUE(env_->getTestDirectory(&test_dir).ok());
   std::string test_file_name = test_dir + "/open_on_read.txt";
   WritableFile* writable_file;
-  ASSERT_LEVELDB_OK(env_->newWritableFile(test_file_name, &writable_file));
+  ASSERT_TRUE(env_->newWritableFile(test_file_name, &writable_file).ok());
 
-  // Fill a file with data generated via a sequence of randomly sized writes.
+  // 随机长度的多次写入, 跨越64KB的写缓冲区
   static const size_t kDataSize = 10 * 1048576;
   std::string data;
   while (data.size() < kDataSize) {
-    int len = rnd.Skewed(18);  // Up to 2^18 - 1, but typically much smaller
-    std::string r;
-    test::RandomString(&rnd, len, &r);
-    ASSERT_LEVELDB_OK(writable_file->Append(r));
+    int len = rnd.skewed(18);  // 最大2^18 - 1, 通常较小
+    std::string r = RandomString(&rnd, len);
+    ASSERT_TRUE(writable_file->append(r).ok());
     data += r;
-    if (rnd.OneIn(10)) {
-      ASSERT_LEVELDB_OK(writable_file->Flush());
+    if (rnd.oneIn(10)) {
+      ASSERT_TRUE(writable_file->flush().ok());
     }
   }
-  ASSERT_LEVELDB_OK(writable_file->Sync());
-  ASSERT_LEVELDB_OK(writable_file->Close());
+  ASSERT_TRUE(writable_file->sync().ok());
+  ASSERT_TRUE(writable_file->close().ok());
   delete writable_file;
 
-  // Read all data using a sequence of randomly sized reads.
+  // 随机长度的多次顺序读取
   SequentialFile* sequential_file;
-  ASSERT_LEVELDB_OK(env_->NewSequentialFile(test_file_name, &sequential_file));
+  ASSERT_TRUE(env_->newSequentialFile(test_file_name, &sequential_file).ok());
   std::string read_result;
   std::string scratch;
   while (read_result.size() < data.size()) {
-    int len = std::min<int>(rnd.Skewed(18), data.size() - read_result.size());
-    scratch.resize(std::max(len, 1));  // at least 1 so &scratch[0] is legal
+    int len = std::min<int>(rnd.skewed(18), data.size() - read_result.size());
+    scratch.resize(std::max(len, 1));  // 至少1字节, &scratch[0]才合法
     Slice read;
-    ASSERT_LEVELDB_OK(sequential_file->Read(len, &read, &scratch[0]));
+    ASSERT_TRUE(sequential_file->read(len, &read, &scratch[0]).ok());
     if (len > 0) {
       ASSERT_GT(read.size(), 0);
     }
@@ -62,41 +68,118 @@ TEST_F(EnvTest, ReadWrite) {
   }
   ASSERT_EQ(read_result, data);
   delete sequential_file;
+
+  // 随机位置读取
+  RandomAccessFile* random_access_file;
+  ASSERT_TRUE(env_->newRandomAccessFile(test_file_name, &random_access_file).ok());
+  for (int i = 0; i < 1000; i++) {
+    const size_t offset = rnd.uniform(data.size());
+    const size_t len = std::min<size_t>(rnd.skewed(16), data.size() - offset);
+    scratch.resize(std::max<size_t>(len, 1));
+    Slice read;
+    ASSERT_TRUE(random_access_file->read(offset, len, &read, &scratch[0]).ok());
+    ASSERT_EQ(data.substr(offset, len), read.toString());
+  }
+  delete random_access_file;
+  ASSERT_TRUE(env_->removeFile(test_file_name).ok());
+}
+
+// O_DIRECT的读写需要按块对齐, 这里的长度和偏移都是随机的, 覆盖不足一块的尾部
+TEST_F(EnvTest, DirectIO) {
+  Random rnd(301);
+  std::string test_dir;
+  ASSERT_TRUE(env_->getTestDirectory(&test_dir).ok());
+  std::string test_file_name = test_dir + "/direct_io.txt";
+
+  EnvOptions env_options;
+  env_options.use_direct_reads = true;
+  env_options.use_direct_writes = true;
+  WritableFile* writable_file;
+  Status s = env_->newWritableFile(test_file_name, env_options, &writable_file);
+  if (s.isNotSupported()) {
+    GTEST_SKIP() << "direct I/O is not supported in " << test_dir;
+  }
+  ASSERT_TRUE(s.ok()) << s.toString();
+
+  static const size_t kDataSize = 3 * 1048576 + 1234;
+  std::string data;
+  while (data.size() < kDataSize) {
+    std::string r = RandomString(&rnd, rnd.skewed(18));
+    ASSERT_TRUE(writable_file->append(r).ok());
+    data += r;
+    if (rnd.oneIn(10)) {
+      ASSERT_TRUE(writable_file->flush().ok());
+    }
+    if (rnd.oneIn(20)) {
+      // sync之后文件的长度和内容与已写入的数据一致, 补零的尾部被截断
+      ASSERT_TRUE(writable_file->sync().ok());
+      std::string contents;
+      ASSERT_TRUE(ReadFileToString(env_, test_file_name, &contents).ok());
+      ASSERT_EQ(data, contents);
+    }
+  }
+  ASSERT_TRUE(writable_file->close().ok());
+  delete writable_file;
+
+  uint64_t file_size;
+  ASSERT_TRUE(env_->getFileSize(test_file_name, &file_size).ok());
+  ASSERT_EQ(data.size(), file_size);
+
+  RandomAccessFile* random_access_file;
+  ASSERT_TRUE(env_->newRandomAccessFile(test_file_name, env_options, &random_access_file).ok());
+  std::string scratch;
+  for (int i = 0; i < 1000; i++) {
+    const size_t offset = rnd.uniform(data.size());
+    const size_t len = rnd.skewed(16);  // 可能超过文件末尾
+    scratch.resize(std::max<size_t>(len, 1));
+    Slice read;
+    ASSERT_TRUE(random_access_file->read(offset, len, &read, &scratch[0]).ok());
+    ASSERT_EQ(data.substr(offset, len), read.toString());
+  }
+
+  // 偏移, 长度和缓冲区都对齐时直接读入scratch
+  AlignedBuffer aligned(4096, 8192);
+  Slice read;
+  ASSERT_TRUE(random_access_file->read(4096, 8192, &read, aligned.data()).ok());
+  ASSERT_EQ(data.substr(4096, 8192), read.toString());
+  ASSERT_TRUE(random_access_file->read(RoundDown(data.size(), 4096), 8192, &read, aligned.data()).ok());
+  ASSERT_EQ(data.substr(RoundDown(data.size(), 4096)), read.toString());
+
+  delete random_access_file;
+  ASSERT_TRUE(env_->removeFile(test_file_name).ok());
 }
 
 TEST_F(EnvTest, RunImmediately) {
   struct RunState {
-    port::Mutex mu;
-    port::CondVar cvar{&mu};
+    std::mutex mu;
+    std::condition_variable cvar;
     bool called = false;
 
     static void Run(void* arg) {
       RunState* state = reinterpret_cast<RunState*>(arg);
-      MutexLock l(&state->mu);
+      std::lock_guard<std::mutex> l(state->mu);
       ASSERT_EQ(state->called, false);
       state->called = true;
-      state->cvar.Signal();
+      state->cvar.notify_one();
     }
   };
 
   RunState state;
-  env_->Schedule(&RunState::Run, &state);
+  env_->schedule(&RunState::Run, &state);
 
-  MutexLock l(&state.mu);
-  while (!state.called) {
-    state.cvar.Wait();
-  }
+  std::unique_lock<std::mutex> l(state.mu);
+  state.cvar.wait(l, [&state] { return state.called; });
 }
 
 TEST_F(EnvTest, RunMany) {
   struct RunState {
-    port::Mutex mu;
-    port::CondVar cvar{&mu};
+    std::mutex mu;
+    std::condition_variable cvar;
     int run_count = 0;
   };
 
   struct Callback {
-    RunState* const state_;  // Pointer to shared state.
+    RunState* const state_;
     bool run = false;
 
     Callback(RunState* s) : state_(s) {}
@@ -105,10 +188,10 @@ TEST_F(EnvTest, RunMany) {
       Callback* callback = reinterpret_cast<Callback*>(arg);
       RunState* state = callback->state_;
 
-      MutexLock l(&state->mu);
+      std::lock_guard<std::mutex> l(state->mu);
       state->run_count++;
       callback->run = true;
-      state->cvar.Signal();
+      state->cvar.notify_one();
     }
   };
 
@@ -117,15 +200,13 @@ TEST_F(EnvTest, RunMany) {
   Callback callback2(&state);
   Callback callback3(&state);
   Callback callback4(&state);
-  env_->Schedule(&Callback::Run, &callback1);
-  env_->Schedule(&Callback::Run, &callback2);
-  env_->Schedule(&Callback::Run, &callback3);
-  env_->Schedule(&Callback::Run, &callback4);
-
-  MutexLock l(&state.mu);
-  while (state.run_count != 4) {
-    state.cvar.Wait();
-  }
+  env_->schedule(&Callback::Run, &callback1);
+  env_->schedule(&Callback::Run, &callback2);
+  env_->schedule(&Callback::Run, &callback3);
+  env_->schedule(&Callback::Run, &callback4);
+
+  std::unique_lock<std::mutex> l(state.mu);
+  state.cvar.wait(l, [&state] { return state.run_count == 4; });
 
   ASSERT_TRUE(callback1.run);
   ASSERT_TRUE(callback2.run);
@@ -133,112 +214,225 @@ TEST_F(EnvTest, RunMany) {
   ASSERT_TRUE(callback4.run);
 }
 
+// Low线程池被长任务占满时, High任务仍然可以执行
+TEST_F(EnvTest, HighPriorityNotBlockedByLow) {
+  struct RunState {
+    std::mutex mu;
+    std::condition_variable cvar;
+    bool low_release = false;
+    int low_done = 0;
+    bool high_done = false;
+
+    static void Low(void* arg) {
+      RunState* state = reinterpret_cast<RunState*>(arg);
+      std::unique_lock<std::mutex> l(state->mu);
+      state->cvar.wait(l, [state] { return state->low_release; });
+      state->low_done++;
+      state->cvar.notify_all();
+    }
+
+    static void High(void* arg) {
+      RunState* state = reinterpret_cast<RunState*>(arg);
+      std::lock_guard<std::mutex> l(state->mu);
+      state->high_done = true;
+      state->cvar.notify_all();
+    }
+  };
+
+  RunState state;
+  const int low_threads = env_->getBackgroundThreads(Env::Priority::Low);
+  for (int i = 0; i < low_threads; i++) {
+    env_->schedule(&RunState::Low, &state, Env::Priority::Low);
+  }
+  env_->schedule(&RunState::High, &state, Env::Priority::High);
+  {
+    std::unique_lock<std::mutex> l(state.mu);
+    state.cvar.wait(l, [&state] { return state.high_done; });
+    ASSERT_EQ(0, state.low_done);
+    state.low_release = true;
+    state.cvar.notify_all();
+    state.cvar.wait(l, [&state, low_threads] { return state.low_done == low_threads; });
+  }
+
+  ThreadPoolStats stats;
+  env_->getThreadPoolStats(Env::Priority::High, &stats);
+  ASSERT_GE(stats.run, 1u);
+  ASSERT_EQ(0u, stats.queue_len);
+}
+
+TEST_F(EnvTest, Unschedule) {
+  struct RunState {
+    std::mutex mu;
+    std::condition_variable cvar;
+    bool release = false;
+    int started = 0;
+    int finished = 0;
+
+    static void Block(void* arg) {
+      RunState* state = reinterpret_cast<RunState*>(arg);
+      std::unique_lock<std::mutex> l(state->mu);
+      state->started++;
+      state->cvar.notify_all();
+      state->cvar.wait(l, [state] { return state->release; });
+      state->finished++;
+      state->cvar.notify_all();
+    }
+  };
+
+  RunState state;
+  env_->setBackgroundThreads(1, Env::Priority::Low);
+  env_->schedule(&RunState::Block, &state, Env::Priority::Low);
+  {
+    std::unique_lock<std::mutex> l(state.mu);
+    state.cvar.wait(l, [&state] { return state.started == 1; });
+  }
+
+  int tag;
+  for (int i = 0; i < 3; i++) {
+    env_->schedule(&RunState::Block, &state, Env::Priority::Low, &tag, [](void* arg) {
+      RunState* state = reinterpret_cast<RunState*>(arg);
+      std::lock_guard<std::mutex> l(state->mu);
+      state->started += 100;
+    });
+  }
+  ASSERT_EQ(3, env_->unschedule(&tag, Env::Priority::Low));
+  ASSERT_EQ(0, env_->unschedule(&tag, Env::Priority::High));
+
+  std::unique_lock<std::mutex> l(state.mu);
+  ASSERT_EQ(301, state.started);
+  state.release = true;
+  state.cvar.notify_all();
+  state.cvar.wait(l, [&state] { return state.finished == 1; });
+}
+
 struct State {
-  port::Mutex mu;
-  port::CondVar cvar{&mu};
+  std::mutex mu;
+  std::condition_variable cvar;
 
-  int val GUARDED_BY(mu);
-  int num_running GUARDED_BY(mu);
+  int val;  // 由mu保护
+  int num_running;  // 由mu保护
 
   State(int val, int num_running) : val(val), num_running(num_running) {}
 };
 
 static void ThreadBody(void* arg) {
   State* s = reinterpret_cast<State*>(arg);
-  s->mu.Lock();
+  std::lock_guard<std::mutex> l(s->mu);
   s->val += 1;
   s->num_running -= 1;
-  s->cvar.Signal();
-  s->mu.Unlock();
+  s->cvar.notify_one();
 }
 
 TEST_F(EnvTest, StartThread) {
   State state(0, 3);
   for (int i = 0; i < 3; i++) {
-    env_->StartThread(&ThreadBody, &state);
+    env_->startThread(&ThreadBody, &state);
   }
 
-  MutexLock l(&state.mu);
-  while (state.num_running != 0) {
-    state.cvar.Wait();
-  }
+  std::unique_lock<std::mutex> l(state.mu);
+  state.cvar.wait(l, [&state] { return state.num_running == 0; });
   ASSERT_EQ(state.val, 3);
 }
 
 TEST_F(EnvTest, TestOpenNonExistentFile) {
-  // Write some test data to a single file that will be opened |n| times.
   std::string test_dir;
-  ASSERT_LEVELDB_OK(env_->GetTestDirectory(&test_dir));
+  ASSERT_TRUE(env_->getTestDirectory(&test_dir).ok());
 
   std::string non_existent_file = test_dir + "/non_existent_file";
-  ASSERT_TRUE(!env_->FileExists(non_existent_file));
+  ASSERT_TRUE(!env_->fileExists(non_existent_file));
 
   RandomAccessFile* random_access_file;
-  Status status =
-      env_->NewRandomAccessFile(non_existent_file, &random_access_file);
-#if defined(LEVELDB_PLATFORM_CHROMIUM)
-  // TODO(crbug.com/760362): See comment in MakeIOError() from env_chromium.cc.
-  ASSERT_TRUE(status.IsIOError());
-#else
-  ASSERT_TRUE(status.IsNotFound());
-#endif  // defined(LEVELDB_PLATFORM_CHROMIUM)
+  Status status = env_->newRandomAccessFile(non_existent_file, &random_access_file);
+  ASSERT_TRUE(status.isNotFound());
 
   SequentialFile* sequential_file;
-  status = env_->NewSequentialFile(non_existent_file, &sequential_file);
-#if defined(LEVELDB_PLATFORM_CHROMIUM)
-  // TODO(crbug.com/760362): See comment in MakeIOError() from env_chromium.cc.
-  ASSERT_TRUE(status.IsIOError());
-#else
-  ASSERT_TRUE(status.IsNotFound());
-#endif  // defined(LEVELDB_PLATFORM_CHROMIUM)
+  status = env_->newSequentialFile(non_existent_file, &sequential_file);
+  ASSERT_TRUE(status.isNotFound());
 }
 
 TEST_F(EnvTest, ReopenWritableFile) {
   std::string test_dir;
-  ASSERT_LEVELDB_OK(env_->GetTestDirectory(&test_dir));
+  ASSERT_TRUE(env_->getTestDirectory(&test_dir).ok());
   std::string test_file_name = test_dir + "/reopen_writable_file.txt";
-  env_->RemoveFile(test_file_name);
+  env_->removeFile(test_file_name);
 
   WritableFile* writable_file;
-  ASSERT_LEVELDB_OK(env_->NewWritableFile(test_file_name, &writable_file));
+  ASSERT_TRUE(env_->newWritableFile(test_file_name, &writable_file).ok());
   std::string data("hello world!");
-  ASSERT_LEVELDB_OK(writable_file->Append(data));
-  ASSERT_LEVELDB_OK(writable_file->Close());
+  ASSERT_TRUE(writable_file->append(data).ok());
+  ASSERT_TRUE(writable_file->close().ok());
   delete writable_file;
 
-  ASSERT_LEVELDB_OK(env_->NewWritableFile(test_file_name, &writable_file));
+  ASSERT_TRUE(env_->newWritableFile(test_file_name, &writable_file).ok());
   data = "42";
-  ASSERT_LEVELDB_OK(writable_file->Append(data));
-  ASSERT_LEVELDB_OK(writable_file->Close());
+  ASSERT_TRUE(writable_file->append(data).ok());
+  ASSERT_TRUE(writable_file->close().ok());
   delete writable_file;
 
-  ASSERT_LEVELDB_OK(ReadFileToString(env_, test_file_name, &data));
+  ASSERT_TRUE(ReadFileToString(env_, test_file_name, &data).ok());
   ASSERT_EQ(std::string("42"), data);
-  env_->RemoveFile(test_file_name);
+  env_->removeFile(test_file_name);
 }
 
 TEST_F(EnvTest, ReopenAppendableFile) {
   std::string test_dir;
-  ASSERT_LEVELDB_OK(env_->GetTestDirectory(&test_dir));
+  ASSERT_TRUE(env_->getTestDirectory(&test_dir).ok());
   std::string test_file_name = test_dir + "/reopen_appendable_file.txt";
-  env_->RemoveFile(test_file_name);
+  env_->removeFile(test_file_name);
 
   WritableFile* appendable_file;
-  ASSERT_LEVELDB_OK(env_->NewAppendableFile(test_file_name, &appendable_file));
+  ASSERT_TRUE(env_->newAppendableFile(test_file_name, &appendable_file).ok());
   std::string data("hello world!");
-  ASSERT_LEVELDB_OK(appendable_file->Append(data));
-  ASSERT_LEVELDB_OK(appendable_file->Close());
+  ASSERT_TRUE(appendable_file->append(data).ok());
+  ASSERT_TRUE(appendable_file->close().ok());
   delete appendable_file;
 
-  ASSERT_LEVELDB_OK(env_->NewAppendableFile(test_file_name, &appendable_file));
+  ASSERT_TRUE(env_->newAppendableFile(test_file_name, &appendable_file).ok());
   data = "42";
-  ASSERT_LEVELDB_OK(appendable_file->Append(data));
-  ASSERT_LEVELDB_OK(appendable_file->Close());
+  ASSERT_TRUE(appendable_file->append(data).ok());
+  ASSERT_TRUE(appendable_file->close().ok());
   delete appendable_file;
 
-  ASSERT_LEVELDB_OK(ReadFileToString(env_, test_file_name, &data));
+  ASSERT_TRUE(ReadFileToString(env_, test_file_name, &data).ok());
   ASSERT_EQ(std::string("hello world!42"), data);
-  env_->RemoveFile(test_file_name);
+  env_->removeFile(test_file_name);
+}
+
+// 同一个进程不能重复锁定同一个文件, 解锁后可以再次锁定
+TEST_F(EnvTest, LockFile) {
+  std::string test_dir;
+  ASSERT_TRUE(env_->getTestDirectory(&test_dir).ok());
+  std::string lock_file_name = test_dir + "/LOCK";
+
+  FileLock* lock;
+  ASSERT_TRUE(env_->lockFile(lock_file_name, &lock).ok());
+  FileLock* lock2;
+  ASSERT_TRUE(env_->lockFile(lock_file_name, &lock2).isIOError());
+  ASSERT_TRUE(env_->unlockFile(lock).ok());
+  ASSERT_TRUE(env_->lockFile(lock_file_name, &lock2).ok());
+  ASSERT_TRUE(env_->unlockFile(lock2).ok());
+  env_->removeFile(lock_file_name);
+}
+
+TEST_F(EnvTest, Directories) {
+  std::string test_dir;
+  ASSERT_TRUE(env_->getTestDirectory(&test_dir).ok());
+  const std::string dir = test_dir + "/children";
+  ASSERT_TRUE(env_->createDir(dir).ok());
+  ASSERT_TRUE(WriteStringToFile(env_, "abc", dir + "/a").ok());
+  ASSERT_TRUE(env_->renameFile(dir + "/a", dir + "/b").ok());
+
+  std::vector<std::string> children;
+  ASSERT_TRUE(env_->getChildren(dir, &children).ok());
+  ASSERT_TRUE(std::find(children.begin(), children.end(), "b") != children.end());
+  ASSERT_TRUE(std::find(children.begin(), children.end(), "a") == children.end());
+  uint64_t size;
+  ASSERT_TRUE(env_->getFileSize(dir + "/b", &size).ok());
+  ASSERT_EQ(3u, size);
+
+  ASSERT_TRUE(env_->removeFile(dir + "/b").ok());
+  ASSERT_TRUE(env_->removeDir(dir).ok());
+  ASSERT_TRUE(!env_->fileExists(dir));
 }
 
-}  // namespace leveldb
+}  // namespace kvstorage
@@ -0,0 +1,107 @@
+#include "hash_link_list.h"
+
+#include <set>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "util/arena.h"
+#include "util/concurrent_arena.h"
+#include "util/random.h"
+
+namespace kvstorage {
+
+typedef uint64_t Key;
+
+// 按key / 100分桶, 同一个桶中的键按大小排序
+struct Comparator {
+  int operator()(const Key& a, const Key& b) const {
+    if (a < b) {
+      return -1;
+    } else if (a > b) {
+      return +1;
+    } else {
+      return 0;
+    }
+  }
+  uint32_t keyHash(const Key& k) const { return static_cast<uint32_t>(k / 100); }
+};
+
+TEST(HashLinkListTest, Empty) {
+  Arena arena;
+  Comparator cmp;
+  HashLinkList<Key, Comparator> list(cmp, &arena, 16);
+  ASSERT_TRUE(!list.contains(10));
+  Key result;
+  ASSERT_TRUE(!list.seek(10, &result));
+  std::vector<Key> keys;
+  list.sortedKeys(&keys);
+  ASSERT_TRUE(keys.empty());
+}
+
+TEST(HashLinkListTest, InsertAndLookup) {
+  const int N = 2000;
+  const Key R = 5000;
+  Random rnd(1000);
+  std::set<Key> keys;
+  Arena arena;
+  Comparator cmp;
+  // 桶的数量少于哈希值的种类, 不同哈希值的键也会落到同一个桶中
+  HashLinkList<Key, Comparator> list(cmp, &arena, 13);
+  for (int i = 0; i < N; i++) {
+    Key key = rnd.uniform(R);
+    if (keys.insert(key).second) {
+      list.insert(key);
+    }
+  }
+  ASSERT_EQ(keys.size(), list.count());
+
+  for (Key i = 0; i < R; i++) {
+    ASSERT_EQ(keys.count(i) == 1, list.contains(i)) << i;
+
+    // seek返回桶内第一个>= i的键, 哈希相同的键中它一定是第一个>= i的键
+    Key result;
+    std::set<Key>::iterator model = keys.lower_bound(i);
+    if (model != keys.end() && *model / 100 == i / 100) {
+      ASSERT_TRUE(list.seek(i, &result));
+      ASSERT_EQ(*model, result);
+    }
+  }
+
+  std::vector<Key> sorted;
+  list.sortedKeys(&sorted);
+  ASSERT_EQ(std::vector<Key>(keys.begin(), keys.end()), sorted);
+}
+
+TEST(HashLinkListTest, ConcurrentInsert) {
+  const int kWriters = 4;
+  const int kPerWriter = 5000;
+  ConcurrentArena arena;
+  Comparator cmp;
+  HashLinkList<Key, Comparator, ConcurrentArena> list(cmp, &arena, 64);
+
+  std::vector<std::thread> writers;
+  for (int t = 0; t < kWriters; t++) {
+    writers.emplace_back([&list, t] {
+      for (int i = 0; i < kPerWriter; i++) {
+        list.concurrentInsert(static_cast<Key>(i) * kWriters + t);
+      }
+    });
+  }
+  for (auto& w : writers) {
+    w.join();
+  }
+
+  const Key total = static_cast<Key>(kWriters) * kPerWriter;
+  ASSERT_EQ(total, list.count());
+  for (Key k = 0; k < total; k++) {
+    ASSERT_TRUE(list.contains(k)) << k;
+  }
+  std::vector<Key> sorted;
+  list.sortedKeys(&sorted);
+  for (Key k = 0; k < total; k++) {
+    ASSERT_EQ(k, sorted[k]);
+  }
+}
+
+}  // namespace kvstorage
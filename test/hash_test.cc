@@ -0,0 +1,96 @@
+#include "hash.h"
+
+#include <set>
+#include <string>
+
+#include "gtest/gtest.h"
+#include "util/random.h"
+
+namespace kvstorage {
+
+static std::string RandomBytes(Random* rnd, size_t n) {
+  std::string s(n, '\0');
+  for (size_t i = 0; i < n; i++) {
+    s[i] = static_cast<char>(rnd->next());
+  }
+  return s;
+}
+
+// 覆盖短键, 中等长度和长键的所有分支, 以及长键中整块之后剩余的条带
+static const size_t s_lengths[] = {0, 1, 2, 3, 4, 5, 8, 9, 15, 16, 17, 32, 33, 64, 65, 96, 97, 128, 129, 200,
+                                   240, 241, 255, 256, 1023, 1024, 1025, 2048, 3000, 5000};
+
+TEST(Hash, Hash64PinnedValues) {
+  // 哈希值可能被持久化, 修改算法时这里会失败
+  ASSERT_EQ(0xf39e5cee5b5d45c1ull, Hash64("", 0));
+  ASSERT_EQ(0xf9fdc5121fc38ecbull, Hash64("a", 1));
+  ASSERT_EQ(0x7c5a36f22e67aad4ull, Hash64("hello world", 11));
+  ASSERT_EQ(0x41fb8cee0cd363d2ull, Hash64("hello world", 11, 42));
+  std::string long_key(1000, 'x');
+  ASSERT_EQ(0xba7012b6416f1b76ull, Hash64(long_key.data(), long_key.size()));
+  Hash128Value v = Hash128(long_key.data(), long_key.size(), 7);
+  ASSERT_EQ(0xb240f358ad637faeull, v.low);
+  ASSERT_EQ(0xb2414a8bb3459086ull, v.high);
+}
+
+TEST(Hash, IndependentOfAlignment) {
+  Random rnd(301);
+  std::string data = RandomBytes(&rnd, 5000);
+  for (size_t n : s_lengths) {
+    const uint64_t expected = Hash64(data.data(), n, 99);
+    const Hash128Value expected128 = Hash128(data.data(), n, 99);
+    for (size_t offset = 1; offset < 16; offset++) {
+      std::string copy(offset, '\0');
+      copy.append(data, 0, n);
+      ASSERT_EQ(expected, Hash64(copy.data() + offset, n, 99)) << n << " " << offset;
+      const Hash128Value actual = Hash128(copy.data() + offset, n, 99);
+      ASSERT_EQ(expected128.low, actual.low);
+      ASSERT_EQ(expected128.high, actual.high);
+    }
+  }
+}
+
+TEST(Hash, SeedAndLengthChangeResult) {
+  Random rnd(1000);
+  std::string data = RandomBytes(&rnd, 5000);
+  std::set<uint64_t> seen;
+  std::set<uint64_t> seen128;
+  for (size_t n = 0; n <= data.size(); n++) {
+    // 同一缓冲区的所有前缀, 以及不同的种子
+    ASSERT_TRUE(seen.insert(Hash64(data.data(), n)).second) << n;
+    ASSERT_TRUE(seen.insert(Hash64(data.data(), n, 1)).second) << n;
+    ASSERT_TRUE(seen.insert(Hash64(data.data(), n, 0xdeadbeefcafeull)).second) << n;
+    const Hash128Value v = Hash128(data.data(), n, 3);
+    ASSERT_NE(v.low, v.high);
+    ASSERT_TRUE(seen128.insert(v.high).second) << n;
+  }
+}
+
+// 输入中任意一位翻转时, 输出平均约一半的位发生变化
+TEST(Hash, Avalanche) {
+  Random rnd(42);
+  for (size_t n : s_lengths) {
+    if (n == 0) {
+      continue;
+    }
+    std::string data = RandomBytes(&rnd, n);
+    const uint64_t base = Hash64(data.data(), n);
+    const uint64_t base_high = Hash128(data.data(), n).high;
+    const int trials = 200;
+    int changed = 0;
+    int changed_high = 0;
+    for (int t = 0; t < trials; t++) {
+      const size_t bit = rnd.uniform(static_cast<int>(n * 8));
+      data[bit / 8] ^= static_cast<char>(1 << (bit % 8));
+      changed += __builtin_popcountll(base ^ Hash64(data.data(), n));
+      changed_high += __builtin_popcountll(base_high ^ Hash128(data.data(), n).high);
+      data[bit / 8] ^= static_cast<char>(1 << (bit % 8));
+    }
+    ASSERT_GT(changed, trials * 28) << n;
+    ASSERT_LT(changed, trials * 36) << n;
+    ASSERT_GT(changed_high, trials * 28) << n;
+    ASSERT_LT(changed_high, trials * 36) << n;
+  }
+}
+
+}  // namespace kvstorage
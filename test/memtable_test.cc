@@ -0,0 +1,607 @@
+#include "memtable.h"
+
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "coding.h"
+#include "comparator.h"
+#include "db_format.h"
+#include "options.h"
+#include "util/arena_block_pool.h"
+
+namespace kvstorage {
+
+class MemTableTest : public testing::Test {
+ public:
+  MemTableTest() : cmp_(BytewiseComparator()), mem_(new MemTable(cmp_)) { mem_->ref(); }
+  ~MemTableTest() override { mem_->unref(); }
+
+  std::string Get(const std::string& key, SequenceNumber seq) {
+    LookupKey lkey(key, seq);
+    std::string value;
+    Status s;
+    if (!mem_->get(lkey, &value, &s)) {
+      return "MISSING";
+    }
+    return s.ok() ? value : "DELETED";
+  }
+
+  InternalKeyComparator cmp_;
+  MemTable* mem_;
+};
+
+TEST_F(MemTableTest, Empty) {
+  ASSERT_EQ("MISSING", Get("foo", 100));
+  Iterator* iter = mem_->newIterator();
+  iter->seekToFirst();
+  ASSERT_TRUE(!iter->valid());
+  delete iter;
+}
+
+TEST_F(MemTableTest, AddAndGet) {
+  mem_->add(1, ValueType::TypeValue, "foo", "v1");
+  mem_->add(2, ValueType::TypeValue, "bar", "v2");
+  mem_->add(3, ValueType::TypeValue, "foo", "v3");
+  mem_->add(4, ValueType::TypeDeletion, "bar", "");
+
+  ASSERT_EQ("MISSING", Get("foo", 0));
+  ASSERT_EQ("v1", Get("foo", 1));
+  ASSERT_EQ("v1", Get("foo", 2));
+  ASSERT_EQ("v3", Get("foo", 3));
+  ASSERT_EQ("v3", Get("foo", s_max_sequence_number));
+  ASSERT_EQ("v2", Get("bar", 3));
+  ASSERT_EQ("DELETED", Get("bar", 4));
+  ASSERT_EQ("MISSING", Get("baz", 4));
+  ASSERT_EQ("MISSING", Get("fo", 4));
+}
+
+// PinnableSlice直接引用arena中的值, 并持有memtable的引用, 释放之前memtable不会被销毁
+TEST(MemTablePinTest, PinnedGet) {
+  InternalKeyComparator cmp(BytewiseComparator());
+  MemTable* mem = new MemTable(cmp);
+  mem->ref();
+  const std::string big(64 * 1024, 'x');
+  mem->add(1, ValueType::TypeValue, "big", big);
+  mem->add(2, ValueType::TypeValue, "gone", "v");
+  mem->add(3, ValueType::TypeDeletion, "gone", "");
+
+  Status s;
+  PinnableSlice deleted;
+  ASSERT_TRUE(mem->get(LookupKey("gone", 3), &deleted, &s));
+  ASSERT_TRUE(s.isNotFound());
+  ASSERT_TRUE(!deleted.isPinned());
+  PinnableSlice missing;
+  ASSERT_TRUE(!mem->get(LookupKey("missing", 3), &missing, &s));
+
+  PinnableSlice value;
+  s = Status::success();
+  ASSERT_TRUE(mem->get(LookupKey("big", 3), &value, &s));
+  ASSERT_TRUE(s.ok());
+  ASSERT_TRUE(value.isPinned());
+  ASSERT_NE(big.data(), value.data());
+  mem->unref();  // 只剩value持有的引用
+  ASSERT_EQ(big.size(), value.size());
+  ASSERT_EQ(big, value.toString());
+  value.reset();  // 释放最后一个引用, memtable被销毁
+}
+
+TEST_F(MemTableTest, LongKey) {
+  // 超过LookupKey内部缓冲区长度的键
+  std::string key(1000, 'k');
+  std::string value(5000, 'v');
+  mem_->add(7, ValueType::TypeValue, key, value);
+  ASSERT_EQ(value, Get(key, 7));
+  ASSERT_EQ("MISSING", Get(key, 6));
+}
+
+TEST_F(MemTableTest, Iterator) {
+  mem_->add(1, ValueType::TypeValue, "b", "vb1");
+  mem_->add(2, ValueType::TypeValue, "a", "va2");
+  mem_->add(3, ValueType::TypeValue, "b", "vb3");
+
+  Iterator* iter = mem_->newIterator();
+  iter->seekToFirst();
+  ASSERT_TRUE(iter->valid());
+  ASSERT_EQ("a", ExtractUserKey(iter->key()).toString());
+  ASSERT_EQ("va2", iter->value().toString());
+  iter->next();
+  // 同一个user_key按序列号降序排列
+  ASSERT_TRUE(iter->valid());
+  ASSERT_EQ(InternalKey("b", 3, ValueType::TypeValue).encode().toString(), iter->key().toString());
+  ASSERT_EQ("vb3", iter->value().toString());
+  iter->next();
+  ASSERT_TRUE(iter->valid());
+  ASSERT_EQ("vb1", iter->value().toString());
+  iter->next();
+  ASSERT_TRUE(!iter->valid());
+
+  iter->seek(InternalKey("b", 2, s_value_type_for_seek).encode());
+  ASSERT_TRUE(iter->valid());
+  ASSERT_EQ("vb1", iter->value().toString());
+  iter->prev();
+  ASSERT_TRUE(iter->valid());
+  ASSERT_EQ("vb3", iter->value().toString());
+  delete iter;
+}
+
+// 结点缓存user_key的前8字节, 前缀相同或键长不足8字节时仍然按字节序排列
+TEST_F(MemTableTest, KeyPrefixOrder) {
+  std::vector<std::string> keys = {"", "a", std::string("a\0", 2), "ab", "abcdefgh", "abcdefgh1",
+                                   "abcdefgh\xff", "abcdefgi", "abcdefh", "b", "\xff\xff\xff\xff\xff\xff\xff\xff\xff"};
+  // 乱序插入
+  for (size_t i = 0; i < keys.size(); i++) {
+    size_t idx = (i * 7) % keys.size();
+    mem_->add(i + 1, ValueType::TypeValue, keys[idx], keys[idx]);
+  }
+  Iterator* iter = mem_->newIterator();
+  iter->seekToFirst();
+  for (const std::string& k : keys) {
+    ASSERT_TRUE(iter->valid());
+    ASSERT_EQ(k, ExtractUserKey(iter->key()).toString());
+    iter->next();
+  }
+  ASSERT_TRUE(!iter->valid());
+  delete iter;
+  for (const std::string& k : keys) {
+    ASSERT_EQ(k, Get(k, s_max_sequence_number));
+  }
+  ASSERT_EQ("MISSING", Get("abcdefgh0", s_max_sequence_number));
+}
+
+// 非BytewiseComparator的用户比较器通过虚函数比较, 顺序与按字节比较相反
+class ReverseComparator : public Comparator {
+ public:
+  const char* name() const override { return "test.ReverseComparator"; }
+  int compare(const Slice& a, const Slice& b) const override { return -a.compare(b); }
+  void findShortestSeparator(std::string*, const Slice&) const override {}
+  void findShortSuccessor(std::string*) const override {}
+};
+
+TEST(MemTableComparatorTest, UserComparator) {
+  ReverseComparator reverse;
+  InternalKeyComparator cmp(&reverse);
+  ASSERT_TRUE(!cmp.isBytewise());
+  ASSERT_TRUE(InternalKeyComparator(BytewiseComparator()).isBytewise());
+
+  MemTable* mem = new MemTable(cmp);
+  mem->ref();
+  std::vector<std::string> keys = {"a", "ab", "abcdefgh", "abcdefgh1", "b"};
+  for (size_t i = 0; i < keys.size(); i++) {
+    mem->add(i + 1, ValueType::TypeValue, keys[i], keys[i]);
+  }
+  mem->add(keys.size() + 1, ValueType::TypeDeletion, "ab", "");
+
+  Iterator* iter = mem->newIterator();
+  iter->seekToFirst();
+  for (auto it = keys.rbegin(); it != keys.rend(); ++it) {
+    ASSERT_TRUE(iter->valid());
+    ASSERT_EQ(*it, ExtractUserKey(iter->key()).toString());
+    iter->next();
+    if (*it == "ab") {
+      // 同一个user_key的记录按序列号降序, 删除标记的序列号更大, 排在前面
+      ASSERT_TRUE(iter->valid());
+      ASSERT_EQ("ab", ExtractUserKey(iter->key()).toString());
+      iter->next();
+    }
+  }
+  ASSERT_TRUE(!iter->valid());
+  delete iter;
+
+  std::string value;
+  Status s;
+  ASSERT_TRUE(mem->get(LookupKey("abcdefgh", s_max_sequence_number), &value, &s));
+  ASSERT_EQ("abcdefgh", value);
+  ASSERT_TRUE(mem->get(LookupKey("ab", s_max_sequence_number), &value, &s));
+  ASSERT_TRUE(s.isNotFound());
+  ASSERT_TRUE(!mem->get(LookupKey("abc", s_max_sequence_number), &value, &s));
+  mem->unref();
+}
+
+static std::string Uint64Key(uint64_t v) {
+  char buf[8];
+  EncodeBigEndian64(buf, v);
+  return std::string(buf, sizeof(buf));
+}
+
+TEST(MemTableComparatorTest, Uint64KeyOrder) {
+  const Comparator* cmp = Uint64KeyComparator();
+  const uint64_t values[] = {0, 1, 255, 256, 0x0102030405060708ull, 0x8000000000000000ull, ~0ull};
+  for (uint64_t a : values) {
+    for (uint64_t b : values) {
+      const int expected = (a < b) ? -1 : (a > b) ? 1 : 0;
+      ASSERT_EQ(expected, cmp->compare(Uint64Key(a), Uint64Key(b)));
+      ASSERT_EQ(expected, BytewiseComparator()->compare(Uint64Key(a), Uint64Key(b)) < 0 ? -1
+                          : BytewiseComparator()->compare(Uint64Key(a), Uint64Key(b)) > 0 ? 1 : 0);
+    }
+  }
+  // 分隔符和后继保持8字节
+  std::string start = Uint64Key(100);
+  cmp->findShortestSeparator(&start, Uint64Key(0x0100000000000000ull));
+  ASSERT_EQ(Uint64Key(100), start);
+  std::string key = Uint64Key(100);
+  cmp->findShortSuccessor(&key);
+  ASSERT_EQ(Uint64Key(100), key);
+}
+
+// 定长的user_key加上规范化tag之后, 按字节比较的顺序与InternalKeyComparator相同
+TEST(MemTableComparatorTest, NormalizedTag) {
+  InternalKeyComparator cmp(Uint64KeyComparator());
+  const uint64_t keys[] = {0, 1, 256, ~0ull};
+  const SequenceNumber seqs[] = {0, 1, 255, 256, s_max_sequence_number};
+  std::vector<std::string> internal_keys;
+  std::vector<std::string> normalized_keys;
+  for (uint64_t k : keys) {
+    for (SequenceNumber seq : seqs) {
+      for (ValueType t : {ValueType::TypeDeletion, ValueType::TypeValue}) {
+        InternalKey ikey(Uint64Key(k), seq, t);
+        internal_keys.push_back(ikey.encode().toString());
+        char tag[8];
+        EncodeNormalizedTag(tag, (seq << 8) | static_cast<uint64_t>(t));
+        ASSERT_EQ((seq << 8) | static_cast<uint64_t>(t), DecodeNormalizedTag(tag));
+        normalized_keys.push_back(Uint64Key(k) + std::string(tag, sizeof(tag)));
+      }
+    }
+  }
+  for (size_t i = 0; i < internal_keys.size(); i++) {
+    for (size_t j = 0; j < internal_keys.size(); j++) {
+      const int expected = cmp.compare(internal_keys[i], internal_keys[j]);
+      const int actual = Slice(normalized_keys[i]).compare(normalized_keys[j]);
+      ASSERT_EQ(expected < 0, actual < 0) << i << " " << j;
+      ASSERT_EQ(expected == 0, actual == 0) << i << " " << j;
+    }
+  }
+}
+
+// 用户键固定为8字节时记录中省略键的长度前缀, 三种索引结构都需要支持
+TEST(MemTableComparatorTest, Uint64Keys) {
+  InternalKeyComparator cmp(Uint64KeyComparator());
+  ASSERT_TRUE(cmp.isUint64());
+  ASSERT_TRUE(cmp.isBytewise());
+
+  for (MemTableRepType rep :
+       {MemTableRepType::SkipList, MemTableRepType::HashLinkList, MemTableRepType::AdaptiveRadixTree}) {
+    Options options;
+    options.memtable_rep = rep;
+    options.memtable_hash_bucket_count = 13;
+    MemTable* mem = new MemTable(cmp, options);
+    mem->ref();
+    const int n = 1000;
+    for (int i = 0; i < n; i++) {
+      const uint64_t v = (static_cast<uint64_t>(i * 7919 % n) << 40) + 3;  // 乱序插入, 高位字节不同
+      mem->add(i + 1, ValueType::TypeValue, Uint64Key(v), "v" + std::to_string(v));
+    }
+    mem->add(n + 1, ValueType::TypeDeletion, Uint64Key(3), "");
+
+    std::string value;
+    Status s;
+    ASSERT_TRUE(mem->get(LookupKey(Uint64Key((5ull << 40) + 3), s_max_sequence_number), &value, &s));
+    ASSERT_EQ("v" + std::to_string((5ull << 40) + 3), value);
+    ASSERT_TRUE(mem->get(LookupKey(Uint64Key(3), s_max_sequence_number), &value, &s));
+    ASSERT_TRUE(s.isNotFound());
+    ASSERT_TRUE(mem->get(LookupKey(Uint64Key(3), n), &value, &s));  // 删除之前的快照
+    ASSERT_EQ("v3", value);
+    ASSERT_TRUE(!mem->get(LookupKey(Uint64Key(4), s_max_sequence_number), &value, &s));
+    ASSERT_TRUE(!mem->get(LookupKey("short", s_max_sequence_number), &value, &s));
+
+    Iterator* iter = mem->newIterator();
+    iter->seekToFirst();
+    ASSERT_TRUE(iter->valid());
+    ASSERT_EQ(Uint64Key(3), ExtractUserKey(iter->key()).toString());
+    iter->next();  // 删除标记之后是同一个键的旧值
+    ASSERT_TRUE(iter->valid());
+    ASSERT_EQ(Uint64Key(3), ExtractUserKey(iter->key()).toString());
+    ASSERT_EQ("v3", iter->value().toString());
+    ParsedInternalKey parsed;  // 记录中的规范化tag还原为InternalKey的格式
+    ASSERT_TRUE(ParseInternalKey(iter->key(), &parsed));
+    ASSERT_EQ(1u, parsed.sequence);
+    ASSERT_EQ(ValueType::TypeValue, parsed.type);
+    iter->next();
+    for (int i = 1; i < n; i++) {
+      ASSERT_TRUE(iter->valid());
+      const uint64_t v = (static_cast<uint64_t>(i) << 40) + 3;
+      ASSERT_EQ(Uint64Key(v), ExtractUserKey(iter->key()).toString()) << i;
+      ASSERT_EQ("v" + std::to_string(v), iter->value().toString());
+      iter->next();
+    }
+    ASSERT_TRUE(!iter->valid());
+
+    InternalKey target(Uint64Key(500ull << 40), s_max_sequence_number, s_value_type_for_seek);
+    iter->seek(target.encode());
+    ASSERT_TRUE(iter->valid());
+    ASSERT_EQ(Uint64Key((500ull << 40) + 3), ExtractUserKey(iter->key()).toString());
+    delete iter;
+    mem->unref();
+  }
+}
+
+// 键定长的格式无法保存其他长度的键, 写入必须被拒绝而不是产生无法解码的记录
+TEST(MemTableComparatorTest, Uint64KeysRejectOtherLengths) {
+  InternalKeyComparator cmp(Uint64KeyComparator());
+  for (MemTableRepType rep :
+       {MemTableRepType::SkipList, MemTableRepType::HashLinkList, MemTableRepType::AdaptiveRadixTree}) {
+    Options options;
+    options.memtable_rep = rep;
+    MemTable* mem = new MemTable(cmp, options);
+    mem->ref();
+    const size_t usage = mem->approximateMemoryUsage();
+    ASSERT_TRUE(mem->add(1, ValueType::TypeValue, "short", "v").isInvalidArgument());
+    ASSERT_TRUE(mem->add(2, ValueType::TypeValue, "ninebytes", "v").isInvalidArgument());
+    ASSERT_TRUE(mem->concurrentAdd(3, ValueType::TypeValue, "", "v").isInvalidArgument());
+    ASSERT_EQ(usage, mem->approximateMemoryUsage());
+    ASSERT_TRUE(mem->add(4, ValueType::TypeValue, Uint64Key(7), "v7").ok());
+
+    Iterator* iter = mem->newIterator();
+    iter->seekToFirst();
+    ASSERT_TRUE(iter->valid());
+    ASSERT_EQ(Uint64Key(7), ExtractUserKey(iter->key()).toString());
+    iter->next();
+    ASSERT_TRUE(!iter->valid());
+    delete iter;
+    mem->unref();
+  }
+}
+
+TEST(MemTableArenaTest, HugePage) {
+  InternalKeyComparator cmp(BytewiseComparator());
+  MemTable* mem = new MemTable(cmp, 1 << 20, true);
+  mem->ref();
+  std::string value(100, 'x');
+  for (int i = 0; i < 10000; i++) {
+    mem->add(i + 1, ValueType::TypeValue, std::to_string(i), value);
+  }
+  LookupKey lkey("1234", s_max_sequence_number);
+  std::string result;
+  Status s;
+  ASSERT_TRUE(mem->get(lkey, &result, &s));
+  ASSERT_EQ(value, result);
+  ASSERT_GE(mem->approximateMemoryUsage(), Arena::s_huge_page_size);
+  mem->unref();
+}
+
+// 前一个memtable销毁后, 下一个memtable复用它归还的内存块
+TEST(MemTableArenaTest, BlockPool) {
+  InternalKeyComparator cmp(BytewiseComparator());
+  ArenaBlockPool pool(16 << 20);
+  std::string value(100, 'x');
+  for (int round = 0; round < 2; round++) {
+    MemTable* mem = new MemTable(cmp, 64 * 1024, false, &pool);
+    mem->ref();
+    for (int i = 0; i < 10000; i++) {
+      mem->add(i + 1, ValueType::TypeValue, std::to_string(i), value);
+    }
+    mem->unref();
+  }
+  ASSERT_GT(pool.hits(), 0);
+  ASSERT_GT(pool.retainedBytes(), 0);
+}
+
+TEST_F(MemTableTest, MemoryUsage) {
+  const size_t start = mem_->approximateMemoryUsage();
+  std::string value(100, 'x');
+  for (int i = 0; i < 10000; i++) {
+    mem_->add(i + 1, ValueType::TypeValue, std::to_string(i), value);
+  }
+  // 至少包含所有记录的数据
+  ASSERT_GE(mem_->approximateMemoryUsage(), start + 10000 * value.size());
+}
+
+// 多个写线程同时通过concurrentAdd写入, 之后所有记录都可以读到
+TEST_F(MemTableTest, ConcurrentAdd) {
+  const int kThreads = 4;
+  const int kPerThread = 5000;
+  std::vector<std::thread> threads;
+  for (int t = 0; t < kThreads; t++) {
+    threads.emplace_back([this, t] {
+      for (int i = 0; i < kPerThread; i++) {
+        SequenceNumber seq = static_cast<SequenceNumber>(i) * kThreads + t + 1;
+        std::string key = "k" + std::to_string(seq % 1000);
+        mem_->concurrentAdd(seq, ValueType::TypeValue, key, std::to_string(seq));
+      }
+    });
+  }
+  for (auto& th : threads) {
+    th.join();
+  }
+
+  const SequenceNumber last = static_cast<SequenceNumber>(kPerThread) * kThreads;
+  for (int k = 0; k < 1000; k++) {
+    // 每个键最新的序列号是最后一个模1000等于k的序列号
+    SequenceNumber expected = last - ((last - k) % 1000);
+    ASSERT_EQ(std::to_string(expected), Get("k" + std::to_string(k), s_max_sequence_number));
+  }
+
+  int count = 0;
+  Iterator* iter = mem_->newIterator();
+  for (iter->seekToFirst(); iter->valid(); iter->next()) {
+    count++;
+  }
+  delete iter;
+  ASSERT_EQ(last, count);
+}
+
+// 使用HashLinkList作为索引的memtable, 桶的数量很少, 保证有大量哈希冲突
+class MemTableHashTest : public MemTableTest {
+ public:
+  MemTableHashTest() {
+    mem_->unref();
+    Options options;
+    options.memtable_rep = MemTableRepType::HashLinkList;
+    options.memtable_hash_bucket_count = 7;
+    mem_ = new MemTable(cmp_, options);
+    mem_->ref();
+  }
+};
+
+TEST_F(MemTableHashTest, AddAndGet) {
+  mem_->add(1, ValueType::TypeValue, "foo", "v1");
+  mem_->add(2, ValueType::TypeValue, "bar", "v2");
+  mem_->add(3, ValueType::TypeValue, "foo", "v3");
+  mem_->add(4, ValueType::TypeDeletion, "bar", "");
+
+  ASSERT_EQ("MISSING", Get("foo", 0));
+  ASSERT_EQ("v1", Get("foo", 1));
+  ASSERT_EQ("v3", Get("foo", 3));
+  ASSERT_EQ("v2", Get("bar", 3));
+  ASSERT_EQ("DELETED", Get("bar", 4));
+  ASSERT_EQ("MISSING", Get("baz", 4));
+
+  std::string value(100, 'x');
+  for (int i = 0; i < 1000; i++) {
+    mem_->add(i + 10, ValueType::TypeValue, std::to_string(i), value + std::to_string(i));
+  }
+  for (int i = 0; i < 1000; i++) {
+    ASSERT_EQ(value + std::to_string(i), Get(std::to_string(i), s_max_sequence_number));
+    ASSERT_EQ("MISSING", Get(std::to_string(i), i + 9));
+  }
+}
+
+// 有序遍历的结果应当和使用跳表时相同
+TEST_F(MemTableHashTest, Iterator) {
+  MemTable* skiplist_mem = new MemTable(cmp_);
+  skiplist_mem->ref();
+  for (int i = 0; i < 1000; i++) {
+    std::string key = std::to_string(i % 300);
+    ValueType type = (i % 7 == 0) ? ValueType::TypeDeletion : ValueType::TypeValue;
+    mem_->add(i + 1, type, key, std::to_string(i));
+    skiplist_mem->add(i + 1, type, key, std::to_string(i));
+  }
+
+  Iterator* iter = mem_->newIterator();
+  Iterator* expected = skiplist_mem->newIterator();
+  int count = 0;
+  for (iter->seekToFirst(), expected->seekToFirst(); expected->valid(); iter->next(), expected->next()) {
+    ASSERT_TRUE(iter->valid());
+    ASSERT_EQ(expected->key().toString(), iter->key().toString());
+    ASSERT_EQ(expected->value().toString(), iter->value().toString());
+    count++;
+  }
+  ASSERT_TRUE(!iter->valid());
+  ASSERT_EQ(1000, count);
+
+  iter->seek(InternalKey("150", s_max_sequence_number, s_value_type_for_seek).encode());
+  expected->seek(InternalKey("150", s_max_sequence_number, s_value_type_for_seek).encode());
+  ASSERT_TRUE(iter->valid());
+  ASSERT_EQ(expected->key().toString(), iter->key().toString());
+  iter->prev();
+  expected->prev();
+  ASSERT_EQ(expected->key().toString(), iter->key().toString());
+
+  iter->seekToLast();
+  expected->seekToLast();
+  ASSERT_EQ(expected->key().toString(), iter->key().toString());
+  delete expected;
+  delete iter;
+  skiplist_mem->unref();
+}
+
+TEST_F(MemTableHashTest, ConcurrentAdd) {
+  const int kThreads = 4;
+  const int kPerThread = 5000;
+  std::vector<std::thread> threads;
+  for (int t = 0; t < kThreads; t++) {
+    threads.emplace_back([this, t] {
+      for (int i = 0; i < kPerThread; i++) {
+        SequenceNumber seq = static_cast<SequenceNumber>(i) * kThreads + t + 1;
+        std::string key = "k" + std::to_string(seq % 1000);
+        mem_->concurrentAdd(seq, ValueType::TypeValue, key, std::to_string(seq));
+      }
+    });
+  }
+  for (auto& th : threads) {
+    th.join();
+  }
+
+  const SequenceNumber last = static_cast<SequenceNumber>(kPerThread) * kThreads;
+  for (int k = 0; k < 1000; k++) {
+    SequenceNumber expected = last - ((last - k) % 1000);
+    ASSERT_EQ(std::to_string(expected), Get("k" + std::to_string(k), s_max_sequence_number));
+  }
+}
+
+// 使用AdaptiveRadixTree作为索引的memtable
+class MemTableArtTest : public MemTableTest {
+ public:
+  MemTableArtTest() {
+    mem_->unref();
+    Options options;
+    options.memtable_rep = MemTableRepType::AdaptiveRadixTree;
+    mem_ = new MemTable(cmp_, options);
+    mem_->ref();
+  }
+};
+
+TEST_F(MemTableArtTest, AddAndGet) {
+  mem_->add(1, ValueType::TypeValue, "foo", "v1");
+  mem_->add(2, ValueType::TypeValue, "bar", "v2");
+  mem_->add(3, ValueType::TypeValue, "foo", "v3");
+  mem_->add(4, ValueType::TypeDeletion, "bar", "");
+  mem_->add(5, ValueType::TypeValue, "fo", "v5");
+
+  ASSERT_EQ("MISSING", Get("foo", 0));
+  ASSERT_EQ("v1", Get("foo", 1));
+  ASSERT_EQ("v1", Get("foo", 2));
+  ASSERT_EQ("v3", Get("foo", 3));
+  ASSERT_EQ("v2", Get("bar", 3));
+  ASSERT_EQ("DELETED", Get("bar", 4));
+  ASSERT_EQ("MISSING", Get("baz", 4));
+  ASSERT_EQ("v5", Get("fo", 5));
+  ASSERT_EQ("MISSING", Get("f", 5));
+  ASSERT_EQ("MISSING", Get("fooo", 5));
+}
+
+// 路径形式的键, 遍历和seek的结果应当和使用跳表时相同
+TEST_F(MemTableArtTest, Iterator) {
+  MemTable* skiplist_mem = new MemTable(cmp_);
+  skiplist_mem->ref();
+  for (int i = 0; i < 2000; i++) {
+    std::string key = "tenant" + std::to_string(i % 3) + "/table" + std::to_string(i % 7);
+    if (i % 5 != 0) {
+      key += "/row" + std::to_string(i % 101);  // 一部分键是其他键的前缀
+    }
+    ValueType type = (i % 11 == 0) ? ValueType::TypeDeletion : ValueType::TypeValue;
+    mem_->add(i + 1, type, key, std::to_string(i));
+    skiplist_mem->add(i + 1, type, key, std::to_string(i));
+  }
+
+  Iterator* iter = mem_->newIterator();
+  Iterator* expected = skiplist_mem->newIterator();
+  int count = 0;
+  for (iter->seekToFirst(), expected->seekToFirst(); expected->valid(); iter->next(), expected->next()) {
+    ASSERT_TRUE(iter->valid());
+    ASSERT_EQ(expected->key().toString(), iter->key().toString());
+    ASSERT_EQ(expected->value().toString(), iter->value().toString());
+    count++;
+  }
+  ASSERT_TRUE(!iter->valid());
+  ASSERT_EQ(2000, count);
+
+  const char* targets[] = {"tenant1/table3", "tenant1/table3/row5", "tenant2/table9", "a", "z"};
+  for (const char* target : targets) {
+    for (SequenceNumber seq : {SequenceNumber(1000), s_max_sequence_number}) {
+      InternalKey ikey(target, seq, s_value_type_for_seek);
+      iter->seek(ikey.encode());
+      expected->seek(ikey.encode());
+      ASSERT_EQ(expected->valid(), iter->valid());
+      if (expected->valid()) {
+        ASSERT_EQ(expected->key().toString(), iter->key().toString());
+        iter->prev();
+        expected->prev();
+        ASSERT_EQ(expected->valid(), iter->valid());
+        if (expected->valid()) {
+          ASSERT_EQ(expected->key().toString(), iter->key().toString());
+        }
+      }
+    }
+  }
+
+  iter->seekToLast();
+  expected->seekToLast();
+  ASSERT_EQ(expected->key().toString(), iter->key().toString());
+  delete expected;
+  delete iter;
+  skiplist_mem->unref();
+}
+
+}  // namespace kvstorage
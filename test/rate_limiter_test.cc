@@ -0,0 +1,221 @@
+#include "rate_limiter.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+
+#include "gtest/gtest.h"
+#include "options.h"
+
+namespace kvstorage {
+
+static uint64_t NowMicros() {
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+TEST(RateLimiterTest, Modify) {
+  std::unique_ptr<RateLimiter> limiter(NewGenericRateLimiter(1000000, 100 * 1000));
+  ASSERT_EQ(1000000, limiter->getBytesPerSecond());
+  ASSERT_EQ(100000, limiter->getSingleBurstBytes());
+  limiter->setBytesPerSecond(2000000);
+  ASSERT_EQ(2000000, limiter->getBytesPerSecond());
+  ASSERT_EQ(200000, limiter->getSingleBurstBytes());
+}
+
+TEST(RateLimiterTest, Rate) {
+  // 1MB/s, 每10ms补充10KB, 申请1MB大约需要1s; 第一次补充立即发生, 所以略少于1s
+  std::unique_ptr<RateLimiter> limiter(NewGenericRateLimiter(1 << 20, 10 * 1000));
+  const int64_t burst = limiter->getSingleBurstBytes();
+  uint64_t start = NowMicros();
+  for (int64_t left = 1 << 20; left > 0; left -= burst) {
+    limiter->request(std::min(left, burst), Env::IOPriority::Low);
+  }
+  uint64_t elapsed = NowMicros() - start;
+  ASSERT_GE(elapsed, 900 * 1000u);
+  ASSERT_LE(elapsed, 1500 * 1000u);
+  ASSERT_EQ(1 << 20, limiter->getTotalBytesThrough(Env::IOPriority::Low));
+  ASSERT_EQ(0, limiter->getTotalBytesThrough(Env::IOPriority::High));
+}
+
+TEST(RateLimiterTest, TotalBypasses) {
+  std::unique_ptr<RateLimiter> limiter(NewGenericRateLimiter(1000, 100 * 1000));
+  uint64_t start = NowMicros();
+  for (int i = 0; i < 1000; i++) {
+    limiter->request(limiter->getSingleBurstBytes(), Env::IOPriority::Total);
+  }
+  ASSERT_LT(NowMicros() - start, 100 * 1000u);
+  ASSERT_EQ(0, limiter->getTotalRequests());
+}
+
+// 申请的字节数可以超过单次上限, 例如调用者读取getSingleBurstBytes()之后速率被调低
+TEST(RateLimiterTest, RequestLargerThanBurst) {
+  std::unique_ptr<RateLimiter> limiter(NewGenericRateLimiter(1 << 20, 10 * 1000));
+  const int64_t burst = limiter->getSingleBurstBytes();
+  limiter->setBytesPerSecond(1 << 19);
+  ASSERT_LT(limiter->getSingleBurstBytes(), burst);
+  limiter->request(burst, Env::IOPriority::Low);
+  ASSERT_EQ(burst, limiter->getTotalBytesThrough(Env::IOPriority::Low));
+
+  // 10倍单次上限的请求在多个补充周期中得到, 512KB/s下大约需要100ms
+  const int64_t large = limiter->getSingleBurstBytes() * 10;
+  uint64_t start = NowMicros();
+  limiter->request(large, Env::IOPriority::High);
+  uint64_t elapsed = NowMicros() - start;
+  ASSERT_GE(elapsed, 80 * 1000u);
+  ASSERT_LE(elapsed, 500 * 1000u);
+  ASSERT_EQ(large, limiter->getTotalBytesThrough(Env::IOPriority::High));
+  ASSERT_EQ(2, limiter->getTotalRequests());
+}
+
+// Low和High同时排队时, 除了1/fairness的概率外都先满足High
+TEST(RateLimiterTest, HighBeforeLow) {
+  std::unique_ptr<RateLimiter> limiter(NewGenericRateLimiter(100 * 1000, 1000, 1 << 30));
+  const int64_t burst = limiter->getSingleBurstBytes();
+  std::atomic<int> low_done(0);
+  std::atomic<int> high_done(0);
+  std::atomic<int> low_done_when_high_finished(-1);
+  std::thread low([&] {
+    for (int i = 0; i < 100; i++) {
+      limiter->request(burst, Env::IOPriority::Low);
+      low_done++;
+    }
+  });
+  std::thread high([&] {
+    for (int i = 0; i < 50; i++) {
+      limiter->request(burst, Env::IOPriority::High);
+      high_done++;
+    }
+    low_done_when_high_finished = low_done.load();
+  });
+  high.join();
+  low.join();
+  // 每个周期只够一个请求, High一直排队时Low最多在High开始之前得到少量令牌
+  ASSERT_LT(low_done_when_high_finished.load(), 25);
+  ASSERT_EQ(50 * burst, limiter->getTotalBytesThrough(Env::IOPriority::High));
+  ASSERT_EQ(100 * burst, limiter->getTotalBytesThrough(Env::IOPriority::Low));
+}
+
+TEST(RateLimiterTest, AutoTune) {
+  // 上限10MB/s, 每1ms补充一次, 每10ms检查一次延迟
+  const int64_t max_rate = 10 << 20;
+  std::unique_ptr<RateLimiter> limiter(NewGenericRateLimiter(max_rate, 1000, 10, 100));
+
+  // 前台延迟高于目标时降速
+  for (int i = 0; i < 200; i++) {
+    limiter->recordForegroundLatency(1000);
+    limiter->request(limiter->getSingleBurstBytes(), Env::IOPriority::Low);
+  }
+  const int64_t slowed = limiter->getBytesPerSecond();
+  ASSERT_LT(slowed, max_rate);
+  ASSERT_GE(slowed, max_rate / 20);
+
+  // 前台延迟恢复, 后台I/O仍然被限速时逐步提速
+  for (int i = 0; i < 2000 && limiter->getBytesPerSecond() < max_rate; i++) {
+    limiter->recordForegroundLatency(10);
+    limiter->request(limiter->getSingleBurstBytes(), Env::IOPriority::Low);
+  }
+  ASSERT_EQ(max_rate, limiter->getBytesPerSecond());
+
+  // 自动调整时setBytesPerSecond设置上限
+  limiter->setBytesPerSecond(max_rate / 2);
+  ASSERT_EQ(max_rate / 2, limiter->getBytesPerSecond());
+}
+
+// 通过EnvOptions打开的文件在读写前申请令牌
+TEST(RateLimiterTest, RateLimitedFiles) {
+  Env* env = Env::defaultEnv();
+  std::string test_dir;
+  ASSERT_TRUE(env->getTestDirectory(&test_dir).ok());
+  const std::string fname = test_dir + "/rate_limited.txt";
+
+  std::unique_ptr<RateLimiter> limiter(NewGenericRateLimiter(64 << 20, 1000));
+  Options options;
+  options.rate_limiter = limiter.get();
+  EnvOptions env_options = EnvOptionsForFlushAndCompaction(options, Env::IOPriority::High);
+
+  WritableFile* file;
+  ASSERT_TRUE(env->newWritableFile(fname, env_options, &file).ok());
+  const std::string data(1 << 20, 'x');  // 大于单次上限, 拆成多次申请
+  ASSERT_TRUE(file->append(data).ok());
+  ASSERT_TRUE(file->close().ok());
+  delete file;
+  ASSERT_EQ(1 << 20, limiter->getTotalBytesThrough(Env::IOPriority::High));
+
+  env_options = EnvOptionsForFlushAndCompaction(options);
+  RandomAccessFile* random_access_file;
+  ASSERT_TRUE(env->newRandomAccessFile(fname, env_options, &random_access_file).ok());
+  std::string scratch(4096, '\0');
+  Slice result;
+  ASSERT_TRUE(random_access_file->read(4096, 4096, &result, &scratch[0]).ok());
+  ASSERT_EQ(data.substr(0, 4096), result.toString());
+  delete random_access_file;
+  ASSERT_EQ(4096, limiter->getTotalBytesThrough(Env::IOPriority::Low));
+
+  // 前台读取不限速
+  ASSERT_TRUE(env->newRandomAccessFile(fname, EnvOptions(options), &random_access_file).ok());
+  ASSERT_TRUE(random_access_file->read(0, 4096, &result, &scratch[0]).ok());
+  delete random_access_file;
+  ASSERT_EQ(4096, limiter->getTotalBytesThrough(Env::IOPriority::Low));
+  ASSERT_TRUE(env->removeFile(fname).ok());
+}
+
+// 只统计写入的字节数
+class CountingWritableFile : public WritableFile {
+ public:
+  Status append(const Slice& data) override {
+    bytes_ += data.size();
+    return Status::success();
+  }
+  Status close() override { return Status::success(); }
+  Status flush() override { return Status::success(); }
+  Status sync() override { return Status::success(); }
+
+  uint64_t bytes_ = 0;
+};
+
+// 每次读取单次上限之后立即在高低两个速率之间切换, 模拟append()拆分之后, 申请令牌之前速率被其他线程调整
+class RateSwitchingLimiter : public RateLimiter {
+ public:
+  RateSwitchingLimiter(RateLimiter* target, int64_t low_rate, int64_t high_rate)
+      : switches_(0), target_(target), low_rate_(low_rate), high_rate_(high_rate) {}
+
+  void setBytesPerSecond(int64_t bytes_per_second) override { target_->setBytesPerSecond(bytes_per_second); }
+  int64_t getBytesPerSecond() const override { return target_->getBytesPerSecond(); }
+  void request(int64_t bytes, Env::IOPriority pri) override { target_->request(bytes, pri); }
+  int64_t getSingleBurstBytes() const override {
+    const int64_t burst = target_->getSingleBurstBytes();
+    target_->setBytesPerSecond(switches_++ % 2 == 0 ? low_rate_ : high_rate_);
+    return burst;
+  }
+  int64_t getTotalBytesThrough(Env::IOPriority pri) const override { return target_->getTotalBytesThrough(pri); }
+  int64_t getTotalRequests(Env::IOPriority pri) const override { return target_->getTotalRequests(pri); }
+  void recordForegroundLatency(uint64_t micros) override { target_->recordForegroundLatency(micros); }
+
+  mutable int switches_;
+
+ private:
+  RateLimiter* const target_;
+  const int64_t low_rate_;
+  const int64_t high_rate_;
+};
+
+// append()按单次上限拆分之后速率被调低, 拆分出的部分超过新的单次上限, 写入的字节仍然全部计入限速
+TEST(RateLimiterTest, SetRateDuringAppend) {
+  const int64_t high_rate = 100 << 20;
+  std::unique_ptr<RateLimiter> target(NewGenericRateLimiter(high_rate, 1000));
+  RateSwitchingLimiter limiter(target.get(), high_rate / 10, high_rate);
+  CountingWritableFile* counter = new CountingWritableFile;
+  std::unique_ptr<WritableFile> file(NewRateLimitedWritableFile(counter, &limiter, Env::IOPriority::Low));
+
+  const std::string data(4 << 20, 'x');
+  ASSERT_TRUE(file->append(data).ok());
+  ASSERT_GT(limiter.switches_, 2);
+  ASSERT_EQ(data.size(), counter->bytes_);
+  ASSERT_EQ(static_cast<int64_t>(data.size()), target->getTotalBytesThrough(Env::IOPriority::Low));
+}
+
+}  // namespace kvstorage
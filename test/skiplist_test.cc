@@ -1,16 +1,21 @@
 #include "skiplist.h"
 
 #include <atomic>
+#include <cassert>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
 #include <set>
+#include <thread>
+#include <vector>
 
+#include "env.h"
 #include "gtest/gtest.h"
-// #include "leveldb/env.h"
-// #include "port/port.h"
-// #include "port/thread_annotations.h"
 #include "util/arena.h"
+#include "util/concurrent_arena.h"
 #include "util/hash.h"
 #include "util/random.h"
-#include "util/testutil.h"
 
 namespace kvstorage {
 
@@ -121,6 +126,178 @@ TEST(SkipTest, InsertAndLookup) {
   }
 }
 
+// 比较器提供keyPrefix时结点缓存前缀, 前缀只取高位, 大量结点前缀相同, 需要回退到完整比较
+struct PrefixComparator : public Comparator {
+  uint64_t keyPrefix(const Key& key) const { return key >> 8; }
+};
+
+TEST(SkipTest, KeyPrefix) {
+  static_assert(HasKeyPrefix<PrefixComparator, Key>::value, "");
+  static_assert(!HasKeyPrefix<Comparator, Key>::value, "");
+  const int N = 5000;
+  Random rnd(1000);
+  std::set<Key> keys;
+  Arena arena;
+  SkipList<Key, PrefixComparator> list(PrefixComparator(), &arena);
+  for (int i = 0; i < N; i++) {
+    Key key = rnd.uniform(N * 4);
+    if (keys.insert(key).second) {
+      if (rnd.oneIn(2)) {
+        list.insert(key);
+      } else {
+        list.insertWithHint(key);
+      }
+    }
+  }
+  for (Key k = 0; k < N * 4; k++) {
+    ASSERT_EQ(keys.count(k) == 1, list.contains(k)) << k;
+  }
+
+  SkipList<Key, PrefixComparator>::Iterator iter(&list);
+  iter.seekToLast();
+  for (auto it = keys.rbegin(); it != keys.rend(); ++it) {
+    ASSERT_TRUE(iter.valid());
+    ASSERT_EQ(*it, iter.key());
+    iter.prev();
+  }
+  ASSERT_TRUE(!iter.valid());
+  for (int i = 0; i < 100; i++) {
+    Key target = rnd.uniform(N * 4);
+    iter.seek(target);
+    auto model = keys.lower_bound(target);
+    if (model == keys.end()) {
+      ASSERT_TRUE(!iter.valid());
+    } else {
+      ASSERT_TRUE(iter.valid());
+      ASSERT_EQ(*model, iter.key());
+    }
+  }
+}
+
+// 顺序追加时insertWithHint每次都应该复用上一次插入的前驱, 乱序插入时结果仍然正确
+TEST(SkipTest, InsertWithHint) {
+  Arena arena;
+  Comparator cmp;
+  SkipList<Key, Comparator> list(cmp, &arena);
+  std::set<Key> keys;
+  const int N = 10000;
+  for (int i = 0; i < N; i++) {
+    Key key = static_cast<Key>(i) * 10;
+    list.insertWithHint(key);
+    keys.insert(key);
+  }
+  ASSERT_EQ(N - 1, list.hintHits());  // 第一次插入时没有可用的前驱
+  ASSERT_EQ(1, list.hintMisses());
+
+  // 在已有键之间乱序插入, 并混合使用insert()
+  Random rnd(301);
+  for (int i = 0; i < N; i++) {
+    Key key = rnd.uniform(N * 10);
+    if (keys.insert(key).second) {
+      if (rnd.oneIn(2)) {
+        list.insertWithHint(key);
+      } else {
+        list.insert(key);
+      }
+    }
+  }
+  ASSERT_GT(list.hintMisses(), 1);
+
+  SkipList<Key, Comparator>::Iterator iter(&list);
+  iter.seekToFirst();
+  for (Key k : keys) {
+    ASSERT_TRUE(iter.valid());
+    ASSERT_EQ(k, iter.key());
+    iter.next();
+  }
+  ASSERT_TRUE(!iter.valid());
+  for (Key k = 0; k < N * 10; k++) {
+    ASSERT_EQ(keys.count(k) == 1, list.contains(k)) << k;
+  }
+}
+
+// 保存后向指针的跳表, 反向遍历的结果应当与std::set相同
+TEST(SkipTest, ReverseIteration) {
+  Arena arena;
+  Comparator cmp;
+  SkipList<Key, Comparator, Arena, true> list(cmp, &arena);
+  SkipList<Key, Comparator, Arena, true>::Iterator iter(&list);
+  iter.seekToLast();
+  ASSERT_TRUE(!iter.valid());
+
+  std::set<Key> keys;
+  Random rnd(301);
+  for (int i = 0; i < 5000; i++) {
+    Key key = rnd.uniform(100000);
+    if (keys.insert(key).second) {
+      if (rnd.oneIn(2)) {
+        list.insertWithHint(key);
+      } else {
+        list.insert(key);
+      }
+    }
+  }
+
+  iter.seekToLast();
+  for (std::set<Key>::reverse_iterator it = keys.rbegin(); it != keys.rend(); ++it) {
+    ASSERT_TRUE(iter.valid());
+    ASSERT_EQ(*it, iter.key());
+    iter.prev();
+  }
+  ASSERT_TRUE(!iter.valid());
+  ASSERT_TRUE(list.verifyBackLinks());
+
+  // seek之后前后交替移动
+  for (int i = 0; i < 1000; i++) {
+    Key target = rnd.uniform(100000);
+    std::set<Key>::iterator model = keys.lower_bound(target);
+    iter.seek(target);
+    if (model == keys.end() || model == keys.begin()) {
+      continue;
+    }
+    iter.prev();
+    ASSERT_TRUE(iter.valid());
+    ASSERT_EQ(*std::prev(model), iter.key());
+    iter.next();
+    ASSERT_EQ(*model, iter.key());
+  }
+}
+
+// seekBatch的结果应当与逐个seek相同, 批量大小超过每轮交错的上限时也是如此
+TEST(SkipTest, SeekBatch) {
+  Arena arena;
+  Comparator cmp;
+  SkipList<Key, Comparator> list(cmp, &arena);
+  std::set<Key> keys;
+  Random rnd(301);
+  for (int i = 0; i < 5000; i++) {
+    Key key = rnd.uniform(100000);
+    if (keys.insert(key).second) {
+      list.insert(key);
+    }
+  }
+
+  const int kBatch = 37;
+  Key targets[kBatch];
+  std::vector<SkipList<Key, Comparator>::Iterator> iters(kBatch, SkipList<Key, Comparator>::Iterator(&list));
+  for (int round = 0; round < 100; round++) {
+    const int n = 1 + rnd.uniform(kBatch);
+    for (int i = 0; i < n; i++) {
+      targets[i] = rnd.uniform(100010);  // 包括超过最大键的目标
+    }
+    list.seekBatch(targets, n, iters.data());
+    for (int i = 0; i < n; i++) {
+      std::set<Key>::iterator model = keys.lower_bound(targets[i]);
+      if (model == keys.end()) {
+        ASSERT_TRUE(!iters[i].valid());
+      } else {
+        ASSERT_TRUE(iters[i].valid());
+        ASSERT_EQ(*model, iters[i].key());
+      }
+    }
+  }
+}
+
 // We want to make sure that with a single writer and multiple
 // concurrent readers (with no synchronization other than when a
 // reader's iterator is created), the reader always observes all the
@@ -170,7 +347,7 @@ class ConcurrentTest {
   }
 
   static Key RandomTarget(Random* rnd) {
-    switch (rnd->Next() % 10) {
+    switch (rnd->next() % 10) {
       case 0:
         // Seek to beginning
         return MakeKey(0, 0);
@@ -179,7 +356,7 @@ class ConcurrentTest {
         return MakeKey(K, 0);
       default:
         // Seek to middle
-        return MakeKey(rnd->Next() % K, 0);
+        return MakeKey(rnd->next() % K, 0);
     }
   }
 
@@ -212,10 +389,10 @@ class ConcurrentTest {
 
   // REQUIRES: External synchronization
   void WriteStep(Random* rnd) {
-    const uint32_t k = rnd->Next() % K;
+    const uint32_t k = rnd->next() % K;
     const intptr_t g = current_.Get(k) + 1;
     const Key key = MakeKey(k, g);
-    list_.Insert(key);
+    list_.insert(key);
     current_.Set(k, g);
   }
 
@@ -228,10 +405,10 @@ class ConcurrentTest {
 
     Key pos = RandomTarget(rnd);
     SkipList<Key, Comparator>::Iterator iter(&list_);
-    iter.Seek(pos);
+    iter.seek(pos);
     while (true) {
       Key current;
-      if (!iter.Valid()) {
+      if (!iter.valid()) {
         current = MakeKey(K, 0);
       } else {
         current = iter.key();
@@ -259,18 +436,18 @@ class ConcurrentTest {
         }
       }
 
-      if (!iter.Valid()) {
+      if (!iter.valid()) {
         break;
       }
 
-      if (rnd->Next() % 2) {
-        iter.Next();
+      if (rnd->next() % 2) {
+        iter.next();
         pos = MakeKey(key(pos), gen(pos) + 1);
       } else {
         Key new_target = RandomTarget(rnd);
         if (new_target > pos) {
           pos = new_target;
-          iter.Seek(new_target);
+          iter.seek(new_target);
         }
       }
     }
@@ -280,11 +457,21 @@ class ConcurrentTest {
 // Needed when building in C++11 mode.
 constexpr uint32_t ConcurrentTest::K;
 
+// 环境变量TEST_RANDOM_SEED可以指定随机种子, 用于复现失败
+static int RandomSeed() {
+  const char* env = std::getenv("TEST_RANDOM_SEED");
+  int result = (env != nullptr ? std::atoi(env) : 301);
+  if (result <= 0) {
+    result = 301;
+  }
+  return result;
+}
+
 // Simple test that does single-threaded testing of the ConcurrentTest
 // scaffolding.
 TEST(SkipTest, ConcurrentWithoutThreads) {
   ConcurrentTest test;
-  Random rnd(test::RandomSeed());
+  Random rnd(RandomSeed());
   for (int i = 0; i < 10000; i++) {
     test.ReadStep(&rnd);
     test.WriteStep(&rnd);
@@ -299,28 +486,23 @@ class TestState {
 
   enum ReaderState { STARTING, RUNNING, DONE };
 
-  explicit TestState(int s)
-      : seed_(s), quit_flag_(false), state_(STARTING), state_cv_(&mu_) {}
+  explicit TestState(int s) : seed_(s), quit_flag_(false), state_(STARTING) {}
 
-  void Wait(ReaderState s) LOCKS_EXCLUDED(mu_) {
-    mu_.Lock();
-    while (state_ != s) {
-      state_cv_.Wait();
-    }
-    mu_.Unlock();
+  void Wait(ReaderState s) {
+    std::unique_lock<std::mutex> lock(mu_);
+    state_cv_.wait(lock, [this, s] { return state_ == s; });
   }
 
-  void Change(ReaderState s) LOCKS_EXCLUDED(mu_) {
-    mu_.Lock();
+  void Change(ReaderState s) {
+    std::lock_guard<std::mutex> lock(mu_);
     state_ = s;
-    state_cv_.Signal();
-    mu_.Unlock();
+    state_cv_.notify_one();
   }
 
  private:
-  port::Mutex mu_;
-  ReaderState state_ GUARDED_BY(mu_);
-  port::CondVar state_cv_ GUARDED_BY(mu_);
+  std::mutex mu_;
+  ReaderState state_;  // 由mu_保护
+  std::condition_variable state_cv_;
 };
 
 static void ConcurrentReader(void* arg) {
@@ -336,7 +518,7 @@ static void ConcurrentReader(void* arg) {
 }
 
 static void RunConcurrent(int run) {
-  const int seed = test::RandomSeed() + (run * 100);
+  const int seed = RandomSeed() + (run * 100);
   Random rnd(seed);
   const int N = 1000;
   const int kSize = 1000;
@@ -345,7 +527,7 @@ static void RunConcurrent(int run) {
       std::fprintf(stderr, "Run %d of %d\n", i, N);
     }
     TestState state(seed + 1);
-    Env::Default()->Schedule(ConcurrentReader, &state);
+    Env::defaultEnv()->schedule(ConcurrentReader, &state);
     state.Wait(TestState::RUNNING);
     for (int i = 0; i < kSize; i++) {
       state.t_.WriteStep(&rnd);
@@ -361,4 +543,112 @@ TEST(SkipTest, Concurrent3) { RunConcurrent(3); }
 TEST(SkipTest, Concurrent4) { RunConcurrent(4); }
 TEST(SkipTest, Concurrent5) { RunConcurrent(5); }
 
-}  // namespace leveldb
+// 多个写线程通过concurrentInsert交错插入互不相同的键, 同时一个读线程不断检查
+// 正向遍历的结果严格递增; 写入结束后检查所有键都可以查到且没有丢失
+TEST(SkipTest, ConcurrentInsertMultiWriter) {
+  const int kWriters = 8;
+  const int kPerWriter = 5000;
+  ConcurrentArena arena;
+  Comparator cmp;
+  SkipList<Key, Comparator, ConcurrentArena> list(cmp, &arena);
+
+  std::atomic<bool> done(false);
+  std::thread reader([&] {
+    while (!done.load(std::memory_order_acquire)) {
+      SkipList<Key, Comparator, ConcurrentArena>::Iterator iter(&list);
+      iter.seekToFirst();
+      Key last = 0;
+      bool first = true;
+      for (; iter.valid(); iter.next()) {
+        EXPECT_TRUE(first || last < iter.key());
+        last = iter.key();
+        first = false;
+      }
+    }
+  });
+
+  std::vector<std::thread> writers;
+  for (int t = 0; t < kWriters; t++) {
+    writers.emplace_back([&list, t] {
+      // 每个写线程打乱自己的插入顺序, 使各线程在同一区间内竞争
+      std::vector<Key> keys;
+      for (int i = 0; i < kPerWriter; i++) {
+        keys.push_back(static_cast<Key>(i) * kWriters + t);
+      }
+      Random rnd(301 + t);
+      for (int i = kPerWriter - 1; i > 0; i--) {
+        std::swap(keys[i], keys[rnd.uniform(i + 1)]);
+      }
+      for (Key k : keys) {
+        list.concurrentInsert(k);
+      }
+    });
+  }
+  for (auto& w : writers) {
+    w.join();
+  }
+  done.store(true, std::memory_order_release);
+  reader.join();
+
+  const Key total = static_cast<Key>(kWriters) * kPerWriter;
+  for (Key k = 0; k < total; k++) {
+    ASSERT_TRUE(list.contains(k)) << k;
+  }
+  ASSERT_TRUE(!list.contains(total));
+
+  SkipList<Key, Comparator, ConcurrentArena>::Iterator iter(&list);
+  iter.seekToFirst();
+  for (Key k = 0; k < total; k++) {
+    ASSERT_TRUE(iter.valid());
+    ASSERT_EQ(k, iter.key());
+    iter.next();
+  }
+  ASSERT_TRUE(!iter.valid());
+
+  iter.seekToLast();
+  ASSERT_TRUE(iter.valid());
+  ASSERT_EQ(total - 1, iter.key());
+}
+
+// 多个写线程并发插入后, 每个结点的后向指针都应当指向它在最底层的直接前驱
+TEST(SkipTest, ConcurrentInsertReverse) {
+  const int kWriters = 4;
+  const int kPerWriter = 5000;
+  ConcurrentArena arena;
+  Comparator cmp;
+  SkipList<Key, Comparator, ConcurrentArena, true> list(cmp, &arena);
+
+  std::vector<std::thread> writers;
+  for (int t = 0; t < kWriters; t++) {
+    writers.emplace_back([&list, t] {
+      Random rnd(1000 + t);
+      for (int i = 0; i < kPerWriter; i++) {
+        // 各线程的键交错分布, 并发地修改相邻结点的后向指针
+        list.concurrentInsert(static_cast<Key>(rnd.uniform(kPerWriter)) * kWriters * kPerWriter +
+                              static_cast<Key>(i) * kWriters + t);
+      }
+    });
+  }
+  for (auto& w : writers) {
+    w.join();
+  }
+
+  // prev()会沿最底层向后修正过时的后向指针, 只检查遍历结果无法发现后向指针错误, 所以直接检查每个结点
+  ASSERT_TRUE(list.verifyBackLinks());
+
+  std::vector<Key> forward;
+  SkipList<Key, Comparator, ConcurrentArena, true>::Iterator iter(&list);
+  for (iter.seekToFirst(); iter.valid(); iter.next()) {
+    forward.push_back(iter.key());
+  }
+  ASSERT_EQ(static_cast<size_t>(kWriters) * kPerWriter, forward.size());
+  iter.seekToLast();
+  for (auto it = forward.rbegin(); it != forward.rend(); ++it) {
+    ASSERT_TRUE(iter.valid());
+    ASSERT_EQ(*it, iter.key());
+    iter.prev();
+  }
+  ASSERT_TRUE(!iter.valid());
+}
+
+}  // namespace kvstorage
@@ -96,6 +96,49 @@ TEST_F(SliceTest, EdgeCases) {
     EXPECT_EQ(with_null.size(), 11);
 }
 
+static void CountRelease(void* arg1, void* arg2) {
+    (*static_cast<int*>(arg1)) += *static_cast<int*>(arg2);
+}
+
+// 引用外部内存时不复制, 释放函数在reset()或析构时调用
+TEST(PinnableSliceTest, PinAndRelease) {
+    std::string external = "external value";
+    int released = 0;
+    int one = 1;
+    {
+        PinnableSlice value;
+        value.pinSlice(external, &CountRelease, &released, &one);
+        EXPECT_TRUE(value.isPinned());
+        EXPECT_EQ(external.data(), value.data());
+        EXPECT_EQ("external value", value.toString());
+        EXPECT_EQ(0, released);
+
+        value.reset();
+        EXPECT_EQ(1, released);
+        EXPECT_TRUE(!value.isPinned());
+        EXPECT_TRUE(value.empty());
+
+        // 重置后可以再次引用, 多个释放函数都会被调用
+        value.pinSlice(external, &CountRelease, &released, &one);
+        value.registerCleanup(&CountRelease, &released, &one);
+    }
+    EXPECT_EQ(3, released);
+}
+
+TEST(PinnableSliceTest, PinSelf) {
+    std::string buf;
+    PinnableSlice value(&buf);
+    value.pinSelf(Slice("copied"));
+    EXPECT_TRUE(!value.isPinned());
+    EXPECT_EQ("copied", value.toString());
+    EXPECT_EQ(buf.data(), value.data());
+
+    value.reset();
+    value.getSelf()->assign("written");
+    value.pinSelf();
+    EXPECT_EQ("written", value.toString());
+}
+
 // 测试异常情况
 TEST_F(SliceTest, ExceptionCases) {
     // 测试越界访问是否会触发断言
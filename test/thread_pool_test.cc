@@ -0,0 +1,141 @@
+#include "util/thread_pool.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#include "gtest/gtest.h"
+
+namespace kvstorage {
+
+// 阻塞线程池中的线程, 直到release()
+struct Gate {
+  std::mutex mu;
+  std::condition_variable cv;
+  bool open = false;
+  int entered = 0;
+
+  static void Wait(void* arg) {
+    Gate* gate = static_cast<Gate*>(arg);
+    std::unique_lock<std::mutex> l(gate->mu);
+    gate->entered++;
+    gate->cv.notify_all();
+    gate->cv.wait(l, [gate] { return gate->open; });
+  }
+
+  void waitEntered(int n) {
+    std::unique_lock<std::mutex> l(mu);
+    cv.wait(l, [this, n] { return entered >= n; });
+  }
+
+  void release() {
+    std::lock_guard<std::mutex> l(mu);
+    open = true;
+    cv.notify_all();
+  }
+};
+
+static void Increment(void* arg) { static_cast<std::atomic<int>*>(arg)->fetch_add(1); }
+
+TEST(ThreadPoolTest, RunsAllJobsBeforeDestruction) {
+  std::atomic<int> count(0);
+  {
+    ThreadPool pool(4);
+    for (int i = 0; i < 1000; i++) {
+      pool.schedule(&Increment, &count, nullptr, nullptr);
+    }
+  }
+  ASSERT_EQ(1000, count.load());
+}
+
+TEST(ThreadPoolTest, Unschedule) {
+  std::atomic<int> count(0);
+  Gate gate;
+  int tag_a;
+  int tag_b;
+  {
+    ThreadPool pool(1);
+    pool.schedule(&Gate::Wait, &gate, nullptr, nullptr);
+    gate.waitEntered(1);
+
+    // 唯一的线程被阻塞, 以下任务都在队列中
+    for (int i = 0; i < 10; i++) {
+      pool.schedule(&Increment, &count, (i % 2 == 0) ? &tag_a : &tag_b, nullptr);
+    }
+    pool.schedule(&Increment, &count, &tag_a, [](void* arg) { static_cast<std::atomic<int>*>(arg)->fetch_add(100); });
+
+    ThreadPoolStats stats;
+    pool.getStats(&stats);
+    ASSERT_EQ(11u, stats.queue_len);
+
+    ASSERT_EQ(6, pool.unschedule(&tag_a));
+    ASSERT_EQ(0, pool.unschedule(&tag_a));
+    ASSERT_EQ(0, pool.unschedule(nullptr));
+    ASSERT_EQ(100, count.load());  // 只有最后一个任务有unschedule_function
+
+    pool.getStats(&stats);
+    ASSERT_EQ(5u, stats.queue_len);
+    ASSERT_EQ(6u, stats.unscheduled);
+    gate.release();
+  }
+  ASSERT_EQ(105, count.load());  // tag_b的5个任务在析构前执行
+}
+
+TEST(ThreadPoolTest, WaitStats) {
+  Gate gate;
+  std::atomic<int> count(0);
+  ThreadPool pool(1);
+  pool.schedule(&Gate::Wait, &gate, nullptr, nullptr);
+  gate.waitEntered(1);
+  pool.schedule(&Increment, &count, nullptr, nullptr);
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  gate.release();
+  while (count.load() == 0) {
+    std::this_thread::yield();
+  }
+
+  ThreadPoolStats stats;
+  pool.getStats(&stats);
+  ASSERT_EQ(1, stats.threads);
+  ASSERT_EQ(0u, stats.queue_len);
+  ASSERT_EQ(2u, stats.scheduled);
+  ASSERT_EQ(2u, stats.run);
+  ASSERT_GE(stats.max_wait_micros, 20000u);  // 第二个任务至少等待了20ms
+  ASSERT_GE(stats.total_wait_micros, stats.max_wait_micros);
+}
+
+TEST(ThreadPoolTest, ResizeThreads) {
+  Gate gate;
+  ThreadPool pool(1);
+  pool.setBackgroundThreads(4);
+  ASSERT_EQ(4, pool.getBackgroundThreads());
+  for (int i = 0; i < 4; i++) {
+    pool.schedule(&Gate::Wait, &gate, nullptr, nullptr);
+  }
+  gate.waitEntered(4);  // 4个任务同时执行
+  gate.release();
+
+  // 减少到1个线程后任务仍然全部执行
+  pool.setBackgroundThreads(0);
+  ASSERT_EQ(1, pool.getBackgroundThreads());
+  std::atomic<int> count(0);
+  for (int i = 0; i < 100; i++) {
+    pool.schedule(&Increment, &count, nullptr, nullptr);
+  }
+  while (count.load() < 100) {
+    std::this_thread::yield();
+  }
+
+  // 再次增加时, 队列中已有的任务会启动新线程
+  Gate gate2;
+  pool.schedule(&Gate::Wait, &gate2, nullptr, nullptr);
+  gate2.waitEntered(1);
+  pool.schedule(&Gate::Wait, &gate2, nullptr, nullptr);
+  pool.setBackgroundThreads(2);
+  gate2.waitEntered(2);
+  gate2.release();
+}
+
+}  // namespace kvstorage